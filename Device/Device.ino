@@ -6,6 +6,7 @@
 #include <PubSubClient.h> // Include the PubSubClient library
 #include <WiFi.h>
 #include <ArduinoJson.h>
+#include "radar_gates.h"
 
 // const char* ssid = "Highlands Coffee";
 // const char* password = "M.le@0911"; // Replace with your WiFi password
@@ -41,6 +42,88 @@ ld2410 radar;
 uint32_t lastReading = 0;
 bool radarConnected = false;
 
+// --- Gate energies ---
+// The radar runs in engineering mode and loop() parses its frames itself
+// (radar_gates.h): the library keeps only the target fields, the gate
+// energies give up to GATE_PEAKS_MAX ranges per reading. Radars that stay in
+// basic mode still work, with the moving and stationary target as candidates.
+const uint32_t RADAR_TIMEOUT_MS = 1000; // No frame for this long: radar disconnected
+GateParser gateParser;
+GateFrame gateFrame = {};
+GatePeakConfig gatePeakConfig;
+GatePeak peaks[GATE_PEAKS_MAX];
+int peakCount = 0;
+unsigned long lastFrameAt = 0;
+
+// --- Event loop timing ---
+// loop() handles due work and then blocks until the radar UART has data or the
+// next timer is due, so the CPU idles between frames instead of spinning.
+const uint32_t READING_INTERVAL_MS = 150;  // Radar sample
+const uint32_t RECONNECT_INTERVAL_MS = 3000;
+const uint32_t CONNECT_TIMEOUT_S = 1;      // Bounds the TCP connect and CONNACK wait of one attempt
+unsigned long lastReconnectAttempt = 0;
+TaskHandle_t loopTaskHandle = nullptr;
+data radar_data = { 0, 0, 0, 0 };
+
+// --- Offline buffer ---
+// Readings published while the broker is unreachable are kept here (the oldest
+// is overwritten when full) and flushed on reconnect with their age in ms, so
+// a receiver can tell them from live ones.
+const int BUFFER_SIZE = 32; // 19 s at one reading per 600 ms
+struct reading {
+  uint32_t takenAt; // millis()
+  int16_t d;
+  int16_t c[GATE_PEAKS_MAX]; // Candidate ranges and their energies, see take_reading()
+  uint8_t ce[GATE_PEAKS_MAX];
+  uint8_t count;
+  uint8_t me;       // Moving and stationary target energy, for the central node's motion state
+  uint8_t se;
+};
+reading buffered[BUFFER_SIZE];
+int bufferHead = 0; // Oldest entry
+int bufferCount = 0;
+
+// --- TDMA ---
+// The central node publishes a transmit schedule on TDMA_TOPIC every few
+// seconds (format in the central node's tdma.h). While it lists this id, the
+// reading is taken at the start of this zone's group, together with the
+// zone's other two sensors, and sent in this sensor's own slot of the frame
+// instead of on the free-running interval. A schedule puts the frame start
+// at its arrival time minus the hub's phase "o". Delivery delay (modem sleep
+// holds frames until the next beacon) only ever makes that late, so the
+// earliest estimate of the last TDMA_WINDOW schedules is used; as old ones
+// drop out of the window, drift between the two clocks is followed too.
+const char* TDMA_TOPIC = "/central/tdma";
+const uint32_t TDMA_TIMEOUT_MS = 16000; // About three schedules missed: back to the free-running interval
+const int TDMA_WINDOW = 4;
+unsigned long tdmaStarts[TDMA_WINDOW]; // Frame start estimates of the last schedules
+int tdmaStartCount = 0;
+int tdmaStartNext = 0;
+bool tdmaActive = false;
+unsigned long tdmaHeardAt = 0;    // millis() of the last schedule
+unsigned long tdmaFrameStart = 0; // millis() at the start of some frame
+unsigned long tdmaFrameMs = 0;
+unsigned long tdmaMeasureOffset = 0; // ms into the frame: this zone's group
+unsigned long tdmaSendDelay = 0;     // ms from the measurement to this sensor's slot
+unsigned long nextMeasureAt = 0;
+unsigned long nextSendAt = 0;
+bool slotPending = false;            // Measured, waiting for the slot
+reading slotReading;
+
+void wait_for_event();
+void sample_radar();
+void on_schedule(const byte* payload, unsigned int length);
+void tdma_step(unsigned long now);
+reading take_reading(unsigned long now);
+bool send_reading(const reading& r, unsigned long age);
+void publish_reading(const reading& r);
+void flush_buffer();
+
+// UART receive callback, runs in the UART event task
+void onRadarData() {
+  if (loopTaskHandle) xTaskNotifyGive(loopTaskHandle);
+}
+
 void setup(void) {
   //Setup Radar
   Serial.begin(115200);  // Feedback over Serial Monitor
@@ -60,48 +143,66 @@ void setup(void) {
   Serial.print(radar.firmware_minor_version);
   Serial.print('.');
   Serial.println(radar.firmware_bugfix_version, HEX);
+  if (radar.requestStartEngineeringMode()) {
+    Serial.println(F("LD2410 engineering mode: ranges from gate energies."));
+  } else {
+    Serial.println(F("LD2410 engineering mode not available, target ranges only."));
+  }
+
+  // Wake loop() when radar bytes arrive
+  loopTaskHandle = xTaskGetCurrentTaskHandle();
+  RADAR_SERIAL.onReceive(onRadarData);
+
+  // 80 MHz is the lowest clock Wi-Fi runs at; modem sleep powers the radio
+  // down between beacons
+  setCpuFrequencyMhz(80);
 
-  // Connect to WiFi network
+  // Connect to WiFi network; the station keeps reconnecting on its own and
+  // loop() starts working right away
+  WiFi.mode(WIFI_STA);
+  WiFi.setSleep(true);
+  WiFi.setAutoReconnect(true);
   WiFi.begin(ssid, password);
-  while (WiFi.status() != WL_CONNECTED) {
-    delay(500);
-    Serial.print(".");
-  }
-  Serial.println("Connected to WiFi!");
 
-  // Connect to MQTT server
+  // MQTT connects from loop() once WiFi is up
+  espClient.setTimeout(CONNECT_TIMEOUT_S);
+  client.setSocketTimeout(CONNECT_TIMEOUT_S);
   client.setServer(mqtt_server, mqtt_port);
   client.setCallback(callback); // Set callback function for incoming messages (optional)
-  while (!client.connected()) {
-    reconnectMQTT();
-    delay(5000);
-  }
-  Serial.println("Connected to MQTT!");
+  client.setBufferSize(512);    // Room for the TDMA schedule of a hub with dozens of sensors
+  lastReconnectAttempt = millis() - RECONNECT_INTERVAL_MS;
 }
 
 void loop() {
-  if (!client.connected()) {
-    reconnectMQTT();
+  // Radar frames arrive on the UART; parse whatever is there
+  while (RADAR_SERIAL.available()) {
+    if (gate_parser_feed(gateParser, RADAR_SERIAL.read(), gateFrame)) lastFrameAt = millis();
   }
-  client.loop(); // Keep client connected
 
-  // // Publish "Hello" message every 5 seconds
-  // static unsigned long lastMillis = 0;
-  // if (millis() - lastMillis >= 5000) {
-  //   client.publish("//message/clients", "Hello");
-  //   Serial.println("Sent 'Hello' to Broker!");
-  //   lastMillis = millis();
-  // }
-  data radar_data = get_data();
-  if (abs(radar_data.Md - radar_data.Sd) <= 15){
-    d = (radar_data.Md + radar_data.Sd)/2;
-    x = d;
+  unsigned long now = millis();
+  if (now - lastReading >= READING_INTERVAL_MS) {
+    lastReading = now;
+    sample_radar();
   }
-  else if (abs(radar_data.Sd - x) <= 25){
-    d = (x + radar_data.Sd)/2;
+
+  if (client.connected()) {
+    client.loop(); // Keep client connected
+  } else if (now - lastReconnectAttempt >= RECONNECT_INTERVAL_MS) {
+    lastReconnectAttempt = now;
+    reconnectMQTT();
   }
-  if (millis() - previousMillis >= interval) {
-    previousMillis = millis();
+
+  if (tdmaActive && now - tdmaHeardAt > TDMA_TIMEOUT_MS) {
+    tdmaActive = false;
+    slotPending = false;
+    previousMillis = now;
+    Serial.println("TDMA schedule lost, free-running again.");
+  }
+
+  if (tdmaActive) {
+    tdma_step(now);
+  } else if (now - previousMillis >= interval) {
+    previousMillis = now;
     Serial.print("Md: ");
     Serial.println(radar_data.Md);
     Serial.print("Me: ");
@@ -113,42 +214,226 @@ void loop() {
     Serial.print("d: ");
     Serial.println(d);
 
-    // Convert radar data to JSON format
-    StaticJsonDocument<200> doc;
-    // doc["Md"] = radar_data.Md;
-    // doc["Me"] = radar_data.Me;
-    // doc["Sd"] = radar_data.Sd;
-    // doc["Se"] = radar_data.Se;
-    doc["id"] = id;
-    doc["d"] = d;
-
-    // Serialize JSON to a char array
-    char buffer[256];
-    serializeJson(doc, buffer);
-
-    // Publish radar data to MQTT server
-    client.publish("/node/central", buffer);
+    publish_reading(take_reading(now));
+    d = 0;
+  }
+
+  wait_for_event();
+}
+
+// Blocks until the radar UART has data or the next timer is due
+void wait_for_event() {
+  unsigned long now = millis();
+  long wait = READING_INTERVAL_MS - (long)(now - lastReading);
+  long untilPublish = interval - (long)(now - previousMillis);
+  if (tdmaActive) {
+    untilPublish = (long)((slotPending ? nextSendAt : nextMeasureAt) - now);
+  }
+  if (untilPublish < wait) wait = untilPublish;
+  if (!client.connected()) {
+    long untilReconnect = RECONNECT_INTERVAL_MS - (long)(now - lastReconnectAttempt);
+    if (untilReconnect < wait) wait = untilReconnect;
+  }
+  if (wait > 0 && !RADAR_SERIAL.available()) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wait));
+  }
+}
+
+void sample_radar() {
+  radar_data = get_data();
+  peakCount = 0;
+  if (millis() - lastFrameAt < RADAR_TIMEOUT_MS) {
+    peakCount = gate_peaks(gateFrame, gatePeakConfig, peaks, GATE_PEAKS_MAX);
+  }
+  if (abs(radar_data.Md - radar_data.Sd) <= 15){
+    d = (radar_data.Md + radar_data.Sd)/2;
+    x = d;
+  }
+  else if (abs(radar_data.Sd - x) <= 25){
+    d = (x + radar_data.Sd)/2;
+  }
+}
+
+// Earliest frame start of the window, as a time near latest
+unsigned long earliest_frame_start(unsigned long latest) {
+  long best = 0;
+  long frame = (long)tdmaFrameMs;
+  for (int k = 0; k < tdmaStartCount; k++) {
+    long offset = (long)(tdmaStarts[k] - latest) % frame;
+    if (offset > frame / 2) offset -= frame;
+    if (offset < -frame / 2) offset += frame;
+    if (offset < best) best = offset;
+  }
+  return latest + best;
+}
+
+// First start of this sensor's group after now
+unsigned long next_measurement(unsigned long now) {
+  unsigned long at = tdmaFrameStart + tdmaMeasureOffset;
+  if ((long)(at - now) <= 0) {
+    unsigned long frames = (now - at) / tdmaFrameMs + 1;
+    at += frames * tdmaFrameMs;
+  }
+  return at;
+}
+
+// Measure at the group's instant, send in the slot
+void tdma_step(unsigned long now) {
+  if (!slotPending && (long)(now - nextMeasureAt) >= 0) {
+    lastReading = now;
+    sample_radar();
+    slotReading = take_reading(now);
+    slotPending = true;
+    nextSendAt = nextMeasureAt + tdmaSendDelay;
+  }
+  if (slotPending && (long)(now - nextSendAt) >= 0) {
+    publish_reading(slotReading);
+    slotPending = false;
+    d = 0;
+    nextMeasureAt = next_measurement(now);
+  }
+}
+
+// {"f":frame,"g":group spacing,"w":slot,"o":hub phase,"s":[ids in slot order]}
+void on_schedule(const byte* payload, unsigned int length) {
+  unsigned long now = millis();
+  DynamicJsonDocument doc(2048); // "s" of a large hub; once every few seconds
+  if (deserializeJson(doc, payload, length)) return;
+  unsigned long frame = doc["f"] | 0UL;
+  unsigned long spacing = doc["g"] | 0UL;
+  unsigned long slot = doc["w"] | 0UL;
+  unsigned long phase = doc["o"] | 0UL;
+  int index = -1;
+  int i = 0;
+  for (JsonVariant v : doc["s"].as<JsonArray>()) {
+    if (v.as<int>() == id) index = i;
+    i++;
+  }
+  if (frame == 0 || index < 0) {
+    if (tdmaActive) Serial.println("Not in the TDMA schedule, free-running.");
+    tdmaActive = false;
+    slotPending = false;
+    return;
+  }
+  if (!tdmaActive) {
+    Serial.print("TDMA slot ");
+    Serial.print(index);
+    Serial.print(" in a ");
+    Serial.print(frame);
+    Serial.println(" ms frame.");
+  }
+  if (!tdmaActive || frame != tdmaFrameMs) tdmaStartCount = 0; // Old or for another layout
+  tdmaFrameMs = frame;
+  tdmaStarts[tdmaStartNext] = now - phase;
+  tdmaStartNext = (tdmaStartNext + 1) % TDMA_WINDOW;
+  if (tdmaStartCount < TDMA_WINDOW) tdmaStartCount++;
+  tdmaFrameStart = earliest_frame_start(now - phase);
+  tdmaMeasureOffset = (index / 3) * spacing;
+  tdmaSendDelay = (index % 3) * slot;
+  tdmaHeardAt = now;
+  // A reading already waiting for its slot keeps it; the next one follows the new phase
+  if (!tdmaActive || !slotPending) nextMeasureAt = next_measurement(now);
+  tdmaActive = true;
+}
+
+// Current reading with its candidate ranges for the central node's
+// multi-target mode: the peaks of the gate energies, or without them the
+// moving and the stationary target, merged when both are the same reflection
+reading take_reading(unsigned long now) {
+  reading r;
+  r.takenAt = now;
+  r.d = d;
+  r.count = 0;
+  r.me = (uint8_t)radar_data.Me;
+  r.se = (uint8_t)radar_data.Se;
+  if (gateFrame.gates > 0) {
+    for (int i = 0; i < peakCount; i++) {
+      r.c[r.count] = peaks[i].cm;
+      r.ce[r.count++] = peaks[i].energy;
+    }
+  } else if (radar_data.Md > 0 && radar_data.Sd > 0 && abs(radar_data.Md - radar_data.Sd) <= 15) {
+    r.c[r.count] = (radar_data.Md + radar_data.Sd) / 2;
+    r.ce[r.count++] = max(radar_data.Me, radar_data.Se);
+  } else {
+    if (radar_data.Md > 0) {
+      r.c[r.count] = radar_data.Md;
+      r.ce[r.count++] = radar_data.Me;
+    }
+    if (radar_data.Sd > 0) {
+      r.c[r.count] = radar_data.Sd;
+      r.ce[r.count++] = radar_data.Se;
+    }
+  }
+  return r;
+}
+
+bool send_reading(const reading& r, unsigned long age) {
+  // Convert radar data to JSON format
+  StaticJsonDocument<200> doc;
+  doc["id"] = id;
+  doc["d"] = r.d;
+  JsonArray candidates = doc.createNestedArray("c");
+  JsonArray energies = doc.createNestedArray("ce");
+  for (int i = 0; i < r.count; i++) {
+    candidates.add(r.c[i]);
+    energies.add(r.ce[i]);
+  }
+  doc["me"] = r.me;
+  doc["se"] = r.se;
+  if (age > 0) doc["age"] = age;
+
+  // Serialize JSON to a char array
+  char buffer[256];
+  serializeJson(doc, buffer);
+  return client.publish("/node/central", buffer);
+}
+
+void publish_reading(const reading& r) {
+  if (client.connected() && send_reading(r, 0)) {
     Serial.println("Published radar data to MQTT gateway.");
     Serial.println();
-    d = 0;
+    return;
+  }
+  // Offline: keep it for the next connection
+  if (bufferCount == BUFFER_SIZE) {
+    bufferHead = (bufferHead + 1) % BUFFER_SIZE;
+    bufferCount--;
+  }
+  buffered[(bufferHead + bufferCount) % BUFFER_SIZE] = r;
+  bufferCount++;
+  Serial.print("Not connected, buffered reading ");
+  Serial.println(bufferCount);
+}
+
+// Sends the buffered readings oldest first, stops at the first failure
+void flush_buffer() {
+  int sent = 0;
+  while (bufferCount > 0 && client.connected()) {
+    const reading& r = buffered[bufferHead];
+    unsigned long age = millis() - r.takenAt;
+    if (!send_reading(r, age > 0 ? age : 1)) break;
+    bufferHead = (bufferHead + 1) % BUFFER_SIZE;
+    bufferCount--;
+    sent++;
   }
+  Serial.print("Flushed buffered readings: ");
+  Serial.println(sent);
 }
 
 data get_data() {
   data received_data;
-  if (radar.isConnected() && millis() - lastReading > 150) {
-    lastReading = millis();
-    unsigned long currentMillis = millis();
-    if ((radar.movingTargetDistance() >= 30) && (radar.movingTargetEnergy() >= 25)) {
-      Md = radar.movingTargetDistance();
-      Me = radar.movingTargetEnergy();
+  // loop() calls this every READING_INTERVAL_MS
+  if (millis() - lastFrameAt < RADAR_TIMEOUT_MS) {
+    if ((gateFrame.movingCm >= 30) && (gateFrame.movingEnergy >= 25)) {
+      Md = gateFrame.movingCm;
+      Me = gateFrame.movingEnergy;
     } else {
       Md = 0;
       Me = 0;
     }
-    if ((radar.stationaryTargetDistance() >= 30) && (radar.stationaryTargetEnergy() >= 25)) {
-      Sd = radar.stationaryTargetDistance();
-      Se = radar.stationaryTargetEnergy();
+    if ((gateFrame.stationaryCm >= 30) && (gateFrame.stationaryEnergy >= 25)) {
+      Sd = gateFrame.stationaryCm;
+      Se = gateFrame.stationaryEnergy;
     } else {
       Sd = 0;
       Se = 0;
@@ -162,6 +447,10 @@ data get_data() {
 }
 
 void callback(char* topic, byte* payload, unsigned int length) {
+  if (!strcmp(topic, TDMA_TOPIC)) {
+    on_schedule(payload, length);
+    return;
+  }
   // Process incoming MQTT messages (optional)
   Serial.print("Message received on topic: ");
   Serial.println(topic);
@@ -169,17 +458,18 @@ void callback(char* topic, byte* payload, unsigned int length) {
   Serial.println((char*)payload);
 }
 
+// One connection attempt; loop() retries every RECONNECT_INTERVAL_MS and
+// keeps sampling the radar in between
 void reconnectMQTT() {
-  // Attempt to reconnect to MQTT server if disconnected
-  while (!client.connected()) {
-    Serial.print("Attempting MQTT connection...");
-    if (client.connect(client_id)) {
-      Serial.println("connected.");
-    } else {
-      Serial.print("failed, rc=");
-      Serial.print(client.state());
-      Serial.println(" try again in 3 seconds");
-      delay(3000);
-    }
+  if (WiFi.status() != WL_CONNECTED) return;
+  Serial.print("Attempting MQTT connection...");
+  if (client.connect(client_id)) {
+    Serial.println("connected.");
+    client.subscribe(TDMA_TOPIC);
+    flush_buffer();
+  } else {
+    Serial.print("failed, rc=");
+    Serial.print(client.state());
+    Serial.println(" try again in 3 seconds");
   }
 }
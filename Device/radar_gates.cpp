@@ -0,0 +1,132 @@
+#include "radar_gates.h"
+
+static const uint8_t FRAME_HEADER[4] = { 0xF4, 0xF3, 0xF2, 0xF1 };
+static const uint8_t FRAME_TRAILER[4] = { 0xF8, 0xF7, 0xF6, 0xF5 };
+
+// Stages: 0-3 header, 4-5 length, 6 body, 7-10 trailer
+static bool parse_body(const GateParser& parser, GateFrame& frame) {
+  const uint8_t* b = parser.body;
+  uint16_t n = parser.length;
+  if (n < 13 || b[1] != 0xAA || b[n - 2] != 0x55) return false;
+  if (b[0] != 0x01 && b[0] != 0x02) return false;
+
+  // Engineering: last moving gate, last stationary gate, then the energies of each
+  int movingGates = 0, stationaryGates = 0;
+  if (b[0] == 0x01) {
+    if (n < 15) return false;
+    movingGates = b[11] + 1;
+    stationaryGates = b[12] + 1;
+    if (movingGates > GATE_COUNT_MAX || stationaryGates > GATE_COUNT_MAX) return false;
+    if (13 + movingGates + stationaryGates > n - 2) return false;
+  }
+  frame.targetState = b[2];
+  frame.movingCm = b[3] | (b[4] << 8);
+  frame.movingEnergy = b[5];
+  frame.stationaryCm = b[6] | (b[7] << 8);
+  frame.stationaryEnergy = b[8];
+  int gates = movingGates < stationaryGates ? movingGates : stationaryGates;
+  for (int g = 0; g < gates; g++) {
+    frame.moving[g] = b[13 + g];
+    frame.stationary[g] = b[13 + movingGates + g];
+  }
+  frame.gates = gates;
+  return true;
+}
+
+bool gate_parser_feed(GateParser& p, uint8_t byte, GateFrame& frame) {
+  if (p.stage < 4) {
+    if (byte == FRAME_HEADER[p.stage]) p.stage++;
+    else p.stage = byte == FRAME_HEADER[0] ? 1 : 0;
+    return false;
+  }
+  if (p.stage == 4) {
+    p.length = byte;
+    p.stage++;
+    return false;
+  }
+  if (p.stage == 5) {
+    p.length |= byte << 8;
+    p.pos = 0;
+    p.stage = p.length > 0 && p.length <= sizeof(p.body) ? 6 : 0;
+    return false;
+  }
+  if (p.stage == 6) {
+    p.body[p.pos++] = byte;
+    if (p.pos == p.length) p.stage++;
+    return false;
+  }
+  if (byte != FRAME_TRAILER[p.stage - 7]) {
+    p.stage = byte == FRAME_HEADER[0] ? 1 : 0;
+    return false;
+  }
+  if (++p.stage < 11) return false;
+  p.stage = 0;
+  return parse_body(p, frame);
+}
+
+// Peaks of one energy array, appended to out (room for GATE_COUNT_MAX)
+static int cfar(const uint8_t* e, int n, const GatePeakConfig& c, uint8_t moving, GatePeak* out) {
+  int count = 0;
+  for (int i = 0; i < n; i++) {
+    int left = i > 0 ? e[i - 1] : 0;
+    int right = i + 1 < n ? e[i + 1] : 0;
+    if (e[i] < c.floor || e[i] < left || e[i] <= right) continue;
+
+    // Training gates on each side, past the guard gates; the quieter side sets the threshold
+    int sumL = 0, cntL = 0, sumR = 0, cntR = 0;
+    for (int k = c.guard + 1; k <= c.guard + c.training; k++) {
+      if (i - k >= 0) { sumL += e[i - k]; cntL++; }
+      if (i + k < n) { sumR += e[i + k]; cntR++; }
+    }
+    int sum = 0, cnt = 0;
+    if (cntL > 0 && (cntR == 0 || sumL * cntR <= sumR * cntL)) { sum = sumL; cnt = cntL; }
+    else if (cntR > 0) { sum = sumR; cnt = cntR; }
+    if (cnt > 0 && e[i] * cnt * 16 <= sum * c.scaleQ4) continue;
+
+    // Vertex of the parabola through the gate and its neighbours, gate centres at (g + 1/2) gateCm
+    int cm = i * c.gateCm + c.gateCm / 2;
+    int curve = 2 * (left - 2 * e[i] + right);
+    if (i > 0 && i + 1 < n && curve < 0) cm += (left - right) * (int)c.gateCm / curve;
+    if (cm < c.minCm) continue;
+    out[count].cm = (int16_t)cm;
+    out[count].energy = e[i];
+    out[count].moving = moving;
+    count++;
+  }
+  return count;
+}
+
+int gate_peaks(const GateFrame& frame, const GatePeakConfig& config, GatePeak* peaks, int maxPeaks) {
+  GatePeak found[2 * GATE_COUNT_MAX];
+  int count = cfar(frame.moving, frame.gates, config, 1, found);
+  int moving = count;
+  int stationary = cfar(frame.stationary, frame.gates, config, 0, found + count);
+
+  // A stationary peak next to a moving one is the same reflector
+  for (int s = moving; s < moving + stationary; s++) {
+    bool merged = false;
+    for (int m = 0; m < moving && !merged; m++) {
+      int apart = found[s].cm - found[m].cm;
+      if (apart < 0) apart = -apart;
+      if (apart > config.gateCm) continue;
+      if (found[s].energy > found[m].energy) found[m].energy = found[s].energy;
+      merged = true;
+    }
+    if (!merged) found[count++] = found[s];
+  }
+
+  // Strongest first; at most 2 * GATE_COUNT_MAX entries
+  int out = 0;
+  while (out < maxPeaks && out < count) {
+    int best = out;
+    for (int k = out + 1; k < count; k++) {
+      if (found[k].energy > found[best].energy) best = k;
+    }
+    GatePeak t = found[out];
+    found[out] = found[best];
+    found[best] = t;
+    peaks[out] = found[out];
+    out++;
+  }
+  return out;
+}
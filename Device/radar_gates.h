@@ -0,0 +1,53 @@
+#ifndef RADAR_GATES_H
+#define RADAR_GATES_H
+
+#include <stdint.h>
+
+// LD2410 report frames and range peaks from their gate energies.
+// gate_parser_feed() assembles basic and engineering frames from the UART
+// bytes; gate_peaks() finds up to maxPeaks people with a CFAR-style detector
+// over the moving and stationary energies, in integer math.
+
+constexpr int GATE_COUNT_MAX = 9;  // Gates 0-8
+constexpr int GATE_PEAKS_MAX = 2;  // The central node's MAX_CANDIDATES
+
+struct GateFrame {
+  uint8_t targetState;         // 0 none, 1 moving, 2 stationary, 3 both
+  uint16_t movingCm;
+  uint8_t movingEnergy;
+  uint16_t stationaryCm;
+  uint8_t stationaryEnergy;
+  uint8_t gates;               // Gates with energies, 0 for a basic frame
+  uint8_t moving[GATE_COUNT_MAX];
+  uint8_t stationary[GATE_COUNT_MAX];
+};
+
+struct GateParser {
+  uint8_t body[48];            // Type byte to check byte; an engineering frame is 35
+  uint16_t length = 0;
+  uint16_t pos = 0;
+  uint8_t stage = 0;           // Header, length, body or trailer byte being matched
+};
+
+struct GatePeak {
+  int16_t cm;
+  uint8_t energy;
+  uint8_t moving;              // 1: from the moving energies
+};
+
+struct GatePeakConfig {
+  uint16_t gateCm = 75;        // Gate resolution (0.75 m; 0.2 m on radars set to it)
+  uint8_t training = 2;        // Gates averaged on each side
+  uint8_t guard = 1;           // Gates left out next to the peak
+  uint8_t scaleQ4 = 32;        // Threshold over the neighbourhood mean, in 1/16 (2.0)
+  uint8_t floor = 20;          // Energy below which nothing is a peak
+  uint16_t minCm = 30;         // Closer peaks are the mounting, not a person
+};
+
+// True when byte completed a frame, which is then in frame
+bool gate_parser_feed(GateParser& parser, uint8_t byte, GateFrame& frame);
+
+// Peaks of a frame with gates into peaks (at most maxPeaks), strongest first; returns their number
+int gate_peaks(const GateFrame& frame, const GatePeakConfig& config, GatePeak* peaks, int maxPeaks);
+
+#endif // RADAR_GATES_H
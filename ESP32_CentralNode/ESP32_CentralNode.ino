@@ -3,6 +3,9 @@
 #include "network_manager.h"
 #include "calculation_logic.h"
 #include "logging.h"
+#include "tuning.h"
+#include "scheduler.h"
+#include "warm_state.h"
 
 void setup() {
     Serial.begin(115200);
@@ -10,6 +13,13 @@ void setup() {
 
     logInfo("SYSTEM", "Central Node - ESP32 Firmware Starting...");
 
+    // Before anything touches the state it may restore
+    warm_boot_check();
+
+    // Load persisted tuning before the settings are logged and validated
+    setup_scheduler();
+    setup_tuning();
+
     // Log configuration settings from config.h
     logInfo("CONFIG", "Anchor Coords: S2_a=%.2f, S3_c=%.2f, S3_b=%.2f", S2_a, S3_c, S3_b);
     logInfo("CONFIG", "Calc Settings: History=%d, Offset=%.2f, Avg Interval=%lu ms", HISTORY_SIZE, DISTANCE_OFFSET, AVERAGE_INTERVAL_MS);
@@ -22,14 +32,13 @@ void setup() {
         while(1); // Stop execution
     }
 
-    // Initialize modules
+    // Initialize modules; each registers its tasks with the scheduler
     setup_wifi();
     setup_mqtt();
     initialize_logic();
 }
 
 void loop() {
-    // Main loop delegates tasks to the respective modules
-    loop_mqtt();
-    loop_logic();
+    // MQTT, tuning and averaging all run as scheduler tasks
+    run_scheduler();
 }
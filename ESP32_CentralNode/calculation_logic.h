@@ -1,9 +1,19 @@
 #ifndef CALCULATION_LOGIC_H
 #define CALCULATION_LOGIC_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 void initialize_logic();
-void loop_logic();
-void on_distance_received(int sensor_id, float distance);
+void update_average_period(); // Picks up a tuned AVERAGE_INTERVAL_MS
+void reset_history();
+void on_sensor_message(int sensor_id, const char* payload, size_t length); // TopicHandler, see topic_router.h and ingest.h
 void publish_results(const char* payload); // Declaration for external use
+void publish_result_packet(const uint8_t* data, size_t length); // BINARY_RESULTS, see result_codec.h
+
+// Zone table: zone 0 is set up by initialize_logic(), further zones come from
+// EXTRA_ZONES or add_zone(). Returns the zone index, or -1 if it was rejected.
+int add_zone(int deviceId, const int sensorIds[3], float s2a, float s3c, float s3b);
+void set_zone_anchors(int zone, float s2a, float s3c, float s3b);
 
 #endif // CALCULATION_LOGIC_H
@@ -1,6 +1,8 @@
 #ifndef CONFIG_H
 #define CONFIG_H
 
+#include "types.h"
+
 // ===================================================================================
 // |                          CONFIGURATION (Declarations)                           |
 // ===================================================================================
@@ -17,24 +19,66 @@ extern const char* MQTT_CLIENT_ID;
 // --- MQTT Topics ---
 extern const char* SENSOR_TOPIC;
 extern const char* OUTPUT_TOPIC;
+extern const char* CONTROL_TOPIC; // Runtime tuning of the settings below (see tuning.h)
+extern const char* SENSOR_LOGIN_PREFIX; // Client id "<prefix><n>" binds a sensor to id n (see topic_router.h), "" = off
+extern const char* TDMA_TOPIC; // Transmit schedule for the sensors (see tdma.h)
+extern const char* HISTORY_TOPIC; // Range requests for the result history (see history_store.h)
+extern const char* HISTORY_REPLY_TOPIC;
+extern const char* GEOFENCE_TOPIC; // Enter/exit/dwell events of the geofences (see geofence.h)
 
 // --- Anchor Coordinates ---
-extern const float S2_a;
-extern const float S3_c;
-extern const float S3_b;
+// Tunable at runtime: these hold the live values, config.cpp holds the defaults
+extern float S2_a;
+extern float S3_c;
+extern float S3_b;
 
 // --- Calculation Settings ---
-// extern const int HISTORY_SIZE;
-constexpr int HISTORY_SIZE = 5;
-extern const float DISTANCE_OFFSET;
-extern const unsigned long AVERAGE_INTERVAL_MS;
-extern const bool PUBLISH_RESULTS;
-extern const int OUTPUT_DEVICE_ID;
+constexpr int MAX_HISTORY_SIZE = 32; // Buffers are sized for this, HISTORY_SIZE is tuned up to it
+extern int HISTORY_SIZE;
+extern float DISTANCE_OFFSET;
+extern unsigned long AVERAGE_INTERVAL_MS;
+// Not const: the Linux daemon (native/central_node) loads these from config.json
+extern bool PUBLISH_RESULTS;
+extern int OUTPUT_DEVICE_ID;
+extern bool MULTI_TARGET_MODE; // Track several people per zone from candidate ranges (see multi_target.h)
+extern bool BINARY_RESULTS; // Publish results packed by result_codec (see result_codec.h) instead of JSON
+extern unsigned long SENSOR_TIMEOUT_MS; // Silence (while its zone reports) after which a sensor is stale, 0 = never
+extern float INGEST_RATE_HZ; // Messages per second a sensor may send before they are dropped, 0 = no limit (see ingest.h)
+extern int INGEST_BURST;     // Messages a sensor may send at once above that rate
+extern unsigned long TDMA_FRAME_MS; // Sensor transmit frame, 0 = sensors free-run (see tdma.h)
+extern bool MOTION_ADAPTIVE; // Each zone's result interval follows its motion state (see motion.h)
+extern unsigned long MOTION_MIN_INTERVAL_MS; // Result interval while the target moves
+extern unsigned long MOTION_MAX_INTERVAL_MS; // ... and while it is stationary
+extern float SIMPLIFY_TOLERANCE_CM; // Drop results this close to the track's extrapolation, 0 = send all (see track_simplify.h)
+extern unsigned long SIMPLIFY_MAX_GAP_MS; // Longest time between results of a zone despite that
+
+// --- Zones ---
+// Zone 0 is the room above (sensors 1-3, S2_a/S3_c/S3_b, OUTPUT_DEVICE_ID).
+// EXTRA_ZONES adds more rooms served by the same board, up to MAX_ZONES in total.
+#ifndef MAX_ZONES
+#define MAX_ZONES 8
+#endif
+#ifndef MAX_SENSOR_ID
+#define MAX_SENSOR_ID 255 // Highest sensor id that can be mapped to a zone
+#endif
+extern const ZoneConfig EXTRA_ZONES[MAX_ZONES];
+
+// --- Geofences ---
+// Boxes and polygons in a zone's anchor frame, checked against every fix
+#ifndef MAX_FENCES
+#define MAX_FENCES 16
+#endif
+extern const FenceConfig FENCES[MAX_FENCES];
+
+// --- Profiling ---
+// Timing zones of profiler.h, reported with the scheduler counters. Uncomment
+// or build with -DPROFILING; the zones cost nothing otherwise.
+// #define PROFILING
 
 // --- Logging Levels ---
 #define LOG_LEVEL_VERBOSE 2
 #define LOG_LEVEL_RESULTS 1
 #define LOG_LEVEL_MINIMAL 0
-extern const int LOG_LEVEL;
+extern int LOG_LEVEL;
 
 #endif // CONFIG_H
\ No newline at end of file
@@ -0,0 +1,32 @@
+#ifndef GEOFENCE_H
+#define GEOFENCE_H
+
+#include <stdint.h>
+#include "config.h"
+#include "types.h"
+
+// Geofences on the hub: boxes and polygons in a zone's anchor frame, with an
+// optional height band, compiled per zone into a GEOFENCE_GRID grid so a fix
+// costs one cell lookup. Enter, dwell and exit events (GEOFENCE_MARGIN_CM
+// hysteresis) go out on GEOFENCE_TOPIC. Multi-target tracks are not checked.
+
+#ifdef ESP8266
+constexpr int GEOFENCE_GRID = 8;
+#else
+constexpr int GEOFENCE_GRID = 16; // Cells per side
+#endif
+constexpr int GEOFENCE_PER_ZONE = 16;     // Bits of FenceMask
+constexpr float GEOFENCE_MARGIN_CM = 10.0; // A few times the noise of a fix
+constexpr int GEOFENCE_GRIDS = MAX_FENCES < MAX_ZONES ? MAX_FENCES : MAX_ZONES;
+
+typedef uint16_t FenceMask;
+
+void setup_geofence();                        // From initialize_logic(): adds FENCES
+int geofence_add(const FenceConfig& fence);   // Returns the fence's index, -1 if rejected; any time
+void geofence_assign(int zone, int deviceId); // Called by add_zone(); compiles the zone's fences
+void geofence_check(int zone, float x, float y, float z); // Every fix, from record_fix()
+
+// Provided by network_manager.cpp: on GEOFENCE_TOPIC, on every broker the board talks to
+void publish_geofence(const char* payload);
+
+#endif // GEOFENCE_H
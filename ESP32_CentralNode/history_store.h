@@ -0,0 +1,57 @@
+#ifndef HISTORY_STORE_H
+#define HISTORY_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "config.h"
+
+// History of the fixes per zone in four tiers (raw, 1 s, 10 s, 1 min
+// buckets), in RAM or PSRAM, with 1 min buckets spilled to LittleFS where
+// HISTORY_SPILL is set. Requests on HISTORY_TOPIC are answered on
+// HISTORY_REPLY_TOPIC by the "history" task, one per run (format in README).
+
+#if defined(BOARD_HAS_PSRAM)
+constexpr int HISTORY_RAW_DEPTH = 256;  // About 2.5 min at Device.ino's rate
+constexpr int HISTORY_1S_DEPTH = 600;   // 10 min
+constexpr int HISTORY_10S_DEPTH = 360;  // 1 h
+constexpr int HISTORY_1M_DEPTH = 720;   // 12 h
+#elif defined(ESP8266)
+constexpr int HISTORY_RAW_DEPTH = 8;
+constexpr int HISTORY_1S_DEPTH = 20;
+constexpr int HISTORY_10S_DEPTH = 12;
+constexpr int HISTORY_1M_DEPTH = 20;
+#else
+constexpr int HISTORY_RAW_DEPTH = 32;   // About 20 s
+constexpr int HISTORY_1S_DEPTH = 60;    // 1 min
+constexpr int HISTORY_10S_DEPTH = 60;   // 10 min
+constexpr int HISTORY_1M_DEPTH = 120;   // 2 h
+#endif
+
+constexpr uint32_t HISTORY_TICK_MS = 1000;
+constexpr uint32_t HISTORY_BUDGET_US = 20000; // Closing buckets and one reply page; spill reads take longer
+constexpr uint32_t HISTORY_SPILL_BYTES = 64 * 1024;
+constexpr int HISTORY_PAGE = 12;            // Entries per reply
+constexpr size_t HISTORY_REPLY_MAX = 1024;  // Bytes of a reply; the MQTT clients' buffers are raised to fit
+
+enum HistoryTier : uint8_t { HISTORY_RAW, HISTORY_1S, HISTORY_10S, HISTORY_1M, HISTORY_TIERS };
+
+// Closed bucket, also the spill file record (after the deviceID)
+struct HistoryBucket {
+    uint32_t t; // Start, seconds of uptime
+    uint16_t n;
+    uint16_t r; // mm
+    int16_t min[3];
+    int16_t mean[3];
+    int16_t max[3];
+};
+
+void setup_history_store();                        // From initialize_logic(): allocates the tiers, clears the spill
+void history_store_assign(int zone, int deviceId); // Called by add_zone()
+void history_store_record(int zone, float x, float y, float z); // Every fix, from record_fix()
+void history_store_tick();                         // Scheduler task every HISTORY_TICK_MS
+void on_history_topic(int sensorId, const char* payload, size_t length); // TopicHandler for HISTORY_TOPIC
+
+// Provided by network_manager.cpp: to the requester's side(s)
+void publish_history(const char* payload);
+
+#endif // HISTORY_STORE_H
@@ -0,0 +1,130 @@
+#include <Arduino.h>
+#include <math.h>
+#include "motion.h"
+#include "logging.h"
+
+// --- Zone State ---
+uint8_t motionState[MAX_ZONES];
+uint32_t motionWindowStart[MAX_ZONES];
+float motionSum[MAX_ZONES][3];
+uint16_t motionCount[MAX_ZONES];
+float motionPrev[MAX_ZONES][3];  // Mean of the last closed window
+uint32_t motionPrevAt[MAX_ZONES]; // When it closed, 0 before the first
+float motionSpeed[MAX_ZONES];     // cm/s between the last two windows, -1 before
+float motionShare[MAX_ZONES];     // Smoothed moving energy share, -1 without energy
+uint32_t motionStillSince[MAX_ZONES];
+bool motionStill[MAX_ZONES];      // Still evidence since motionStillSince
+
+void setup_motion() {
+    if (MOTION_MIN_INTERVAL_MS == 0 || MOTION_MIN_INTERVAL_MS > MOTION_MAX_INTERVAL_MS) {
+        logWarn("MOTION", "Interval bounds %lu..%lu ms are invalid, using %lu ms.", MOTION_MIN_INTERVAL_MS,
+                MOTION_MAX_INTERVAL_MS, AVERAGE_INTERVAL_MS);
+        MOTION_MIN_INTERVAL_MS = MOTION_MAX_INTERVAL_MS = AVERAGE_INTERVAL_MS;
+    }
+    if (MOTION_ADAPTIVE) {
+        logInfo("MOTION", "Result interval %lu ms while moving, %lu ms while stationary.", MOTION_MIN_INTERVAL_MS,
+                MOTION_MAX_INTERVAL_MS);
+    }
+}
+
+void motion_reset(int zone) {
+    motionState[zone] = MOTION_UNKNOWN;
+    motionWindowStart[zone] = millis();
+    motionSum[zone][0] = motionSum[zone][1] = motionSum[zone][2] = 0;
+    motionCount[zone] = 0;
+    motionPrevAt[zone] = 0;
+    motionSpeed[zone] = -1;
+    motionShare[zone] = -1;
+    motionStill[zone] = false;
+}
+
+static void set_state(int zone, MotionState state) {
+    if (motionState[zone] == state) return;
+    motionState[zone] = state;
+    logVerbose("MOTION", "Zone %d %s (%.1f cm/s, moving share %.2f).", zone, motion_name(state), motionSpeed[zone],
+               motionShare[zone]);
+}
+
+static void classify(int zone, uint32_t now) {
+    float speed = motionSpeed[zone];
+    float share = motionShare[zone];
+    if (speed >= MOTION_MOVING_CM_S || share >= MOTION_MOVING_SHARE) {
+        motionStill[zone] = false;
+        set_state(zone, MOTION_MOVING);
+        return;
+    }
+    if (speed < 0 || speed >= MOTION_STILL_CM_S || share >= MOTION_STILL_SHARE) {
+        motionStill[zone] = false;
+        return;
+    }
+    if (!motionStill[zone]) {
+        motionStill[zone] = true;
+        motionStillSince[zone] = now;
+    }
+    if (now - motionStillSince[zone] >= MOTION_SETTLE_MS) set_state(zone, MOTION_STATIONARY);
+}
+
+void motion_fix(int zone, float x, float y, float z) {
+    motionSum[zone][0] += x;
+    motionSum[zone][1] += y;
+    motionSum[zone][2] += z;
+    motionCount[zone]++;
+    uint32_t now = millis();
+    if (now - motionWindowStart[zone] < MOTION_WINDOW_MS) return;
+
+    float mean[3];
+    for (int i = 0; i < 3; i++) {
+        mean[i] = motionSum[zone][i] / motionCount[zone];
+        motionSum[zone][i] = 0;
+    }
+    motionCount[zone] = 0;
+    motionWindowStart[zone] = now;
+    // After a gap in the fixes the last window says nothing about now
+    uint32_t dt = now - motionPrevAt[zone];
+    if (motionPrevAt[zone] != 0 && dt <= 3 * MOTION_WINDOW_MS) {
+        float dx = mean[0] - motionPrev[zone][0];
+        float dy = mean[1] - motionPrev[zone][1];
+        float dz = mean[2] - motionPrev[zone][2];
+        motionSpeed[zone] = sqrtf(dx * dx + dy * dy + dz * dz) * 1000.0f / dt;
+    } else {
+        motionSpeed[zone] = -1;
+    }
+    for (int i = 0; i < 3; i++) motionPrev[zone][i] = mean[i];
+    motionPrevAt[zone] = now ? now : 1;
+    classify(zone, now);
+}
+
+void motion_energy(int zone, int movingEnergy, int stationaryEnergy) {
+    if (movingEnergy < 0 || stationaryEnergy < 0 || movingEnergy + stationaryEnergy == 0) return;
+    float share = (float)movingEnergy / (movingEnergy + stationaryEnergy);
+    if (motionShare[zone] < 0) motionShare[zone] = share;
+    else motionShare[zone] += MOTION_SHARE_GAIN * (share - motionShare[zone]);
+    classify(zone, millis());
+}
+
+MotionState motion_state(int zone) {
+    return (MotionState)motionState[zone];
+}
+
+uint32_t motion_interval_ms(int zone) {
+    switch (motionState[zone]) {
+        case MOTION_MOVING: return MOTION_MIN_INTERVAL_MS;
+        case MOTION_STATIONARY: return MOTION_MAX_INTERVAL_MS;
+        default: break;
+    }
+    if (AVERAGE_INTERVAL_MS < MOTION_MIN_INTERVAL_MS) return MOTION_MIN_INTERVAL_MS;
+    if (AVERAGE_INTERVAL_MS > MOTION_MAX_INTERVAL_MS) return MOTION_MAX_INTERVAL_MS;
+    return AVERAGE_INTERVAL_MS;
+}
+
+uint32_t motion_tick_ms() {
+    return MOTION_ADAPTIVE ? MOTION_MIN_INTERVAL_MS : AVERAGE_INTERVAL_MS;
+}
+
+const char* motion_name(MotionState state) {
+    switch (state) {
+        case MOTION_MOVING: return "moving";
+        case MOTION_STATIONARY: return "stationary";
+        default: return nullptr;
+    }
+}
@@ -0,0 +1,213 @@
+#include <Arduino.h>
+#include "multi_target.h"
+#include "config.h"
+#include "logging.h"
+#include "warm_state.h"
+
+// --- Track Table (struct of arrays, [zone][track]) ---
+float trackX[MAX_ZONES][MAX_TRACKS];
+float trackY[MAX_ZONES][MAX_TRACKS];
+float trackZ[MAX_ZONES][MAX_TRACKS];
+uint16_t trackId[MAX_ZONES][MAX_TRACKS]; // 0 marks a free slot
+uint8_t trackHits[MAX_ZONES][MAX_TRACKS];
+uint8_t trackMisses[MAX_ZONES][MAX_TRACKS];
+uint16_t nextTrackId[MAX_ZONES];
+
+void reset_tracks(int zone) {
+    for (int t = 0; t < MAX_TRACKS; t++) trackId[zone][t] = 0;
+    nextTrackId[zone] = 1;
+}
+
+void save_tracks(int zone, WarmZone& w) {
+    w.nextTrackId = nextTrackId[zone];
+    for (int t = 0; t < MAX_TRACKS; t++) {
+        w.trackId[t] = trackId[zone][t];
+        w.trackX[t] = warm_cm(trackX[zone][t]);
+        w.trackY[t] = warm_cm(trackY[zone][t]);
+        w.trackZ[t] = warm_cm(trackZ[zone][t]);
+        w.trackHits[t] = trackHits[zone][t];
+        w.trackMisses[t] = trackMisses[zone][t];
+    }
+}
+
+void restore_tracks(int zone, const WarmZone& w) {
+    nextTrackId[zone] = w.nextTrackId != 0 ? w.nextTrackId : 1;
+    for (int t = 0; t < MAX_TRACKS; t++) {
+        trackId[zone][t] = w.trackId[t];
+        trackX[zone][t] = w.trackX[t];
+        trackY[zone][t] = w.trackY[t];
+        trackZ[zone][t] = w.trackZ[t];
+        trackHits[zone][t] = w.trackHits[t];
+        trackMisses[zone][t] = w.trackMisses[t];
+    }
+}
+
+static bool is_confirmed(int zone, int t) {
+    return trackId[zone][t] != 0 && trackHits[zone][t] >= TRACK_CONFIRM_HITS;
+}
+
+static bool uses_range(const TargetFix& fix, const uint8_t rangeUsed[3]) {
+    for (int s = 0; s < 3; s++) {
+        if (rangeUsed[s] & (1 << fix.cand[s])) return true;
+    }
+    return false;
+}
+
+static void mark_ranges(const TargetFix& fix, uint8_t rangeUsed[3]) {
+    for (int s = 0; s < 3; s++) rangeUsed[s] |= (uint8_t)(1 << fix.cand[s]);
+}
+
+// Joint association search: picks a gated fix (or none) for each active track so
+// that no two chosen fixes share a candidate range, at the lowest total cost.
+// A track left without a fix costs a full gate. At most MAX_TRACKS levels deep and
+// ranges run out after MAX_CANDIDATES picks, so the search stays tiny.
+struct AssocSearch {
+    const TargetFix* fixes;
+    int count;
+    int tracks[MAX_TRACKS]; // Active track slots, confirmed ones first
+    int trackCount;
+    float cost[MAX_TRACKS][MAX_CANDIDATES * MAX_CANDIDATES * MAX_CANDIDATES]; // < 0 outside the gate
+    int8_t pick[MAX_TRACKS];
+    int8_t bestPick[MAX_TRACKS];
+    float bestCost;
+};
+
+static void search_assignment(AssocSearch& s, int level, float costSoFar, uint8_t rangeUsed[3]) {
+    if (costSoFar >= s.bestCost) return;
+    if (level == s.trackCount) {
+        s.bestCost = costSoFar;
+        for (int i = 0; i < s.trackCount; i++) s.bestPick[i] = s.pick[i];
+        return;
+    }
+    const float gate2 = TRACK_GATE_CM * TRACK_GATE_CM;
+    for (int f = 0; f < s.count; f++) {
+        if (s.cost[level][f] < 0 || uses_range(s.fixes[f], rangeUsed)) continue;
+        uint8_t next[3] = { rangeUsed[0], rangeUsed[1], rangeUsed[2] };
+        mark_ranges(s.fixes[f], next);
+        s.pick[level] = (int8_t)f;
+        search_assignment(s, level + 1, costSoFar + s.cost[level][f], next);
+    }
+    s.pick[level] = -1;
+    search_assignment(s, level + 1, costSoFar + gate2, rangeUsed);
+}
+
+void update_tracks(int zone, const TargetFix* fixes, int count) {
+    AssocSearch s;
+    s.fixes = fixes;
+    s.count = count;
+    s.trackCount = 0;
+    s.bestCost = 1e30f;
+    for (int pass = 0; pass < 2; pass++) {
+        for (int t = 0; t < MAX_TRACKS; t++) {
+            if (trackId[zone][t] != 0 && is_confirmed(zone, t) == (pass == 0)) s.tracks[s.trackCount++] = t;
+        }
+    }
+
+    const float gate2 = TRACK_GATE_CM * TRACK_GATE_CM;
+    for (int i = 0; i < s.trackCount; i++) {
+        int t = s.tracks[i];
+        s.bestPick[i] = -1;
+        for (int f = 0; f < count; f++) {
+            float dx = fixes[f].p.x - trackX[zone][t];
+            float dy = fixes[f].p.y - trackY[zone][t];
+            float dz = fixes[f].p.z - trackZ[zone][t];
+            // People keep their height, ghost fixes swing up and down
+            float d2 = dx * dx + dy * dy + TRACK_Z_WEIGHT * dz * dz;
+            // Tentative tracks pay extra so a confirmed track wins a contested range
+            if (!is_confirmed(zone, t)) d2 *= 2;
+            s.cost[i][f] = d2 > gate2 ? -1.0f : d2;
+        }
+    }
+    uint8_t noRanges[3] = {};
+    search_assignment(s, 0, 0, noRanges);
+
+    bool trackUsed[MAX_TRACKS] = {};
+    bool fixUsed[MAX_CANDIDATES * MAX_CANDIDATES * MAX_CANDIDATES] = {};
+    uint8_t rangeUsed[3] = {}; // Bit per candidate index, per sensor
+    for (int i = 0; i < s.trackCount; i++) {
+        int t = s.tracks[i];
+        int f = s.bestPick[i];
+        if (f < 0) continue;
+        trackUsed[t] = true;
+        fixUsed[f] = true;
+        mark_ranges(fixes[f], rangeUsed);
+
+        trackX[zone][t] += TRACK_SMOOTHING * (fixes[f].p.x - trackX[zone][t]);
+        trackY[zone][t] += TRACK_SMOOTHING * (fixes[f].p.y - trackY[zone][t]);
+        trackZ[zone][t] += TRACK_SMOOTHING * (fixes[f].p.z - trackZ[zone][t]);
+        trackMisses[zone][t] = 0;
+        if (trackHits[zone][t] < 255) trackHits[zone][t]++;
+        if (trackHits[zone][t] == TRACK_CONFIRM_HITS) {
+            logInfo("TRACK", "Zone %d: track %u confirmed at (%.2f, %.2f, %.2f)", zone, trackId[zone][t],
+                    trackX[zone][t], trackY[zone][t], trackZ[zone][t]);
+        }
+    }
+
+    // Tracks without a fix this frame
+    for (int t = 0; t < MAX_TRACKS; t++) {
+        if (trackId[zone][t] == 0 || trackUsed[t]) continue;
+        if (++trackMisses[zone][t] > TRACK_MAX_MISSES) {
+            if (is_confirmed(zone, t)) logInfo("TRACK", "Zone %d: track %u lost", zone, trackId[zone][t]);
+            trackId[zone][t] = 0;
+        } else if (!is_confirmed(zone, t)) {
+            trackHits[zone][t] = 0; // Tentative tracks need consecutive hits
+        }
+    }
+
+    // Births from fixes built only from unexplained ranges. Triplets of the same candidate
+    // rank on all three sensors go first (each one's strongest peak, or its moving target
+    // for a radar without gate frames); they are the likelier real targets.
+    for (int pass = 0; pass < 2; pass++) {
+        for (int f = 0; f < count; f++) {
+            const TargetFix& fix = fixes[f];
+            bool sameRank = fix.cand[0] == fix.cand[1] && fix.cand[1] == fix.cand[2];
+            if (fixUsed[f] || sameRank != (pass == 0) || uses_range(fix, rangeUsed)) continue;
+            int slot = -1;
+            for (int t = 0; t < MAX_TRACKS; t++) {
+                if (trackId[zone][t] == 0) {
+                    slot = t;
+                    break;
+                }
+            }
+            if (slot < 0) {
+                logVerbose("TRACK", "Zone %d: no free track slot for a new target", zone);
+                return;
+            }
+            trackId[zone][slot] = nextTrackId[zone]++;
+            if (nextTrackId[zone] == 0) nextTrackId[zone] = 1;
+            trackX[zone][slot] = fix.p.x;
+            trackY[zone][slot] = fix.p.y;
+            trackZ[zone][slot] = fix.p.z;
+            trackHits[zone][slot] = 1;
+            trackMisses[zone][slot] = 0;
+            fixUsed[f] = true;
+            mark_ranges(fix, rangeUsed);
+            logVerbose("TRACK", "Zone %d: tentative track %u at (%.2f, %.2f, %.2f)", zone, trackId[zone][slot],
+                       fix.p.x, fix.p.y, fix.p.z);
+        }
+    }
+}
+
+void write_tracks(int zone, JsonArray targets) {
+    for (int t = 0; t < MAX_TRACKS; t++) {
+        if (!is_confirmed(zone, t)) continue;
+        JsonObject target = targets.createNestedObject();
+        target["track"] = trackId[zone][t];
+        target["x"] = round(trackX[zone][t] * 100) / 100.0;
+        target["y"] = round(trackY[zone][t] * 100) / 100.0;
+        target["z"] = round(trackZ[zone][t] * 100) / 100.0;
+    }
+}
+
+int read_tracks(int zone, uint16_t ids[MAX_TRACKS], Point3D positions[MAX_TRACKS]) {
+    int count = 0;
+    for (int t = 0; t < MAX_TRACKS; t++) {
+        if (!is_confirmed(zone, t)) continue;
+        ids[count] = trackId[zone][t];
+        positions[count].x = trackX[zone][t];
+        positions[count].y = trackY[zone][t];
+        positions[count].z = trackZ[zone][t];
+        count++;
+    }
+    return count;
+}
@@ -1,10 +1,24 @@
 #include <WiFi.h>
 #include <PubSubClient.h>
-#include <ArduinoJson.h>
 #include "network_manager.h"
 #include "config.h"
 #include "logging.h"
 #include "calculation_logic.h" // To call on_distance_received
+#include "tuning.h"
+#include "scheduler.h"
+#include "warm_state.h"
+#include "topic_router.h"
+#include "profiler.h"
+#include "tdma.h"
+#include "geofence.h"
+#include "history_store.h"
+
+constexpr uint32_t NETWORK_BUDGET_US = 5000;      // One broker or client pass; longer ones delay the averaging task
+constexpr uint32_t RECONNECT_INTERVAL_MS = 5000;
+constexpr int32_t CONNECT_TIMEOUT_MS = 250;   // TCP connect of one attempt; a broker on the LAN answers in a few ms
+constexpr uint16_t CONNACK_TIMEOUT_S = 1;     // PubSubClient waits whole seconds for CONNACK
+constexpr uint32_t WIFI_POLL_MS = 50;
+constexpr uint32_t WIFI_CONNECT_TIMEOUT_MS = 10500; // Full join with scan and DHCP, then restart
 
 // --- Networking & MQTT Objects ---
 WiFiClient espClient;
@@ -13,76 +27,107 @@ PubSubClient mqttClient(espClient);
 void mqtt_callback(char* topic, byte* payload, unsigned int length);
 void reconnect_mqtt();
 
-void setup_wifi() {
-    logInfo("WIFI", "Connecting to %s", WIFI_SSID);
-    WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
-    int attempts = 0;
+static bool wait_for_wifi(uint32_t timeoutMs) {
+    uint32_t start = millis();
     while (WiFi.status() != WL_CONNECTED) {
-        delay(500);
-        Serial.print(".");
-        if(attempts++ > 20) {
+        if (millis() - start >= timeoutMs) return false;
+        delay(WIFI_POLL_MS);
+    }
+    return true;
+}
+
+// After a warm restart the cached BSSID, channel and IP settings skip the scan
+// and DHCP; if that join fails the cache is dropped and a full join follows
+void setup_wifi() {
+    bool connected = false;
+    const WarmWifi* cached = warm_wifi();
+    if (cached) {
+        logInfo("WIFI", "Rejoining %s on channel %d", WIFI_SSID, cached->channel);
+        WiFi.config(IPAddress(cached->ip), IPAddress(cached->gateway), IPAddress(cached->subnet), IPAddress(cached->dns));
+        WiFi.begin(WIFI_SSID, WIFI_PASSWORD, cached->channel, cached->bssid);
+        connected = wait_for_wifi(FAST_CONNECT_TIMEOUT_MS);
+        if (!connected) {
+            logWarn("WIFI", "Cached association failed, scanning.");
+            warm_clear_wifi();
+            WiFi.disconnect();
+            WiFi.config(IPAddress(), IPAddress(), IPAddress()); // Back to DHCP
+        }
+    }
+    if (!connected) {
+        logInfo("WIFI", "Connecting to %s", WIFI_SSID);
+        WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+        if (!wait_for_wifi(WIFI_CONNECT_TIMEOUT_MS)) {
             logError("WIFI", "Failed to connect. Restarting...");
             ESP.restart();
         }
     }
-    Serial.println("");
+    warm_save_wifi(WiFi.BSSID(), WiFi.channel(), (uint32_t)WiFi.localIP(), (uint32_t)WiFi.gatewayIP(),
+                   (uint32_t)WiFi.subnetMask(), (uint32_t)WiFi.dnsIP());
     logInfo("WIFI", "WiFi Connected. IP: %s", WiFi.localIP().toString().c_str());
 }
 
 void setup_mqtt() {
     mqttClient.setServer(MQTT_BROKER_IP, MQTT_BROKER_PORT);
+    mqttClient.setSocketTimeout(CONNACK_TIMEOUT_S);
     mqttClient.setCallback(mqtt_callback);
+    mqttClient.setBufferSize(HISTORY_REPLY_MAX + 64); // Room for a history reply and its topic
+    topic_route(SENSOR_TOPIC, on_sensor_message);
+    topic_route_sensors(SENSOR_TOPIC, on_sensor_message); // SENSOR_TOPIC/<id>
+    topic_route(CONTROL_TOPIC, on_control_topic);
+    topic_route(HISTORY_TOPIC, on_history_topic);
+    reconnect_mqtt();
+    scheduler_add("mqtt-reconnect", reconnect_mqtt, RECONNECT_INTERVAL_MS, 0, 0);
+    scheduler_add("mqtt", loop_mqtt, 0, 0, NETWORK_BUDGET_US);
 }
 
 void loop_mqtt() {
-    if (!mqttClient.connected()) {
-        reconnect_mqtt();
+    if (mqttClient.connected()) {
+        mqttClient.loop();
     }
-    mqttClient.loop();
 }
 
+// One attempt per RECONNECT_INTERVAL_MS instead of blocking until connected, so
+// the averaging task keeps its cadence while the broker is away. The TCP
+// connect is made here, bounded by CONNECT_TIMEOUT_MS rather than the core's
+// few seconds to an absent host; PubSubClient then only exchanges CONNECT and
+// CONNACK on it
 void reconnect_mqtt() {
-    while (!mqttClient.connected()) {
-        logInfo("MQTT", "Attempting MQTT connection...");
-        if (mqttClient.connect(MQTT_CLIENT_ID)) {
-            logInfo("MQTT", "Connected to broker.");
-            if(mqttClient.subscribe(SENSOR_TOPIC)){
-                logInfo("MQTT", "Subscribed to topic: %s", SENSOR_TOPIC);
-            } else {
-                logError("MQTT", "Subscription failed!");
-            }
+    if (mqttClient.connected()) return;
+    logInfo("MQTT", "Attempting MQTT connection...");
+    if (!espClient.connect(MQTT_BROKER_IP, MQTT_BROKER_PORT, CONNECT_TIMEOUT_MS)) {
+        logError("MQTT", "No answer within %ld ms. Retrying in %lu ms...", (long)CONNECT_TIMEOUT_MS,
+                 (unsigned long)RECONNECT_INTERVAL_MS);
+        return;
+    }
+    if (mqttClient.connect(MQTT_CLIENT_ID)) {
+        logInfo("MQTT", "Connected to broker.");
+        if(mqttClient.subscribe(SENSOR_TOPIC)){
+            logInfo("MQTT", "Subscribed to topic: %s", SENSOR_TOPIC);
         } else {
-            logError("MQTT", "Failed, rc=%d. Retrying in 5 seconds...", mqttClient.state());
-            delay(5000);
+            logError("MQTT", "Subscription failed!");
         }
+        char perSensor[64];
+        snprintf(perSensor, sizeof(perSensor), "%s/+", SENSOR_TOPIC);
+        mqttClient.subscribe(perSensor);
+        mqttClient.subscribe(CONTROL_TOPIC);
+        mqttClient.subscribe(HISTORY_TOPIC);
+    } else {
+        logError("MQTT", "Failed, rc=%d. Retrying in %lu ms...", mqttClient.state(), (unsigned long)RECONNECT_INTERVAL_MS);
     }
 }
 
 void mqtt_callback(char* topic, byte* payload, unsigned int length) {
+    PROFILE_ZONE("mqtt_callback");
     char payloadStr[length + 1];
     memcpy(payloadStr, payload, length);
     payloadStr[length] = '\0';
     
     logVerbose("RECV", "Message arrived [%s]: %s", topic, payloadStr);
 
-    StaticJsonDocument<96> doc;
-    DeserializationError error = deserializeJson(doc, payloadStr);
-
-    if (error) {
-        logError("PARSE", "deserializeJson() failed: %s", error.c_str());
-        return;
-    }
-
-    if (!doc.containsKey("id") || !doc.containsKey("d")) {
-        logWarn("RECV", "Ignoring invalid message: missing 'id' or 'd'");
-        return;
+    // The broker does not say who published: shared-topic messages carry their id in the body
+    if (!route_message(topic, strlen(topic), payloadStr, length)) {
+        logVerbose("RECV", "No route for topic %s", topic);
     }
-
-    int id = doc["id"];
-    float d = doc["d"];
-
-    // Pass the received data to the calculation logic module
-    on_distance_received(id, d);
 }
 
 // This function needs to be declared in network_manager.cpp as well to be callable from calculation_logic.cpp
@@ -98,3 +143,26 @@ void publish_results(const char* payload) {
         logVerbose("SENDER", "Publishing is disabled.");
     }
 }
+
+void publish_result_packet(const uint8_t* data, size_t length) {
+    if (!PUBLISH_RESULTS) return;
+    if (mqttClient.connected()) {
+        mqttClient.publish(OUTPUT_TOPIC, data, length);
+    } else {
+        logWarn("SENDER", "Cannot publish. MQTT client not connected.");
+    }
+}
+
+// Sensors share the broker with this node and subscribe to TDMA_TOPIC there
+void publish_schedule(const char* payload) {
+    if (mqttClient.connected()) mqttClient.publish(TDMA_TOPIC, payload);
+}
+
+// Dashboards ask on the same broker
+void publish_history(const char* payload) {
+    if (mqttClient.connected()) mqttClient.publish(HISTORY_REPLY_TOPIC, payload);
+}
+
+void publish_geofence(const char* payload) {
+    if (mqttClient.connected()) mqttClient.publish(GEOFENCE_TOPIC, payload);
+}
@@ -0,0 +1,80 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdint.h>
+#include <Arduino.h>
+#include "config.h"
+
+// Scoped profiling zones: PROFILE_ZONE("name") times the rest of its block.
+// Boards count CPU cycles and log per-zone totals with the scheduler report;
+// the host also records every run for profiler_flush(). Empty without PROFILING.
+
+#ifdef PROFILING
+
+#ifndef MAX_PROFILE_ZONES
+#define MAX_PROFILE_ZONES 24
+#endif
+
+#ifdef ARDUINO_SHIM_H
+#include <chrono>
+#define PROFILE_EVENTS 1
+typedef uint64_t ProfileTicks; // ns
+inline ProfileTicks profile_now() {
+    return (ProfileTicks)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+#else
+typedef uint32_t ProfileTicks; // CPU cycles, wraps after about 18 s at 240 MHz; zones are far shorter
+inline ProfileTicks profile_now() {
+    return ESP.getCycleCount();
+}
+#endif
+
+// Returns the zone's index (a name used at several sites is one zone), -1 when the table is full
+int profiler_zone(const char* name);
+void profiler_record(int zone, ProfileTicks start, ProfileTicks end);
+const char* profiler_zone_name(int zone);
+float profiler_ticks_per_us();
+void profiler_report(); // From scheduler_report()
+
+class ProfileScope {
+public:
+    explicit ProfileScope(int zone) : zone(zone), start(profile_now()) {}
+    ~ProfileScope() { profiler_record(zone, start, profile_now()); }
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    int zone;
+    ProfileTicks start;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_ZONE(name)                                                              \
+    static const int PROFILE_CONCAT(profileZone, __LINE__) = profiler_zone(name);       \
+    ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(PROFILE_CONCAT(profileZone, __LINE__))
+
+#ifdef PROFILE_EVENTS
+struct ProfileEvent {
+    int zone;
+    ProfileTicks start;
+    ProfileTicks end;
+};
+
+constexpr int PROFILE_EVENT_BATCH = 4096;
+
+typedef void (*ProfileSink)(const ProfileEvent* events, int count);
+void profiler_set_sink(ProfileSink sink); // nullptr stops recording events
+void profiler_flush();                    // Between loop passes: the buffered events to the sink
+#endif
+
+#else
+
+#define PROFILE_ZONE(name) ((void)0)
+inline void profiler_report() {}
+inline void profiler_flush() {}
+
+#endif // PROFILING
+
+#endif // PROFILER_H
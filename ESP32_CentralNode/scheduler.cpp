@@ -0,0 +1,125 @@
+#include <Arduino.h>
+#include "scheduler.h"
+#include "config.h"
+#include "logging.h"
+#include "fix_cache.h"
+#include "profiler.h"
+
+// --- Task Table (struct of arrays) ---
+int taskCount = 0;
+const char* taskName[MAX_TASKS];
+TaskFunction taskFn[MAX_TASKS];
+uint32_t taskPeriod[MAX_TASKS];   // ms, 0 = polling task
+uint32_t taskDeadline[MAX_TASKS]; // ms after release
+uint32_t taskBudget[MAX_TASKS];   // us, 0 = unlimited
+uint32_t taskRelease[MAX_TASKS];  // millis() of the next release
+
+// Counters since the last report
+uint32_t taskRuns[MAX_TASKS];
+uint32_t taskOverruns[MAX_TASKS];
+uint32_t taskMisses[MAX_TASKS];
+uint32_t taskSkipped[MAX_TASKS];
+uint32_t taskMaxUs[MAX_TASKS];
+uint64_t taskTotalUs[MAX_TASKS];
+
+static void execute(int t) {
+    uint32_t start = micros();
+    taskFn[t]();
+    uint32_t elapsed = micros() - start;
+    taskRuns[t]++;
+    taskTotalUs[t] += elapsed;
+    if (elapsed > taskMaxUs[t]) taskMaxUs[t] = elapsed;
+    if (taskBudget[t] != 0 && elapsed > taskBudget[t]) {
+        taskOverruns[t]++;
+        logVerbose("SCHED", "%s ran %lu us, budget %lu us", taskName[t], (unsigned long)elapsed, (unsigned long)taskBudget[t]);
+    }
+}
+
+void setup_scheduler() {
+    scheduler_add("sched-report", scheduler_report, SCHEDULER_REPORT_MS, 0, 0);
+}
+
+int scheduler_add(const char* name, TaskFunction fn, uint32_t periodMs, uint32_t deadlineMs, uint32_t budgetUs) {
+    if (taskCount >= MAX_TASKS) {
+        logError("SCHED", "Task table full (%d), %s not added.", MAX_TASKS, name);
+        return -1;
+    }
+    int t = taskCount++;
+    taskName[t] = name;
+    taskFn[t] = fn;
+    taskPeriod[t] = periodMs;
+    taskDeadline[t] = deadlineMs != 0 ? deadlineMs : periodMs;
+    taskBudget[t] = budgetUs;
+    taskRelease[t] = millis() + periodMs;
+    logVerbose("SCHED", "Task %s: period %lu ms, deadline %lu ms, budget %lu us", name, (unsigned long)periodMs,
+               (unsigned long)taskDeadline[t], (unsigned long)budgetUs);
+    return t;
+}
+
+void scheduler_set_period(int task, uint32_t periodMs) {
+    if (task < 0 || task >= taskCount || taskPeriod[task] == 0 || periodMs == 0) return;
+    if (taskDeadline[task] == taskPeriod[task]) taskDeadline[task] = periodMs;
+    taskRelease[task] = taskRelease[task] - taskPeriod[task] + periodMs;
+    taskPeriod[task] = periodMs;
+}
+
+void run_scheduler() {
+    // Due periodic tasks, earliest deadline first
+    for (;;) {
+        uint32_t now = millis();
+        int next = -1;
+        int32_t nextSlack = 0;
+        for (int t = 0; t < taskCount; t++) {
+            if (taskPeriod[t] == 0 || (int32_t)(now - taskRelease[t]) < 0) continue;
+            int32_t slack = (int32_t)(taskRelease[t] + taskDeadline[t] - now);
+            if (next < 0 || slack < nextSlack) {
+                next = t;
+                nextSlack = slack;
+            }
+        }
+        if (next < 0) break;
+
+        if (nextSlack < 0) taskMisses[next]++;
+        uint32_t late = now - taskRelease[next];
+        if (late >= taskPeriod[next]) {
+            uint32_t passed = late / taskPeriod[next];
+            taskSkipped[next] += passed;
+            taskRelease[next] += passed * taskPeriod[next];
+        }
+        taskRelease[next] += taskPeriod[next];
+        execute(next);
+    }
+
+    for (int t = 0; t < taskCount; t++) {
+        if (taskPeriod[t] == 0) execute(t);
+    }
+}
+
+uint32_t scheduler_idle_ms() {
+    uint32_t now = millis();
+    uint32_t idle = UINT32_MAX;
+    for (int t = 0; t < taskCount; t++) {
+        if (taskPeriod[t] == 0) continue;
+        int32_t until = (int32_t)(taskRelease[t] - now);
+        if (until <= 0) return 0;
+        if ((uint32_t)until < idle) idle = (uint32_t)until;
+    }
+    return idle;
+}
+
+void scheduler_report() {
+    for (int t = 0; t < taskCount; t++) {
+        bool trouble = taskOverruns[t] || taskMisses[t] || taskSkipped[t];
+        if (trouble || LOG_LEVEL >= LOG_LEVEL_VERBOSE) {
+            uint32_t avgUs = taskRuns[t] ? (uint32_t)(taskTotalUs[t] / taskRuns[t]) : 0;
+            (trouble ? logWarn : logVerbose)("SCHED", "%s: runs=%lu avg=%lu us max=%lu us overruns=%lu misses=%lu skipped=%lu",
+                                            taskName[t], (unsigned long)taskRuns[t], (unsigned long)avgUs,
+                                            (unsigned long)taskMaxUs[t], (unsigned long)taskOverruns[t],
+                                            (unsigned long)taskMisses[t], (unsigned long)taskSkipped[t]);
+        }
+        taskRuns[t] = taskOverruns[t] = taskMisses[t] = taskSkipped[t] = taskMaxUs[t] = 0;
+        taskTotalUs[t] = 0;
+    }
+    profiler_report();
+    fix_cache_report();
+}
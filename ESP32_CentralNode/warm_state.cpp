@@ -0,0 +1,149 @@
+#include <Arduino.h>
+#include <string.h>
+#include "warm_state.h"
+#include "logging.h"
+
+#if defined(ESP32)
+#include <esp_attr.h>
+#include <esp_system.h>
+#elif defined(ESP8266)
+extern "C" {
+#include <user_interface.h>
+}
+#endif
+
+constexpr uint32_t WARM_MAGIC = 0x314D5257; // "WRM1"
+
+struct WarmState {
+    uint32_t magic;
+    uint32_t checksum; // FNV-1a of everything after it
+    uint32_t size;     // sizeof(WarmState), catches a layout change between builds
+    uint16_t zoneCount;
+    uint8_t resultSeq;
+    uint8_t reserved;
+    WarmWifi wifi;
+    WarmZone zones[MAX_ZONES];
+};
+
+#if defined(ESP32)
+RTC_NOINIT_ATTR WarmState warm;
+#elif defined(ESP8266)
+// RTC user memory is addressed in 4-byte blocks; blocks 0-31 belong to OTA updates
+constexpr uint32_t WARM_RTC_BLOCK = 32;
+static_assert(sizeof(WarmState) <= 512 - WARM_RTC_BLOCK * 4, "WarmState does not fit the RTC user memory");
+WarmState warm;
+#else
+WarmState warm; // Host builds: never survives, every start is cold
+#endif
+
+bool warmBoot = false;
+
+static uint32_t checksum(const WarmState& s) {
+    const uint8_t* p = (const uint8_t*)&s.size;
+    const uint8_t* end = (const uint8_t*)&s + sizeof(WarmState);
+    uint32_t h = 2166136261u;
+    while (p < end) {
+        h ^= *p++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static void seal() {
+    warm.magic = WARM_MAGIC;
+    warm.size = sizeof(WarmState);
+    warm.checksum = checksum(warm);
+#if defined(ESP8266)
+    ESP.rtcUserMemoryWrite(WARM_RTC_BLOCK, (uint32_t*)&warm, sizeof(WarmState));
+#endif
+}
+
+static bool power_on_reset() {
+#if defined(ESP32)
+    return esp_reset_reason() == ESP_RST_POWERON;
+#elif defined(ESP8266)
+    return ESP.getResetInfoPtr()->reason == REASON_DEFAULT_RST;
+#else
+    return true;
+#endif
+}
+
+bool warm_boot_check() {
+#if defined(ESP8266)
+    ESP.rtcUserMemoryRead(WARM_RTC_BLOCK, (uint32_t*)&warm, sizeof(WarmState));
+#endif
+    warmBoot = !power_on_reset() && warm.magic == WARM_MAGIC && warm.size == sizeof(WarmState) &&
+               warm.checksum == checksum(warm) && warm.zoneCount <= MAX_ZONES;
+    if (warmBoot) {
+        logInfo("WARM", "Warm restart: state of %d zone(s) kept, Wi-Fi %s.", warm.zoneCount,
+                warm.wifi.channel != 0 ? "cached" : "not cached");
+    } else {
+        logInfo("WARM", "Cold boot.");
+        memset(&warm, 0, sizeof(WarmState));
+    }
+    return warmBoot;
+}
+
+bool is_warm_boot() {
+    return warmBoot;
+}
+
+const WarmWifi* warm_wifi() {
+    return warmBoot && warm.wifi.channel != 0 ? &warm.wifi : nullptr;
+}
+
+void warm_save_wifi(const uint8_t* bssid, int channel, uint32_t ip, uint32_t gateway, uint32_t subnet, uint32_t dns) {
+    if (bssid == nullptr || channel <= 0 || channel > 255) return;
+    memcpy(warm.wifi.bssid, bssid, sizeof(warm.wifi.bssid));
+    warm.wifi.channel = (uint8_t)channel;
+    warm.wifi.ip = ip;
+    warm.wifi.gateway = gateway;
+    warm.wifi.subnet = subnet;
+    warm.wifi.dns = dns;
+    // A reset before the first interval still finds the association
+    seal();
+}
+
+void warm_clear_wifi() {
+    warm.wifi.channel = 0;
+    seal();
+}
+
+int16_t warm_cm(float v) {
+    long cm = lround(v);
+    if (cm > 32767) return 32767;
+    if (cm < -32768) return -32768;
+    return (int16_t)cm;
+}
+
+void warm_state_save() {
+#if !defined(ESP32) && !defined(ESP8266)
+    return; // Nothing would read it back
+#endif
+    int count = zone_count();
+    if (count > MAX_ZONES) count = MAX_ZONES;
+    warm.zoneCount = (uint16_t)count;
+    warm.resultSeq = result_packet_seq();
+    for (int zone = 0; zone < count; zone++) {
+        WarmZone& w = warm.zones[zone];
+        save_zone_state(zone, w);
+        save_codec_state(zone, w);
+        save_tracks(zone, w);
+    }
+    seal();
+}
+
+void warm_state_restore() {
+    if (!warmBoot) return;
+    set_result_packet_seq(warm.resultSeq);
+    int restored = 0;
+    int count = zone_count() < warm.zoneCount ? zone_count() : warm.zoneCount;
+    for (int zone = 0; zone < count; zone++) {
+        const WarmZone& w = warm.zones[zone];
+        if (!restore_zone_state(zone, w)) continue;
+        restore_codec_state(zone, w);
+        restore_tracks(zone, w);
+        restored++;
+    }
+    logInfo("WARM", "Restored %d of %d zone(s) from before the reset.", restored, zone_count());
+}
@@ -0,0 +1,74 @@
+#ifndef WARM_STATE_H
+#define WARM_STATE_H
+
+#include <stdint.h>
+#include "config.h"
+#include "multi_target.h"
+
+// Warm restart: the tracking state and the Wi-Fi association are kept in RTC
+// memory after every interval and restored after a reset that is not a power
+// cycle. The ESP8266's 512 bytes do not hold the fix history.
+
+#if defined(ESP8266)
+#define WARM_HISTORY_SIZE 0
+#else
+#define WARM_HISTORY_SIZE MAX_HISTORY_SIZE
+#endif
+
+constexpr uint32_t FAST_CONNECT_TIMEOUT_MS = 1500; // Rejoin with the cached association, then fall back to a scan
+
+struct WarmWifi {
+    uint8_t bssid[6];
+    uint8_t channel; // 0 while nothing is cached
+    uint8_t reserved;
+    uint32_t ip;
+    uint32_t gateway;
+    uint32_t subnet;
+    uint32_t dns;
+};
+
+// One zone; positions in whole centimetres
+struct WarmZone {
+    int32_t deviceId;
+    int16_t lastX, lastY, lastZ;
+    int16_t sentX, sentY, sentZ;
+    uint8_t recordsToKey;
+    uint8_t recordCounter;
+    uint16_t nextTrackId;
+    uint16_t trackId[MAX_TRACKS];
+    int16_t trackX[MAX_TRACKS];
+    int16_t trackY[MAX_TRACKS];
+    int16_t trackZ[MAX_TRACKS];
+    uint8_t trackHits[MAX_TRACKS];
+    uint8_t trackMisses[MAX_TRACKS];
+#if WARM_HISTORY_SIZE > 0
+    uint8_t histIndex;
+    uint8_t histCount;
+    int16_t histX[WARM_HISTORY_SIZE];
+    int16_t histY[WARM_HISTORY_SIZE];
+    int16_t histZ[WARM_HISTORY_SIZE];
+#endif
+};
+
+bool warm_boot_check(); // First thing in setup(): true if a valid snapshot survived the reset
+bool is_warm_boot();
+const WarmWifi* warm_wifi(); // Cached association, nullptr if there is none
+void warm_save_wifi(const uint8_t* bssid, int channel, uint32_t ip, uint32_t gateway, uint32_t subnet, uint32_t dns);
+void warm_clear_wifi();      // The cached association did not work
+void warm_state_save();      // End of every averaging interval
+void warm_state_restore();   // From initialize_logic(), once the zone table is built
+
+int16_t warm_cm(float v); // Rounded and clamped to int16
+
+// Provided by the modules that own the state
+int zone_count();                                     // calculation_logic.cpp
+void save_zone_state(int zone, WarmZone& w);
+bool restore_zone_state(int zone, const WarmZone& w); // false if the zone's deviceID changed
+void save_codec_state(int zone, WarmZone& w);         // result_codec.cpp
+void restore_codec_state(int zone, const WarmZone& w);
+uint8_t result_packet_seq();
+void set_result_packet_seq(uint8_t seq);
+void save_tracks(int zone, WarmZone& w);              // multi_target.cpp
+void restore_tracks(int zone, const WarmZone& w);
+
+#endif // WARM_STATE_H
@@ -3,6 +3,9 @@
 #include "network_manager.h"
 #include "calculation_logic.h"
 #include "logging.h"
+#include "tuning.h"
+#include "scheduler.h"
+#include "warm_state.h"
 
 void setup() {
     Serial.begin(115200);
@@ -14,7 +17,12 @@ void setup() {
     logInfo("CONFIG", "Local Broker Port: %d", LOCAL_BROKER_PORT);
     logInfo("CONFIG", "External Gateway: %s:%d", EXTERNAL_BROKER_IP, EXTERNAL_BROKER_PORT);
 
-    // Initialize modules
+    // Before anything touches the state it may restore
+    warm_boot_check();
+
+    // Initialize modules; each registers its tasks with the scheduler
+    setup_scheduler();
+    setup_tuning();           // Load persisted parameters first
     setup_wifi();
     setup_local_broker();
     setup_external_client();
@@ -22,8 +30,6 @@ void setup() {
 }
 
 void loop() {
-    // Loop all network modules and the calculation logic
-    loop_local_broker();
-    loop_external_client();
-    loop_logic();
+    // Broker, client, tuning and averaging all run as scheduler tasks
+    run_scheduler();
 }
@@ -4,143 +4,621 @@
 #include "config.h"
 #include "types.h"
 #include "logging.h"
+#include "fix_cache.h"
+#include "geofence.h"
+#include "history_store.h"
+#include "ingest.h"
+#include "motion.h"
+#include "track_simplify.h"
+#include "multi_target.h"
+#include "profiler.h"
+#include "result_codec.h"
+#include "scheduler.h"
+#include "tdma.h"
+#include "warm_state.h"
 
-// --- State Variables & Buffers ---
-float latestDistances[3] = { -1.0, -1.0, -1.0 };
-bool newDataFlags[3] = { false, false, false };
-Point3D coordHistory[HISTORY_SIZE];
-int coordHistoryIndex = 0;
-int coordHistoryCount = 0;
-Point3D periodicHistory[HISTORY_SIZE * 2];
-int periodicHistoryCount = 0;
-unsigned long lastAverageTime = 0;
+// --- Zone Table ---
+// Every tracked room is a row, stored column by column (struct of arrays) so
+// the per-message path only touches the route entry and the few bytes of its
+// own zone, and the per-interval pass walks each column linearly.
+int zoneCount = 0;
+int16_t sensorRoute[MAX_SENSOR_ID + 1]; // (zone << 2) | slot, -1 if the sensor id is not mapped
+
+int zoneDeviceId[MAX_ZONES];
+float zoneS2a[MAX_ZONES];
+float zoneS3c[MAX_ZONES];
+float zoneS3b[MAX_ZONES];
+float zoneLatest[MAX_ZONES][3];
+uint8_t zoneNewMask[MAX_ZONES]; // One bit per slot holding a range not used in a fix yet
+
+// Candidate ranges per slot for MULTI_TARGET_MODE
+float zoneCand[MAX_ZONES][3][MAX_CANDIDATES];
+uint8_t zoneCandCount[MAX_ZONES][3];
+uint8_t zoneCandMask[MAX_ZONES];
+
+// Last HISTORY_SIZE fixes per zone (ring), for calculate_r
+float zoneHistX[MAX_ZONES][MAX_HISTORY_SIZE];
+float zoneHistY[MAX_ZONES][MAX_HISTORY_SIZE];
+float zoneHistZ[MAX_ZONES][MAX_HISTORY_SIZE];
+uint8_t zoneHistIndex[MAX_ZONES];
+uint8_t zoneHistCount[MAX_ZONES];
+
+// Running sums of the fixes in the current averaging interval
+float zoneSumX[MAX_ZONES];
+float zoneSumY[MAX_ZONES];
+float zoneSumZ[MAX_ZONES];
+uint16_t zoneFixCount[MAX_ZONES];
+uint16_t zoneDegradedCount[MAX_ZONES]; // Fixes of the interval solved from two ranges
+uint16_t zoneTicksSince[MAX_ZONES];     // Runs of the averaging task since the zone's last result (MOTION_ADAPTIVE)
+uint8_t zoneSentMotion[MAX_ZONES];      // MotionState of the zone's last result
+
+// Sensor liveness: a slot is stale once it has been silent for SENSOR_TIMEOUT_MS
+// while the other slots of its zone kept reporting. Requiring
+// STALE_AFTER_MESSAGES from the others as well keeps a stall of this node
+// (queued messages all handled at one millis()) from looking like dead
+// sensors. With one stale slot the zone keeps fixing from the other two
+// ranges at the height of its last full fix (degraded mode) until the sensor
+// is back.
+constexpr uint8_t STALE_AFTER_MESSAGES = 6;
+uint32_t zoneLastSeen[MAX_ZONES][3];
+uint8_t zoneOthersSince[MAX_ZONES][3]; // Messages from the zone's other slots since this slot's last, saturating
+uint8_t zoneStaleMask[MAX_ZONES];
+float zoneLastX[MAX_ZONES]; // Last fix: x, y pick between the two degraded solutions
+float zoneLastY[MAX_ZONES];
+float zoneLastZ[MAX_ZONES]; // Height of the last full fix, 0 before the first one
+
+// Averaging runs as a scheduler task on a fixed AVERAGE_INTERVAL_MS grid
+constexpr uint32_t AVERAGE_DEADLINE_MS = 50;   // Start later than this after the release counts as a miss
+constexpr uint32_t AVERAGE_BUDGET_US = 20000;  // Averaging and publishing every zone
+int averageTask = -1;
 
 // --- Forward Declarations ---
-void performInstantCalculation();
-void calculateAndSendAverage();
-float calculate_r();
+bool solve_fix(int zone, float r1, float r2, float r3, Point3D& p, float& zSquared);
+void performInstantCalculation(int zone);
+void performDegradedCalculation(int zone, int missingSlot);
+void record_fix(int zone, float x, float y, float z);
+int ingest_slot(int sensor_id);
+void apply_distance(int zone, int slot, float distance);
+void apply_candidates(int zone, int slot, const float* ranges, int count);
+void update_liveness(int zone);
+void performMultiTargetFrame(int zone);
+void calculateAndSendAverage(int zone);
+void clear_interval(int zone);
+void publish_interval_results();
+float calculate_r(int zone);
 
 void initialize_logic() {
-    lastAverageTime = millis();
+    for (int i = 0; i <= MAX_SENSOR_ID; i++) sensorRoute[i] = -1;
+    zoneCount = 0;
+
+    // Zone 0 is the board's own room: sensors 1-3, the tunable anchors and OUTPUT_DEVICE_ID
+    const int primarySensors[3] = { 1, 2, 3 };
+    add_zone(OUTPUT_DEVICE_ID, primarySensors, S2_a, S3_c, S3_b);
+    for (int i = 0; i < MAX_ZONES; i++) {
+        const ZoneConfig& z = EXTRA_ZONES[i];
+        if (z.deviceId != 0) add_zone(z.deviceId, z.sensorIds, z.S2_a, z.S3_c, z.S3_b);
+    }
+    logInfo("ZONES", "Tracking %d zone(s), capacity %d.", zoneCount, MAX_ZONES);
+    setup_ingest();
+    setup_tdma();
+    setup_history_store();
+    setup_geofence();
+    setup_motion();
+    averageTask = scheduler_add("average", publish_interval_results, motion_tick_ms(), AVERAGE_DEADLINE_MS,
+                                AVERAGE_BUDGET_US);
+    warm_state_restore();
 }
 
-void loop_logic() {
-    if (millis() - lastAverageTime >= AVERAGE_INTERVAL_MS) {
-        lastAverageTime = millis();
-        calculateAndSendAverage();
+int add_zone(int deviceId, const int sensorIds[3], float s2a, float s3c, float s3b) {
+    if (zoneCount >= MAX_ZONES) {
+        logError("ZONES", "Zone table full (%d), deviceID %d not added.", MAX_ZONES, deviceId);
+        return -1;
+    }
+    if (s2a == 0 || s3b == 0) {
+        logError("ZONES", "S2_a and S3_b cannot be zero, deviceID %d not added.", deviceId);
+        return -1;
+    }
+    for (int slot = 0; slot < 3; slot++) {
+        int id = sensorIds[slot];
+        if (id < 0 || id > MAX_SENSOR_ID || sensorRoute[id] >= 0) {
+            logError("ZONES", "Sensor id %d is out of range or already mapped, deviceID %d not added.", id, deviceId);
+            return -1;
+        }
+    }
+
+    int zone = zoneCount++;
+    for (int slot = 0; slot < 3; slot++) {
+        sensorRoute[sensorIds[slot]] = (int16_t)((zone << 2) | slot);
+        zoneLatest[zone][slot] = -1.0;
+        zoneLastSeen[zone][slot] = millis();
+        zoneOthersSince[zone][slot] = 0;
+        ingest_reset_slot(zone * 3 + slot);
     }
+    tdma_assign(zone, sensorIds);
+    history_store_assign(zone, deviceId);
+    geofence_assign(zone, deviceId);
+    motion_reset(zone);
+    simplify_reset(zone);
+    zoneTicksSince[zone] = 0;
+    zoneSentMotion[zone] = MOTION_UNKNOWN;
+    zoneStaleMask[zone] = 0;
+    zoneLastX[zone] = zoneLastY[zone] = zoneLastZ[zone] = 0;
+    zoneDegradedCount[zone] = 0;
+    zoneDeviceId[zone] = deviceId;
+    zoneNewMask[zone] = 0;
+    zoneCandMask[zone] = 0;
+    reset_tracks(zone);
+    result_codec_reset(zone);
+    set_zone_anchors(zone, s2a, s3c, s3b);
+    zoneHistIndex[zone] = 0;
+    zoneHistCount[zone] = 0;
+    zoneSumX[zone] = zoneSumY[zone] = zoneSumZ[zone] = 0;
+    zoneFixCount[zone] = 0;
+    logVerbose("ZONES", "Zone %d: deviceID=%d, sensors %d,%d,%d", zone, deviceId, sensorIds[0], sensorIds[1], sensorIds[2]);
+    return zone;
 }
 
-void on_distance_received(int sensor_id, float distance) {
-    if (sensor_id >= 1 && sensor_id <= 3) {
-        int index = sensor_id - 1;
-        latestDistances[index] = distance;
-        newDataFlags[index] = true;
-        logVerbose("STATE", "Updated distance: id=%d, d=%.2f. Flags: %d,%d,%d", sensor_id, distance, newDataFlags[0], newDataFlags[1], newDataFlags[2]);
+void set_zone_anchors(int zone, float s2a, float s3c, float s3b) {
+    if (zone < 0 || zone >= zoneCount) return;
+    zoneS2a[zone] = s2a;
+    zoneS3c[zone] = s3c;
+    zoneS3b[zone] = s3b;
+    fix_cache_invalidate();
+}
+
+// Drops the history after HISTORY_SIZE changed so indices stay consistent
+void reset_history() {
+    for (int zone = 0; zone < zoneCount; zone++) {
+        zoneHistIndex[zone] = 0;
+        zoneHistCount[zone] = 0;
+        zoneSumX[zone] = zoneSumY[zone] = zoneSumZ[zone] = 0;
+        zoneFixCount[zone] = 0;
+        zoneDegradedCount[zone] = 0;
+    }
+}
+
+int zone_count() {
+    return zoneCount;
+}
 
-        if (newDataFlags[0] && newDataFlags[1] && newDataFlags[2]) {
-            logVerbose("CALC", "All new data received. Triggering calculation.");
-            performInstantCalculation();
-            newDataFlags[0] = false;
-            newDataFlags[1] = false;
-            newDataFlags[2] = false;
+// --- Warm Restart (see warm_state.h) ---
+void save_zone_state(int zone, WarmZone& w) {
+    w.deviceId = zoneDeviceId[zone];
+    w.lastX = warm_cm(zoneLastX[zone]);
+    w.lastY = warm_cm(zoneLastY[zone]);
+    w.lastZ = warm_cm(zoneLastZ[zone]);
+#if WARM_HISTORY_SIZE > 0
+    w.histIndex = zoneHistIndex[zone];
+    w.histCount = zoneHistCount[zone];
+    for (int i = 0; i < zoneHistCount[zone]; i++) {
+        w.histX[i] = warm_cm(zoneHistX[zone][i]);
+        w.histY[i] = warm_cm(zoneHistY[zone][i]);
+        w.histZ[i] = warm_cm(zoneHistZ[zone][i]);
+    }
+#endif
+}
+
+bool restore_zone_state(int zone, const WarmZone& w) {
+    if (w.deviceId != zoneDeviceId[zone]) return false;
+    zoneLastX[zone] = w.lastX;
+    zoneLastY[zone] = w.lastY;
+    zoneLastZ[zone] = w.lastZ;
+#if WARM_HISTORY_SIZE > 0
+    // A history kept under another HISTORY_SIZE would not line up with the ring
+    if (w.histCount <= HISTORY_SIZE && w.histIndex < HISTORY_SIZE) {
+        zoneHistIndex[zone] = w.histIndex;
+        zoneHistCount[zone] = w.histCount;
+        for (int i = 0; i < w.histCount; i++) {
+            zoneHistX[zone][i] = w.histX[i];
+            zoneHistY[zone][i] = w.histY[i];
+            zoneHistZ[zone][i] = w.histZ[i];
         }
-    } else {
-        logWarn("RECV", "Ignoring message with invalid ID: %d", sensor_id);
     }
+#endif
+    return true;
+}
+
+void publish_interval_results() {
+    PROFILE_ZONE("publish_interval_results");
+    for (int zone = 0; zone < zoneCount; zone++) {
+        if (MOTION_ADAPTIVE) {
+            // The zone's interval in runs of the task, rounded; a new motion state goes out at once
+            uint32_t runs = (motion_interval_ms(zone) + MOTION_MIN_INTERVAL_MS / 2) / MOTION_MIN_INTERVAL_MS;
+            if (++zoneTicksSince[zone] < runs && motion_state(zone) == zoneSentMotion[zone]) continue;
+            zoneTicksSince[zone] = 0;
+        }
+        calculateAndSendAverage(zone);
+    }
+    if (BINARY_RESULTS) result_packet_flush();
+    ingest_log_stats();
+    warm_state_save();
 }
 
-void performInstantCalculation() {
-    float d1 = latestDistances[0] + DISTANCE_OFFSET;
-    float d2 = latestDistances[1] + DISTANCE_OFFSET;
-    float d3 = latestDistances[2] + DISTANCE_OFFSET;
-    
-    float x = (pow(S2_a, 2) + pow(d1, 2) - pow(d2, 2)) / (2 * S2_a);
-    float y_numerator = pow(d1, 2) + pow(S3_c, 2) + pow(S3_b, 2) - pow(d3, 2) - (2 * S3_c * x);
-    float y = y_numerator / (2 * S3_b);
-    float zSquared = pow(d1, 2) - pow(x, 2) - pow(y, 2);
+void update_average_period() {
+    scheduler_set_period(averageTask, motion_tick_ms());
+}
 
-    if (zSquared < 0) {
-        logWarn("CALC", "Invalid calculation (z^2 = %.4f < 0). Discarding.", zSquared);
+// Sensor message {"id", "d", "c", "age"}, parsed into the sensor's ingest
+// slot (see ingest.h); the calculation runs when the slot is drained. A
+// sensor id known from the topic or the client login (>= 0) takes the place
+// of "id", and an unmapped or over-rate one is dropped before the payload is
+// parsed.
+void on_sensor_message(int sensor_id, const char* payload, size_t length) {
+    PROFILE_ZONE("on_sensor_message");
+    if (sensor_id > MAX_SENSOR_ID || (sensor_id >= 0 && sensorRoute[sensor_id] < 0)) {
+        logVerbose("RECV", "Ignoring message from unmapped sensor %d", sensor_id);
+        return;
+    }
+    bool admitted = false;
+    if (sensor_id >= 0) {
+        if (!ingest_admit(ingest_slot(sensor_id))) return;
+        admitted = true;
+    }
+    StaticJsonDocument<256> doc; // id, d, c[2], age, me, se
+    DeserializationError error;
+    {
+        PROFILE_ZONE("deserializeJson");
+        error = deserializeJson(doc, payload, length);
+    }
+    if (error) {
+        logError("PARSE", "JSON parse failed on sensor message: %s", error.c_str());
         return;
     }
-    float z = sqrt(zSquared);
+    if ((sensor_id < 0 && !doc.containsKey("id")) || !doc.containsKey("d")) {
+        logWarn("RECV", "Invalid sensor message: missing 'id' or 'd'");
+        return;
+    }
+    if (sensor_id < 0) {
+        sensor_id = doc["id"];
+        if (sensor_id < 0 || sensor_id > MAX_SENSOR_ID || sensorRoute[sensor_id] < 0) {
+            logWarn("RECV", "Ignoring message with unmapped ID: %d", sensor_id);
+            return;
+        }
+    }
+    int slot = ingest_slot(sensor_id);
+    if (!admitted && !ingest_admit(slot)) return;
 
-    if (x <= 0 || y <= 0 || z <= 0) {
-        logWarn("VALIDATION", "Non-positive coord (x=%.2f, y=%.2f, z=%.2f). Discarding.", x, y, z);
+    // Readings a sensor buffered while disconnected carry their age; old ones
+    // would pair with current ranges of the other sensors
+    unsigned long age = doc["age"] | 0UL;
+    if (SENSOR_TIMEOUT_MS != 0 && age > SENSOR_TIMEOUT_MS) {
+        logVerbose("RECV", "Reading from sensor %d is %lu ms old, not used.", sensor_id, age);
         return;
     }
+    IngestValue value;
+    value.distance = doc["d"];
+    value.candCount = 0;
+    value.movingEnergy = doc["me"] | -1;
+    value.stationaryEnergy = doc["se"] | -1;
+    value.hasCandidates = MULTI_TARGET_MODE && doc["c"].is<JsonArray>();
+    if (value.hasCandidates) {
+        for (JsonVariant range : doc["c"].as<JsonArray>()) {
+            if (value.candCount == MAX_CANDIDATES) break;
+            float d = range.as<float>();
+            if (d > 0) value.cand[value.candCount++] = d;
+        }
+    }
+    ingest_put(slot, value);
+}
 
-    logVerbose("CALC", "Instant Coords: x=%.2f, y=%.2f, z=%.2f", x, y, z);
-    Point3D currentCoord = {x, y, z};
+// Ingest slot of a mapped sensor: zone * 3 + slot
+int ingest_slot(int sensor_id) {
+    int route = sensorRoute[sensor_id];
+    return (route >> 2) * 3 + (route & 3);
+}
 
-    coordHistory[coordHistoryIndex] = currentCoord;
-    coordHistoryIndex = (coordHistoryIndex + 1) % HISTORY_SIZE;
-    if (coordHistoryCount < HISTORY_SIZE) coordHistoryCount++;
+void apply_ingested(int slot, const IngestValue& value) {
+    int zone = slot / 3;
+    if (zone >= zoneCount) return;
+    if (value.movingEnergy >= 0) motion_energy(zone, value.movingEnergy, value.stationaryEnergy);
+    apply_distance(zone, slot % 3, value.distance);
+    if (value.hasCandidates) apply_candidates(zone, slot % 3, value.cand, value.candCount);
+}
 
-    if (periodicHistoryCount < (sizeof(periodicHistory) / sizeof(Point3D))) {
-        periodicHistory[periodicHistoryCount++] = currentCoord;
-    } else {
-        logWarn("CALC", "Periodic history buffer full.");
+void apply_distance(int zone, int slot, float distance) {
+    PROFILE_ZONE("apply_distance");
+    uint8_t bit = (uint8_t)(1 << slot);
+    zoneLatest[zone][slot] = distance;
+    zoneLastSeen[zone][slot] = millis();
+    for (int other = 0; other < 3; other++) {
+        if (other == slot) zoneOthersSince[zone][other] = 0;
+        else if (zoneOthersSince[zone][other] < 255) zoneOthersSince[zone][other]++;
+    }
+    zoneNewMask[zone] |= bit;
+    if (zoneStaleMask[zone] & bit) {
+        zoneStaleMask[zone] &= (uint8_t)~bit;
+        logInfo("LIVENESS", "Sensor slot S%d (zone %d) is back.", slot + 1, zone);
+    }
+    update_liveness(zone);
+    logVerbose("STATE", "Updated distance: zone %d S%d, d=%.2f. Flags: %d,%d,%d", zone, slot + 1, distance,
+               zoneNewMask[zone] & 1, (zoneNewMask[zone] >> 1) & 1, (zoneNewMask[zone] >> 2) & 1);
+
+    // Fix once every live slot has a new range: all three, or two in degraded mode
+    uint8_t live = (uint8_t)(0x7 & ~zoneStaleMask[zone]);
+    if ((zoneNewMask[zone] & live) != live) return;
+    if (live == 0x7) {
+        logVerbose("CALC", "All new data received for zone %d. Triggering calculation.", zone);
+        performInstantCalculation(zone);
+    } else if (live == 0x6 || live == 0x5 || live == 0x3) {
+        performDegradedCalculation(zone, live == 0x6 ? 0 : (live == 0x5 ? 1 : 2));
     }
+    zoneNewMask[zone] = 0;
 }
 
-void calculateAndSendAverage() {
-    StaticJsonDocument<256> doc;
-    JsonObject data = doc.createNestedObject("data");
+// Marks slots that fell SENSOR_TIMEOUT_MS and STALE_AFTER_MESSAGES behind the rest of the zone as stale (0 disables the check)
+void update_liveness(int zone) {
+    if (SENSOR_TIMEOUT_MS == 0) return;
+    const uint32_t* seen = zoneLastSeen[zone];
+    uint32_t newest = seen[0];
+    for (int slot = 1; slot < 3; slot++) {
+        if ((int32_t)(seen[slot] - newest) > 0) newest = seen[slot];
+    }
+    for (int slot = 0; slot < 3; slot++) {
+        uint8_t bit = (uint8_t)(1 << slot);
+        if ((zoneStaleMask[zone] & bit) || zoneOthersSince[zone][slot] < STALE_AFTER_MESSAGES ||
+            newest - seen[slot] <= SENSOR_TIMEOUT_MS) {
+            continue;
+        }
+        zoneStaleMask[zone] |= bit;
+        zoneNewMask[zone] &= (uint8_t)~bit;
+        logWarn("LIVENESS", "Zone %d: sensor slot S%d silent for %lu ms, marked stale.", zone, slot + 1,
+                (unsigned long)(newest - seen[slot]));
+    }
+}
 
-    if (periodicHistoryCount > 0) {
-        float sumX = 0, sumY = 0, sumZ = 0;
-        for (int i = 0; i < periodicHistoryCount; i++) {
-            sumX += periodicHistory[i].x;
-            sumY += periodicHistory[i].y;
-            sumZ += periodicHistory[i].z;
+void apply_candidates(int zone, int slot, const float* ranges, int count) {
+    for (int i = 0; i < count; i++) zoneCand[zone][slot][i] = ranges[i];
+    zoneCandCount[zone][slot] = (uint8_t)count;
+    zoneCandMask[zone] |= (uint8_t)(1 << slot);
+
+    if (zoneCandMask[zone] == 0x7) {
+        performMultiTargetFrame(zone);
+        zoneCandMask[zone] = 0;
+    }
+}
+
+// Trilateration from raw ranges (DISTANCE_OFFSET is added here) with the zone's anchors.
+// Returns false for an invalid fix; zSquared and p then say why. Whole cm ranges go through fix_cache.h.
+bool solve_fix(int zone, float r1, float r2, float r3, Point3D& p, float& zSquared) {
+    float a = zoneS2a[zone];
+    float c = zoneS3c[zone];
+    float b = zoneS3b[zone];
+    float d1 = r1 + DISTANCE_OFFSET;
+    float d2 = r2 + DISTANCE_OFFSET;
+    float d3 = r3 + DISTANCE_OFFSET;
+
+    bool valid;
+    if (fix_cache_get(zone, r1, r2, r3, p, zSquared, valid)) return valid;
+
+    p.x = (pow(a, 2) + pow(d1, 2) - pow(d2, 2)) / (2 * a);
+    float y_numerator = pow(d1, 2) + pow(c, 2) + pow(b, 2) - pow(d3, 2) - (2 * c * p.x);
+    p.y = y_numerator / (2 * b);
+    zSquared = pow(d1, 2) - pow(p.x, 2) - pow(p.y, 2);
+    p.z = zSquared < 0 ? 0 : sqrt(zSquared);
+    valid = zSquared >= 0 && p.x > 0 && p.y > 0 && p.z > 0;
+    fix_cache_put(zone, r1, r2, r3, p, zSquared, valid);
+    return valid;
+}
+
+void performInstantCalculation(int zone) {
+    PROFILE_ZONE("performInstantCalculation");
+    const float* latest = zoneLatest[zone];
+    Point3D p;
+    float zSquared;
+    if (!solve_fix(zone, latest[0], latest[1], latest[2], p, zSquared)) {
+        if (zSquared < 0) {
+            logWarn("CALC", "Invalid calculation (z^2 = %.4f < 0). Discarding.", zSquared);
+        } else {
+            logWarn("VALIDATION", "Non-positive coord (x=%.2f, y=%.2f, z=%.2f). Discarding.", p.x, p.y, p.z);
         }
-        float avgX = sumX / periodicHistoryCount;
-        float avgY = sumY / periodicHistoryCount;
-        float avgZ = sumZ / periodicHistoryCount;
+        return;
+    }
+    float x = p.x, y = p.y, z = p.z;
 
-        float r_raw = calculate_r();
-        float r_offset = (r_raw >= 0) ? (r_raw + DISTANCE_OFFSET) : DISTANCE_OFFSET;
+    logVerbose("CALC", "Instant Coords (zone %d): x=%.2f, y=%.2f, z=%.2f", zone, x, y, z);
+    logFix(zoneDeviceId[zone], latest[0], latest[1], latest[2], x, y, z);
 
-        doc["deviceID"] = OUTPUT_DEVICE_ID;
-        data["x"] = round(avgX * 100) / 100.0;
-        data["y"] = round(avgY * 100) / 100.0;
-        data["z"] = round(avgZ * 100) / 100.0;
+    zoneLastZ[zone] = z;
+    record_fix(zone, x, y, z);
+}
+
+// Two ranges and the height of the last full fix: each range is then a circle
+// in the plane at that height, and of the two intersections (mirrored across
+// the line through the two anchors) the one inside the room and nearer to the
+// zone's last fix is kept. Ranges that do not quite meet (noise) give the
+// point between the circles. Close to that line the solution is poorly
+// conditioned: when it crosses the room (S1 lost), expect a few times the
+// error of a full fix there.
+void performDegradedCalculation(int zone, int missingSlot) {
+    PROFILE_ZONE("performDegradedCalculation");
+    float z = zoneLastZ[zone];
+    if (z <= 0) {
+        logVerbose("DEGRADED", "Zone %d: no full fix yet, cannot solve from two ranges.", zone);
+        return;
+    }
+    const float anchorX[3] = { 0, zoneS2a[zone], zoneS3c[zone] };
+    const float anchorY[3] = { 0, 0, zoneS3b[zone] };
+    int s0 = missingSlot == 0 ? 1 : 0;
+    int s1 = missingSlot == 2 ? 1 : 2;
+    float d0 = zoneLatest[zone][s0] + DISTANCE_OFFSET;
+    float d1 = zoneLatest[zone][s1] + DISTANCE_OFFSET;
+    float rho0Sq = d0 * d0 - z * z;
+    float rho1Sq = d1 * d1 - z * z;
+    if (rho0Sq < 0 || rho1Sq < 0) {
+        logWarn("DEGRADED", "Zone %d: range shorter than the last height (%.2f). Discarding.", zone, z);
+        return;
+    }
+
+    float ux = anchorX[s1] - anchorX[s0];
+    float uy = anchorY[s1] - anchorY[s0];
+    float dist = sqrt(ux * ux + uy * uy);
+    ux /= dist;
+    uy /= dist;
+    float along = (rho0Sq - rho1Sq + dist * dist) / (2 * dist);
+    float hSq = rho0Sq - along * along;
+    float h = hSq > 0 ? sqrt(hSq) : 0;
+    float mx = anchorX[s0] + along * ux;
+    float my = anchorY[s0] + along * uy;
+    float ax = mx - h * uy, ay = my + h * ux;
+    float bx = mx + h * uy, by = my - h * ux;
+    float da = (ax - zoneLastX[zone]) * (ax - zoneLastX[zone]) + (ay - zoneLastY[zone]) * (ay - zoneLastY[zone]);
+    float db = (bx - zoneLastX[zone]) * (bx - zoneLastX[zone]) + (by - zoneLastY[zone]) * (by - zoneLastY[zone]);
+    bool aValid = ax > 0 && ay > 0;
+    bool bValid = bx > 0 && by > 0;
+    if (!aValid && !bValid) {
+        logWarn("VALIDATION", "Non-positive degraded coord (x=%.2f, y=%.2f). Discarding.", ax, ay);
+        return;
+    }
+    bool pickA = aValid && (!bValid || da <= db);
+    float x = pickA ? ax : bx;
+    float y = pickA ? ay : by;
+
+    logVerbose("DEGRADED", "Zone %d without S%d: x=%.2f, y=%.2f, z=%.2f (held)", zone, missingSlot + 1, x, y, z);
+    zoneDegradedCount[zone]++;
+    record_fix(zone, x, y, z);
+}
+
+void record_fix(int zone, float x, float y, float z) {
+    zoneLastX[zone] = x;
+    zoneLastY[zone] = y;
+
+    int h = zoneHistIndex[zone];
+    zoneHistX[zone][h] = x;
+    zoneHistY[zone][h] = y;
+    zoneHistZ[zone][h] = z;
+    zoneHistIndex[zone] = (uint8_t)((h + 1) % HISTORY_SIZE);
+    if (zoneHistCount[zone] < HISTORY_SIZE) zoneHistCount[zone]++;
+
+    zoneSumX[zone] += x;
+    zoneSumY[zone] += y;
+    zoneSumZ[zone] += z;
+    zoneFixCount[zone]++;
+    history_store_record(zone, x, y, z);
+    geofence_check(zone, x, y, z);
+    motion_fix(zone, x, y, z);
+}
+
+// Solves every candidate triplet (at most MAX_CANDIDATES^3) and hands the valid ones to the tracker
+void performMultiTargetFrame(int zone) {
+    PROFILE_ZONE("performMultiTargetFrame");
+    TargetFix fixes[MAX_CANDIDATES * MAX_CANDIDATES * MAX_CANDIDATES];
+    int count = 0;
+    int tried = 0;
+    const uint8_t* n = zoneCandCount[zone];
+    for (int i = 0; i < n[0]; i++) {
+        for (int j = 0; j < n[1]; j++) {
+            for (int k = 0; k < n[2]; k++) {
+                tried++;
+                float zSquared;
+                TargetFix& fix = fixes[count];
+                if (!solve_fix(zone, zoneCand[zone][0][i], zoneCand[zone][1][j], zoneCand[zone][2][k], fix.p, zSquared)) continue;
+                fix.cand[0] = (uint8_t)i;
+                fix.cand[1] = (uint8_t)j;
+                fix.cand[2] = (uint8_t)k;
+                count++;
+            }
+        }
+    }
+    logVerbose("MULTI", "Zone %d: %d of %d candidate triplets solved.", zone, count, tried);
+    update_tracks(zone, fixes, count);
+}
+
+void calculateAndSendAverage(int zone) {
+    PROFILE_ZONE("calculateAndSendAverage");
+    StaticJsonDocument<512> doc;
+    JsonObject data = doc.createNestedObject("data");
+    doc["deviceID"] = zoneDeviceId[zone];
+
+    int count = zoneFixCount[zone];
+    bool degraded = count > 0 && zoneDegradedCount[zone] > 0;
+    MotionState motion = motion_state(zone);
+    Point3D avg;
+    float r_offset = 0;
+    if (count > 0) {
+        avg.x = zoneSumX[zone] / count;
+        avg.y = zoneSumY[zone] / count;
+        avg.z = zoneSumZ[zone] / count;
+    }
+
+    // With SIMPLIFY_TOLERANCE_CM a result the receiver can extrapolate is dropped (track_simplify.h)
+    if (count == 0) {
+        simplify_reset(zone);
+    } else if (!simplify_result(zone, avg.x, avg.y, avg.z,
+                                degraded || motion != zoneSentMotion[zone] || MULTI_TARGET_MODE)) {
+        clear_interval(zone);
+        return;
+    }
+
+    if (count > 0) {
+        float r_raw = calculate_r(zone);
+        r_offset = (r_raw >= 0) ? (r_raw + DISTANCE_OFFSET) : DISTANCE_OFFSET;
+
+        data["x"] = round(avg.x * 100) / 100.0;
+        data["y"] = round(avg.y * 100) / 100.0;
+        data["z"] = round(avg.z * 100) / 100.0;
         data["r"] = round(r_offset * 100) / 100.0;
 
     } else {
-        logInfo("SENDER", "No valid data in interval. Sending default values.");
-        doc["deviceID"] = OUTPUT_DEVICE_ID;
+        logInfo("SENDER", "No valid data in interval for deviceID %d. Sending default values.", zoneDeviceId[zone]);
         data["x"] = 0;
         data["y"] = 0;
         data["z"] = 0;
         data["r"] = 0;
     }
 
-    String output;
-    serializeJson(doc, output);
-    logResult(output.c_str());
+    if (degraded) doc["degraded"] = true;
+    if (motion != MOTION_UNKNOWN) doc["motion"] = motion_name(motion);
+    zoneSentMotion[zone] = motion;
+
+    if (MULTI_TARGET_MODE) {
+        write_tracks(zone, doc.createNestedArray("targets"));
+    }
+
+    char output[384]; // Fixed buffer: no heap String per result
+    {
+        PROFILE_ZONE("serializeJson");
+        serializeJson(doc, output, sizeof(output));
+    }
+    logResult(output);
+
+    if (BINARY_RESULTS) {
+        // Packed with the other zones of this interval, publish_interval_results() flushes the message
+        uint16_t trackIds[MAX_TRACKS];
+        Point3D trackPos[MAX_TRACKS];
+        int trackCount = MULTI_TARGET_MODE ? read_tracks(zone, trackIds, trackPos) : 0;
+        result_packet_add(zone, zoneDeviceId[zone], count > 0 ? &avg : nullptr, r_offset, degraded, motion,
+                          MULTI_TARGET_MODE ? trackIds : nullptr, trackPos, trackCount);
+    } else {
+        publish_results(output); // This will call the publisher in network_manager
+    }
+    clear_interval(zone);
+}
 
-    publish_results(output.c_str()); // This will call the publisher in network_manager
-    
-    periodicHistoryCount = 0;
-    logVerbose("STATE", "Periodic history cleared.");
+// Starts the zone's next averaging interval
+void clear_interval(int zone) {
+    zoneSumX[zone] = zoneSumY[zone] = zoneSumZ[zone] = 0;
+    zoneFixCount[zone] = 0;
+    zoneDegradedCount[zone] = 0;
+    logVerbose("STATE", "Periodic sums cleared for zone %d.", zone);
 }
 
-float calculate_r() {
-    if (coordHistoryCount < HISTORY_SIZE) {
+float calculate_r(int zone) {
+    PROFILE_ZONE("calculate_r");
+    if (zoneHistCount[zone] < HISTORY_SIZE) {
         return -1.0;
     }
 
-    float rValues[HISTORY_SIZE];
+    const float* hx = zoneHistX[zone];
+    const float* hy = zoneHistY[zone];
+    const float* hz = zoneHistZ[zone];
+    float rValues[MAX_HISTORY_SIZE];
     float sumR = 0;
     for (int i = 0; i < HISTORY_SIZE; i++) {
-        rValues[i] = sqrt(pow(coordHistory[i].x, 2) + pow(coordHistory[i].y, 2) + pow(coordHistory[i].z, 2));
+        rValues[i] = sqrt(pow(hx[i], 2) + pow(hy[i], 2) + pow(hz[i], 2));
         sumR += rValues[i];
     }
     float avgR = sumR / HISTORY_SIZE;
-    
+
     float maxDeviation = -1;
     int outlierIndex = -1;
     for (int i = 0; i < HISTORY_SIZE; i++) {
@@ -150,7 +628,7 @@ float calculate_r() {
             outlierIndex = i;
         }
     }
-    
+
     float sumFilteredR = 0;
     int filteredCount = 0;
     for (int i = 0; i < HISTORY_SIZE; i++) {
@@ -161,7 +639,7 @@ float calculate_r() {
     }
 
     if (filteredCount == 0) return -1.0;
-    
+
     float R_avg_later = sumFilteredR / filteredCount;
     float sumDeviationsLater = 0;
     for(int i = 0; i < HISTORY_SIZE; i++){
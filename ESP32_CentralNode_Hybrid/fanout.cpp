@@ -0,0 +1,59 @@
+#include <Arduino.h>
+#include <string.h>
+#include "fanout.h"
+#include "logging.h"
+#include "profiler.h"
+#include "scheduler.h"
+
+// --- Result Queue (ring) ---
+uint8_t fanoutData[FANOUT_QUEUE][FANOUT_MAX_PAYLOAD];
+uint16_t fanoutLength[FANOUT_QUEUE];
+int fanoutHead = 0; // Oldest queued result
+int fanoutCount = 0;
+
+uint32_t fanoutDropped = 0; // Since the last warning
+uint32_t fanoutLoggedAt = 0;
+
+void setup_fanout() {
+    if (!LOCAL_RESULTS) {
+        logInfo("FANOUT", "Local results disabled.");
+        return;
+    }
+    fanoutHead = fanoutCount = 0;
+    scheduler_add("fanout", fanout_drain, 0, 0, FANOUT_BUDGET_US);
+    logInfo("FANOUT", "Results republished locally on %s.", LOCAL_RESULT_TOPIC);
+}
+
+void fanout_push(const uint8_t* data, size_t length) {
+    if (!LOCAL_RESULTS) return;
+    if (length > FANOUT_MAX_PAYLOAD) {
+        logWarn("FANOUT", "Result of %u bytes does not fit %u, not republished.", (unsigned)length,
+                (unsigned)FANOUT_MAX_PAYLOAD);
+        return;
+    }
+    if (fanoutCount == FANOUT_QUEUE) {
+        // Full: the oldest result makes room
+        fanoutHead = (fanoutHead + 1) % FANOUT_QUEUE;
+        fanoutCount--;
+        fanoutDropped++;
+    }
+    int tail = (fanoutHead + fanoutCount) % FANOUT_QUEUE;
+    memcpy(fanoutData[tail], data, length);
+    fanoutLength[tail] = (uint16_t)length;
+    fanoutCount++;
+}
+
+void fanout_drain() {
+    if (fanoutDropped > 0 && millis() - fanoutLoggedAt >= FANOUT_LOG_MS) {
+        logWarn("FANOUT", "%lu result(s) dropped, the local broker is not keeping up.", (unsigned long)fanoutDropped);
+        fanoutDropped = 0;
+        fanoutLoggedAt = millis();
+    }
+    if (fanoutCount == 0) return;
+    PROFILE_ZONE("fanout_drain");
+    for (int n = 0; n < FANOUT_PER_PASS && fanoutCount > 0; n++) {
+        publish_local(fanoutData[fanoutHead], fanoutLength[fanoutHead]);
+        fanoutHead = (fanoutHead + 1) % FANOUT_QUEUE;
+        fanoutCount--;
+    }
+}
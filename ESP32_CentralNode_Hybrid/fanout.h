@@ -0,0 +1,28 @@
+#ifndef FANOUT_H
+#define FANOUT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "config.h"
+#include "result_codec.h"
+
+// Local fan-out: every result is republished on LOCAL_RESULT_TOPIC by the
+// hub's own broker. fanout_push() queues it (the oldest is dropped when
+// full) and the "fanout" task hands FANOUT_PER_PASS per pass to publish_local().
+
+#ifndef FANOUT_QUEUE
+#define FANOUT_QUEUE MAX_ZONES // One interval of JSON results
+#endif
+constexpr size_t FANOUT_MAX_PAYLOAD = RESULT_PACKET_MAX > 384 ? RESULT_PACKET_MAX : 384; // JSON results are up to 384
+constexpr int FANOUT_PER_PASS = 2;
+constexpr uint32_t FANOUT_BUDGET_US = 5000;
+constexpr uint32_t FANOUT_LOG_MS = 10000;
+
+void setup_fanout();                                // From setup_local_broker()
+void fanout_push(const uint8_t* data, size_t length); // From the result publishers, with LOCAL_RESULTS
+void fanout_drain();                                // Scheduler task
+
+// Provided by network_manager.cpp: to every subscriber of LOCAL_RESULT_TOPIC
+void publish_local(const uint8_t* data, size_t length);
+
+#endif // FANOUT_H
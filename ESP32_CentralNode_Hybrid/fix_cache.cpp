@@ -0,0 +1,121 @@
+#include <Arduino.h>
+#include <string.h>
+#include "fix_cache.h"
+#include "logging.h"
+
+enum FixOutcome : uint8_t { FIX_VALID, FIX_NO_HEIGHT, FIX_NOT_POSITIVE };
+
+struct FixCacheEntry {
+    uint16_t zone;
+    uint16_t range[3];   // Whole cm
+    uint16_t generation; // 0: empty
+    uint8_t outcome;
+    float x, y, z;       // z holds z^2 for FIX_NO_HEIGHT
+};
+
+FixCacheEntry fixCache[FIX_CACHE_SIZE];
+uint16_t fixCacheGeneration = 1;
+uint8_t fixCacheVictim = 0;  // Probe overwritten when all are taken, in turn
+uint32_t fixCacheHits = 0;   // Since the last fix_cache_report()
+uint32_t fixCacheMisses = 0;
+uint32_t fixCacheBypassed = 0;
+uint32_t fixCacheTotalHits = 0;
+uint32_t fixCacheTotalMisses = 0;
+uint32_t fixCacheTotalBypassed = 0;
+
+// Whole cm ranges into key, false for any other
+static bool cache_key(float r1, float r2, float r3, uint16_t* key) {
+    const float r[3] = { r1, r2, r3 };
+    for (int i = 0; i < 3; i++) {
+        if (!(r[i] >= 0 && r[i] < 65536.0f)) return false;
+        key[i] = (uint16_t)r[i];
+        if ((float)key[i] != r[i]) return false;
+    }
+    return true;
+}
+
+static uint32_t cache_home(int zone, const uint16_t* key) {
+    uint32_t h = (uint32_t)zone * 2654435761u ^ key[0] * 73856093u ^ key[1] * 19349663u ^ key[2] * 83492791u;
+    return (h ^ (h >> 16)) & (FIX_CACHE_SIZE - 1);
+}
+
+static bool cache_match(const FixCacheEntry& e, int zone, const uint16_t* key) {
+    return e.generation == fixCacheGeneration && e.zone == zone && e.range[0] == key[0] && e.range[1] == key[1] &&
+           e.range[2] == key[2];
+}
+
+bool fix_cache_get(int zone, float r1, float r2, float r3, Point3D& p, float& zSquared, bool& valid) {
+    uint16_t key[3];
+    if (!cache_key(r1, r2, r3, key)) {
+        fixCacheBypassed++;
+        fixCacheTotalBypassed++;
+        return false;
+    }
+    uint32_t home = cache_home(zone, key);
+    for (int probe = 0; probe < FIX_CACHE_PROBES; probe++) {
+        const FixCacheEntry& e = fixCache[(home + probe) & (FIX_CACHE_SIZE - 1)];
+        if (!cache_match(e, zone, key)) continue;
+        p.x = e.x;
+        p.y = e.y;
+        if (e.outcome == FIX_NO_HEIGHT) {
+            p.z = 0;
+            zSquared = e.z;
+        } else {
+            p.z = e.z;
+            zSquared = e.z * e.z;
+        }
+        valid = e.outcome == FIX_VALID;
+        fixCacheHits++;
+        fixCacheTotalHits++;
+        return true;
+    }
+    fixCacheMisses++;
+    fixCacheTotalMisses++;
+    return false;
+}
+
+void fix_cache_put(int zone, float r1, float r2, float r3, const Point3D& p, float zSquared, bool valid) {
+    uint16_t key[3];
+    if (!cache_key(r1, r2, r3, key)) return;
+    uint32_t home = cache_home(zone, key);
+    FixCacheEntry* slot = nullptr;
+    for (int probe = 0; probe < FIX_CACHE_PROBES && !slot; probe++) {
+        FixCacheEntry& e = fixCache[(home + probe) & (FIX_CACHE_SIZE - 1)];
+        if (e.generation != fixCacheGeneration) slot = &e;
+    }
+    if (!slot) {
+        slot = &fixCache[(home + fixCacheVictim) & (FIX_CACHE_SIZE - 1)];
+        fixCacheVictim = (uint8_t)((fixCacheVictim + 1) % FIX_CACHE_PROBES);
+    }
+    slot->zone = (uint16_t)zone;
+    memcpy(slot->range, key, sizeof(slot->range));
+    slot->generation = fixCacheGeneration;
+    slot->outcome = zSquared < 0 ? FIX_NO_HEIGHT : (valid ? FIX_VALID : FIX_NOT_POSITIVE);
+    slot->x = p.x;
+    slot->y = p.y;
+    slot->z = zSquared < 0 ? zSquared : p.z;
+}
+
+void fix_cache_invalidate() {
+    // Generation 0 marks empty entries; after a wrap old ones could match again
+    if (++fixCacheGeneration == 0) {
+        memset(fixCache, 0, sizeof(fixCache));
+        fixCacheGeneration = 1;
+    }
+}
+
+void fix_cache_report() {
+    uint32_t lookups = fixCacheHits + fixCacheMisses;
+    if (lookups > 0 || fixCacheBypassed > 0) {
+        logVerbose("FIXCACHE", "%lu of %lu fix(es) from the cache (%.1f%%), %lu with ranges not in whole cm.",
+                   (unsigned long)fixCacheHits, (unsigned long)lookups, lookups ? 100.0 * fixCacheHits / lookups : 0.0,
+                   (unsigned long)fixCacheBypassed);
+    }
+    fixCacheHits = fixCacheMisses = fixCacheBypassed = 0;
+}
+
+void fix_cache_totals(uint32_t& hits, uint32_t& misses, uint32_t& bypassed) {
+    hits = fixCacheTotalHits;
+    misses = fixCacheTotalMisses;
+    bypassed = fixCacheTotalBypassed;
+}
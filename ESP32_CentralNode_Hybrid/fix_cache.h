@@ -0,0 +1,31 @@
+#ifndef FIX_CACHE_H
+#define FIX_CACHE_H
+
+#include <stdint.h>
+#include "config.h"
+#include "types.h"
+
+// Solved fixes of recent whole-cm range triplets, for solve_fix(): an
+// open-addressed table of FIX_CACHE_SIZE entries, emptied by moving to a new
+// geometry generation in fix_cache_invalidate().
+
+#ifndef FIX_CACHE_SIZE
+#ifdef ESP8266
+#define FIX_CACHE_SIZE 128 // 24 bytes each
+#else
+#define FIX_CACHE_SIZE 256
+#endif
+#endif
+
+static_assert((FIX_CACHE_SIZE & (FIX_CACHE_SIZE - 1)) == 0, "FIX_CACHE_SIZE must be a power of two");
+
+constexpr int FIX_CACHE_PROBES = 4;
+
+// True when the fix of these ranges is cached; p, zSquared and valid are then what solve_fix() found
+bool fix_cache_get(int zone, float r1, float r2, float r3, Point3D& p, float& zSquared, bool& valid);
+void fix_cache_put(int zone, float r1, float r2, float r3, const Point3D& p, float zSquared, bool valid);
+void fix_cache_invalidate(); // From set_zone_anchors(); tuning changes DISTANCE_OFFSET through apply_params(), which calls it
+void fix_cache_report();     // From scheduler_report()
+void fix_cache_totals(uint32_t& hits, uint32_t& misses, uint32_t& bypassed); // Since boot
+
+#endif // FIX_CACHE_H
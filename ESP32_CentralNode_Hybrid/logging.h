@@ -9,5 +9,6 @@ void logInfo(const char* prefix, const char* format, ...);
 void logWarn(const char* prefix, const char* format, ...);
 void logError(const char* prefix, const char* format, ...);
 void logResult(const char* resultString);
+void logFix(int deviceId, float d1, float d2, float d3, float x, float y, float z); // One valid instant fix (raw distances)
 
 #endif // LOGGING_H
@@ -0,0 +1,31 @@
+#ifndef MOTION_H
+#define MOTION_H
+
+#include <stdint.h>
+#include "config.h"
+
+// Motion state per zone, from the speed of windowed fix means and the LD2410's
+// moving share me / (me + se). A zone turns moving at once and stationary
+// only after MOTION_SETTLE_MS. With MOTION_ADAPTIVE each zone publishes on
+// its own interval.
+
+enum MotionState : uint8_t { MOTION_UNKNOWN, MOTION_STATIONARY, MOTION_MOVING };
+
+constexpr uint32_t MOTION_WINDOW_MS = 1000;
+constexpr uint32_t MOTION_SETTLE_MS = 3000;
+constexpr float MOTION_MOVING_CM_S = 20.0;  // A slow walk is about 50 cm/s
+constexpr float MOTION_STILL_CM_S = 8.0;    // A few times the speed noise of 1 s windows
+constexpr float MOTION_MOVING_SHARE = 0.6;
+constexpr float MOTION_STILL_SHARE = 0.4;
+constexpr float MOTION_SHARE_GAIN = 0.3;    // Smoothing of the share, per sensor message
+
+void setup_motion();          // From initialize_logic(): checks the interval bounds
+void motion_reset(int zone);  // Called by add_zone()
+void motion_fix(int zone, float x, float y, float z);           // Every fix, from record_fix()
+void motion_energy(int zone, int movingEnergy, int stationaryEnergy); // Sensor messages carrying "me" and "se"
+MotionState motion_state(int zone);
+uint32_t motion_interval_ms(int zone); // The zone's result interval with MOTION_ADAPTIVE
+uint32_t motion_tick_ms();             // Period of the averaging task
+const char* motion_name(MotionState state); // "moving", "stationary", nullptr while unknown
+
+#endif // MOTION_H
@@ -1,11 +1,26 @@
 #include <WiFi.h>
 #include <sMQTTBroker.h>     // For the local broker (Switched from uMQTTBroker)
 #include <PubSubClient.h>    // For the external client
-#include <ArduinoJson.h>
 #include "network_manager.h"
 #include "config.h"
 #include "logging.h"
 #include "calculation_logic.h"
+#include "tuning.h"
+#include "scheduler.h"
+#include "warm_state.h"
+#include "topic_router.h"
+#include "profiler.h"
+#include "tdma.h"
+#include "fanout.h"
+#include "geofence.h"
+#include "history_store.h"
+
+constexpr uint32_t NETWORK_BUDGET_US = 5000;      // One broker or client pass; longer ones delay the averaging task
+constexpr uint32_t RECONNECT_INTERVAL_MS = 5000;
+constexpr int32_t CONNECT_TIMEOUT_MS = 250;   // TCP connect of one attempt; a broker on the LAN answers in a few ms
+constexpr uint16_t CONNACK_TIMEOUT_S = 1;     // PubSubClient waits whole seconds for CONNACK
+constexpr uint32_t WIFI_POLL_MS = 50;
+constexpr uint32_t WIFI_CONNECT_TIMEOUT_MS = 10500; // Full join with scan and DHCP, then restart
 
 // --- BEGIN: LOCAL BROKER IMPLEMENTATION (using sMQTTBroker) ---
 
@@ -25,22 +40,13 @@ void onLocalDisconnect(const sMQTT::Client &client) {
     }
 }
 
-// Callback for when our local broker receives data
+// Callback for when our local broker receives data. sMQTTBroker does not say
+// which client published, so shared-topic messages carry their id in the body.
 void onLocalData(const char *topic, const char *payload, uint8_t *payload_raw, size_t len) {
+    PROFILE_ZONE("onLocalData");
     logVerbose("RECV", "Message on LOCAL broker [%s]: %s", topic, payload);
-    
-    if (strcmp(topic, SENSOR_TOPIC) == 0) {
-        StaticJsonDocument<96> doc;
-        DeserializationError error = deserializeJson(doc, payload);
-        if (error) {
-            logError("PARSE", "JSON parse failed on local message: %s", error.c_str());
-            return;
-        }
-        if (!doc.containsKey("id") || !doc.containsKey("d")) {
-            logWarn("RECV", "Invalid local message: missing 'id' or 'd'");
-            return;
-        }
-        on_distance_received(doc["id"], doc["d"]);
+    if (!route_message(topic, strlen(topic), payload, len)) {
+        logVerbose("RECV", "No route for topic %s", topic);
     }
 }
 
@@ -49,6 +55,12 @@ void setup_local_broker() {
     localBroker.onConnect(onLocalConnect);
     localBroker.onDisconnect(onLocalDisconnect);
     localBroker.onData(onLocalData);
+    topic_route(SENSOR_TOPIC, on_sensor_message);
+    topic_route_sensors(SENSOR_TOPIC, on_sensor_message); // SENSOR_TOPIC/<id>
+    topic_route(CONTROL_TOPIC, on_control_topic);
+    topic_route(HISTORY_TOPIC, on_history_topic);
+    scheduler_add("local-broker", loop_local_broker, 0, 0, NETWORK_BUDGET_US);
+    setup_fanout();
     logInfo("LOCAL_BROKER", "sMQTTBroker setup complete. Awaiting connections...");
 }
 
@@ -56,6 +68,16 @@ void loop_local_broker() {
     localBroker.loop();
 }
 
+// The broker delivers it to the sensors subscribed to TDMA_TOPIC
+void publish_schedule(const char* payload) {
+    localBroker.publish(TDMA_TOPIC, payload);
+}
+
+// Results for nearby consumers, from the fanout task (fanout.h)
+void publish_local(const uint8_t* data, size_t length) {
+    localBroker.publish(LOCAL_RESULT_TOPIC, std::string((const char*)data, length));
+}
+
 // --- END: LOCAL BROKER IMPLEMENTATION ---
 
 // --- BEGIN: EXTERNAL CLIENT IMPLEMENTATION ---
@@ -63,33 +85,62 @@ void loop_local_broker() {
 WiFiClient espClient;
 PubSubClient externalClient(espClient);
 
+// Callback for control messages arriving from the external gateway
+void external_callback(char* topic, byte* payload, unsigned int length) {
+    char payloadStr[length + 1];
+    memcpy(payloadStr, payload, length);
+    payloadStr[length] = '\0';
+    logVerbose("RECV", "Message on EXTERNAL client [%s]: %s", topic, payloadStr);
+
+    if (strcmp(topic, CONTROL_TOPIC) == 0) {
+        on_control_message(payloadStr);
+    } else if (strcmp(topic, HISTORY_TOPIC) == 0) {
+        on_history_topic(-1, payloadStr, length);
+    }
+}
+
+// One attempt per RECONNECT_INTERVAL_MS instead of blocking until connected, so
+// sensors keep being served while the gateway is away. The TCP connect is made
+// here, bounded by CONNECT_TIMEOUT_MS rather than the core's few seconds to an
+// absent host; PubSubClient then only exchanges CONNECT and CONNACK on it
 void reconnect_external_client() {
-    while (!externalClient.connected()) {
-        logInfo("EXT_CLIENT", "Attempting connection to external gateway...");
-        if (externalClient.connect(MQTT_CLIENT_ID)) {
-            logInfo("EXT_CLIENT", "Connected to %s", EXTERNAL_BROKER_IP);
-        } else {
-            logError("EXT_CLIENT", "Failed, rc=%d. Retrying in 5 seconds...", externalClient.state());
-            delay(5000);
-        }
+    if (externalClient.connected()) return;
+    logInfo("EXT_CLIENT", "Attempting connection to external gateway...");
+    if (!espClient.connect(EXTERNAL_BROKER_IP, EXTERNAL_BROKER_PORT, CONNECT_TIMEOUT_MS)) {
+        logError("EXT_CLIENT", "No answer within %ld ms. Retrying in %lu ms...", (long)CONNECT_TIMEOUT_MS,
+                 (unsigned long)RECONNECT_INTERVAL_MS);
+        return;
+    }
+    if (externalClient.connect(MQTT_CLIENT_ID)) {
+        logInfo("EXT_CLIENT", "Connected to %s", EXTERNAL_BROKER_IP);
+        externalClient.subscribe(CONTROL_TOPIC);
+        externalClient.subscribe(HISTORY_TOPIC);
+    } else {
+        logError("EXT_CLIENT", "Failed, rc=%d. Retrying in %lu ms...", externalClient.state(), (unsigned long)RECONNECT_INTERVAL_MS);
     }
 }
 
 void setup_external_client() {
     logInfo("EXT_CLIENT", "Setting up client for external gateway %s:%d", EXTERNAL_BROKER_IP, EXTERNAL_BROKER_PORT);
     externalClient.setServer(EXTERNAL_BROKER_IP, EXTERNAL_BROKER_PORT);
-    // We don't need a callback for the external client as it only publishes
+    externalClient.setSocketTimeout(CONNACK_TIMEOUT_S);
+    // Results are published; CONTROL_TOPIC and HISTORY_TOPIC are subscribed to
+    externalClient.setCallback(external_callback);
+    externalClient.setBufferSize(HISTORY_REPLY_MAX + 64); // Room for a history reply and its topic
+    reconnect_external_client();
+    scheduler_add("ext-reconnect", reconnect_external_client, RECONNECT_INTERVAL_MS, 0, 0);
+    scheduler_add("ext-client", loop_external_client, 0, 0, NETWORK_BUDGET_US);
 }
 
 void loop_external_client() {
-    if (!externalClient.connected()) {
-        reconnect_external_client();
+    if (externalClient.connected()) {
+        externalClient.loop();
     }
-    externalClient.loop();
 }
 
 // This is the function that will be called by calculation logic
 void publish_results(const char* payload) {
+    fanout_push((const uint8_t*)payload, strlen(payload)); // Also while the gateway is away
     if (PUBLISH_RESULTS) {
         if (externalClient.connected()) {
             logVerbose("SENDER", "Publishing to EXTERNAL gateway on topic %s", OUTPUT_TOPIC);
@@ -102,23 +153,68 @@ void publish_results(const char* payload) {
     }
 }
 
+void publish_result_packet(const uint8_t* data, size_t length) {
+    fanout_push(data, length);
+    if (!PUBLISH_RESULTS) return;
+    if (externalClient.connected()) {
+        externalClient.publish(OUTPUT_TOPIC, data, length);
+    } else {
+        logWarn("SENDER", "Cannot publish to external gateway. Client not connected.");
+    }
+}
+
+// Requests come from either side; the reply goes to both, the request id tells them apart
+void publish_history(const char* payload) {
+    localBroker.publish(HISTORY_REPLY_TOPIC, payload);
+    if (externalClient.connected()) externalClient.publish(HISTORY_REPLY_TOPIC, payload);
+}
+
+// Alarm relays on the sensor network hear it first; the gateway when it is there
+void publish_geofence(const char* payload) {
+    localBroker.publish(GEOFENCE_TOPIC, payload);
+    if (externalClient.connected()) externalClient.publish(GEOFENCE_TOPIC, payload);
+}
+
 // --- END: EXTERNAL CLIENT IMPLEMENTATION ---
 
 // --- BEGIN: SHARED WIFI SETUP ---
 
-void setup_wifi() {
-    logInfo("WIFI", "Connecting to %s", WIFI_SSID);
-    WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
-    int attempts = 0;
+static bool wait_for_wifi(uint32_t timeoutMs) {
+    uint32_t start = millis();
     while (WiFi.status() != WL_CONNECTED) {
-        delay(500);
-        Serial.print(".");
-        if(attempts++ > 20) {
+        if (millis() - start >= timeoutMs) return false;
+        delay(WIFI_POLL_MS);
+    }
+    return true;
+}
+
+// After a warm restart the cached BSSID, channel and IP settings skip the scan
+// and DHCP; if that join fails the cache is dropped and a full join follows
+void setup_wifi() {
+    bool connected = false;
+    const WarmWifi* cached = warm_wifi();
+    if (cached) {
+        logInfo("WIFI", "Rejoining %s on channel %d", WIFI_SSID, cached->channel);
+        WiFi.config(IPAddress(cached->ip), IPAddress(cached->gateway), IPAddress(cached->subnet), IPAddress(cached->dns));
+        WiFi.begin(WIFI_SSID, WIFI_PASSWORD, cached->channel, cached->bssid);
+        connected = wait_for_wifi(FAST_CONNECT_TIMEOUT_MS);
+        if (!connected) {
+            logWarn("WIFI", "Cached association failed, scanning.");
+            warm_clear_wifi();
+            WiFi.disconnect();
+            WiFi.config(IPAddress(), IPAddress(), IPAddress()); // Back to DHCP
+        }
+    }
+    if (!connected) {
+        logInfo("WIFI", "Connecting to %s", WIFI_SSID);
+        WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+        if (!wait_for_wifi(WIFI_CONNECT_TIMEOUT_MS)) {
             logError("WIFI", "Failed to connect. Restarting...");
             ESP.restart();
         }
     }
-    Serial.println("");
+    warm_save_wifi(WiFi.BSSID(), WiFi.channel(), (uint32_t)WiFi.localIP(), (uint32_t)WiFi.gatewayIP(),
+                   (uint32_t)WiFi.subnetMask(), (uint32_t)WiFi.dnsIP());
     logInfo("WIFI", "WiFi Connected. ESP32 IP: %s", WiFi.localIP().toString().c_str());
     logInfo("WIFI", "Sensor nodes should connect to this IP on port %d.", LOCAL_BROKER_PORT);
 }
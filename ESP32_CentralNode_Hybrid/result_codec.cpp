@@ -0,0 +1,137 @@
+#include <Arduino.h>
+#include "result_codec.h"
+#include "calculation_logic.h"
+#include "config.h"
+#include "logging.h"
+#include "multi_target.h"
+#include "warm_state.h"
+
+// --- Encoder State ---
+int16_t sentX[MAX_ZONES]; // Last coordinates sent per zone, base of the next delta
+int16_t sentY[MAX_ZONES];
+int16_t sentZ[MAX_ZONES];
+uint8_t recordsToKey[MAX_ZONES]; // Records left until the next key record, 0 = next one is
+uint8_t recordCounter[MAX_ZONES];
+
+uint8_t resultPacket[RESULT_PACKET_MAX];
+size_t resultPacketLength = 0; // 0 while no record is queued
+uint8_t resultPacketRecords = 0;
+uint8_t resultPacketSeq = 0;
+
+// Largest record: deviceID, flags, 4 coordinates (r with the degraded and motion bits), track count, MAX_TRACKS tracks
+constexpr int RECORD_MAX = 5 + 1 + 4 * 3 + 1 + MAX_TRACKS * (3 + 3 * 3);
+
+void result_codec_reset(int zone) {
+    sentX[zone] = sentY[zone] = sentZ[zone] = 0;
+    recordsToKey[zone] = 0;
+    recordCounter[zone] = 0;
+}
+
+void save_codec_state(int zone, WarmZone& w) {
+    w.sentX = sentX[zone];
+    w.sentY = sentY[zone];
+    w.sentZ = sentZ[zone];
+    w.recordsToKey = recordsToKey[zone];
+    w.recordCounter = recordCounter[zone];
+}
+
+void restore_codec_state(int zone, const WarmZone& w) {
+    sentX[zone] = w.sentX;
+    sentY[zone] = w.sentY;
+    sentZ[zone] = w.sentZ;
+    recordsToKey[zone] = w.recordsToKey;
+    recordCounter[zone] = w.recordCounter;
+}
+
+uint8_t result_packet_seq() {
+    return resultPacketSeq;
+}
+
+void set_result_packet_seq(uint8_t seq) {
+    resultPacketSeq = seq;
+}
+
+static int16_t to_cm(float v) {
+    long cm = lround(v);
+    if (cm > 32767) return 32767;
+    if (cm < -32768) return -32768;
+    return (int16_t)cm;
+}
+
+static size_t put_varint(uint8_t* out, uint32_t v) {
+    size_t n = 0;
+    while (v >= 0x80) {
+        out[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    out[n++] = (uint8_t)v;
+    return n;
+}
+
+static size_t put_signed(uint8_t* out, int32_t v) {
+    return put_varint(out, ((uint32_t)v << 1) ^ (uint32_t)(v >> 31)); // Zigzag: small magnitudes stay short
+}
+
+void result_packet_add(int zone, int deviceId, const Point3D* avg, float r, bool degraded, uint8_t motion,
+                       const uint16_t* trackIds, const Point3D* trackPos, int trackCount) {
+    uint8_t record[RECORD_MAX];
+    size_t n = put_varint(record, (uint32_t)deviceId);
+    size_t flagsAt = n++;
+    uint8_t flags = 0;
+
+    if (avg) {
+        int16_t x = to_cm(avg->x);
+        int16_t y = to_cm(avg->y);
+        int16_t z = to_cm(avg->z);
+        flags |= RESULT_FLAG_VALID | (uint8_t)((recordCounter[zone]++ & 31) << RESULT_COUNTER_SHIFT);
+        if (recordsToKey[zone] == 0) {
+            flags |= RESULT_FLAG_KEY;
+            n += put_signed(record + n, x);
+            n += put_signed(record + n, y);
+            n += put_signed(record + n, z);
+            recordsToKey[zone] = RESULT_KEY_INTERVAL - 1;
+        } else {
+            n += put_signed(record + n, x - sentX[zone]);
+            n += put_signed(record + n, y - sentY[zone]);
+            n += put_signed(record + n, z - sentZ[zone]);
+            recordsToKey[zone]--;
+        }
+        n += put_varint(record + n, (uint32_t)(r > 0 ? to_cm(r) : 0) << 3 | (uint32_t)(motion & 3) << 1 | (degraded ? 1 : 0));
+        sentX[zone] = x;
+        sentY[zone] = y;
+        sentZ[zone] = z;
+    }
+
+    if (trackIds) {
+        if (trackCount > MAX_TRACKS) trackCount = MAX_TRACKS;
+        flags |= RESULT_FLAG_TARGETS;
+        record[n++] = (uint8_t)trackCount;
+        for (int t = 0; t < trackCount; t++) {
+            n += put_varint(record + n, trackIds[t]);
+            n += put_signed(record + n, to_cm(trackPos[t].x));
+            n += put_signed(record + n, to_cm(trackPos[t].y));
+            n += put_signed(record + n, to_cm(trackPos[t].z));
+        }
+    }
+    record[flagsAt] = flags;
+
+    if (resultPacketLength + n > RESULT_PACKET_MAX || resultPacketRecords == 255) result_packet_flush();
+    if (resultPacketLength == 0) {
+        resultPacket[0] = RESULT_MAGIC;
+        resultPacket[1] = RESULT_VERSION;
+        resultPacket[2] = resultPacketSeq++;
+        resultPacketLength = 4; // resultPacket[3] is the record count, written on flush
+    }
+    memcpy(resultPacket + resultPacketLength, record, n);
+    resultPacketLength += n;
+    resultPacketRecords++;
+}
+
+void result_packet_flush() {
+    if (resultPacketLength == 0) return;
+    resultPacket[3] = resultPacketRecords;
+    logVerbose("SENDER", "Binary result message: %u record(s), %u bytes.", resultPacketRecords, (unsigned)resultPacketLength);
+    publish_result_packet(resultPacket, resultPacketLength);
+    resultPacketLength = 0;
+    resultPacketRecords = 0;
+}
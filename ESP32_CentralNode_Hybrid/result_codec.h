@@ -0,0 +1,35 @@
+#ifndef RESULT_CODEC_H
+#define RESULT_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "types.h"
+
+// Packed binary results for BINARY_RESULTS: all zones of an interval in one
+// message of varint records, delta-encoded per zone with periodic key records.
+// The layout is in the README; native/common/result_decoder.h reads it.
+
+constexpr uint8_t RESULT_MAGIC = 0xB5; // Never the first byte of a JSON result
+constexpr uint8_t RESULT_VERSION = 3; // 2: degraded bit in r, 3: motion state in r
+constexpr int RESULT_KEY_INTERVAL = 16;
+
+// Record flags
+constexpr uint8_t RESULT_FLAG_KEY = 0x01;     // x, y, z are absolute
+constexpr uint8_t RESULT_FLAG_VALID = 0x02;   // x, y, z, r present; otherwise no fix this interval (all 0 in JSON)
+constexpr uint8_t RESULT_FLAG_TARGETS = 0x04; // Track list follows (MULTI_TARGET_MODE)
+constexpr int RESULT_COUNTER_SHIFT = 3;       // Bits 3-7: the zone's coordinate record counter, mod 32
+
+// Fits a PubSubClient packet (256 bytes by default) with the topic and MQTT header
+#ifndef RESULT_PACKET_MAX
+#define RESULT_PACKET_MAX 192
+#endif
+
+void result_codec_reset(int zone); // The zone's next record is a key record
+
+// Queues one zone's result; avg is nullptr when the zone had no fix. Publishes
+// the pending message first when the record does not fit any more.
+void result_packet_add(int zone, int deviceId, const Point3D* avg, float r, bool degraded, uint8_t motion,
+                       const uint16_t* trackIds, const Point3D* trackPos, int trackCount);
+void result_packet_flush(); // Publishes the pending message, if any
+
+#endif // RESULT_CODEC_H
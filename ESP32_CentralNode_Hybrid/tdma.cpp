@@ -0,0 +1,63 @@
+#include <Arduino.h>
+#include <stdio.h>
+#include "tdma.h"
+#include "logging.h"
+#include "scheduler.h"
+
+// --- Slot Table ---
+int16_t tdmaSensor[TDMA_MAX_SENSORS]; // Slot order, three per zone
+int tdmaGroups = 0;
+uint32_t tdmaOrigin = 0; // millis() at the start of frame 0
+
+// Frame geometry for the current group count: the groups are spread evenly
+// over the frame so the hub gets their triplets one at a time
+static void frame_layout(uint32_t& frame, uint32_t& spacing, uint32_t& slot) {
+    frame = TDMA_FRAME_MS;
+    int groups = tdmaGroups > 0 ? tdmaGroups : 1;
+    slot = frame / (3 * groups);
+    if (slot > TDMA_SLOT_MS) slot = TDMA_SLOT_MS;
+    if (slot < TDMA_MIN_SLOT_MS) {
+        slot = TDMA_MIN_SLOT_MS;
+        frame = slot * 3 * groups;
+    }
+    spacing = frame / groups;
+}
+
+void setup_tdma() {
+    if (TDMA_FRAME_MS == 0) {
+        logInfo("TDMA", "Disabled, sensors free-run.");
+        return;
+    }
+    tdmaOrigin = millis();
+    scheduler_add("tdma", tdma_publish, TDMA_SYNC_MS, 0, 0);
+    logInfo("TDMA", "Schedule on %s every %lu ms, %lu ms frame.", TDMA_TOPIC, (unsigned long)TDMA_SYNC_MS,
+            (unsigned long)TDMA_FRAME_MS);
+}
+
+void tdma_assign(int zone, const int sensorIds[3]) {
+    if (zone < 0 || zone >= MAX_ZONES) return;
+    for (int slot = 0; slot < 3; slot++) tdmaSensor[zone * 3 + slot] = (int16_t)sensorIds[slot];
+    if (zone >= tdmaGroups) tdmaGroups = zone + 1;
+}
+
+void tdma_publish() {
+    if (TDMA_FRAME_MS == 0 || tdmaGroups == 0) return;
+    uint32_t frame, spacing, slot;
+    frame_layout(frame, spacing, slot);
+
+    // The header plus up to 6 characters per sensor id
+    char payload[64 + TDMA_MAX_SENSORS * 6];
+    uint32_t phase = (millis() - tdmaOrigin) % frame;
+    int n = snprintf(payload, sizeof(payload), "{\"f\":%lu,\"g\":%lu,\"w\":%lu,\"o\":%lu,\"s\":[", (unsigned long)frame,
+                     (unsigned long)spacing, (unsigned long)slot, (unsigned long)phase);
+    for (int i = 0; i < tdmaGroups * 3 && n < (int)sizeof(payload); i++) {
+        n += snprintf(payload + n, sizeof(payload) - n, i ? ",%d" : "%d", tdmaSensor[i]);
+    }
+    if (n >= (int)sizeof(payload) - 2) {
+        logError("TDMA", "Schedule does not fit %u bytes, not sent.", (unsigned)sizeof(payload));
+        return;
+    }
+    memcpy(payload + n, "]}", 3);
+    publish_schedule(payload);
+    logVerbose("TDMA", "Schedule sent, %d group(s) %lu ms apart: %s", tdmaGroups, (unsigned long)spacing, payload);
+}
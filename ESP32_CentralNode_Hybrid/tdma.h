@@ -0,0 +1,24 @@
+#ifndef TDMA_H
+#define TDMA_H
+
+#include <stdint.h>
+#include "config.h"
+
+// Transmit schedule for the sensors (TDMA). The hub splits every
+// TDMA_FRAME_MS frame among the zones and publishes the slot layout on
+// TDMA_TOPIC every TDMA_SYNC_MS; the three sensors of a zone measure
+// together and send one after another (format in README, Device/Device.ino).
+
+constexpr uint32_t TDMA_SYNC_MS = 5000;     // Schedule broadcast period
+constexpr uint32_t TDMA_SLOT_MS = 20;       // Widest transmit slot, a few times one MQTT publish on the air
+constexpr uint32_t TDMA_MIN_SLOT_MS = 4;    // Narrower slots make the frame longer instead
+constexpr int TDMA_MAX_SENSORS = MAX_ZONES * 3;
+
+void setup_tdma();                                 // From initialize_logic(), after the zones
+void tdma_assign(int zone, const int sensorIds[3]); // Called by add_zone(); in the next schedule sent
+void tdma_publish();                               // Scheduler task every TDMA_SYNC_MS
+
+// Provided by network_manager.cpp: to every sensor subscribed to TDMA_TOPIC
+void publish_schedule(const char* payload);
+
+#endif // TDMA_H
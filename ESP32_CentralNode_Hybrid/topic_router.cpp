@@ -0,0 +1,106 @@
+#include <Arduino.h>
+#include <string.h>
+#include "topic_router.h"
+#include "config.h"
+#include "logging.h"
+
+constexpr int ROUTE_SLOTS = MAX_ROUTES * 2; // Hash table at most half full
+constexpr int MAX_ID_DIGITS = 5;
+
+// --- Route Table (struct of arrays) ---
+int routeCount = 0;
+const char* routeTopic[MAX_ROUTES]; // Exact topic, or the prefix of a per-sensor family
+uint8_t routeTopicLength[MAX_ROUTES];
+bool routePerSensor[MAX_ROUTES];
+TopicHandler routeHandler[MAX_ROUTES];
+
+// Open addressing with linear probing: route index + 1 per slot, 0 = empty
+uint8_t slotRoute[ROUTE_SLOTS];
+uint32_t slotHash[ROUTE_SLOTS];
+
+static uint32_t fnv1a(const char* s, size_t length) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        h ^= (uint8_t)s[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static int find_route(const char* key, size_t length, bool perSensor) {
+    uint32_t h = fnv1a(key, length);
+    for (int i = 0, s = h % ROUTE_SLOTS; i < ROUTE_SLOTS; i++, s = (s + 1) % ROUTE_SLOTS) {
+        int r = slotRoute[s] - 1;
+        if (r < 0) return -1;
+        if (slotHash[s] == h && routePerSensor[r] == perSensor && routeTopicLength[r] == length &&
+            memcmp(routeTopic[r], key, length) == 0) {
+            return r;
+        }
+    }
+    return -1;
+}
+
+static bool add_route(const char* topic, bool perSensor, TopicHandler handler) {
+    size_t length = strlen(topic);
+    if (routeCount >= MAX_ROUTES || length > 255) {
+        logError("ROUTER", "Route table full (%d) or topic too long, %s not added.", MAX_ROUTES, topic);
+        return false;
+    }
+    int r = routeCount++;
+    routeTopic[r] = topic;
+    routeTopicLength[r] = (uint8_t)length;
+    routePerSensor[r] = perSensor;
+    routeHandler[r] = handler;
+
+    uint32_t h = fnv1a(topic, length);
+    int s = h % ROUTE_SLOTS;
+    while (slotRoute[s] != 0) s = (s + 1) % ROUTE_SLOTS;
+    slotRoute[s] = (uint8_t)(r + 1);
+    slotHash[s] = h;
+    logVerbose("ROUTER", "Route %s%s", topic, perSensor ? "/<id>" : "");
+    return true;
+}
+
+bool topic_route(const char* topic, TopicHandler handler) {
+    return add_route(topic, false, handler);
+}
+
+bool topic_route_sensors(const char* prefix, TopicHandler handler) {
+    return add_route(prefix, true, handler);
+}
+
+// Decimal id of at most MAX_ID_DIGITS digits, -1 otherwise
+static int parse_id(const char* s, size_t length) {
+    if (length == 0 || length > MAX_ID_DIGITS) return -1;
+    int id = 0;
+    for (size_t i = 0; i < length; i++) {
+        if (s[i] < '0' || s[i] > '9') return -1;
+        id = id * 10 + (s[i] - '0');
+    }
+    return id;
+}
+
+bool route_message(const char* topic, size_t topicLength, const char* payload, size_t length, int boundSensorId) {
+    int r = find_route(topic, topicLength, false);
+    if (r >= 0) {
+        routeHandler[r](boundSensorId, payload, length);
+        return true;
+    }
+
+    // "<prefix>/<id>"
+    size_t slash = topicLength;
+    while (slash > 0 && topic[slash - 1] != '/') slash--;
+    if (slash < 2) return false;
+    int id = parse_id(topic + slash, topicLength - slash);
+    if (id < 0) return false;
+    r = find_route(topic, slash - 1, true);
+    if (r < 0) return false;
+    routeHandler[r](id, payload, length);
+    return true;
+}
+
+int sensor_id_from_login(const char* login) {
+    size_t prefixLength = strlen(SENSOR_LOGIN_PREFIX);
+    if (prefixLength == 0 || strncmp(login, SENSOR_LOGIN_PREFIX, prefixLength) != 0) return -1;
+    return parse_id(login + prefixLength, strlen(login + prefixLength));
+}
@@ -0,0 +1,15 @@
+#ifndef TRACK_SIMPLIFY_H
+#define TRACK_SIMPLIFY_H
+
+#include <stdint.h>
+#include "config.h"
+
+// Dead-reckoning simplification: a zone's result is sent only when it is more
+// than SIMPLIFY_TOLERANCE_CM from the extrapolation of the last two sent, or
+// SIMPLIFY_MAX_GAP_MS after the last one. 0 (the default) sends every result.
+
+void simplify_reset(int zone); // Called by add_zone(), and for an empty result: the next one is sent
+// Whether to send the zone's result at (x, y, z); force sends it in any case. Remembers what is sent
+bool simplify_result(int zone, float x, float y, float z, bool force);
+
+#endif // TRACK_SIMPLIFY_H
@@ -8,4 +8,27 @@ struct Point3D {
     float z = 0;
 };
 
+// One tracked room: three sensors and the anchor geometry they are mounted in
+struct ZoneConfig {
+    int deviceId;     // deviceID carried by this zone's results, 0 marks an unused entry
+    int sensorIds[3]; // Sensor ids at S1 (origin), S2 (a, 0, 0) and S3 (c, b, 0)
+    float S2_a;
+    float S3_c;
+    float S3_b;
+};
+
+constexpr int MAX_FENCE_VERTICES = 8;
+
+// A geofence in the anchor frame of one zone, in cm (see geofence.h)
+struct FenceConfig {
+    int id;       // Carried by its events, 0 marks an unused entry
+    int deviceId; // The zone whose fixes it watches
+    int vertices; // 2: a box between two opposite corners, 3..MAX_FENCE_VERTICES: a polygon
+    float x[MAX_FENCE_VERTICES];
+    float y[MAX_FENCE_VERTICES];
+    float zMin;   // Height band, zMin == zMax for any height
+    float zMax;
+    unsigned long dwellMs; // Inside this long gives one dwell event, 0 = none
+};
+
 #endif // TYPES_H
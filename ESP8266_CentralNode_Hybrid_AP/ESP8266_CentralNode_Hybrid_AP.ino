@@ -3,6 +3,9 @@
 #include "network_manager.h"
 #include "calculation_logic.h"
 #include "logging.h"
+#include "tuning.h"
+#include "scheduler.h"
+#include "warm_state.h"
 
 void setup() {
     Serial.begin(115200);
@@ -10,7 +13,12 @@ void setup() {
 
     logInfo("SYSTEM", "Central Node - ESP32 HYBRID (AP+STA) Firmware Starting...");
 
-    // Initialize modules
+    // Before anything touches the state it may restore
+    warm_boot_check();
+
+    // Initialize modules; each registers its tasks with the scheduler
+    setup_scheduler();
+    setup_tuning();           // Load persisted parameters first
     setup_wifi_ap_sta();      // Setup both WiFi modes
     setup_local_broker();     // Start the broker on the AP
     setup_external_client();  // Setup the client on the STA connection
@@ -18,8 +26,6 @@ void setup() {
 }
 
 void loop() {
-    // Loop all network modules and the calculation logic
-    loop_local_broker();
-    loop_external_client();
-    loop_logic();
+    // Broker, client, tuning and averaging all run as scheduler tasks
+    run_scheduler();
 }
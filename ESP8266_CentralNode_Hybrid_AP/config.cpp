@@ -19,17 +19,50 @@ const char* MQTT_CLIENT_ID = "esp32-central-node-hybrid-ap";
 // --- MQTT Topics ---
 const char* SENSOR_TOPIC = "/node/central";
 const char* OUTPUT_TOPIC = "/central/d_gateway";
+const char* CONTROL_TOPIC = "/central/control";
+const char* SENSOR_LOGIN_PREFIX = ""; // e.g. "ESP8266Client" for the client ids Device.ino uses
+const char* TDMA_TOPIC = "/central/tdma";
+const char* HISTORY_TOPIC = "/central/history";
+const char* HISTORY_REPLY_TOPIC = "/central/history/reply";
+const char* GEOFENCE_TOPIC = "/central/geofence";
+const char* LOCAL_RESULT_TOPIC = "/central/results";
 
 // --- Anchor Coordinates ---
-const float S2_a = 81.0;
-const float S3_c = 0.0;
-const float S3_b = 54.0;
+float S2_a = 81.0;
+float S3_c = 0.0;
+float S3_b = 54.0;
 
 // --- Calculation Settings ---
-const float DISTANCE_OFFSET = 35.0;
-const unsigned long AVERAGE_INTERVAL_MS = 3000;
-const bool PUBLISH_RESULTS = true;
-const int OUTPUT_DEVICE_ID = 1;
+int HISTORY_SIZE = 5;
+float DISTANCE_OFFSET = 35.0;
+unsigned long AVERAGE_INTERVAL_MS = 3000;
+bool PUBLISH_RESULTS = true;
+bool LOCAL_RESULTS = true;
+int OUTPUT_DEVICE_ID = 1;
+bool MULTI_TARGET_MODE = false;
+bool BINARY_RESULTS = false;
+unsigned long SENSOR_TIMEOUT_MS = 2000;
+float INGEST_RATE_HZ = 20.0;
+int INGEST_BURST = 32; // Room for the up to 32 buffered readings Device.ino flushes on reconnect
+unsigned long TDMA_FRAME_MS = 600; // Device.ino's publish interval
+bool MOTION_ADAPTIVE = false; // Off: every zone keeps AVERAGE_INTERVAL_MS
+unsigned long MOTION_MIN_INTERVAL_MS = 1000;
+unsigned long MOTION_MAX_INTERVAL_MS = 10000;
+float SIMPLIFY_TOLERANCE_CM = 0; // Off: every result is published
+unsigned long SIMPLIFY_MAX_GAP_MS = 30000;
+
+// --- Zones ---
+// deviceID, { S1, S2, S3 sensor ids }, S2_a, S3_c, S3_b
+const ZoneConfig EXTRA_ZONES[MAX_ZONES] = {
+    // { 2, { 4, 5, 6 }, 370.0, 0.0, 110.0 },
+};
+
+// --- Geofences ---
+// id, deviceID, vertices, { x... }, { y... }, zMin, zMax, dwellMs
+const FenceConfig FENCES[MAX_FENCES] = {
+    // { 1, 1, 2, { 0, 120 }, { 0, 110 }, 0, 0, 30000 },         // Box: the first 1.2 m of the room
+    // { 2, 1, 3, { 250, 370, 370 }, { 0, 0, 110 }, 0, 0, 0 },   // Triangle in the far corner
+};
 
 // --- Logging Levels ---
-const int LOG_LEVEL = LOG_LEVEL_VERBOSE;
+int LOG_LEVEL = LOG_LEVEL_VERBOSE;
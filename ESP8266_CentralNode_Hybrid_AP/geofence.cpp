@@ -0,0 +1,285 @@
+#include <Arduino.h>
+#include <math.h>
+#include <stdio.h>
+#include "geofence.h"
+#include "logging.h"
+#include "profiler.h"
+
+// --- Fence Table ---
+// Boxes are stored as their four corners, so every fence is a polygon
+int fenceCount = 0;
+int fenceId[MAX_FENCES];
+int fenceDeviceId[MAX_FENCES];
+int16_t fenceZone[MAX_FENCES]; // -1 until a zone with its deviceID is added
+uint8_t fenceVertices[MAX_FENCES];
+float fenceX[MAX_FENCES][MAX_FENCE_VERTICES];
+float fenceY[MAX_FENCES][MAX_FENCE_VERTICES];
+float fenceZMin[MAX_FENCES];
+float fenceZMax[MAX_FENCES];
+uint32_t fenceDwellMs[MAX_FENCES];
+
+// State, per fence
+bool fenceInside[MAX_FENCES];
+bool fenceDwelt[MAX_FENCES];
+uint32_t fenceEnteredAt[MAX_FENCES];
+
+// --- Zone Grids ---
+// Cell (cx, cy) covers x0 + cx * cellW .. x0 + (cx + 1) * cellW, likewise in y.
+// Bit b of the masks is the zone's fence fence[b].
+struct GeofenceGrid {
+    float x0;
+    float y0;
+    float cellW;
+    float cellH;
+    int fences;
+    int16_t fence[GEOFENCE_PER_ZONE];
+    FenceMask inside[GEOFENCE_GRID * GEOFENCE_GRID]; // The whole cell lies inside
+    FenceMask near[GEOFENCE_GRID * GEOFENCE_GRID];   // Part of the cell is within the margin of an edge
+    FenceMask active;                                // Fences entered and not left yet
+};
+
+GeofenceGrid geofenceGrid[GEOFENCE_GRIDS];
+int geofenceGridCount = 0;
+int geoZoneCount = 0;
+int geoZoneDeviceId[MAX_ZONES];
+int16_t geoZoneGrid[MAX_ZONES]; // -1 for a zone without fences
+
+static void compile_zone(int zone);
+
+// Crossing-number test and the distance to the nearest edge
+static bool locate_polygon(int f, float px, float py, float& edgeDistance) {
+    bool in = false;
+    float best = INFINITY;
+    int n = fenceVertices[f];
+    const float* xs = fenceX[f];
+    const float* ys = fenceY[f];
+    for (int i = 0, j = n - 1; i < n; j = i++) {
+        if ((ys[i] > py) != (ys[j] > py) && px < xs[j] + (py - ys[j]) * (xs[i] - xs[j]) / (ys[i] - ys[j])) in = !in;
+        float ex = xs[i] - xs[j], ey = ys[i] - ys[j];
+        float len2 = ex * ex + ey * ey;
+        float t = len2 > 0 ? ((px - xs[j]) * ex + (py - ys[j]) * ey) / len2 : 0;
+        t = t < 0 ? 0 : (t > 1 ? 1 : t);
+        float dx = px - (xs[j] + t * ex), dy = py - (ys[j] + t * ey);
+        float d2 = dx * dx + dy * dy;
+        if (d2 < best) best = d2;
+    }
+    edgeDistance = sqrtf(best);
+    return in;
+}
+
+// 1 inside, 0 outside by at most GEOFENCE_MARGIN_CM, -1 further out
+static int locate_height(int f, float z) {
+    if (fenceZMin[f] == fenceZMax[f]) return 1;
+    if (z >= fenceZMin[f] && z <= fenceZMax[f]) return 1;
+    if (z >= fenceZMin[f] - GEOFENCE_MARGIN_CM && z <= fenceZMax[f] + GEOFENCE_MARGIN_CM) return 0;
+    return -1;
+}
+
+static void emit(int zone, int f, const char* event, uint32_t now, bool withTime) {
+    char payload[128];
+    if (withTime) {
+        snprintf(payload, sizeof(payload), "{\"deviceID\":%d,\"fence\":%d,\"event\":\"%s\",\"t\":%lu,\"ms\":%lu}",
+                 geoZoneDeviceId[zone], fenceId[f], event, (unsigned long)now,
+                 (unsigned long)(now - fenceEnteredAt[f]));
+    } else {
+        snprintf(payload, sizeof(payload), "{\"deviceID\":%d,\"fence\":%d,\"event\":\"%s\",\"t\":%lu}",
+                 geoZoneDeviceId[zone], fenceId[f], event, (unsigned long)now);
+    }
+    publish_geofence(payload);
+    logInfo("GEOFENCE", "deviceID %d, fence %d: %s", geoZoneDeviceId[zone], fenceId[f], event);
+}
+
+void setup_geofence() {
+    static bool loaded = false;
+    if (loaded) return;
+    loaded = true;
+    for (int i = 0; i < MAX_FENCES; i++) {
+        if (FENCES[i].id != 0) geofence_add(FENCES[i]);
+    }
+    if (fenceCount > 0) {
+        logInfo("GEOFENCE", "%d fence(s) in %d zone grid(s) of %dx%d, events on %s.", fenceCount, geofenceGridCount,
+                GEOFENCE_GRID, GEOFENCE_GRID, GEOFENCE_TOPIC);
+    }
+}
+
+int geofence_add(const FenceConfig& fence) {
+    if (fenceCount >= MAX_FENCES) {
+        logError("GEOFENCE", "Fence table full (%d), fence %d not added.", MAX_FENCES, fence.id);
+        return -1;
+    }
+    if (fence.vertices < 2 || fence.vertices > MAX_FENCE_VERTICES || fence.zMin > fence.zMax) {
+        logError("GEOFENCE", "Fence %d needs 2..%d vertices and zMin <= zMax, not added.", fence.id,
+                 MAX_FENCE_VERTICES);
+        return -1;
+    }
+
+    int f = fenceCount;
+    if (fence.vertices == 2) {
+        float x0 = fminf(fence.x[0], fence.x[1]), x1 = fmaxf(fence.x[0], fence.x[1]);
+        float y0 = fminf(fence.y[0], fence.y[1]), y1 = fmaxf(fence.y[0], fence.y[1]);
+        const float xs[4] = { x0, x1, x1, x0 };
+        const float ys[4] = { y0, y0, y1, y1 };
+        fenceVertices[f] = 4;
+        for (int i = 0; i < 4; i++) {
+            fenceX[f][i] = xs[i];
+            fenceY[f][i] = ys[i];
+        }
+    } else {
+        fenceVertices[f] = (uint8_t)fence.vertices;
+        for (int i = 0; i < fence.vertices; i++) {
+            fenceX[f][i] = fence.x[i];
+            fenceY[f][i] = fence.y[i];
+        }
+    }
+    // Shoelace: a box without width or a polygon on a line can never be entered
+    float area2 = 0;
+    for (int i = 0, j = fenceVertices[f] - 1; i < fenceVertices[f]; j = i++) {
+        area2 += fenceX[f][j] * fenceY[f][i] - fenceX[f][i] * fenceY[f][j];
+    }
+    if (fabsf(area2) < 1.0f) {
+        logError("GEOFENCE", "Fence %d has no area, not added.", fence.id);
+        return -1;
+    }
+
+    fenceId[f] = fence.id;
+    fenceDeviceId[f] = fence.deviceId;
+    fenceZMin[f] = fence.zMin;
+    fenceZMax[f] = fence.zMax;
+    fenceDwellMs[f] = (uint32_t)fence.dwellMs;
+    fenceInside[f] = false;
+    fenceDwelt[f] = false;
+    fenceZone[f] = -1;
+    fenceCount++;
+    for (int zone = 0; zone < geoZoneCount; zone++) {
+        if (geoZoneDeviceId[zone] != fence.deviceId) continue;
+        fenceZone[f] = (int16_t)zone;
+        compile_zone(zone);
+        break;
+    }
+    return f;
+}
+
+void geofence_assign(int zone, int deviceId) {
+    if (zone < 0 || zone >= MAX_ZONES) return;
+    geoZoneDeviceId[zone] = deviceId;
+    geoZoneGrid[zone] = -1;
+    if (zone >= geoZoneCount) geoZoneCount = zone + 1;
+    bool any = false;
+    for (int f = 0; f < fenceCount; f++) {
+        if (fenceDeviceId[f] != deviceId || fenceZone[f] >= 0) continue;
+        fenceZone[f] = (int16_t)zone;
+        any = true;
+    }
+    if (any) compile_zone(zone);
+}
+
+// Builds (or rebuilds, after a fence was added) the zone's grid. A cell is
+// classified from its centre: it is wholly inside when the centre is inside
+// and further than half the cell diagonal from every edge, wholly beyond the
+// margin when the centre is outside by more than that plus the margin.
+static void compile_zone(int zone) {
+    int g = geoZoneGrid[zone];
+    if (g < 0) {
+        if (geofenceGridCount >= GEOFENCE_GRIDS) {
+            logError("GEOFENCE", "Grid table full (%d), fences of deviceID %d are not checked.", GEOFENCE_GRIDS,
+                     geoZoneDeviceId[zone]);
+            return;
+        }
+        g = geofenceGridCount++;
+        geoZoneGrid[zone] = (int16_t)g;
+    }
+    GeofenceGrid& grid = geofenceGrid[g];
+    grid.fences = 0;
+    grid.active = 0;
+    float x0 = INFINITY, y0 = INFINITY, x1 = -INFINITY, y1 = -INFINITY;
+    for (int f = 0; f < fenceCount; f++) {
+        if (fenceZone[f] != zone) continue;
+        if (grid.fences >= GEOFENCE_PER_ZONE) {
+            logError("GEOFENCE", "More than %d fences for deviceID %d, fence %d is not checked.", GEOFENCE_PER_ZONE,
+                     geoZoneDeviceId[zone], fenceId[f]);
+            continue;
+        }
+        if (fenceInside[f]) grid.active |= (FenceMask)(1u << grid.fences);
+        grid.fence[grid.fences++] = (int16_t)f;
+        for (int i = 0; i < fenceVertices[f]; i++) {
+            x0 = fminf(x0, fenceX[f][i]);
+            x1 = fmaxf(x1, fenceX[f][i]);
+            y0 = fminf(y0, fenceY[f][i]);
+            y1 = fmaxf(y1, fenceY[f][i]);
+        }
+    }
+
+    // Outside the grid every fix is beyond the margin of every fence
+    grid.x0 = x0 - GEOFENCE_MARGIN_CM;
+    grid.y0 = y0 - GEOFENCE_MARGIN_CM;
+    grid.cellW = (x1 - x0 + 2 * GEOFENCE_MARGIN_CM) / GEOFENCE_GRID;
+    grid.cellH = (y1 - y0 + 2 * GEOFENCE_MARGIN_CM) / GEOFENCE_GRID;
+    float halfDiagonal = 0.5f * sqrtf(grid.cellW * grid.cellW + grid.cellH * grid.cellH);
+    int nearCells = 0;
+    for (int cy = 0; cy < GEOFENCE_GRID; cy++) {
+        for (int cx = 0; cx < GEOFENCE_GRID; cx++) {
+            int cell = cy * GEOFENCE_GRID + cx;
+            float px = grid.x0 + (cx + 0.5f) * grid.cellW;
+            float py = grid.y0 + (cy + 0.5f) * grid.cellH;
+            grid.inside[cell] = 0;
+            grid.near[cell] = 0;
+            for (int b = 0; b < grid.fences; b++) {
+                float d;
+                bool in = locate_polygon(grid.fence[b], px, py, d);
+                if (in && d > halfDiagonal) grid.inside[cell] |= (FenceMask)(1u << b);
+                else if (in || d <= halfDiagonal + GEOFENCE_MARGIN_CM) grid.near[cell] |= (FenceMask)(1u << b);
+            }
+            if (grid.near[cell]) nearCells++;
+        }
+    }
+    logVerbose("GEOFENCE", "deviceID %d: %d fence(s), %.1f x %.1f cm cells, %d of %d near an edge.",
+               geoZoneDeviceId[zone], grid.fences, grid.cellW, grid.cellH, nearCells, GEOFENCE_GRID * GEOFENCE_GRID);
+}
+
+void geofence_check(int zone, float x, float y, float z) {
+    if (zone < 0 || zone >= geoZoneCount || geoZoneGrid[zone] < 0) return;
+    PROFILE_ZONE("geofence_check");
+    GeofenceGrid& grid = geofenceGrid[geoZoneGrid[zone]];
+    FenceMask inside = 0, near = 0;
+    float fx = (x - grid.x0) / grid.cellW;
+    float fy = (y - grid.y0) / grid.cellH;
+    if (fx >= 0 && fy >= 0 && fx < GEOFENCE_GRID && fy < GEOFENCE_GRID) {
+        int cell = (int)fy * GEOFENCE_GRID + (int)fx;
+        inside = grid.inside[cell];
+        near = grid.near[cell];
+    }
+
+    // Only fences the fix is in or near, or that it has to leave
+    FenceMask todo = inside | near | grid.active;
+    uint32_t now = millis();
+    for (int b = 0; todo; b++, todo >>= 1) {
+        if (!(todo & 1)) continue;
+        FenceMask bit = (FenceMask)(1u << b);
+        int f = grid.fence[b];
+        int where = -1; // 1 inside, 0 outside within the margin, -1 beyond it
+        if (inside & bit) {
+            where = 1;
+        } else if (near & bit) {
+            float d;
+            where = locate_polygon(f, x, y, d) ? 1 : (d <= GEOFENCE_MARGIN_CM ? 0 : -1);
+        }
+        int height = locate_height(f, z);
+        if (height < where) where = height;
+
+        if (!fenceInside[f]) {
+            if (where < 1) continue;
+            fenceInside[f] = true;
+            fenceDwelt[f] = false;
+            fenceEnteredAt[f] = now;
+            grid.active |= bit;
+            emit(zone, f, "enter", now, false);
+        } else if (where < 0) {
+            fenceInside[f] = false;
+            grid.active &= (FenceMask)~bit;
+            emit(zone, f, "exit", now, true);
+        } else if (!fenceDwelt[f] && fenceDwellMs[f] > 0 && now - fenceEnteredAt[f] >= fenceDwellMs[f]) {
+            fenceDwelt[f] = true;
+            emit(zone, f, "dwell", now, true);
+        }
+    }
+}
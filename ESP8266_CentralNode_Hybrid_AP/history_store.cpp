@@ -0,0 +1,386 @@
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "history_store.h"
+#include "logging.h"
+#include "profiler.h"
+#include "scheduler.h"
+
+#ifndef ARDUINO_SHIM_H
+#define HISTORY_SPILL 1
+#include <LittleFS.h>
+#endif
+
+// --- Tiers ---
+static const uint32_t TIER_WIDTH_S[HISTORY_TIERS] = { 0, 1, 10, 60 };
+static const int TIER_DEPTH[HISTORY_TIERS] = { HISTORY_RAW_DEPTH, HISTORY_1S_DEPTH, HISTORY_10S_DEPTH, HISTORY_1M_DEPTH };
+static const char* const TIER_NAME[HISTORY_TIERS] = { "raw", "1s", "10s", "1m" };
+
+struct HistoryRaw {
+    uint32_t tMs; // Uptime
+    int16_t p[3];
+};
+
+// Bucket being filled, per tier and zone. The distances from S1 are summed
+// relative to the bucket's first one, so the variance of r keeps its digits.
+struct HistoryOpen {
+    uint32_t start;
+    uint16_t n;
+    float sum[3];
+    float min[3];
+    float max[3];
+    float refR;
+    float sumR;
+    float sumR2;
+};
+
+// --- Zone Rings (allocated once, in PSRAM where there is some) ---
+int histZoneCount = 0;
+int histDeviceId[MAX_ZONES];
+HistoryRaw* histRaw = nullptr;                   // [zone * HISTORY_RAW_DEPTH + i]
+HistoryBucket* histBuckets[HISTORY_TIERS] = {}; // [zone * depth + i], tiers 1..3
+uint16_t histHead[HISTORY_TIERS][MAX_ZONES];    // Next slot to write
+uint16_t histCount[HISTORY_TIERS][MAX_ZONES];
+HistoryOpen histOpen[HISTORY_TIERS][MAX_ZONES];
+
+// millis() extended past its 49-day wrap
+uint64_t histUptimeMs = 0;
+uint32_t histLastMillis = 0;
+
+// Request staged by on_history_topic(), served by the next tick
+struct HistoryRequest {
+    bool pending;
+    long id;
+    int zone;
+    uint8_t tier;
+    bool relative; // "since": from is seconds before the reply
+    uint32_t since;
+    uint32_t from;
+    uint32_t to;
+    const char* error;
+};
+HistoryRequest histRequest = {};
+
+#ifdef HISTORY_SPILL
+static const char* SPILL_FILE = "/history.bin";
+static const char* SPILL_OLD_FILE = "/history.old";
+bool histSpillMounted = false;
+
+struct HistorySpillRecord {
+    int32_t deviceId;
+    HistoryBucket b;
+};
+#endif
+
+static uint64_t uptime_ms() {
+    uint32_t now = millis();
+    histUptimeMs += (uint32_t)(now - histLastMillis);
+    histLastMillis = now;
+    return histUptimeMs;
+}
+
+static int16_t to_cm(float v) {
+    if (v > 32767.0f) return 32767;
+    if (v < -32768.0f) return -32768;
+    return (int16_t)lroundf(v);
+}
+
+static void* alloc_tier(size_t bytes) {
+#if defined(BOARD_HAS_PSRAM)
+    return ps_malloc(bytes);
+#else
+    return malloc(bytes);
+#endif
+}
+
+static void open_bucket(int tier, int zone, uint32_t nowS) {
+    HistoryOpen& o = histOpen[tier][zone];
+    o.start = nowS - nowS % TIER_WIDTH_S[tier];
+    o.n = 0;
+}
+
+void setup_history_store() {
+    if (histRaw) return;
+    uptime_ms();
+    histRaw = (HistoryRaw*)alloc_tier(sizeof(HistoryRaw) * MAX_ZONES * HISTORY_RAW_DEPTH);
+    size_t total = sizeof(HistoryRaw) * MAX_ZONES * HISTORY_RAW_DEPTH;
+    for (int tier = HISTORY_1S; tier < HISTORY_TIERS; tier++) {
+        histBuckets[tier] = (HistoryBucket*)alloc_tier(sizeof(HistoryBucket) * MAX_ZONES * TIER_DEPTH[tier]);
+        total += sizeof(HistoryBucket) * MAX_ZONES * TIER_DEPTH[tier];
+    }
+    if (!histRaw || !histBuckets[HISTORY_1S] || !histBuckets[HISTORY_10S] || !histBuckets[HISTORY_1M]) {
+        logError("HISTORY", "Cannot allocate %u bytes, history disabled.", (unsigned)total);
+        free(histRaw);
+        histRaw = nullptr;
+        for (int tier = HISTORY_1S; tier < HISTORY_TIERS; tier++) {
+            free(histBuckets[tier]);
+            histBuckets[tier] = nullptr;
+        }
+        scheduler_add("history", history_store_tick, HISTORY_TICK_MS, 0, 0); // Still answers, with the error
+        return;
+    }
+#ifdef HISTORY_SPILL
+#if defined(ESP32)
+    histSpillMounted = LittleFS.begin(true); // Formats a blank partition
+#else
+    histSpillMounted = LittleFS.begin();
+#endif
+    if (histSpillMounted) {
+        // Uptime starts again at 0: older buckets could not be placed
+        LittleFS.remove(SPILL_FILE);
+        LittleFS.remove(SPILL_OLD_FILE);
+    } else {
+        logWarn("HISTORY", "LittleFS not mounted, the 1 min tier stays in RAM.");
+    }
+#endif
+    scheduler_add("history", history_store_tick, HISTORY_TICK_MS, 0, HISTORY_BUDGET_US);
+    logInfo("HISTORY", "%u bytes for %d zone(s): %d raw, %d x 1 s, %d x 10 s, %d x 1 min per zone.", (unsigned)total,
+            MAX_ZONES, HISTORY_RAW_DEPTH, HISTORY_1S_DEPTH, HISTORY_10S_DEPTH, HISTORY_1M_DEPTH);
+}
+
+void history_store_assign(int zone, int deviceId) {
+    if (zone < 0 || zone >= MAX_ZONES) return;
+    histDeviceId[zone] = deviceId;
+    uint32_t nowS = (uint32_t)(uptime_ms() / 1000);
+    for (int tier = 0; tier < HISTORY_TIERS; tier++) {
+        histHead[tier][zone] = 0;
+        histCount[tier][zone] = 0;
+        if (tier != HISTORY_RAW) open_bucket(tier, zone, nowS);
+    }
+    if (zone >= histZoneCount) histZoneCount = zone + 1;
+}
+
+void history_store_record(int zone, float x, float y, float z) {
+    if (!histRaw || zone < 0 || zone >= histZoneCount) return;
+    uint64_t nowMs = uptime_ms();
+    const float p[3] = { x, y, z };
+
+    uint16_t& head = histHead[HISTORY_RAW][zone];
+    HistoryRaw& raw = histRaw[zone * HISTORY_RAW_DEPTH + head];
+    raw.tMs = (uint32_t)nowMs;
+    // Raw times are the paging cursor, so two fixes never share one
+    if (histCount[HISTORY_RAW][zone] > 0) {
+        uint32_t lastMs = histRaw[zone * HISTORY_RAW_DEPTH + (head + HISTORY_RAW_DEPTH - 1) % HISTORY_RAW_DEPTH].tMs;
+        if ((int32_t)(raw.tMs - lastMs) <= 0) raw.tMs = lastMs + 1;
+    }
+    for (int axis = 0; axis < 3; axis++) raw.p[axis] = to_cm(p[axis]);
+    head = (uint16_t)((head + 1) % HISTORY_RAW_DEPTH);
+    if (histCount[HISTORY_RAW][zone] < HISTORY_RAW_DEPTH) histCount[HISTORY_RAW][zone]++;
+
+    float r = sqrtf(x * x + y * y + z * z);
+    for (int tier = HISTORY_1S; tier < HISTORY_TIERS; tier++) {
+        HistoryOpen& o = histOpen[tier][zone];
+        if (o.n == 0) {
+            for (int axis = 0; axis < 3; axis++) {
+                o.sum[axis] = 0;
+                o.min[axis] = o.max[axis] = p[axis];
+            }
+            o.refR = r;
+            o.sumR = o.sumR2 = 0;
+        }
+        for (int axis = 0; axis < 3; axis++) {
+            o.sum[axis] += p[axis];
+            if (p[axis] < o.min[axis]) o.min[axis] = p[axis];
+            if (p[axis] > o.max[axis]) o.max[axis] = p[axis];
+        }
+        float d = r - o.refR;
+        o.sumR += d;
+        o.sumR2 += d * d;
+        if (o.n < 0xFFFF) o.n++;
+    }
+}
+
+#ifdef HISTORY_SPILL
+static void spill_bucket(int zone, const HistoryBucket& b) {
+    if (!histSpillMounted) return;
+    HistorySpillRecord rec = { histDeviceId[zone], b };
+    File f = LittleFS.open(SPILL_FILE, "a");
+    if (!f) return;
+    f.write((const uint8_t*)&rec, sizeof(rec));
+    bool full = f.size() >= HISTORY_SPILL_BYTES;
+    f.close();
+    if (full) {
+        LittleFS.remove(SPILL_OLD_FILE);
+        LittleFS.rename(SPILL_FILE, SPILL_OLD_FILE);
+    }
+}
+#endif
+
+static void close_bucket(int tier, int zone) {
+    HistoryOpen& o = histOpen[tier][zone];
+    int depth = TIER_DEPTH[tier];
+    uint16_t& head = histHead[tier][zone];
+    HistoryBucket& b = histBuckets[tier][zone * depth + head];
+#ifdef HISTORY_SPILL
+    if (tier == HISTORY_1M && histCount[tier][zone] == depth) spill_bucket(zone, b); // About to be overwritten
+#endif
+    b.t = o.start;
+    b.n = o.n;
+    for (int axis = 0; axis < 3; axis++) {
+        b.min[axis] = to_cm(o.min[axis]);
+        b.mean[axis] = to_cm(o.sum[axis] / o.n);
+        b.max[axis] = to_cm(o.max[axis]);
+    }
+    float meanD = o.sumR / o.n;
+    float variance = o.sumR2 / o.n - meanD * meanD;
+    float rMm = variance > 0 ? sqrtf(variance) * 10.0f : 0;
+    b.r = rMm < 65535.0f ? (uint16_t)lroundf(rMm) : 65535;
+    head = (uint16_t)((head + 1) % depth);
+    if (histCount[tier][zone] < depth) histCount[tier][zone]++;
+}
+
+// --- Replies ---
+
+struct ReplyWriter {
+    char buf[HISTORY_REPLY_MAX];
+    int len;
+    int entries;
+    bool more;
+    uint32_t next;
+};
+
+static void reply_add(ReplyWriter& w, uint32_t t, const char* entry) {
+    if (w.more) return;
+    int n = (int)strlen(entry) + 1;
+    // Room for the closing "],\"next\":4294967295}"
+    if (w.entries == HISTORY_PAGE || w.len + n + 24 >= (int)sizeof(w.buf)) {
+        w.more = true;
+        w.next = t;
+        return;
+    }
+    if (w.entries > 0) w.buf[w.len++] = ',';
+    memcpy(w.buf + w.len, entry, n);
+    w.len += n - 1;
+    w.entries++;
+}
+
+static void reply_bucket(ReplyWriter& w, const HistoryBucket& b, uint32_t from, uint32_t to) {
+    if (b.t < from || b.t > to) return;
+    char entry[96];
+    snprintf(entry, sizeof(entry), "[%lu,%u,%d,%d,%d,%d,%d,%d,%d,%d,%d,%u]", (unsigned long)b.t, b.n, b.min[0],
+             b.mean[0], b.max[0], b.min[1], b.mean[1], b.max[1], b.min[2], b.mean[2], b.max[2], b.r);
+    reply_add(w, b.t, entry);
+}
+
+#ifdef HISTORY_SPILL
+static void reply_spill(ReplyWriter& w, const char* path, int deviceId, uint32_t from, uint32_t to) {
+    File f = LittleFS.open(path, "r");
+    if (!f) return;
+    HistorySpillRecord rec;
+    while (!w.more && f.read((uint8_t*)&rec, sizeof(rec)) == (int)sizeof(rec)) {
+        if (rec.deviceId == deviceId) reply_bucket(w, rec.b, from, to);
+    }
+    f.close();
+}
+#endif
+
+static void serve_request() {
+    HistoryRequest req = histRequest;
+    histRequest.pending = false;
+    if (req.error) {
+        char error[96];
+        snprintf(error, sizeof(error), "{\"id\":%ld,\"error\":\"%s\"}", req.id, req.error);
+        publish_history(error);
+        return;
+    }
+    uint32_t nowS = (uint32_t)(uptime_ms() / 1000);
+    uint32_t from = req.relative ? (req.since < nowS ? nowS - req.since : 0) : req.from;
+    uint32_t to = req.relative ? nowS : req.to;
+    int zone = req.zone;
+
+    ReplyWriter w;
+    w.len = snprintf(w.buf, sizeof(w.buf), "{\"id\":%ld,\"dev\":%d,\"tier\":\"%s\",\"now\":%lu,\"b\":[", req.id,
+                     histDeviceId[zone], TIER_NAME[req.tier], (unsigned long)nowS);
+    w.entries = 0;
+    w.more = false;
+    w.next = 0;
+
+    int depth = TIER_DEPTH[req.tier];
+    int count = histCount[req.tier][zone];
+    int oldest = (histHead[req.tier][zone] + depth - count) % depth;
+    if (req.tier == HISTORY_RAW) {
+        // Raw entries page by their own time, so "from", "to" and "next" are in ms here
+        uint32_t nowMs = (uint32_t)uptime_ms();
+        uint32_t fromMs = req.relative ? (req.since < nowS ? nowMs - req.since * 1000 : 0) : req.from;
+        uint32_t toMs = req.relative ? nowMs : req.to;
+        for (int i = 0; i < count && !w.more; i++) {
+            const HistoryRaw& raw = histRaw[zone * depth + (oldest + i) % depth];
+            if (raw.tMs < fromMs || raw.tMs > toMs) continue;
+            char entry[48];
+            snprintf(entry, sizeof(entry), "[%lu,%d,%d,%d]", (unsigned long)raw.tMs, raw.p[0], raw.p[1], raw.p[2]);
+            reply_add(w, raw.tMs, entry);
+        }
+    } else {
+        const HistoryBucket* ring = histBuckets[req.tier] + zone * depth;
+#ifdef HISTORY_SPILL
+        // Spilled buckets are older than the ring's
+        if (req.tier == HISTORY_1M && count == depth && from < ring[oldest].t) {
+            reply_spill(w, SPILL_OLD_FILE, histDeviceId[zone], from, to);
+            reply_spill(w, SPILL_FILE, histDeviceId[zone], from, to);
+        }
+#endif
+        for (int i = 0; i < count && !w.more; i++) reply_bucket(w, ring[(oldest + i) % depth], from, to);
+    }
+
+    if (w.more) w.len += snprintf(w.buf + w.len, sizeof(w.buf) - w.len, "],\"next\":%lu}", (unsigned long)w.next);
+    else w.len += snprintf(w.buf + w.len, sizeof(w.buf) - w.len, "]}");
+    publish_history(w.buf);
+    logVerbose("HISTORY", "Request %ld: %d %s entries of deviceID %d%s.", req.id, w.entries, TIER_NAME[req.tier],
+               histDeviceId[zone], w.more ? ", more to come" : "");
+}
+
+void history_store_tick() {
+    if (!histRaw) {
+        if (histRequest.pending) serve_request(); // "history disabled"
+        return;
+    }
+    PROFILE_ZONE("history_store_tick");
+    uint32_t nowS = (uint32_t)(uptime_ms() / 1000);
+    for (int zone = 0; zone < histZoneCount; zone++) {
+        for (int tier = HISTORY_1S; tier < HISTORY_TIERS; tier++) {
+            HistoryOpen& o = histOpen[tier][zone];
+            if (nowS < o.start + TIER_WIDTH_S[tier]) continue;
+            if (o.n > 0) close_bucket(tier, zone);
+            open_bucket(tier, zone, nowS);
+        }
+    }
+    if (histRequest.pending) serve_request();
+}
+
+// --- Requests ---
+
+void on_history_topic(int, const char* payload, size_t) {
+    StaticJsonDocument<256> doc;
+    DeserializationError error = deserializeJson(doc, payload);
+    if (error) {
+        logError("HISTORY", "JSON parse failed on history request: %s", error.c_str());
+        return;
+    }
+    if (histRequest.pending) logWarn("HISTORY", "Request %ld replaced before it was served.", histRequest.id);
+    HistoryRequest req = {};
+    req.pending = true;
+    req.id = doc["id"] | 0L;
+    int deviceId = doc["dev"] | -1;
+    req.zone = -1;
+    for (int zone = 0; zone < histZoneCount; zone++) {
+        if (histDeviceId[zone] == deviceId) req.zone = zone;
+    }
+    const char* tier = doc["tier"] | "1m";
+    req.tier = HISTORY_TIERS;
+    for (int t = 0; t < HISTORY_TIERS; t++) {
+        if (!strcmp(tier, TIER_NAME[t])) req.tier = (uint8_t)t;
+    }
+    req.relative = doc.containsKey("since");
+    req.since = doc["since"] | 0UL;
+    req.from = doc["from"] | 0UL;
+    req.to = doc["to"] | 0xFFFFFFFFUL;
+
+    if (!histRaw) req.error = "history disabled";
+    else if (req.zone < 0) req.error = "unknown dev";
+    else if (req.tier == HISTORY_TIERS) req.error = "unknown tier";
+    else if (!req.relative && req.from > req.to) req.error = "from after to";
+    histRequest = req;
+}
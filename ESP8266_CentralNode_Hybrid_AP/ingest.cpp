@@ -0,0 +1,115 @@
+#include <Arduino.h>
+#include "ingest.h"
+#include "logging.h"
+#include "profiler.h"
+#include "scheduler.h"
+
+// --- Slot Table (struct of arrays) ---
+IngestValue slotValue[INGEST_SLOTS];
+bool slotPending[INGEST_SLOTS];
+uint16_t slotOverwrites[INGEST_SLOTS]; // Since the last ingest_log_stats(), saturating
+uint16_t slotDrops[INGEST_SLOTS];
+
+// Token bucket as a theoretical arrival time (GCRA): a message is admitted if
+// the bucket's clock is at most (INGEST_BURST - 1) intervals ahead of now,
+// and every admitted message moves it one interval on
+uint32_t slotNextAtMs[INGEST_SLOTS];
+
+// Pending slots in the order they were first written since the last drain
+int16_t pendingOrder[INGEST_SLOTS];
+int pendingCount = 0;
+
+// Snapshot taken by ingest_drain()
+IngestValue drainValue[INGEST_SLOTS];
+int16_t drainSlot[INGEST_SLOTS];
+
+uint32_t totalOverwrites = 0;
+uint32_t totalDrops = 0;
+
+void setup_ingest() {
+    for (int slot = 0; slot < INGEST_SLOTS; slot++) ingest_reset_slot(slot);
+    pendingCount = 0;
+    scheduler_add("ingest", ingest_drain, 0, 0, INGEST_BUDGET_US);
+}
+
+void ingest_reset_slot(int slot) {
+    if (slot < 0 || slot >= INGEST_SLOTS) return;
+    slotOverwrites[slot] = 0;
+    slotDrops[slot] = 0;
+    slotNextAtMs[slot] = millis();
+    if (!slotPending[slot]) return;
+    // Take it out of the pending order as well
+    slotPending[slot] = false;
+    int kept = 0;
+    for (int i = 0; i < pendingCount; i++) {
+        if (pendingOrder[i] != slot) pendingOrder[kept++] = pendingOrder[i];
+    }
+    pendingCount = kept;
+}
+
+static uint32_t interval_ms() {
+    uint32_t ms = (uint32_t)(1000.0f / INGEST_RATE_HZ);
+    return ms > 0 ? ms : 1;
+}
+
+bool ingest_admit(int slot) {
+    if (INGEST_RATE_HZ <= 0) return true;
+    uint32_t now = millis();
+    uint32_t interval = interval_ms();
+    uint32_t tolerance = INGEST_BURST > 1 ? (uint32_t)(INGEST_BURST - 1) * interval : 0;
+    uint32_t& next = slotNextAtMs[slot];
+    if ((int32_t)(next - now) < 0) next = now; // Idle: the bucket is full
+    if (next - now > tolerance) {
+        if (slotDrops[slot] < 0xFFFF) slotDrops[slot]++;
+        totalDrops++;
+        return false;
+    }
+    next += interval;
+    return true;
+}
+
+void ingest_put(int slot, const IngestValue& value) {
+    if (slotPending[slot]) {
+        if (slotOverwrites[slot] < 0xFFFF) slotOverwrites[slot]++;
+        totalOverwrites++;
+    } else {
+        slotPending[slot] = true;
+        pendingOrder[pendingCount++] = (int16_t)slot;
+    }
+    slotValue[slot] = value;
+}
+
+void ingest_drain() {
+    if (pendingCount == 0) return;
+    PROFILE_ZONE("ingest_drain");
+    // Snapshot first: a value put while the calculation runs waits for the next pass
+    int count = pendingCount;
+    for (int i = 0; i < count; i++) {
+        int slot = pendingOrder[i];
+        drainSlot[i] = (int16_t)slot;
+        drainValue[i] = slotValue[slot];
+        slotPending[slot] = false;
+    }
+    pendingCount = 0;
+    for (int i = 0; i < count; i++) apply_ingested(drainSlot[i], drainValue[i]);
+}
+
+void ingest_log_stats() {
+    uint32_t now = millis();
+    uint32_t overwrites = 0;
+    for (int slot = 0; slot < INGEST_SLOTS; slot++) {
+        overwrites += slotOverwrites[slot];
+        if (slotDrops[slot] > 0) {
+            logWarn("INGEST", "Zone %d S%d over %.1f msg/s: %u message(s) dropped this interval.", slot / 3,
+                    slot % 3 + 1, INGEST_RATE_HZ, slotDrops[slot]);
+        }
+        slotOverwrites[slot] = 0;
+        slotDrops[slot] = 0;
+        // Keep an idle bucket's clock from falling so far behind that millis() wraps past it
+        if ((int32_t)(slotNextAtMs[slot] - now) < 0) slotNextAtMs[slot] = now;
+    }
+    if (overwrites > 0) {
+        logVerbose("INGEST", "%lu range(s) replaced by a newer one before use (%lu overall, %lu dropped overall).",
+                   (unsigned long)overwrites, (unsigned long)totalOverwrites, (unsigned long)totalDrops);
+    }
+}
@@ -0,0 +1,34 @@
+#ifndef INGEST_H
+#define INGEST_H
+
+#include <stdint.h>
+#include "config.h"
+#include "multi_target.h"
+
+// Ingest stage between the broker callbacks and the calculation: one
+// latest-value slot per sensor, drained by the "ingest" task once per loop
+// pass, with a token bucket (INGEST_RATE_HZ, INGEST_BURST) in front of each.
+
+constexpr int INGEST_SLOTS = MAX_ZONES * 3; // zone * 3 + slot
+constexpr uint32_t INGEST_BUDGET_US = 5000;  // Draining every slot of every zone
+
+struct IngestValue {
+    float distance;
+    float cand[MAX_CANDIDATES];
+    uint8_t candCount;
+    bool hasCandidates; // The message carried "c" (MULTI_TARGET_MODE)
+    int16_t movingEnergy; // "me" and "se" of an LD2410 (see motion.h), -1 if not sent
+    int16_t stationaryEnergy;
+};
+
+void setup_ingest();                // From initialize_logic(): empties the slots, registers the drain task
+void ingest_reset_slot(int slot);   // A zone slot was (re)assigned
+bool ingest_admit(int slot);        // Takes a token; false: over the rate, drop the message (counted)
+void ingest_put(int slot, const IngestValue& value);
+void ingest_drain();                // Scheduler task: every pending value to apply_ingested()
+void ingest_log_stats();            // End of every averaging interval
+
+// Provided by calculation_logic.cpp
+void apply_ingested(int slot, const IngestValue& value);
+
+#endif // INGEST_H
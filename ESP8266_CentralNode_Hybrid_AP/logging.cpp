@@ -46,3 +46,10 @@ void logError(const char* prefix, const char* format, ...) {
 void logResult(const char* resultString) {
     Serial.printf("[RESULT] %s\n", resultString);
 }
+
+void logFix(int deviceId, float d1, float d2, float d3, float x, float y, float z) {
+    // Same columns as system/central_node/data/*.csv (without the timestamp), plus the zone's deviceID
+    if (LOG_LEVEL >= LOG_LEVEL_VERBOSE) {
+        Serial.printf("[FIX] %.0f,%.0f,%.0f,%.2f,%.2f,%.2f,%d\n", d1, d2, d3, x, y, z, deviceId);
+    }
+}
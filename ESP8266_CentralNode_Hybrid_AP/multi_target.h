@@ -0,0 +1,30 @@
+#ifndef MULTI_TARGET_H
+#define MULTI_TARGET_H
+
+#include <ArduinoJson.h>
+#include "types.h"
+
+// Multi-target tracking for MULTI_TARGET_MODE: every candidate triplet of a
+// zone's frame is solved, and tracks are associated with the fixes jointly so
+// that no two chosen fixes share a sensor range, which rules out ghosts.
+
+constexpr int MAX_CANDIDATES = 2;       // Ranges per sensor frame
+constexpr int MAX_TRACKS = 4;           // Tracks per zone
+constexpr float TRACK_GATE_CM = 75.0;   // A fix further than this from a track (z weighted) never updates it
+constexpr float TRACK_Z_WEIGHT = 4.0;   // Height change counts this much more than horizontal movement
+constexpr float TRACK_SMOOTHING = 0.5;  // Weight of a new fix in the track position
+constexpr int TRACK_CONFIRM_HITS = 3;
+constexpr int TRACK_MAX_MISSES = 5;
+
+// One solved candidate triplet
+struct TargetFix {
+    Point3D p;
+    uint8_t cand[3]; // Candidate index used from each sensor
+};
+
+void reset_tracks(int zone);
+void update_tracks(int zone, const TargetFix* fixes, int count);
+void write_tracks(int zone, JsonArray targets); // Confirmed tracks as {"track":id,"x","y","z"}
+int read_tracks(int zone, uint16_t ids[MAX_TRACKS], Point3D positions[MAX_TRACKS]); // Confirmed tracks, returns the count
+
+#endif // MULTI_TARGET_H
@@ -1,18 +1,38 @@
 #include <ESP8266WiFi.h>
 #include <sMQTTBroker.h>
 #include <PubSubClient.h>
-#include <ArduinoJson.h>
 #include <map>
 #include <string>
 #include "network_manager.h"
 #include "config.h"
 #include "logging.h"
 #include "calculation_logic.h"
+#include "tuning.h"
+#include "scheduler.h"
+#include "warm_state.h"
+#include "topic_router.h"
+#include "profiler.h"
+#include "tdma.h"
+#include "fanout.h"
+#include "geofence.h"
+#include "history_store.h"
+
+constexpr uint32_t NETWORK_BUDGET_US = 5000;      // One broker or client pass; longer ones delay the averaging task
+constexpr uint32_t RECONNECT_INTERVAL_MS = 5000;
+constexpr int32_t CONNECT_TIMEOUT_MS = 250;   // TCP connect of one attempt; a broker on the LAN answers in a few ms
+constexpr uint16_t CONNACK_TIMEOUT_S = 1;     // PubSubClient waits whole seconds for CONNACK
+constexpr uint32_t WIFI_POLL_MS = 50;
+constexpr uint32_t WIFI_CONNECT_TIMEOUT_MS = 10500; // Full join with scan and DHCP, then restart
 
 // --- BEGIN: LOCAL BROKER IMPLEMENTATION (sMQTTBroker Event Model) ---
 
-// Map to store client pointers against their login IDs
-std::map<sMQTTClient*, std::string> client_logins;
+// Map to store client pointers against their login IDs, and the sensor id a
+// login binds to (SENSOR_LOGIN_PREFIX), -1 if none
+struct ClientLogin {
+    std::string login;
+    int sensorId;
+};
+std::map<sMQTTClient*, ClientLogin> client_logins;
 
 class MyLocalBroker : public sMQTTBroker {
 public:
@@ -26,7 +46,7 @@ public:
                 
                 // Store the client's login for later use
                 if (client) {
-                    client_logins[client] = login;
+                    client_logins[client] = { login, sensor_id_from_login(login.c_str()) };
                 }
                 logInfo("LOCAL_BROKER", "Sensor connected, id: %s", login.c_str());
                 break;
@@ -37,7 +57,7 @@ public:
                 
                 // Remove the client from our map
                 if (client && client_logins.count(client)) {
-                    logInfo("LOCAL_BROKER", "Sensor disconnected, id: %s", client_logins[client].c_str());
+                    logInfo("LOCAL_BROKER", "Sensor disconnected, id: %s", client_logins[client].login.c_str());
                     client_logins.erase(client);
                 } else {
                     logInfo("LOCAL_BROKER", "An unknown sensor has disconnected.");
@@ -45,32 +65,26 @@ public:
                 break;
             }
             case Public_sMQTTEventType: {
+                PROFILE_ZONE("onLocalData");
                 sMQTTPublicClientEvent *e = (sMQTTPublicClientEvent*)event;
                 sMQTTClient *client = e->Client();
                 
                 // Look up the client's login from our map
                 const char* client_id = "unknown";
+                int sensorId = -1;
                 if (client && client_logins.count(client)) {
-                    client_id = client_logins[client].c_str();
+                    const ClientLogin& c = client_logins[client];
+                    client_id = c.login.c_str();
+                    sensorId = c.sensorId;
                 }
 
                 const std::string topic_str = e->Topic();
-                const char* topic = topic_str.c_str();
                 const std::string payload_str = e->Payload();
                 const char* payload = payload_str.c_str();
 
-                logVerbose("RECV", "Message on LOCAL broker from [%s] on topic [%s]: %s", client_id, topic, payload);
-                
-                if (strcmp(topic, SENSOR_TOPIC) == 0) {
-                    StaticJsonDocument<96> doc;
-                    DeserializationError error = deserializeJson(doc, payload);
-                    if (error) {
-                        logError("PARSE", "JSON parse failed on local message: %s", error.c_str());
-                    } else if (!doc.containsKey("id") || !doc.containsKey("d")) {
-                        logWarn("RECV", "Invalid local message: missing 'id' or 'd'");
-                    } else {
-                        on_distance_received(doc["id"], doc["d"]);
-                    }
+                logVerbose("RECV", "Message on LOCAL broker from [%s] on topic [%s]: %s", client_id, topic_str.c_str(), payload);
+                if (!route_message(topic_str.c_str(), topic_str.size(), payload, payload_str.size(), sensorId)) {
+                    logVerbose("RECV", "No route for topic %s", topic_str.c_str());
                 }
                 break;
             }
@@ -90,12 +104,28 @@ void setup_local_broker() {
     } else {
         logError("LOCAL_BROKER", "Failed to initialize sMQTTBroker!");
     }
+    topic_route(SENSOR_TOPIC, on_sensor_message);
+    topic_route_sensors(SENSOR_TOPIC, on_sensor_message); // SENSOR_TOPIC/<id>
+    topic_route(CONTROL_TOPIC, on_control_topic);
+    topic_route(HISTORY_TOPIC, on_history_topic);
+    scheduler_add("local-broker", loop_local_broker, 0, 0, NETWORK_BUDGET_US);
+    setup_fanout();
 }
 
 void loop_local_broker() {
     localBroker.update();
 }
 
+// The broker delivers it to the sensors subscribed to TDMA_TOPIC
+void publish_schedule(const char* payload) {
+    localBroker.publish(TDMA_TOPIC, payload);
+}
+
+// Results for nearby consumers, from the fanout task (fanout.h)
+void publish_local(const uint8_t* data, size_t length) {
+    localBroker.publish(LOCAL_RESULT_TOPIC, std::string((const char*)data, length));
+}
+
 // --- END: LOCAL BROKER IMPLEMENTATION ---
 
 // --- BEGIN: EXTERNAL CLIENT IMPLEMENTATION ---
@@ -103,31 +133,62 @@ void loop_local_broker() {
 WiFiClient espClient;
 PubSubClient externalClient(espClient);
 
+// Callback for control messages arriving from the external gateway
+void external_callback(char* topic, byte* payload, unsigned int length) {
+    char payloadStr[length + 1];
+    memcpy(payloadStr, payload, length);
+    payloadStr[length] = '\0';
+    logVerbose("RECV", "Message on EXTERNAL client [%s]: %s", topic, payloadStr);
+
+    if (strcmp(topic, CONTROL_TOPIC) == 0) {
+        on_control_message(payloadStr);
+    } else if (strcmp(topic, HISTORY_TOPIC) == 0) {
+        on_history_topic(-1, payloadStr, length);
+    }
+}
+
+// One attempt per RECONNECT_INTERVAL_MS instead of blocking until connected, so
+// sensors keep being served while the gateway is away. The TCP connect is made
+// here, bounded by CONNECT_TIMEOUT_MS (espClient's timeout) rather than the
+// core's few seconds to an absent host; PubSubClient then only exchanges
+// CONNECT and CONNACK on it
 void reconnect_external_client() {
-    while (!externalClient.connected()) {
-        logInfo("EXT_CLIENT", "Attempting connection to external gateway...");
-        if (externalClient.connect(MQTT_CLIENT_ID)) {
-            logInfo("EXT_CLIENT", "Connected to %s", EXTERNAL_BROKER_IP);
-        } else {
-            logError("EXT_CLIENT", "Failed, rc=%d. Retrying in 5 seconds...", externalClient.state());
-            delay(5000);
-        }
+    if (externalClient.connected()) return;
+    logInfo("EXT_CLIENT", "Attempting connection to external gateway...");
+    if (!espClient.connect(EXTERNAL_BROKER_IP, EXTERNAL_BROKER_PORT)) {
+        logError("EXT_CLIENT", "No answer within %ld ms. Retrying in %lu ms...", (long)CONNECT_TIMEOUT_MS,
+                 (unsigned long)RECONNECT_INTERVAL_MS);
+        return;
+    }
+    if (externalClient.connect(MQTT_CLIENT_ID)) {
+        logInfo("EXT_CLIENT", "Connected to %s", EXTERNAL_BROKER_IP);
+        externalClient.subscribe(CONTROL_TOPIC);
+        externalClient.subscribe(HISTORY_TOPIC);
+    } else {
+        logError("EXT_CLIENT", "Failed, rc=%d. Retrying in %lu ms...", externalClient.state(), (unsigned long)RECONNECT_INTERVAL_MS);
     }
 }
 
 void setup_external_client() {
     logInfo("EXT_CLIENT", "Setting up client for external gateway %s:%d", EXTERNAL_BROKER_IP, EXTERNAL_BROKER_PORT);
     externalClient.setServer(EXTERNAL_BROKER_IP, EXTERNAL_BROKER_PORT);
+    espClient.setTimeout(CONNECT_TIMEOUT_MS);
+    externalClient.setSocketTimeout(CONNACK_TIMEOUT_S);
+    externalClient.setCallback(external_callback);
+    externalClient.setBufferSize(HISTORY_REPLY_MAX + 64); // Room for a history reply and its topic
+    reconnect_external_client();
+    scheduler_add("ext-reconnect", reconnect_external_client, RECONNECT_INTERVAL_MS, 0, 0);
+    scheduler_add("ext-client", loop_external_client, 0, 0, NETWORK_BUDGET_US);
 }
 
 void loop_external_client() {
-    if (!externalClient.connected()) {
-        reconnect_external_client();
+    if (externalClient.connected()) {
+        externalClient.loop();
     }
-    externalClient.loop();
 }
 
 void publish_results(const char* payload) {
+    fanout_push((const uint8_t*)payload, strlen(payload)); // Also while the gateway is away
     if (PUBLISH_RESULTS) {
         if (externalClient.connected()) {
             logVerbose("SENDER", "Publishing to EXTERNAL gateway on topic %s", OUTPUT_TOPIC);
@@ -140,10 +201,41 @@ void publish_results(const char* payload) {
     }
 }
 
+void publish_result_packet(const uint8_t* data, size_t length) {
+    fanout_push(data, length);
+    if (!PUBLISH_RESULTS) return;
+    if (externalClient.connected()) {
+        externalClient.publish(OUTPUT_TOPIC, data, length);
+    } else {
+        logWarn("SENDER", "Cannot publish to external gateway. Client not connected.");
+    }
+}
+
+// Requests come from either side; the reply goes to both, the request id tells them apart
+void publish_history(const char* payload) {
+    localBroker.publish(HISTORY_REPLY_TOPIC, payload);
+    if (externalClient.connected()) externalClient.publish(HISTORY_REPLY_TOPIC, payload);
+}
+
+// Alarm relays on the sensor network hear it first; the gateway when it is there
+void publish_geofence(const char* payload) {
+    localBroker.publish(GEOFENCE_TOPIC, payload);
+    if (externalClient.connected()) externalClient.publish(GEOFENCE_TOPIC, payload);
+}
+
 // --- END: EXTERNAL CLIENT IMPLEMENTATION ---
 
 // --- BEGIN: WIFI AP+STA SETUP ---
 
+static bool wait_for_wifi(uint32_t timeoutMs) {
+    uint32_t start = millis();
+    while (WiFi.status() != WL_CONNECTED) {
+        if (millis() - start >= timeoutMs) return false;
+        delay(WIFI_POLL_MS);
+    }
+    return true;
+}
+
 void setup_wifi_ap_sta() {
     logInfo("WIFI", "Setting up WiFi in Access Point + Station mode...");
     WiFi.mode(WIFI_AP_STA);
@@ -157,19 +249,33 @@ void setup_wifi_ap_sta() {
         logError("WIFI_AP", "Failed to start Access Point!");
     }
 
-    // Setup the Station mode to connect to the external network
-    logInfo("WIFI_STA", "Connecting to external WiFi: %s", WIFI_SSID);
-    WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
-    int attempts = 0;
-    while (WiFi.status() != WL_CONNECTED) {
-        delay(500);
-        Serial.print(".");
-        if(attempts++ > 20) {
+    // Setup the Station mode to connect to the external network. After a warm
+    // restart the cached BSSID, channel and IP settings skip the scan and DHCP;
+    // if that join fails the cache is dropped and a full join follows.
+    bool connected = false;
+    const WarmWifi* cached = warm_wifi();
+    if (cached) {
+        logInfo("WIFI_STA", "Rejoining %s on channel %d", WIFI_SSID, cached->channel);
+        WiFi.config(IPAddress(cached->ip), IPAddress(cached->gateway), IPAddress(cached->subnet), IPAddress(cached->dns));
+        WiFi.begin(WIFI_SSID, WIFI_PASSWORD, cached->channel, cached->bssid);
+        connected = wait_for_wifi(FAST_CONNECT_TIMEOUT_MS);
+        if (!connected) {
+            logWarn("WIFI_STA", "Cached association failed, scanning.");
+            warm_clear_wifi();
+            WiFi.disconnect();
+            WiFi.config(IPAddress(), IPAddress(), IPAddress()); // Back to DHCP
+        }
+    }
+    if (!connected) {
+        logInfo("WIFI_STA", "Connecting to external WiFi: %s", WIFI_SSID);
+        WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+        if (!wait_for_wifi(WIFI_CONNECT_TIMEOUT_MS)) {
             logError("WIFI_STA", "Failed to connect to external WiFi. Restarting...");
             ESP.restart();
         }
     }
-    Serial.println("");
+    warm_save_wifi(WiFi.BSSID(), WiFi.channel(), (uint32_t)WiFi.localIP(), (uint32_t)WiFi.gatewayIP(),
+                   (uint32_t)WiFi.subnetMask(), (uint32_t)WiFi.dnsIP());
     logInfo("WIFI_STA", "Connected to external WiFi. Device IP on external net: %s", WiFi.localIP().toString().c_str());
 }
 
@@ -0,0 +1,94 @@
+#include "profiler.h"
+
+#ifdef PROFILING
+
+#include <string.h>
+#include "logging.h"
+
+// --- Zone Table (struct of arrays) ---
+int profileZoneCount = 0;
+const char* profileName[MAX_PROFILE_ZONES];
+uint32_t profileRuns[MAX_PROFILE_ZONES]; // Since the last report
+uint64_t profileTotal[MAX_PROFILE_ZONES]; // Ticks
+ProfileTicks profileMax[MAX_PROFILE_ZONES];
+
+#ifdef PROFILE_EVENTS
+ProfileEvent profileEvents[PROFILE_EVENT_BATCH];
+int profileEventCount = 0;
+ProfileSink profileSink = nullptr;
+uint32_t profileEventsDropped = 0;
+#endif
+
+int profiler_zone(const char* name) {
+    for (int z = 0; z < profileZoneCount; z++) {
+        if (!strcmp(profileName[z], name)) return z;
+    }
+    if (profileZoneCount >= MAX_PROFILE_ZONES) {
+        logError("PROF", "Zone table full (%d), %s not profiled.", MAX_PROFILE_ZONES, name);
+        return -1;
+    }
+    profileName[profileZoneCount] = name;
+    return profileZoneCount++;
+}
+
+void profiler_record(int zone, ProfileTicks start, ProfileTicks end) {
+    if (zone < 0) return;
+    ProfileTicks elapsed = end - start;
+    profileRuns[zone]++;
+    profileTotal[zone] += elapsed;
+    if (elapsed > profileMax[zone]) profileMax[zone] = elapsed;
+#ifdef PROFILE_EVENTS
+    if (!profileSink) return;
+    // Flushing here would count the sink's file I/O into the zones still open
+    if (profileEventCount == PROFILE_EVENT_BATCH) {
+        profileEventsDropped++;
+        return;
+    }
+    profileEvents[profileEventCount++] = { zone, start, end };
+#endif
+}
+
+const char* profiler_zone_name(int zone) {
+    return zone >= 0 && zone < profileZoneCount ? profileName[zone] : "?";
+}
+
+float profiler_ticks_per_us() {
+#ifdef ARDUINO_SHIM_H
+    return 1000.0f;
+#else
+    return (float)ESP.getCpuFreqMHz();
+#endif
+}
+
+void profiler_report() {
+    float perUs = profiler_ticks_per_us();
+    for (int z = 0; z < profileZoneCount; z++) {
+        if (profileRuns[z] == 0) continue;
+        logInfo("PROF", "%s: runs=%lu avg=%.2f us max=%.2f us total=%.1f ms", profileName[z],
+                (unsigned long)profileRuns[z], profileTotal[z] / perUs / profileRuns[z], profileMax[z] / perUs,
+                profileTotal[z] / perUs / 1000.0f);
+        profileRuns[z] = 0;
+        profileTotal[z] = 0;
+        profileMax[z] = 0;
+    }
+}
+
+#ifdef PROFILE_EVENTS
+void profiler_set_sink(ProfileSink sink) {
+    if (profileSink) profiler_flush();
+    profileSink = sink;
+    profileEventCount = 0;
+}
+
+void profiler_flush() {
+    if (profileSink && profileEventCount > 0) profileSink(profileEvents, profileEventCount);
+    profileEventCount = 0;
+    if (profileEventsDropped > 0) {
+        logWarn("PROF", "%lu event(s) dropped, more than %d between two flushes.", (unsigned long)profileEventsDropped,
+                PROFILE_EVENT_BATCH);
+        profileEventsDropped = 0;
+    }
+}
+#endif
+
+#endif // PROFILING
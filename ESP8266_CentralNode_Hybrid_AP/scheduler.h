@@ -0,0 +1,30 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+
+// Cooperative scheduler behind loop(). Periodic tasks are released on a fixed
+// grid and run earliest deadline first, polling tasks (period 0) once per pass
+// after them. Overruns, deadline misses and skipped releases are logged every
+// SCHEDULER_REPORT_MS.
+
+#ifndef MAX_TASKS
+#define MAX_TASKS 12
+#endif
+
+constexpr uint32_t SCHEDULER_REPORT_MS = 60000;
+
+typedef void (*TaskFunction)();
+
+void setup_scheduler(); // Registers the periodic report
+
+// Returns the task handle, or -1 when the table is full. A deadline of 0 means
+// one period; a budget of 0 disables overrun accounting. The first release of
+// a periodic task is one period after registration.
+int scheduler_add(const char* name, TaskFunction fn, uint32_t periodMs, uint32_t deadlineMs, uint32_t budgetUs);
+void scheduler_set_period(int task, uint32_t periodMs); // Next release = last release + new period
+void run_scheduler();
+uint32_t scheduler_idle_ms(); // Until the next periodic release, 0 if one is due
+void scheduler_report();
+
+#endif // SCHEDULER_H
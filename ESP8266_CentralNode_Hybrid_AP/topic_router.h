@@ -0,0 +1,28 @@
+#ifndef TOPIC_ROUTER_H
+#define TOPIC_ROUTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Routing of incoming messages by topic, exact or "<prefix>/<id>", through a
+// small hashed table. Handlers get the sensor id from the topic or the client
+// login, or -1. Payloads are NUL-terminated.
+
+#ifndef MAX_ROUTES
+#define MAX_ROUTES 8
+#endif
+
+typedef void (*TopicHandler)(int sensorId, const char* payload, size_t length);
+
+// Both return false when the table is full. The topic string must outlive the route.
+bool topic_route(const char* topic, TopicHandler handler);
+bool topic_route_sensors(const char* prefix, TopicHandler handler);
+
+// Dispatches one message, false if no route matched. boundSensorId is passed
+// to exact-topic handlers.
+bool route_message(const char* topic, size_t topicLength, const char* payload, size_t length, int boundSensorId = -1);
+
+// "<SENSOR_LOGIN_PREFIX><n>" -> n, -1 for any other login or an empty prefix
+int sensor_id_from_login(const char* login);
+
+#endif // TOPIC_ROUTER_H
@@ -0,0 +1,54 @@
+#include <Arduino.h>
+#include <math.h>
+#include <string.h>
+#include "track_simplify.h"
+#include "logging.h"
+
+// --- Zone State ---
+uint8_t simplifySent[MAX_ZONES];        // Results remembered, 0..2
+uint32_t simplifyAt[MAX_ZONES][2];      // millis() of the last two sent, newest first
+float simplifyPos[MAX_ZONES][2][3];
+uint16_t simplifyDropped[MAX_ZONES];    // Since the last sent result
+
+void simplify_reset(int zone) {
+    simplifySent[zone] = 0;
+    simplifyDropped[zone] = 0;
+}
+
+// Distance of (x, y, z) from where the last two sent results put the target at now
+static float deviation(int zone, uint32_t now, float x, float y, float z) {
+    const float* last = simplifyPos[zone][0];
+    float k = 0;
+    if (simplifySent[zone] == 2) {
+        uint32_t span = simplifyAt[zone][0] - simplifyAt[zone][1];
+        if (span > 0) k = (float)(now - simplifyAt[zone][0]) / span;
+    }
+    const float* prev = simplifyPos[zone][1];
+    float dx = x - (last[0] + (last[0] - prev[0]) * k);
+    float dy = y - (last[1] + (last[1] - prev[1]) * k);
+    float dz = z - (last[2] + (last[2] - prev[2]) * k);
+    return sqrt(dx * dx + dy * dy + dz * dz);
+}
+
+bool simplify_result(int zone, float x, float y, float z, bool force) {
+    uint32_t now = millis();
+    bool send = force || SIMPLIFY_TOLERANCE_CM <= 0 || simplifySent[zone] == 0 ||
+                now - simplifyAt[zone][0] >= SIMPLIFY_MAX_GAP_MS ||
+                deviation(zone, now, x, y, z) > SIMPLIFY_TOLERANCE_CM;
+    if (!send) {
+        simplifyDropped[zone]++;
+        return false;
+    }
+    if (simplifyDropped[zone] > 0) {
+        logVerbose("SIMPLIFY", "Zone %d: result sent after %u dropped.", zone, simplifyDropped[zone]);
+    }
+    simplifyAt[zone][1] = simplifyAt[zone][0];
+    memcpy(simplifyPos[zone][1], simplifyPos[zone][0], sizeof(simplifyPos[zone][0]));
+    simplifyAt[zone][0] = now;
+    simplifyPos[zone][0][0] = x;
+    simplifyPos[zone][0][1] = y;
+    simplifyPos[zone][0][2] = z;
+    if (simplifySent[zone] < 2) simplifySent[zone]++;
+    simplifyDropped[zone] = 0;
+    return true;
+}
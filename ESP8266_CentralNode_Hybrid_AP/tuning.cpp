@@ -0,0 +1,195 @@
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#if defined(ESP32)
+#include <Preferences.h>
+#elif defined(ESP8266)
+#include <EEPROM.h>
+#endif
+#include "tuning.h"
+#include "calculation_logic.h"
+#include "config.h"
+#include "logging.h"
+#include "scheduler.h"
+
+// --- Tunable Parameter Set ---
+struct TuningParams {
+    uint32_t magic;
+    int32_t historySize;
+    uint32_t averageIntervalMs;
+    float distanceOffset;
+    float S2_a;
+    float S3_c;
+    float S3_b;
+    int32_t logLevel;
+};
+
+static const uint32_t TUNING_MAGIC = 0x54554E31; // "TUN1", bump when the layout changes
+
+TuningParams defaultParams;  // Compile-time values from config.cpp
+TuningParams pendingParams;  // Accepted but not yet applied
+bool pendingApply = false;
+bool pendingPersist = false;
+
+#if defined(ESP32)
+Preferences tuningStore;
+#endif
+
+// --- Helpers ---
+
+TuningParams capture_live_params() {
+    TuningParams p;
+    p.magic = TUNING_MAGIC;
+    p.historySize = HISTORY_SIZE;
+    p.averageIntervalMs = AVERAGE_INTERVAL_MS;
+    p.distanceOffset = DISTANCE_OFFSET;
+    p.S2_a = S2_a;
+    p.S3_c = S3_c;
+    p.S3_b = S3_b;
+    p.logLevel = LOG_LEVEL;
+    return p;
+}
+
+bool validate_params(const TuningParams& p) {
+    if (p.historySize < 2 || p.historySize > MAX_HISTORY_SIZE) {
+        logWarn("TUNING", "historySize must be 2..%d (got %ld)", MAX_HISTORY_SIZE, (long)p.historySize);
+        return false;
+    }
+    if (p.averageIntervalMs < 100) {
+        logWarn("TUNING", "averageIntervalMs must be >= 100 (got %lu)", (unsigned long)p.averageIntervalMs);
+        return false;
+    }
+    if (p.S2_a == 0 || p.S3_b == 0) {
+        logWarn("TUNING", "S2_a and S3_b cannot be zero.");
+        return false;
+    }
+    if (p.logLevel < LOG_LEVEL_MINIMAL || p.logLevel > LOG_LEVEL_VERBOSE) {
+        logWarn("TUNING", "logLevel must be %d..%d", LOG_LEVEL_MINIMAL, LOG_LEVEL_VERBOSE);
+        return false;
+    }
+    return true;
+}
+
+void apply_params(const TuningParams& p) {
+    bool historyResized = (p.historySize != HISTORY_SIZE);
+    HISTORY_SIZE = p.historySize;
+    AVERAGE_INTERVAL_MS = p.averageIntervalMs;
+    DISTANCE_OFFSET = p.distanceOffset;
+    S2_a = p.S2_a;
+    S3_c = p.S3_c;
+    S3_b = p.S3_b;
+    LOG_LEVEL = p.logLevel;
+    set_zone_anchors(0, S2_a, S3_c, S3_b); // The tunable anchors belong to zone 0
+    update_average_period();
+    if (historyResized) {
+        reset_history();
+    }
+    logInfo("TUNING", "Applied: History=%d, Offset=%.2f, Avg Interval=%lu ms, S2_a=%.2f, S3_c=%.2f, S3_b=%.2f, Log Level=%d",
+            HISTORY_SIZE, DISTANCE_OFFSET, AVERAGE_INTERVAL_MS, S2_a, S3_c, S3_b, LOG_LEVEL);
+}
+
+// --- Persistence ---
+
+bool load_persisted(TuningParams& p) {
+#if defined(ESP32)
+    size_t len = tuningStore.getBytes("params", &p, sizeof(p));
+    return len == sizeof(p) && p.magic == TUNING_MAGIC;
+#elif defined(ESP8266)
+    EEPROM.get(0, p);
+    return p.magic == TUNING_MAGIC;
+#else
+    (void)p;
+    return false;
+#endif
+}
+
+void persist_params(const TuningParams& p) {
+#if defined(ESP32)
+    tuningStore.putBytes("params", &p, sizeof(p));
+#elif defined(ESP8266)
+    EEPROM.put(0, p);
+    EEPROM.commit();
+#else
+    (void)p;
+#endif
+    logVerbose("TUNING", "Parameters persisted.");
+}
+
+void clear_persisted() {
+#if defined(ESP32)
+    tuningStore.remove("params");
+#elif defined(ESP8266)
+    TuningParams blank = {};
+    EEPROM.put(0, blank);
+    EEPROM.commit();
+#endif
+}
+
+// --- Public API ---
+
+void setup_tuning() {
+    scheduler_add("tuning", loop_tuning, 0, 0, 0);
+    defaultParams = capture_live_params();
+#if defined(ESP32)
+    tuningStore.begin("tuning", false);
+#elif defined(ESP8266)
+    EEPROM.begin(sizeof(TuningParams));
+#endif
+    TuningParams stored;
+    if (load_persisted(stored) && validate_params(stored)) {
+        logInfo("TUNING", "Loaded persisted parameters.");
+        apply_params(stored);
+    } else {
+        logInfo("TUNING", "No persisted parameters, using compiled defaults.");
+    }
+}
+
+void loop_tuning() {
+    if (!pendingApply) return;
+    pendingApply = false;
+    apply_params(pendingParams);
+    if (pendingPersist) {
+        persist_params(pendingParams);
+    } else {
+        clear_persisted();
+    }
+}
+
+void on_control_topic(int, const char* payload, size_t) {
+    on_control_message(payload);
+}
+
+void on_control_message(const char* payload) {
+    StaticJsonDocument<256> doc;
+    DeserializationError error = deserializeJson(doc, payload);
+    if (error) {
+        logError("TUNING", "JSON parse failed on control message: %s", error.c_str());
+        return;
+    }
+
+    if (doc["defaults"] | false) {
+        pendingParams = defaultParams;
+        pendingPersist = false;
+        pendingApply = true;
+        logInfo("TUNING", "Restoring compiled defaults at the next fix boundary.");
+        return;
+    }
+
+    // Start from whatever is staged (or live) so partial updates compose
+    TuningParams p = pendingApply ? pendingParams : capture_live_params();
+    p.historySize = doc["historySize"] | p.historySize;
+    p.averageIntervalMs = doc["averageIntervalMs"] | p.averageIntervalMs;
+    p.distanceOffset = doc["distanceOffset"] | p.distanceOffset;
+    p.S2_a = doc["S2_a"] | p.S2_a;
+    p.S3_c = doc["S3_c"] | p.S3_c;
+    p.S3_b = doc["S3_b"] | p.S3_b;
+    p.logLevel = doc["logLevel"] | p.logLevel;
+
+    if (!validate_params(p)) {
+        logWarn("TUNING", "Control message rejected: %s", payload);
+        return;
+    }
+    pendingParams = p;
+    pendingPersist = true;
+    pendingApply = true;
+    logInfo("TUNING", "Control message accepted, applying at the next fix boundary.");
+}
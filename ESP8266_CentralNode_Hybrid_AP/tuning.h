@@ -0,0 +1,15 @@
+#ifndef TUNING_H
+#define TUNING_H
+
+// Runtime tuning of the calculation settings through CONTROL_TOPIC (payload in
+// the README). A message is accepted or rejected as a whole; loop_tuning()
+// applies staged values between two fixes and persists them (NVS or EEPROM).
+
+#include <stddef.h>
+
+void setup_tuning();
+void loop_tuning();
+void on_control_message(const char* payload);
+void on_control_topic(int sensorId, const char* payload, size_t length); // TopicHandler for CONTROL_TOPIC
+
+#endif // TUNING_H
@@ -0,0 +1,43 @@
+#ifndef ARDUINO_SHIM_H
+#define ARDUINO_SHIM_H
+
+// Just enough of the Arduino core to build the firmware's portable modules
+// (calculation_logic.cpp, tuning.cpp) on Linux. Put this directory on the
+// include path before anything else so <Arduino.h> resolves here.
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cmath>
+
+// The firmware calls abs() on floats, which the Arduino macro handles
+using std::abs;
+
+typedef uint8_t byte;
+
+// Wall clock by default; the firmware simulator (native/firmware_sim) builds
+// with ARDUINO_SHIM_VIRTUAL_CLOCK and supplies a virtual one
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+
+// Serial writes to stderr by default so it never mixes with result lines on stdout
+class HostSerial {
+public:
+    void begin(unsigned long) {}
+    explicit operator bool() const { return true; }
+    void setOutput(FILE* out) { output = out; } // nullptr discards everything
+    int printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+    size_t print(const char* s);
+    size_t println(const char* s = "");
+
+private:
+    FILE* output = stderr;
+};
+
+extern HostSerial Serial;
+
+#endif // ARDUINO_SHIM_H
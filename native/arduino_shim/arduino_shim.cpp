@@ -0,0 +1,52 @@
+#include "Arduino.h"
+#include <time.h>
+
+#ifndef ARDUINO_SHIM_VIRTUAL_CLOCK
+
+static uint64_t monotonic_us() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ull + (uint64_t)ts.tv_nsec / 1000;
+}
+
+// Both clocks count from the first call, like they count from boot on the board
+static const uint64_t bootUs = monotonic_us();
+
+unsigned long millis() {
+    return (unsigned long)((monotonic_us() - bootUs) / 1000);
+}
+
+unsigned long micros() {
+    return (unsigned long)(monotonic_us() - bootUs);
+}
+
+void delay(unsigned long ms) {
+    timespec ts;
+    ts.tv_sec = ms / 1000;
+    ts.tv_nsec = (long)(ms % 1000) * 1000000L;
+    nanosleep(&ts, nullptr);
+}
+
+#endif // ARDUINO_SHIM_VIRTUAL_CLOCK
+
+HostSerial Serial;
+
+int HostSerial::printf(const char* format, ...) {
+    if (!output) return 0;
+    va_list args;
+    va_start(args, format);
+    int n = vfprintf(output, format, args);
+    va_end(args);
+    return n;
+}
+
+size_t HostSerial::print(const char* s) {
+    if (!output) return strlen(s);
+    return fputs(s, output) < 0 ? 0 : strlen(s);
+}
+
+size_t HostSerial::println(const char* s) {
+    size_t n = print(s);
+    if (output) fputc('\n', output);
+    return n + 1;
+}
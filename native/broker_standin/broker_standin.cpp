@@ -0,0 +1,299 @@
+/**
+ * Broker stand-in - a small epoll MQTT broker for local load runs.
+ *
+ * Stands in for the Device Gateway (port 1885) and, when no central node is
+ * running, for the central node's sensor broker (port 1886), so the load
+ * generator can be pointed at a Linux box without any external broker.
+ * QoS 0 only: QoS 1 publishes are acknowledged and forwarded as QoS 0.
+ * Subscribers whose output queue exceeds --queue-limit drop messages
+ * instead of stalling everyone else, and the drops are reported.
+ *
+ * Build (from the repository root):
+ *   g++ -std=c++17 -O2 -Inative/common native/broker_standin/broker_standin.cpp \
+ *       native/common/mqtt_codec.cpp native/common/net_util.cpp native/common/host_log.cpp \
+ *       -o native/bin/broker_standin
+ *
+ * Usage:
+ *   native/bin/broker_standin --port 1885 --port 1886 [--queue-limit 1048576] [--stats 5] [--verbose]
+ */
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+#include "host_log.h"
+#include "mqtt_codec.h"
+#include "net_util.h"
+
+struct BrokerClient {
+    Connection conn;
+    uint16_t port = 0;
+    std::string id;
+    std::vector<std::string> filters;
+    bool connected = false;
+};
+
+struct Stats {
+    uint64_t received = 0;
+    uint64_t delivered = 0;
+    uint64_t dropped = 0;
+    uint64_t malformed = 0;
+};
+
+static volatile sig_atomic_t running = 1;
+static int epollFd = -1;
+static std::unordered_map<int, uint16_t> listeners; // fd -> port
+static std::unordered_map<int, BrokerClient> clients;
+static Stats stats;
+static size_t queueLimit = 1 << 20;
+
+static void on_signal(int) {
+    running = 0;
+}
+
+static void update_interest(BrokerClient& c) {
+    epoll_event ev{};
+    ev.events = EPOLLIN | (c.conn.out.empty() ? 0u : (uint32_t)EPOLLOUT);
+    ev.data.fd = c.conn.fd;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, c.conn.fd, &ev);
+}
+
+static void close_client(int fd) {
+    auto it = clients.find(fd);
+    if (it == clients.end()) return;
+    logVerbose("BROKER", "Client [%s] on port %u disconnected", it->second.id.c_str(), it->second.port);
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    clients.erase(it);
+}
+
+// Routes a publish to every subscriber on the same listening port
+static void route_publish(uint16_t port, const mqtt::PublishView& pub) {
+    std::string frame;
+    std::string topic(pub.topic, pub.topicLen);
+    for (auto& kv : clients) {
+        BrokerClient& sub = kv.second;
+        if (!sub.connected || sub.port != port) continue;
+        for (const std::string& filter : sub.filters) {
+            if (!mqtt::topic_matches(filter.c_str(), pub.topic, pub.topicLen)) continue;
+            if (frame.empty()) mqtt::encode_publish(frame, topic.c_str(), pub.payload, pub.payloadLen);
+            if (sub.conn.out.size() + frame.size() > sub.conn.outLimit) {
+                stats.dropped++;
+            } else {
+                bool wasEmpty = sub.conn.out.empty();
+                sub.conn.out += frame;
+                stats.delivered++;
+                if (wasEmpty) update_interest(sub);
+            }
+            break;
+        }
+    }
+}
+
+// Handles every complete packet in the client's input buffer.
+// Returns false if the client must be dropped.
+static bool process_input(BrokerClient& c) {
+    size_t offset = 0;
+    bool ok = true;
+    while (ok) {
+        mqtt::Packet p;
+        long used = mqtt::parse_packet((const uint8_t*)c.conn.in.data() + offset, c.conn.in.size() - offset, p);
+        if (used == 0) break;
+        if (used < 0) {
+            stats.malformed++;
+            ok = false;
+            break;
+        }
+        offset += (size_t)used;
+
+        if (!c.connected && p.type != mqtt::CONNECT) {
+            ok = false;
+            break;
+        }
+        switch (p.type) {
+            case mqtt::CONNECT: {
+                mqtt::ConnectInfo info;
+                if (!mqtt::decode_connect(p, info)) {
+                    stats.malformed++;
+                    ok = false;
+                    break;
+                }
+                c.id = info.clientId;
+                c.connected = true;
+                mqtt::encode_connack(c.conn.out, 0);
+                logVerbose("BROKER", "Client [%s] connected on port %u", c.id.c_str(), c.port);
+                break;
+            }
+            case mqtt::PUBLISH: {
+                mqtt::PublishView pub;
+                if (!mqtt::decode_publish(p, pub)) {
+                    stats.malformed++;
+                    ok = false;
+                    break;
+                }
+                stats.received++;
+                if (pub.qos == 1) mqtt::encode_puback(c.conn.out, pub.packetId);
+                route_publish(c.port, pub);
+                break;
+            }
+            case mqtt::SUBSCRIBE: {
+                uint16_t packetId;
+                std::vector<std::string> filters;
+                if (!mqtt::decode_subscribe(p, packetId, filters)) {
+                    stats.malformed++;
+                    ok = false;
+                    break;
+                }
+                for (auto& f : filters) {
+                    logVerbose("BROKER", "Client [%s] subscribed to %s", c.id.c_str(), f.c_str());
+                    c.filters.push_back(f);
+                }
+                mqtt::encode_suback(c.conn.out, packetId, filters.size());
+                break;
+            }
+            case mqtt::UNSUBSCRIBE: {
+                uint16_t packetId;
+                std::vector<std::string> filters;
+                if (!mqtt::decode_unsubscribe(p, packetId, filters)) {
+                    stats.malformed++;
+                    ok = false;
+                    break;
+                }
+                for (auto& f : filters) {
+                    for (size_t i = 0; i < c.filters.size(); i++) {
+                        if (c.filters[i] == f) {
+                            c.filters.erase(c.filters.begin() + i);
+                            break;
+                        }
+                    }
+                }
+                mqtt::encode_unsuback(c.conn.out, packetId);
+                break;
+            }
+            case mqtt::PINGREQ:
+                mqtt::encode_pingresp(c.conn.out);
+                break;
+            case mqtt::DISCONNECT:
+                ok = false;
+                break;
+            default:
+                break; // PUBACK etc. are ignored at QoS 0
+        }
+    }
+    c.conn.in.erase(0, offset);
+    return ok;
+}
+
+static void accept_all(int listenFd, uint16_t port) {
+    for (;;) {
+        int fd = tcp_accept(listenFd);
+        if (fd < 0) return;
+        BrokerClient& c = clients[fd];
+        c.conn.fd = fd;
+        c.conn.outLimit = queueLimit;
+        c.port = port;
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev);
+    }
+}
+
+static void print_usage() {
+    fprintf(stderr, "Usage: broker_standin --port <p> [--port <p> ...] [--queue-limit <bytes>] [--stats <s>] [--verbose]\n");
+}
+
+int main(int argc, char** argv) {
+    std::vector<uint16_t> ports;
+    int statsIntervalS = 5;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--port") && i + 1 < argc) {
+            ports.push_back((uint16_t)atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--queue-limit") && i + 1 < argc) {
+            queueLimit = (size_t)strtoull(argv[++i], nullptr, 10);
+        } else if (!strcmp(argv[i], "--stats") && i + 1 < argc) {
+            statsIntervalS = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--verbose")) {
+            setHostLogLevel(LOG_LEVEL_VERBOSE);
+        } else {
+            print_usage();
+            return 1;
+        }
+    }
+    if (ports.empty()) ports.push_back(1885);
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    epollFd = epoll_create1(0);
+    for (uint16_t port : ports) {
+        int fd = tcp_listen(port);
+        if (fd < 0) {
+            logError("BROKER", "Cannot listen on port %u", port);
+            return 1;
+        }
+        listeners[fd] = port;
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev);
+        logInfo("BROKER", "Listening on port %u", port);
+    }
+
+    uint64_t lastStats = now_us();
+    Stats lastSnapshot;
+    std::vector<epoll_event> events(1024);
+    std::vector<int> toClose;
+
+    while (running) {
+        int n = epoll_wait(epollFd, events.data(), (int)events.size(), 200);
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+            auto lit = listeners.find(fd);
+            if (lit != listeners.end()) {
+                accept_all(fd, lit->second);
+                continue;
+            }
+            auto it = clients.find(fd);
+            if (it == clients.end()) continue;
+            BrokerClient& c = it->second;
+            bool alive = true;
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                alive = read_available(c.conn);
+                if (!process_input(c)) alive = false;
+            }
+            if (alive && !c.conn.out.empty()) {
+                alive = flush_output(c.conn);
+            }
+            if (alive) update_interest(c);
+            else toClose.push_back(fd);
+        }
+        for (int fd : toClose) close_client(fd);
+        toClose.clear();
+
+        uint64_t now = now_us();
+        if (statsIntervalS > 0 && now - lastStats >= (uint64_t)statsIntervalS * 1000000ull) {
+            double secs = (now - lastStats) / 1e6;
+            logInfo("STATS", "clients=%zu in=%.0f/s out=%.0f/s dropped=%llu malformed=%llu",
+                    clients.size(),
+                    (stats.received - lastSnapshot.received) / secs,
+                    (stats.delivered - lastSnapshot.delivered) / secs,
+                    (unsigned long long)stats.dropped,
+                    (unsigned long long)stats.malformed);
+            lastSnapshot = stats;
+            lastStats = now;
+        }
+    }
+
+    for (auto& kv : clients) close(kv.first);
+    for (auto& kv : listeners) close(kv.first);
+    close(epollFd);
+    logInfo("BROKER", "Stopped. received=%llu delivered=%llu dropped=%llu",
+            (unsigned long long)stats.received, (unsigned long long)stats.delivered, (unsigned long long)stats.dropped);
+    return 0;
+}
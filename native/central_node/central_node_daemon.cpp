@@ -0,0 +1,532 @@
+/**
+ * Linux central node - the firmware's calculation core behind an epoll loop.
+ *
+ * Replaces system/central_node/central_node.js on a gateway box. The
+ * trilateration, calculate_r, averaging and runtime tuning are not ported:
+ * calculation_logic.cpp and tuning.cpp are compiled straight from
+ * ESP32_CentralNode_Hybrid against native/arduino_shim, so a fix to the
+ * firmware is a fix to the daemon.
+ *
+ * The daemon is the sensors' broker on centralNodePort, like the hybrid
+ * boards' sMQTTBroker, and a client of the Device Gateway taken from
+ * deviceGatewayUrl, where it publishes results and listens on CONTROL_TOPIC.
+ * Clients of the local side that subscribe to LOCAL_RESULT_TOPIC get the
+ * results as well, each through a bounded queue of its own.
+ * Everything runs on one thread: socket readiness, the firmware's scheduler
+ * tasks (averaging, tuning) and the CSV batch flush are all driven by one
+ * epoll_wait whose timeout ends at the next task release, and no step
+ * blocks, so results keep the scheduler's fixed cadence.
+ *
+ * One process serves many anchor groups through the firmware's zone table,
+ * built here with a larger MAX_ZONES. Zones come from the "zones" array in
+ * config.json, or from --auto-zones N, which lays out N zones the way the
+ * load generator numbers its sensors (3g+1..3g+3 -> deviceID g+1, zone 0's
+ * anchors). Geofences come from the "fences" array; their events go to the
+ * gateway and to local subscribers of GEOFENCE_TOPIC.
+ *
+ * With calculationSettings.binaryResults the results of an interval go out
+ * in result_codec's packed format instead of one JSON message per zone;
+ * RESULT_PACKET_MAX is raised so a message fills a typical TCP segment.
+ *
+ * Build (from the repository root, ArduinoJson 6 checked out somewhere):
+ *   g++ -std=c++17 -O2 -DMAX_ZONES=512 -DMAX_SENSOR_ID=2047 -DMAX_FENCES=512 -DRESULT_PACKET_MAX=1400 \
+ *       -Inative/arduino_shim -Inative/common -Inative/central_node \
+ *       -IESP32_CentralNode_Hybrid -I<ArduinoJson>/src \
+ *       native/central_node/central_node_daemon.cpp native/central_node/daemon_config.cpp \
+ *       native/central_node/daemon_logging.cpp native/arduino_shim/arduino_shim.cpp \
+ *       native/common/mqtt_codec.cpp native/common/net_util.cpp \
+ *       ESP32_CentralNode_Hybrid/calculation_logic.cpp ESP32_CentralNode_Hybrid/multi_target.cpp \
+ *       ESP32_CentralNode_Hybrid/result_codec.cpp ESP32_CentralNode_Hybrid/scheduler.cpp \
+ *       ESP32_CentralNode_Hybrid/tuning.cpp ESP32_CentralNode_Hybrid/warm_state.cpp \
+ *       ESP32_CentralNode_Hybrid/topic_router.cpp ESP32_CentralNode_Hybrid/ingest.cpp \
+ *       ESP32_CentralNode_Hybrid/profiler.cpp ESP32_CentralNode_Hybrid/tdma.cpp \
+ *       ESP32_CentralNode_Hybrid/fanout.cpp ESP32_CentralNode_Hybrid/history_store.cpp \
+ *       ESP32_CentralNode_Hybrid/geofence.cpp ESP32_CentralNode_Hybrid/motion.cpp \
+ *       ESP32_CentralNode_Hybrid/track_simplify.cpp ESP32_CentralNode_Hybrid/fix_cache.cpp \
+ *       native/common/profile_trace.cpp -o native/bin/central_node
+ *
+ * Add -DPROFILING for the firmware's profiling zones (profiler.h): they are
+ * logged with the scheduler report, and --profile writes every zone run to a
+ * Chrome trace.
+ *
+ * Usage:
+ *   native/bin/central_node [--config system/central_node/config.json] [--csv system/central_node/data/1.csv]
+ *                           [--auto-zones N] [--profile trace.json]
+ */
+
+#include <Arduino.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+#include "calculation_logic.h"
+#include "config.h"
+#include "daemon_config.h"
+#include "daemon_logging.h"
+#include "fanout.h"
+#include "geofence.h"
+#include "history_store.h"
+#include "logging.h"
+#include "mqtt_codec.h"
+#include "net_util.h"
+#include "profile_trace.h"
+#include "profiler.h"
+#include "scheduler.h"
+#include "tdma.h"
+#include "topic_router.h"
+#include "tuning.h"
+
+static const int LOOP_TICK_MS = 10;               // Longest epoll wait; scheduler releases end it sooner
+static const unsigned long RECONNECT_DELAY_MS = 5000;
+static const uint16_t GATEWAY_KEEPALIVE_S = 15;
+static const size_t SUBSCRIBER_QUEUE_BYTES = 64 * 1024; // Per local result subscriber, then it misses results
+
+struct SensorClient {
+    Connection conn;
+    std::string id;
+    int sensorId = -1; // Bound by the login (SENSOR_LOGIN_PREFIX)
+    bool connected = false;
+    bool tdma = false; // Subscribed to TDMA_TOPIC
+    bool history = false; // Subscribed to HISTORY_REPLY_TOPIC
+    bool geofence = false; // Subscribed to GEOFENCE_TOPIC
+    bool results = false; // Subscribed to LOCAL_RESULT_TOPIC
+    uint32_t resultsMissed = 0; // While its queue is full
+};
+
+enum GatewayState { GW_DISCONNECTED, GW_CONNECTING, GW_CONNECTED };
+
+struct Gateway {
+    Connection conn;
+    GatewayState state = GW_DISCONNECTED;
+    unsigned long lastAttempt = 0;
+    unsigned long lastPing = 0;
+    bool everAttempted = false;
+};
+
+static volatile sig_atomic_t running = 1;
+static int epollFd = -1;
+static int listenFd = -1;
+static std::unordered_map<int, SensorClient> sensors;
+static Gateway gateway;
+
+static void on_signal(int) {
+    running = 0;
+}
+
+static void watch(int fd, bool wantWrite, int op) {
+    epoll_event ev{};
+    ev.events = EPOLLIN | (wantWrite ? (uint32_t)EPOLLOUT : 0u);
+    ev.data.fd = fd;
+    epoll_ctl(epollFd, op, fd, &ev);
+}
+
+// --- Sensor Side (the local broker) ---
+
+static void on_sensor_publish(const SensorClient& c, const mqtt::PublishView& pub) {
+    PROFILE_ZONE("on_sensor_publish");
+    // Payloads are tiny; copy into a terminated buffer for the JSON parser and the log
+    char payload[256];
+    size_t len = pub.payloadLen < sizeof(payload) - 1 ? pub.payloadLen : sizeof(payload) - 1;
+    memcpy(payload, pub.payload, len);
+    payload[len] = '\0';
+
+    logVerbose("RECV", "Message on LOCAL broker [%.*s]: %s", (int)pub.topicLen, pub.topic, payload);
+    if (!route_message(pub.topic, pub.topicLen, payload, len, c.sensorId)) {
+        logVerbose("RECV", "No route for topic %.*s", (int)pub.topicLen, pub.topic);
+    }
+}
+
+// Returns false if the sensor must be dropped
+static bool process_sensor_input(SensorClient& c) {
+    size_t offset = 0;
+    bool ok = true;
+    while (ok) {
+        mqtt::Packet p;
+        long used = mqtt::parse_packet((const uint8_t*)c.conn.in.data() + offset, c.conn.in.size() - offset, p);
+        if (used == 0) break;
+        if (used < 0 || (!c.connected && p.type != mqtt::CONNECT)) {
+            ok = false;
+            break;
+        }
+        offset += (size_t)used;
+
+        switch (p.type) {
+            case mqtt::CONNECT: {
+                mqtt::ConnectInfo info;
+                if (!mqtt::decode_connect(p, info)) {
+                    ok = false;
+                    break;
+                }
+                c.id = info.clientId;
+                c.sensorId = sensor_id_from_login(c.id.c_str());
+                c.connected = true;
+                mqtt::encode_connack(c.conn.out, 0);
+                logInfo("LOCAL_BROKER", "Sensor connected, id: %s", c.id.c_str());
+                break;
+            }
+            case mqtt::PUBLISH: {
+                mqtt::PublishView pub;
+                if (!mqtt::decode_publish(p, pub)) {
+                    ok = false;
+                    break;
+                }
+                if (pub.qos == 1) mqtt::encode_puback(c.conn.out, pub.packetId);
+                on_sensor_publish(c, pub);
+                break;
+            }
+            case mqtt::SUBSCRIBE: {
+                // Acknowledged so standard clients are happy; only the topics flagged below are sent
+                uint16_t packetId;
+                std::vector<std::string> filters;
+                if (!mqtt::decode_subscribe(p, packetId, filters)) {
+                    ok = false;
+                    break;
+                }
+                for (const std::string& f : filters) {
+                    if (f == TDMA_TOPIC) c.tdma = true;
+                    if (f == HISTORY_REPLY_TOPIC) c.history = true;
+                    if (f == GEOFENCE_TOPIC) c.geofence = true;
+                    if (f == LOCAL_RESULT_TOPIC) c.results = true;
+                }
+                mqtt::encode_suback(c.conn.out, packetId, filters.size());
+                break;
+            }
+            case mqtt::PINGREQ:
+                mqtt::encode_pingresp(c.conn.out);
+                break;
+            case mqtt::DISCONNECT:
+                ok = false;
+                break;
+            default:
+                break;
+        }
+    }
+    c.conn.in.erase(0, offset);
+    return ok;
+}
+
+static void close_sensor(int fd) {
+    auto it = sensors.find(fd);
+    if (it == sensors.end()) return;
+    if (it->second.connected) logInfo("LOCAL_BROKER", "Sensor disconnected, id: %s", it->second.id.c_str());
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    sensors.erase(it);
+}
+
+static void accept_sensors() {
+    for (;;) {
+        int fd = tcp_accept(listenFd);
+        if (fd < 0) return;
+        SensorClient& c = sensors[fd];
+        c.conn.fd = fd;
+        watch(fd, false, EPOLL_CTL_ADD);
+    }
+}
+
+// --- Gateway Side (the external client) ---
+
+static void close_gateway() {
+    if (gateway.conn.fd >= 0) {
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, gateway.conn.fd, nullptr);
+        close(gateway.conn.fd);
+    }
+    gateway.conn = Connection();
+    gateway.state = GW_DISCONNECTED;
+}
+
+// Non-blocking replacement for the firmware's reconnect loop: one attempt per RECONNECT_DELAY_MS
+static void maintain_gateway() {
+    unsigned long now = millis();
+    if (gateway.state == GW_DISCONNECTED) {
+        if (gateway.everAttempted && now - gateway.lastAttempt < RECONNECT_DELAY_MS) return;
+        gateway.everAttempted = true;
+        gateway.lastAttempt = now;
+        logInfo("EXT_CLIENT", "Attempting connection to external gateway %s:%u...", GATEWAY_HOST.c_str(), GATEWAY_PORT);
+        int fd = tcp_connect(GATEWAY_HOST.c_str(), GATEWAY_PORT);
+        if (fd < 0) {
+            logError("EXT_CLIENT", "Failed. Retrying in %lu seconds...", RECONNECT_DELAY_MS / 1000);
+            return;
+        }
+        gateway.conn.fd = fd;
+        mqtt::encode_connect(gateway.conn.out, MQTT_CLIENT_ID, GATEWAY_KEEPALIVE_S);
+        gateway.state = GW_CONNECTING;
+        watch(fd, true, EPOLL_CTL_ADD);
+        return;
+    }
+    if (gateway.state == GW_CONNECTING && now - gateway.lastAttempt >= RECONNECT_DELAY_MS) {
+        logError("EXT_CLIENT", "No CONNACK from gateway. Retrying in %lu seconds...", RECONNECT_DELAY_MS / 1000);
+        close_gateway();
+        return;
+    }
+    if (gateway.state == GW_CONNECTED && now - gateway.lastPing >= GATEWAY_KEEPALIVE_S * 1000ul / 2) {
+        gateway.lastPing = now;
+        mqtt::encode_pingreq(gateway.conn.out);
+    }
+}
+
+static bool process_gateway_input() {
+    size_t offset = 0;
+    bool ok = true;
+    while (ok) {
+        mqtt::Packet p;
+        long used = mqtt::parse_packet((const uint8_t*)gateway.conn.in.data() + offset, gateway.conn.in.size() - offset, p);
+        if (used == 0) break;
+        if (used < 0) {
+            ok = false;
+            break;
+        }
+        offset += (size_t)used;
+
+        if (p.type == mqtt::CONNACK) {
+            if (p.bodyLen < 2 || p.body[1] != 0) {
+                logError("EXT_CLIENT", "Gateway refused the connection, rc=%d", p.bodyLen >= 2 ? p.body[1] : -1);
+                ok = false;
+                break;
+            }
+            gateway.state = GW_CONNECTED;
+            gateway.lastPing = millis();
+            mqtt::encode_subscribe(gateway.conn.out, 1, CONTROL_TOPIC);
+            mqtt::encode_subscribe(gateway.conn.out, 2, HISTORY_TOPIC);
+            logInfo("EXT_CLIENT", "Connected to %s", GATEWAY_HOST.c_str());
+        } else if (p.type == mqtt::PUBLISH) {
+            mqtt::PublishView pub;
+            if (!mqtt::decode_publish(p, pub)) {
+                ok = false;
+                break;
+            }
+            std::string payload((const char*)pub.payload, pub.payloadLen);
+            std::string topic(pub.topic, pub.topicLen);
+            logVerbose("RECV", "Message on EXTERNAL client [%s]: %s", topic.c_str(), payload.c_str());
+            if (topic == CONTROL_TOPIC) on_control_message(payload.c_str());
+            else if (topic == HISTORY_TOPIC) on_history_topic(-1, payload.c_str(), payload.size());
+        }
+    }
+    gateway.conn.in.erase(0, offset);
+    return ok;
+}
+
+// Called by calculation_logic.cpp after every averaging interval
+void publish_results(const char* payload) {
+    fanout_push((const uint8_t*)payload, strlen(payload)); // Also while the gateway is away
+    if (!PUBLISH_RESULTS) {
+        logVerbose("SENDER", "Publishing is disabled.");
+        return;
+    }
+    if (gateway.state != GW_CONNECTED) {
+        logWarn("SENDER", "Cannot publish to external gateway. Client not connected.");
+        return;
+    }
+    if (gateway.conn.out.size() > gateway.conn.outLimit) {
+        logWarn("SENDER", "Gateway is not draining its queue, result dropped.");
+        return;
+    }
+    logVerbose("SENDER", "Publishing to EXTERNAL gateway on topic %s", OUTPUT_TOPIC);
+    mqtt::encode_publish(gateway.conn.out, OUTPUT_TOPIC, payload, strlen(payload));
+}
+
+void publish_result_packet(const uint8_t* data, size_t length) {
+    fanout_push(data, length);
+    if (!PUBLISH_RESULTS) return;
+    if (gateway.state != GW_CONNECTED || gateway.conn.out.size() > gateway.conn.outLimit) {
+        logWarn("SENDER", "Gateway not connected or not draining, binary result message dropped.");
+        return;
+    }
+    mqtt::encode_publish(gateway.conn.out, OUTPUT_TOPIC, data, length);
+}
+
+// From the scheduler, outside the epoll loop: a sensor that cannot take it now is closed
+static void publish_to_subscribers(bool SensorClient::*subscribed, const char* topic, const char* payload) {
+    size_t length = strlen(payload);
+    std::vector<int> lost;
+    for (auto& kv : sensors) {
+        SensorClient& c = kv.second;
+        if (!c.connected || !(c.*subscribed) || c.conn.out.size() > c.conn.outLimit) continue;
+        mqtt::encode_publish(c.conn.out, topic, payload, length);
+        if (!flush_output(c.conn)) lost.push_back(kv.first);
+        else watch(kv.first, !c.conn.out.empty(), EPOLL_CTL_MOD);
+    }
+    for (int fd : lost) close_sensor(fd);
+}
+
+void publish_schedule(const char* payload) {
+    publish_to_subscribers(&SensorClient::tdma, TDMA_TOPIC, payload);
+}
+
+// Requests come from either side; the reply goes to both, the request id tells them apart
+void publish_history(const char* payload) {
+    publish_to_subscribers(&SensorClient::history, HISTORY_REPLY_TOPIC, payload);
+    if (gateway.state == GW_CONNECTED && gateway.conn.out.size() <= gateway.conn.outLimit) {
+        mqtt::encode_publish(gateway.conn.out, HISTORY_REPLY_TOPIC, payload, strlen(payload));
+    }
+}
+
+// From record_fix(), inside the ingest task
+void publish_geofence(const char* payload) {
+    publish_to_subscribers(&SensorClient::geofence, GEOFENCE_TOPIC, payload);
+    if (gateway.state == GW_CONNECTED && gateway.conn.out.size() <= gateway.conn.outLimit) {
+        mqtt::encode_publish(gateway.conn.out, GEOFENCE_TOPIC, payload, strlen(payload));
+    }
+}
+
+// From the fanout task (fanout.h). A subscriber that has not taken the
+// results queued for it misses this one; the others are not held up.
+void publish_local(const uint8_t* data, size_t length) {
+    std::vector<int> lost;
+    for (auto& kv : sensors) {
+        SensorClient& c = kv.second;
+        if (!c.connected || !c.results) continue;
+        if (c.conn.out.size() + length > SUBSCRIBER_QUEUE_BYTES) {
+            if (c.resultsMissed++ == 0) logWarn("FANOUT", "Subscriber %s is not draining, results dropped.", c.id.c_str());
+            continue;
+        }
+        if (c.resultsMissed > 0) {
+            logInfo("FANOUT", "Subscriber %s caught up, %lu result(s) missed.", c.id.c_str(),
+                    (unsigned long)c.resultsMissed);
+            c.resultsMissed = 0;
+        }
+        mqtt::encode_publish(c.conn.out, LOCAL_RESULT_TOPIC, data, length);
+        if (!flush_output(c.conn)) lost.push_back(kv.first);
+        else watch(kv.first, !c.conn.out.empty(), EPOLL_CTL_MOD);
+    }
+    for (int fd : lost) close_sensor(fd);
+}
+
+// --- Main Loop ---
+
+static void print_usage() {
+    fprintf(stderr, "Usage: central_node [--config <config.json>] [--csv <fixes.csv>] [--auto-zones <n>]\n"
+                    "                    [--profile <trace.json>]\n");
+}
+
+int main(int argc, char** argv) {
+    const char* configPath = "system/central_node/config.json";
+    const char* csvPath = nullptr;
+    const char* profilePath = nullptr;
+    int autoZones = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--config") && i + 1 < argc) {
+            configPath = argv[++i];
+        } else if (!strcmp(argv[i], "--csv") && i + 1 < argc) {
+            csvPath = argv[++i];
+        } else if (!strcmp(argv[i], "--auto-zones") && i + 1 < argc) {
+            autoZones = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--profile") && i + 1 < argc) {
+            profilePath = argv[++i];
+        } else {
+            print_usage();
+            return 1;
+        }
+    }
+
+    if (!load_daemon_config(configPath)) return 1;
+    if (csvPath && !open_fix_csv(csvPath)) return 1;
+    if (profilePath && !profile::open_trace(profilePath, "central_node")) {
+        logError("MAIN", profile::profiling_built() ? "Cannot write %s" : "%s: built without -DPROFILING", profilePath);
+        return 1;
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    signal(SIGPIPE, SIG_IGN);
+
+    setup_scheduler();
+    setup_tuning();
+    topic_route(SENSOR_TOPIC, on_sensor_message);
+    topic_route_sensors(SENSOR_TOPIC, on_sensor_message); // SENSOR_TOPIC/<id>
+    topic_route(CONTROL_TOPIC, on_control_topic);
+    topic_route(HISTORY_TOPIC, on_history_topic);
+    setup_fanout();
+    logInfo("CONFIG", "Anchors: S2(%.2f, 0, 0), S3(%.2f, %.2f, 0)", S2_a, S3_c, S3_b);
+    logInfo("CONFIG", "History=%d, Offset=%.2f, Avg Interval=%lu ms, Publish=%s, Device ID=%d",
+            HISTORY_SIZE, DISTANCE_OFFSET, AVERAGE_INTERVAL_MS, PUBLISH_RESULTS ? "ON" : "OFF", OUTPUT_DEVICE_ID);
+
+    epollFd = epoll_create1(0);
+    listenFd = tcp_listen(CENTRAL_NODE_PORT);
+    if (listenFd < 0) {
+        logError("LOCAL_BROKER", "Cannot listen on port %u", CENTRAL_NODE_PORT);
+        return 1;
+    }
+    watch(listenFd, false, EPOLL_CTL_ADD);
+    logInfo("LOCAL_BROKER", "Listening for sensors on port %u, topic %s", CENTRAL_NODE_PORT, SENSOR_TOPIC);
+
+    initialize_logic();
+    for (const ZoneConfig& z : CONFIG_ZONES) {
+        add_zone(z.deviceId, z.sensorIds, z.S2_a, z.S3_c, z.S3_b);
+    }
+    for (int g = 1; g < autoZones; g++) {
+        const int ids[3] = { 3 * g + 1, 3 * g + 2, 3 * g + 3 };
+        if (add_zone(g + 1, ids, S2_a, S3_c, S3_b) < 0) break;
+    }
+    logInfo("ZONES", "Serving %zu configured + %d generated zone(s) besides zone 0.",
+            CONFIG_ZONES.size(), autoZones > 1 ? autoZones - 1 : 0);
+    int fences = 0;
+    for (const FenceConfig& f : CONFIG_FENCES) fences += geofence_add(f) >= 0;
+    if (fences > 0) logInfo("GEOFENCE", "%d fence(s), events on %s.", fences, GEOFENCE_TOPIC);
+
+    std::vector<epoll_event> events(1024);
+    std::vector<int> toClose;
+
+    while (running) {
+        maintain_gateway();
+
+        int timeoutMs = (int)std::min<uint32_t>(LOOP_TICK_MS, scheduler_idle_ms());
+        int n = epoll_wait(epollFd, events.data(), (int)events.size(), timeoutMs);
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+            if (fd == listenFd) {
+                accept_sensors();
+                continue;
+            }
+            if (fd == gateway.conn.fd) {
+                bool alive = true;
+                if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                    alive = read_available(gateway.conn) && process_gateway_input();
+                }
+                if (!alive) {
+                    logError("EXT_CLIENT", "Gateway connection lost.");
+                    close_gateway();
+                }
+                continue;
+            }
+            auto it = sensors.find(fd);
+            if (it == sensors.end()) continue;
+            SensorClient& c = it->second;
+            bool alive = true;
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                alive = read_available(c.conn);
+                if (!process_sensor_input(c)) alive = false;
+            }
+            if (alive && !c.conn.out.empty()) alive = flush_output(c.conn);
+            if (alive) watch(fd, !c.conn.out.empty(), EPOLL_CTL_MOD);
+            else toClose.push_back(fd);
+        }
+        for (int fd : toClose) close_sensor(fd);
+        toClose.clear();
+
+        // Tuning and averaging, as on the boards; staged tuning lands between two fixes
+        run_scheduler();
+
+        if (gateway.conn.fd >= 0 && !gateway.conn.out.empty()) {
+            if (!flush_output(gateway.conn)) {
+                logError("EXT_CLIENT", "Gateway connection lost.");
+                close_gateway();
+            }
+        }
+        if (gateway.conn.fd >= 0) watch(gateway.conn.fd, !gateway.conn.out.empty(), EPOLL_CTL_MOD);
+        flush_fix_csv(false);
+        profiler_flush();
+    }
+
+    logInfo("MAIN", "Stopping.");
+    close_fix_csv();
+    profile::close_trace();
+    close_gateway();
+    for (auto& kv : sensors) close(kv.first);
+    close(listenFd);
+    close(epollFd);
+    return 0;
+}
@@ -0,0 +1,198 @@
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <stdio.h>
+#include <string>
+#include "config.h"
+#include "daemon_config.h"
+#include "logging.h"
+
+// --- Firmware Settings (see config.h) ---
+const char* MQTT_CLIENT_ID = "linux-central-node";
+const char* SENSOR_TOPIC = "/node/central";
+const char* OUTPUT_TOPIC = "/central/d_gateway";
+const char* CONTROL_TOPIC = "/central/control";
+const char* SENSOR_LOGIN_PREFIX = "";
+const char* TDMA_TOPIC = "/central/tdma";
+const char* HISTORY_TOPIC = "/central/history";
+const char* HISTORY_REPLY_TOPIC = "/central/history/reply";
+const char* GEOFENCE_TOPIC = "/central/geofence";
+const char* LOCAL_RESULT_TOPIC = "/central/results";
+
+float S2_a = 370.0;
+float S3_c = 0.0;
+float S3_b = 110.0;
+
+int HISTORY_SIZE = 5;
+float DISTANCE_OFFSET = 35.0;
+unsigned long AVERAGE_INTERVAL_MS = 3000;
+bool PUBLISH_RESULTS = true;
+bool LOCAL_RESULTS = true;
+int OUTPUT_DEVICE_ID = 1;
+bool MULTI_TARGET_MODE = false;
+bool BINARY_RESULTS = false;
+unsigned long SENSOR_TIMEOUT_MS = 2000;
+float INGEST_RATE_HZ = 20.0;
+int INGEST_BURST = 32;
+unsigned long TDMA_FRAME_MS = 600;
+bool MOTION_ADAPTIVE = false;
+unsigned long MOTION_MIN_INTERVAL_MS = 1000;
+unsigned long MOTION_MAX_INTERVAL_MS = 10000;
+float SIMPLIFY_TOLERANCE_CM = 0;
+unsigned long SIMPLIFY_MAX_GAP_MS = 30000;
+
+int LOG_LEVEL = LOG_LEVEL_RESULTS;
+
+// The daemon's zones come from config.json (CONFIG_ZONES), not from this table
+const ZoneConfig EXTRA_ZONES[MAX_ZONES] = {};
+const FenceConfig FENCES[MAX_FENCES] = {}; // Likewise CONFIG_FENCES
+
+// --- Daemon Settings ---
+uint16_t CENTRAL_NODE_PORT = 1886;
+std::string GATEWAY_HOST = "127.0.0.1";
+uint16_t GATEWAY_PORT = 1885;
+std::vector<ZoneConfig> CONFIG_ZONES;
+std::vector<FenceConfig> CONFIG_FENCES;
+
+// Backing storage for the topic pointers above once they come from the file
+static std::string sensorTopic, outputTopic, sensorLoginPrefix, localResultTopic;
+
+static bool read_file(const char* path, std::string& out) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.append(buf, n);
+    fclose(f);
+    return true;
+}
+
+// "mqtt://192.168.1.107:1885" -> host and port
+static bool parse_gateway_url(const char* url) {
+    std::string s(url);
+    size_t scheme = s.find("://");
+    if (scheme != std::string::npos) s.erase(0, scheme + 3);
+    size_t colon = s.rfind(':');
+    if (colon == std::string::npos) {
+        GATEWAY_HOST = s;
+        return !s.empty();
+    }
+    int port = atoi(s.c_str() + colon + 1);
+    if (port <= 0 || port > 65535) return false;
+    GATEWAY_HOST = s.substr(0, colon);
+    GATEWAY_PORT = (uint16_t)port;
+    return !GATEWAY_HOST.empty();
+}
+
+bool load_daemon_config(const char* path) {
+    std::string text;
+    if (!read_file(path, text)) {
+        logError("CONFIG", "Cannot read %s", path);
+        return false;
+    }
+    // One slot per member or element, so at most one per comma or opening bracket, plus
+    // the copied strings: sized from the file, a config with hundreds of zones fits
+    size_t values = 1;
+    for (char c : text) values += c == ',' || c == '[' || c == '{';
+    DynamicJsonDocument doc(JSON_ARRAY_SIZE(values) + text.size());
+    DeserializationError error = deserializeJson(doc, text);
+    if (error) {
+        logError("CONFIG", "JSON parse failed on %s: %s", path, error.c_str());
+        return false;
+    }
+
+    JsonObject anchors = doc["anchorCoordinates"];
+    S2_a = anchors["S2_a"] | S2_a;
+    S3_c = anchors["S3_c"] | S3_c;
+    S3_b = anchors["S3_b"] | S3_b;
+
+    JsonObject calc = doc["calculationSettings"];
+    HISTORY_SIZE = calc["historySize"] | HISTORY_SIZE;
+    if (HISTORY_SIZE < 2 || HISTORY_SIZE > MAX_HISTORY_SIZE) {
+        logWarn("CONFIG", "historySize must be 2..%d, using 5", MAX_HISTORY_SIZE);
+        HISTORY_SIZE = 5;
+    }
+    PUBLISH_RESULTS = calc["publishResults"] | PUBLISH_RESULTS;
+    LOCAL_RESULTS = calc["localResults"] | LOCAL_RESULTS;
+    DISTANCE_OFFSET = calc["distanceOffset"] | DISTANCE_OFFSET;
+    AVERAGE_INTERVAL_MS = calc["averageCalculationIntervalMs"] | AVERAGE_INTERVAL_MS;
+    MULTI_TARGET_MODE = calc["multiTarget"] | MULTI_TARGET_MODE;
+    BINARY_RESULTS = calc["binaryResults"] | BINARY_RESULTS;
+    SENSOR_TIMEOUT_MS = calc["sensorTimeoutMs"] | SENSOR_TIMEOUT_MS;
+    INGEST_RATE_HZ = calc["ingestRateHz"] | INGEST_RATE_HZ;
+    INGEST_BURST = calc["ingestBurst"] | INGEST_BURST;
+    TDMA_FRAME_MS = calc["tdmaFrameMs"] | TDMA_FRAME_MS;
+    MOTION_ADAPTIVE = calc["motionAdaptive"] | MOTION_ADAPTIVE;
+    MOTION_MIN_INTERVAL_MS = calc["motionMinIntervalMs"] | MOTION_MIN_INTERVAL_MS;
+    MOTION_MAX_INTERVAL_MS = calc["motionMaxIntervalMs"] | MOTION_MAX_INTERVAL_MS;
+    SIMPLIFY_TOLERANCE_CM = calc["simplifyToleranceCm"] | SIMPLIFY_TOLERANCE_CM;
+    SIMPLIFY_MAX_GAP_MS = calc["simplifyMaxGapMs"] | SIMPLIFY_MAX_GAP_MS;
+
+    const char* level = doc["logging"]["level"] | "results";
+    if (!strcmp(level, "verbose")) LOG_LEVEL = LOG_LEVEL_VERBOSE;
+    else if (!strcmp(level, "minimal")) LOG_LEVEL = LOG_LEVEL_MINIMAL;
+    else LOG_LEVEL = LOG_LEVEL_RESULTS;
+
+    JsonObject mqttConfig = doc["mqttConfig"];
+    CENTRAL_NODE_PORT = mqttConfig["centralNodePort"] | CENTRAL_NODE_PORT;
+    const char* url = mqttConfig["deviceGatewayUrl"];
+    if (url && !parse_gateway_url(url)) {
+        logWarn("CONFIG", "Bad deviceGatewayUrl '%s', using %s:%u", url, GATEWAY_HOST.c_str(), GATEWAY_PORT);
+    }
+    sensorTopic = mqttConfig["sensorTopic"] | SENSOR_TOPIC;
+    outputTopic = mqttConfig["outputTopic"] | OUTPUT_TOPIC;
+    sensorLoginPrefix = mqttConfig["sensorLoginPrefix"] | SENSOR_LOGIN_PREFIX;
+    localResultTopic = mqttConfig["localResultTopic"] | LOCAL_RESULT_TOPIC;
+    SENSOR_TOPIC = sensorTopic.c_str();
+    OUTPUT_TOPIC = outputTopic.c_str();
+    SENSOR_LOGIN_PREFIX = sensorLoginPrefix.c_str();
+    LOCAL_RESULT_TOPIC = localResultTopic.c_str();
+    OUTPUT_DEVICE_ID = mqttConfig["outputDeviceId"] | OUTPUT_DEVICE_ID;
+
+    JsonArray zones = doc["zones"];
+    for (JsonObject z : zones) {
+        JsonArray ids = z["sensorIds"];
+        ZoneConfig zone;
+        zone.deviceId = z["deviceId"] | 0;
+        if (zone.deviceId == 0 || ids.size() != 3) {
+            logWarn("CONFIG", "Skipping zone without deviceId or with sensorIds not of length 3");
+            continue;
+        }
+        for (int slot = 0; slot < 3; slot++) zone.sensorIds[slot] = ids[slot];
+        zone.S2_a = z["S2_a"] | S2_a;
+        zone.S3_c = z["S3_c"] | S3_c;
+        zone.S3_b = z["S3_b"] | S3_b;
+        CONFIG_ZONES.push_back(zone);
+    }
+
+    JsonArray fences = doc["fences"];
+    for (JsonObject f : fences) {
+        FenceConfig fence = {};
+        fence.id = f["id"] | 0;
+        fence.deviceId = f["deviceId"] | OUTPUT_DEVICE_ID;
+        JsonArray box = f["box"];
+        JsonArray polygon = f["polygon"];
+        if (box.size() == 4) {
+            fence.vertices = 2;
+            fence.x[0] = box[0];
+            fence.y[0] = box[1];
+            fence.x[1] = box[2];
+            fence.y[1] = box[3];
+        } else if (polygon.size() >= 3 && polygon.size() <= (size_t)MAX_FENCE_VERTICES) {
+            fence.vertices = (int)polygon.size();
+            for (int i = 0; i < fence.vertices; i++) {
+                fence.x[i] = polygon[i][0];
+                fence.y[i] = polygon[i][1];
+            }
+        }
+        if (fence.id == 0 || fence.vertices == 0) {
+            logWarn("CONFIG", "Skipping fence without id or without a box [x0, y0, x1, y1] or 3..%d polygon points",
+                    MAX_FENCE_VERTICES);
+            continue;
+        }
+        fence.zMin = f["zMin"] | 0.0f;
+        fence.zMax = f["zMax"] | 0.0f;
+        fence.dwellMs = f["dwellMs"] | 0UL;
+        CONFIG_FENCES.push_back(fence);
+    }
+    return true;
+}
@@ -0,0 +1,30 @@
+#ifndef DAEMON_CONFIG_H
+#define DAEMON_CONFIG_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "types.h"
+
+// The calculation settings are the firmware's own config.h globals, defined in
+// daemon_config.cpp and filled from config.json. Only the settings the boards
+// hard-code in config.cpp (ports, gateway address) live here.
+extern uint16_t CENTRAL_NODE_PORT;
+extern std::string GATEWAY_HOST;
+extern uint16_t GATEWAY_PORT;
+
+// Zones beyond zone 0, from the optional "zones" array in config.json:
+//   "zones": [ { "deviceId": 2, "sensorIds": [4, 5, 6], "S2_a": 370, "S3_c": 0, "S3_b": 110 } ]
+// Anchors left out default to zone 0's.
+extern std::vector<ZoneConfig> CONFIG_ZONES;
+
+// Geofences (see geofence.h), from the optional "fences" array, as a box or a polygon:
+//   "fences": [ { "id": 1, "deviceId": 2, "box": [0, 0, 120, 110], "dwellMs": 30000 },
+//               { "id": 2, "deviceId": 2, "polygon": [[250, 0], [370, 0], [370, 110]], "zMin": 0, "zMax": 100 } ]
+extern std::vector<FenceConfig> CONFIG_FENCES;
+
+// Reads the same config.json as system/central_node/central_node.js.
+// Missing keys keep their defaults. Returns false if the file is unreadable or invalid.
+bool load_daemon_config(const char* path);
+
+#endif // DAEMON_CONFIG_H
@@ -0,0 +1,122 @@
+#include <Arduino.h>
+#include <string>
+#include <time.h>
+#include "config.h"
+#include "daemon_logging.h"
+#include "logging.h"
+
+static const size_t CSV_BATCH_BYTES = 64 * 1024;
+static const unsigned long CSV_BATCH_MS = 1000;
+static const long TIMESTAMP_UTC_OFFSET_S = 7 * 3600; // GMT+7, as in central_node.js
+
+static FILE* csvFile = nullptr;
+static std::string csvBatch;
+static unsigned long csvBatchStart = 0;
+
+static void vlog(const char* level, const char* prefix, const char* format, va_list args) {
+    char buffer[512];
+    vsnprintf(buffer, sizeof(buffer), format, args);
+    fprintf(stderr, "[%s] [%s] %s\n", level, prefix, buffer);
+}
+
+void logVerbose(const char* prefix, const char* format, ...) {
+    if (LOG_LEVEL >= LOG_LEVEL_VERBOSE) {
+        va_list args;
+        va_start(args, format);
+        vlog("VERBOSE", prefix, format, args);
+        va_end(args);
+    }
+}
+
+void logInfo(const char* prefix, const char* format, ...) {
+    if (LOG_LEVEL >= LOG_LEVEL_RESULTS) {
+        va_list args;
+        va_start(args, format);
+        vlog("INFO", prefix, format, args);
+        va_end(args);
+    }
+}
+
+void logWarn(const char* prefix, const char* format, ...) {
+    if (LOG_LEVEL >= LOG_LEVEL_RESULTS) {
+        va_list args;
+        va_start(args, format);
+        vlog("WARN", prefix, format, args);
+        va_end(args);
+    }
+}
+
+void logError(const char* prefix, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    vlog("ERROR", prefix, format, args);
+    va_end(args);
+}
+
+void logResult(const char* resultString) {
+    printf("[RESULT] %s\n", resultString);
+    fflush(stdout);
+}
+
+// --- CSV Sink ---
+
+// "YYYY-MM-DD HH:MM:SS" in GMT+7, formatted at most once per second
+static const char* timestamp_gmt7() {
+    static time_t cachedSecond = 0;
+    static char cached[24];
+    time_t now = time(nullptr);
+    if (now != cachedSecond) {
+        cachedSecond = now;
+        time_t shifted = now + TIMESTAMP_UTC_OFFSET_S;
+        tm t;
+        gmtime_r(&shifted, &t);
+        strftime(cached, sizeof(cached), "%Y-%m-%d %H:%M:%S", &t);
+    }
+    return cached;
+}
+
+void logFix(int deviceId, float d1, float d2, float d3, float x, float y, float z) {
+    logVerbose("FIX", "%.0f,%.0f,%.0f,%.2f,%.2f,%.2f,%d", d1, d2, d3, x, y, z, deviceId);
+    if (!csvFile) return;
+
+    // Coordinates rounded to 2 decimals and printed without trailing zeros, like toFixed(2) + parseFloat
+    char row[128];
+    int n = snprintf(row, sizeof(row), "%s,%g,%g,%g,%.10g,%.10g,%.10g,%d\n", timestamp_gmt7(), d1, d2, d3,
+                     round(x * 100) / 100.0, round(y * 100) / 100.0, round(z * 100) / 100.0, deviceId);
+    if (n <= 0) return;
+    if (csvBatch.empty()) csvBatchStart = millis();
+    csvBatch.append(row, (size_t)n < sizeof(row) ? (size_t)n : sizeof(row) - 1);
+    if (csvBatch.size() >= CSV_BATCH_BYTES) flush_fix_csv(true);
+}
+
+bool open_fix_csv(const char* path) {
+    csvFile = fopen(path, "a");
+    if (!csvFile) {
+        logError("FILE_LOG", "Cannot open %s for appending", path);
+        return false;
+    }
+    if (ftell(csvFile) == 0) {
+        fputs("time,d1,d2,d3,x,y,z,deviceID\n", csvFile);
+        fflush(csvFile);
+        logInfo("FILE_LOG", "Created %s with header", path);
+    }
+    csvBatch.reserve(CSV_BATCH_BYTES + 128);
+    return true;
+}
+
+void flush_fix_csv(bool force) {
+    if (!csvFile || csvBatch.empty()) return;
+    if (!force && millis() - csvBatchStart < CSV_BATCH_MS) return;
+    if (fwrite(csvBatch.data(), 1, csvBatch.size(), csvFile) != csvBatch.size()) {
+        logError("FILE_LOG", "Short write, %zu bytes of fixes lost", csvBatch.size());
+    }
+    fflush(csvFile);
+    logVerbose("FILE_LOG", "Wrote %zu bytes of fixes", csvBatch.size());
+    csvBatch.clear();
+}
+
+void close_fix_csv() {
+    flush_fix_csv(true);
+    if (csvFile) fclose(csvFile);
+    csvFile = nullptr;
+}
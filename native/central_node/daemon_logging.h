@@ -0,0 +1,17 @@
+#ifndef DAEMON_LOGGING_H
+#define DAEMON_LOGGING_H
+
+// Host implementation of the firmware's logging.h. Log lines go to stderr,
+// [RESULT] lines to stdout, and every logFix() becomes a CSV row in the
+// central_node.js format ("time,d1,d2,d3,x,y,z", GMT+7 timestamps) with the
+// zone's deviceID appended, since one file holds every zone.
+//
+// Rows are collected in memory and written in batches instead of one
+// appendFileSync per fix, so a slow disk never stalls the event loop for
+// longer than one batch write.
+
+bool open_fix_csv(const char* path); // Creates the file with its header if needed
+void flush_fix_csv(bool force);      // Writes the batch once it is big or old enough
+void close_fix_csv();
+
+#endif // DAEMON_LOGGING_H
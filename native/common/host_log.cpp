@@ -0,0 +1,53 @@
+#include "host_log.h"
+#include <stdarg.h>
+#include <stdio.h>
+
+static int hostLogLevel = LOG_LEVEL_RESULTS;
+
+void setHostLogLevel(int level) {
+    hostLogLevel = level;
+}
+
+static void vlog(const char* level, const char* prefix, const char* format, va_list args) {
+    char buffer[512];
+    vsnprintf(buffer, sizeof(buffer), format, args);
+    fprintf(stderr, "[%s] [%s] %s\n", level, prefix, buffer);
+}
+
+void logVerbose(const char* prefix, const char* format, ...) {
+    if (hostLogLevel >= LOG_LEVEL_VERBOSE) {
+        va_list args;
+        va_start(args, format);
+        vlog("VERBOSE", prefix, format, args);
+        va_end(args);
+    }
+}
+
+void logInfo(const char* prefix, const char* format, ...) {
+    if (hostLogLevel >= LOG_LEVEL_RESULTS) {
+        va_list args;
+        va_start(args, format);
+        vlog("INFO", prefix, format, args);
+        va_end(args);
+    }
+}
+
+void logWarn(const char* prefix, const char* format, ...) {
+    if (hostLogLevel >= LOG_LEVEL_RESULTS) {
+        va_list args;
+        va_start(args, format);
+        vlog("WARN", prefix, format, args);
+        va_end(args);
+    }
+}
+
+void logError(const char* prefix, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    vlog("ERROR", prefix, format, args);
+    va_end(args);
+}
+
+void logResult(const char* resultString) {
+    printf("[RESULT] %s\n", resultString);
+}
@@ -0,0 +1,19 @@
+#ifndef HOST_LOG_H
+#define HOST_LOG_H
+
+// Host-side counterpart of the firmware's logging.h, with the same
+// "[LEVEL] [PREFIX] message" format so tool output reads like Serial logs.
+
+#define LOG_LEVEL_VERBOSE 2
+#define LOG_LEVEL_RESULTS 1
+#define LOG_LEVEL_MINIMAL 0
+
+void setHostLogLevel(int level);
+
+void logVerbose(const char* prefix, const char* format, ...);
+void logInfo(const char* prefix, const char* format, ...);
+void logWarn(const char* prefix, const char* format, ...);
+void logError(const char* prefix, const char* format, ...);
+void logResult(const char* resultString);
+
+#endif // HOST_LOG_H
@@ -0,0 +1,221 @@
+#include "mqtt_codec.h"
+#include <string.h>
+
+namespace mqtt {
+
+// --- Helpers ---
+
+static void put_remaining_length(std::string& out, size_t len) {
+    do {
+        uint8_t byte = len % 128;
+        len /= 128;
+        if (len > 0) byte |= 0x80;
+        out.push_back((char)byte);
+    } while (len > 0);
+}
+
+static void put_u16(std::string& out, uint16_t v) {
+    out.push_back((char)(v >> 8));
+    out.push_back((char)(v & 0xFF));
+}
+
+static void put_string(std::string& out, const char* s, size_t len) {
+    put_u16(out, (uint16_t)len);
+    out.append(s, len);
+}
+
+static bool get_u16(const uint8_t*& p, const uint8_t* end, uint16_t& v) {
+    if (end - p < 2) return false;
+    v = (uint16_t)((p[0] << 8) | p[1]);
+    p += 2;
+    return true;
+}
+
+static bool get_string(const uint8_t*& p, const uint8_t* end, const char*& s, size_t& len) {
+    uint16_t n;
+    if (!get_u16(p, end, n) || end - p < n) return false;
+    s = (const char*)p;
+    len = n;
+    p += n;
+    return true;
+}
+
+// --- Parsing ---
+
+long parse_packet(const uint8_t* buf, size_t len, Packet& out) {
+    if (len < 2) return 0;
+    size_t remaining = 0;
+    size_t multiplier = 1;
+    size_t pos = 1;
+    for (;;) {
+        if (pos >= len) return 0;
+        uint8_t byte = buf[pos++];
+        remaining += (byte & 0x7F) * multiplier;
+        if ((byte & 0x80) == 0) break;
+        multiplier *= 128;
+        if (pos > 4) return -1; // Remaining length is at most four bytes
+    }
+    if (len - pos < remaining) return 0;
+    out.type = buf[0] >> 4;
+    out.flags = buf[0] & 0x0F;
+    out.body = buf + pos;
+    out.bodyLen = remaining;
+    return (long)(pos + remaining);
+}
+
+bool decode_connect(const Packet& p, ConnectInfo& out) {
+    const uint8_t* cur = p.body;
+    const uint8_t* end = p.body + p.bodyLen;
+    const char* s;
+    size_t n;
+    if (!get_string(cur, end, s, n)) return false; // Protocol name
+    if (end - cur < 2) return false;
+    cur++; // Protocol level
+    uint8_t connectFlags = *cur++;
+    if (!get_u16(cur, end, out.keepAlive)) return false;
+    if (!get_string(cur, end, s, n)) return false;
+    out.clientId.assign(s, n);
+    if (connectFlags & 0x04) { // Will topic + message
+        if (!get_string(cur, end, s, n) || !get_string(cur, end, s, n)) return false;
+    }
+    out.username.clear();
+    if (connectFlags & 0x80) {
+        if (!get_string(cur, end, s, n)) return false;
+        out.username.assign(s, n);
+    }
+    return true;
+}
+
+bool decode_publish(const Packet& p, PublishView& out) {
+    const uint8_t* cur = p.body;
+    const uint8_t* end = p.body + p.bodyLen;
+    if (!get_string(cur, end, out.topic, out.topicLen)) return false;
+    out.qos = (p.flags >> 1) & 0x03;
+    out.packetId = 0;
+    if (out.qos > 0 && !get_u16(cur, end, out.packetId)) return false;
+    out.payload = cur;
+    out.payloadLen = (size_t)(end - cur);
+    return true;
+}
+
+static bool decode_filter_list(const Packet& p, uint16_t& packetId, std::vector<std::string>& filters, bool withQos) {
+    const uint8_t* cur = p.body;
+    const uint8_t* end = p.body + p.bodyLen;
+    if (!get_u16(cur, end, packetId)) return false;
+    filters.clear();
+    while (cur < end) {
+        const char* s;
+        size_t n;
+        if (!get_string(cur, end, s, n)) return false;
+        if (withQos) {
+            if (cur >= end) return false;
+            cur++; // Requested QoS, always granted as 0
+        }
+        filters.emplace_back(s, n);
+    }
+    return !filters.empty();
+}
+
+bool decode_subscribe(const Packet& p, uint16_t& packetId, std::vector<std::string>& filters) {
+    return decode_filter_list(p, packetId, filters, true);
+}
+
+bool decode_unsubscribe(const Packet& p, uint16_t& packetId, std::vector<std::string>& filters) {
+    return decode_filter_list(p, packetId, filters, false);
+}
+
+// --- Encoding ---
+
+void encode_connect(std::string& out, const char* clientId, uint16_t keepAlive, const char* username) {
+    size_t idLen = strlen(clientId);
+    size_t userLen = username ? strlen(username) : 0;
+    size_t remaining = 10 + 2 + idLen + (username ? 2 + userLen : 0);
+    out.push_back((char)(CONNECT << 4));
+    put_remaining_length(out, remaining);
+    put_string(out, "MQTT", 4);
+    out.push_back(4); // Protocol level 3.1.1
+    out.push_back((char)(0x02 | (username ? 0x80 : 0))); // Clean session
+    put_u16(out, keepAlive);
+    put_string(out, clientId, idLen);
+    if (username) put_string(out, username, userLen);
+}
+
+void encode_connack(std::string& out, uint8_t returnCode) {
+    out.push_back((char)(CONNACK << 4));
+    out.push_back(2);
+    out.push_back(0);
+    out.push_back((char)returnCode);
+}
+
+void encode_publish(std::string& out, const char* topic, const void* payload, size_t len) {
+    size_t topicLen = strlen(topic);
+    out.push_back((char)(PUBLISH << 4));
+    put_remaining_length(out, 2 + topicLen + len);
+    put_string(out, topic, topicLen);
+    out.append((const char*)payload, len);
+}
+
+void encode_puback(std::string& out, uint16_t packetId) {
+    out.push_back((char)(PUBACK << 4));
+    out.push_back(2);
+    put_u16(out, packetId);
+}
+
+void encode_subscribe(std::string& out, uint16_t packetId, const char* filter) {
+    size_t len = strlen(filter);
+    out.push_back((char)((SUBSCRIBE << 4) | 0x02));
+    put_remaining_length(out, 2 + 2 + len + 1);
+    put_u16(out, packetId);
+    put_string(out, filter, len);
+    out.push_back(0); // QoS 0
+}
+
+void encode_suback(std::string& out, uint16_t packetId, size_t count) {
+    out.push_back((char)(SUBACK << 4));
+    put_remaining_length(out, 2 + count);
+    put_u16(out, packetId);
+    out.append(count, '\0');
+}
+
+void encode_unsuback(std::string& out, uint16_t packetId) {
+    out.push_back((char)(UNSUBACK << 4));
+    out.push_back(2);
+    put_u16(out, packetId);
+}
+
+void encode_pingreq(std::string& out) {
+    out.push_back((char)(PINGREQ << 4));
+    out.push_back(0);
+}
+
+void encode_pingresp(std::string& out) {
+    out.push_back((char)(PINGRESP << 4));
+    out.push_back(0);
+}
+
+void encode_disconnect(std::string& out) {
+    out.push_back((char)(DISCONNECT << 4));
+    out.push_back(0);
+}
+
+// --- Topic matching ---
+
+bool topic_matches(const char* filter, const char* topic, size_t topicLen) {
+    const char* t = topic;
+    const char* tEnd = topic + topicLen;
+    const char* f = filter;
+    while (*f) {
+        if (*f == '#') return true;
+        if (*f == '+') {
+            while (t < tEnd && *t != '/') t++;
+            f++;
+            continue;
+        }
+        if (t >= tEnd || *f != *t) return false;
+        f++;
+        t++;
+    }
+    return t == tEnd;
+}
+
+} // namespace mqtt
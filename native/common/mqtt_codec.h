@@ -0,0 +1,76 @@
+#ifndef MQTT_CODEC_H
+#define MQTT_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Minimal MQTT 3.1.1 packet codec for the host tools.
+// Only what the sensors, the central node and the gateway actually use:
+// CONNECT/CONNACK, QoS 0 PUBLISH (QoS 1 is acknowledged and downgraded),
+// SUBSCRIBE/SUBACK, UNSUBSCRIBE/UNSUBACK, PINGREQ/PINGRESP and DISCONNECT.
+namespace mqtt {
+
+enum PacketType : uint8_t {
+    CONNECT = 1,
+    CONNACK = 2,
+    PUBLISH = 3,
+    PUBACK = 4,
+    SUBSCRIBE = 8,
+    SUBACK = 9,
+    UNSUBSCRIBE = 10,
+    UNSUBACK = 11,
+    PINGREQ = 12,
+    PINGRESP = 13,
+    DISCONNECT = 14
+};
+
+// A complete packet view into a receive buffer (no copies)
+struct Packet {
+    uint8_t type = 0;
+    uint8_t flags = 0;
+    const uint8_t* body = nullptr;
+    size_t bodyLen = 0;
+};
+
+struct ConnectInfo {
+    std::string clientId;
+    std::string username;
+    uint16_t keepAlive = 0;
+};
+
+struct PublishView {
+    const char* topic = nullptr;
+    size_t topicLen = 0;
+    const uint8_t* payload = nullptr;
+    size_t payloadLen = 0;
+    uint8_t qos = 0;
+    uint16_t packetId = 0;
+};
+
+// Returns bytes consumed, 0 if the buffer holds an incomplete packet, -1 if malformed
+long parse_packet(const uint8_t* buf, size_t len, Packet& out);
+
+bool decode_connect(const Packet& p, ConnectInfo& out);
+bool decode_publish(const Packet& p, PublishView& out);
+bool decode_subscribe(const Packet& p, uint16_t& packetId, std::vector<std::string>& filters);
+bool decode_unsubscribe(const Packet& p, uint16_t& packetId, std::vector<std::string>& filters);
+
+void encode_connect(std::string& out, const char* clientId, uint16_t keepAlive, const char* username = nullptr);
+void encode_connack(std::string& out, uint8_t returnCode);
+void encode_publish(std::string& out, const char* topic, const void* payload, size_t len);
+void encode_puback(std::string& out, uint16_t packetId);
+void encode_subscribe(std::string& out, uint16_t packetId, const char* filter);
+void encode_suback(std::string& out, uint16_t packetId, size_t count);
+void encode_unsuback(std::string& out, uint16_t packetId);
+void encode_pingreq(std::string& out);
+void encode_pingresp(std::string& out);
+void encode_disconnect(std::string& out);
+
+// MQTT topic filter matching with '+' and '#' wildcards
+bool topic_matches(const char* filter, const char* topic, size_t topicLen);
+
+} // namespace mqtt
+
+#endif // MQTT_CODEC_H
@@ -0,0 +1,31 @@
+#ifndef NET_UTIL_H
+#define NET_UTIL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+// Non-blocking TCP helpers shared by the epoll-based host tools.
+
+// A socket with its pending input and output bytes
+struct Connection {
+    int fd = -1;
+    std::string in;
+    std::string out;
+    size_t outLimit = 1 << 20; // Output bytes allowed to queue before the peer counts as stalled
+};
+
+int tcp_listen(uint16_t port, int backlog = 512);
+int tcp_connect(const char* host, uint16_t port); // Non-blocking; completion is signalled by EPOLLOUT
+int tcp_accept(int listenFd);                     // Returns -1 when there is nothing left to accept
+bool set_nonblocking(int fd);
+
+// Reads everything available. Returns false on EOF or a hard error.
+bool read_available(Connection& c);
+// Writes as much queued output as the socket takes. Returns false on a hard error.
+bool flush_output(Connection& c);
+
+// Monotonic clock in microseconds
+uint64_t now_us();
+
+#endif // NET_UTIL_H
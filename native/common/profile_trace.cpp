@@ -0,0 +1,57 @@
+#include "profile_trace.h"
+#include <stdio.h>
+#include "profiler.h"
+
+namespace profile {
+
+#ifdef PROFILING
+
+static FILE* out = nullptr;
+static ProfileTicks origin = 0;
+
+static void write_events(const ProfileEvent* events, int count) {
+    for (int i = 0; i < count; i++) {
+        const ProfileEvent& e = events[i];
+        // Zone names are string literals from the firmware source, no escaping needed
+        fprintf(out, ",\n{\"name\":\"%s\",\"cat\":\"fw\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+                profiler_zone_name(e.zone), (e.start - origin) / 1000.0, (e.end - e.start) / 1000.0);
+    }
+}
+
+bool open_trace(const char* path, const char* processName) {
+    out = fopen(path, "w");
+    if (!out) return false;
+    fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    fprintf(out, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"%s\"}}", processName);
+    origin = profile_now();
+    profiler_set_sink(write_events);
+    return true;
+}
+
+bool profiling_built() {
+    return true;
+}
+
+void close_trace() {
+    if (!out) return;
+    profiler_set_sink(nullptr);
+    fprintf(out, "\n]}\n");
+    fclose(out);
+    out = nullptr;
+}
+
+#else
+
+bool open_trace(const char*, const char*) {
+    return false;
+}
+
+bool profiling_built() {
+    return false;
+}
+
+void close_trace() {}
+
+#endif // PROFILING
+
+} // namespace profile
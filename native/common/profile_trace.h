@@ -0,0 +1,22 @@
+#ifndef PROFILE_TRACE_H
+#define PROFILE_TRACE_H
+
+// Chrome trace export of the firmware's profiling zones (profiler.h) for host
+// builds with -DPROFILING: every run of a zone becomes a complete ("X") event
+// with microsecond timestamps from the start of the trace. The file opens in
+// chrome://tracing or ui.perfetto.dev, where nested zones stack under the
+// zone that called them.
+//
+// Needs the firmware directory on the include path. Events reach the file when
+// the host calls profiler_flush(). Without PROFILING, open_trace() fails and
+// close_trace() does nothing.
+namespace profile {
+
+// Starts recording to path; false if the file cannot be created or profiling_built() is false
+bool open_trace(const char* path, const char* processName);
+bool profiling_built(); // Compiled with -DPROFILING
+void close_trace(); // Flushes the last events and closes the JSON
+
+} // namespace profile
+
+#endif // PROFILE_TRACE_H
@@ -0,0 +1,137 @@
+#include "result_decoder.h"
+#include <stdio.h>
+
+namespace results {
+
+// --- Helpers ---
+
+static bool get_varint(const uint8_t*& p, const uint8_t* end, uint32_t& v) {
+    v = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (p == end) return false;
+        uint8_t byte = *p++;
+        v |= (uint32_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) return true;
+    }
+    return false;
+}
+
+static bool get_signed(const uint8_t*& p, const uint8_t* end, int32_t& v) {
+    uint32_t u;
+    if (!get_varint(p, end, u)) return false;
+    v = (int32_t)(u >> 1) ^ -(int32_t)(u & 1);
+    return true;
+}
+
+static bool get_xyz(const uint8_t*& p, const uint8_t* end, int32_t& x, int32_t& y, int32_t& z) {
+    return get_signed(p, end, x) && get_signed(p, end, y) && get_signed(p, end, z);
+}
+
+// --- Decoding ---
+
+bool is_binary(const uint8_t* data, size_t len) {
+    return len >= 4 && data[0] == MAGIC;
+}
+
+bool Decoder::decode(const uint8_t* data, size_t len, std::vector<Record>& out) {
+    if (!is_binary(data, len) || data[1] < 2 || data[1] > VERSION) return false;
+    int motionBits = data[1] >= 3 ? 2 : 0;
+    messages++;
+    int seq = data[2];
+    if (lastSeq >= 0 && seq != ((lastSeq + 1) & 0xFF)) {
+        int missed = (seq - lastSeq - 1) & 0xFF;
+        gaps += (uint64_t)missed;
+        // Record counters only tell short gaps apart; after a long one no base is trusted
+        if (missed >= KEY_INTERVAL) {
+            for (auto& entry : bases) entry.second.synced = false;
+        }
+    }
+    lastSeq = seq;
+
+    int count = data[3];
+    const uint8_t* p = data + 4;
+    const uint8_t* end = data + len;
+    for (int i = 0; i < count; i++) {
+        uint32_t deviceId;
+        if (!get_varint(p, end, deviceId) || p == end) return false;
+        uint8_t flags = *p++;
+
+        Record rec;
+        rec.deviceId = (int)deviceId;
+        bool usable = true;
+        if (flags & FLAG_VALID) {
+            int32_t x, y, z;
+            uint32_t r;
+            if (!get_xyz(p, end, x, y, z) || !get_varint(p, end, r)) return false;
+            Base& base = bases[rec.deviceId];
+            uint8_t counter = flags >> COUNTER_SHIFT;
+            if (base.synced && counter != ((base.counter + 1) & 31)) base.synced = false;
+            base.counter = counter;
+            if (flags & FLAG_KEY) {
+                base.synced = true;
+            } else if (base.synced) {
+                x += base.x;
+                y += base.y;
+                z += base.z;
+            } else {
+                usable = false;
+            }
+            if (usable) {
+                base.x = (int16_t)x;
+                base.y = (int16_t)y;
+                base.z = (int16_t)z;
+                rec.valid = true;
+                rec.x = base.x;
+                rec.y = base.y;
+                rec.z = base.z;
+                rec.r = (uint16_t)(r >> (1 + motionBits));
+                rec.degraded = (r & 1) != 0;
+                rec.motion = (uint8_t)((r >> 1) & ((1u << motionBits) - 1));
+            }
+        }
+        if (flags & FLAG_TARGETS) {
+            if (p == end) return false;
+            int trackCount = *p++;
+            rec.hasTargets = true;
+            for (int t = 0; t < trackCount; t++) {
+                uint32_t id;
+                int32_t x, y, z;
+                if (!get_varint(p, end, id) || !get_xyz(p, end, x, y, z)) return false;
+                rec.targets.push_back({ (uint16_t)id, (int16_t)x, (int16_t)y, (int16_t)z });
+            }
+        }
+
+        if (!usable) {
+            skipped++;
+            continue;
+        }
+        records++;
+        out.push_back(std::move(rec));
+    }
+    return p == end;
+}
+
+std::string to_json(const Record& r) {
+    char buf[96];
+    std::string json;
+    snprintf(buf, sizeof(buf), "{\"deviceID\":%d,\"data\":{\"x\":%d,\"y\":%d,\"z\":%d,\"r\":%d}", r.deviceId, r.x, r.y,
+             r.z, r.r);
+    json = buf;
+    if (r.degraded) json += ",\"degraded\":true";
+    if (r.motion == 1) json += ",\"motion\":\"stationary\"";
+    if (r.motion == 2) json += ",\"motion\":\"moving\"";
+    if (r.hasTargets) {
+        json += ",\"targets\":[";
+        for (size_t i = 0; i < r.targets.size(); i++) {
+            const Track& t = r.targets[i];
+            snprintf(buf, sizeof(buf), "%s{\"track\":%u,\"x\":%d,\"y\":%d,\"z\":%d}", i ? "," : "", t.id, t.x, t.y,
+                     t.z);
+            json += buf;
+        }
+        json += "]";
+    }
+    json += "}";
+    return json;
+}
+
+} // namespace results
@@ -0,0 +1,71 @@
+#ifndef RESULT_DECODER_H
+#define RESULT_DECODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Gateway-side reader for the central node's binary results (BINARY_RESULTS,
+// format described in ESP32_CentralNode_Hybrid/result_codec.h). Binary and
+// JSON results can share OUTPUT_TOPIC: check is_binary() per message.
+namespace results {
+
+constexpr uint8_t MAGIC = 0xB5;
+constexpr uint8_t VERSION = 3;     // Also reads version 2, without the motion state
+
+constexpr uint8_t FLAG_KEY = 0x01;
+constexpr uint8_t FLAG_VALID = 0x02;
+constexpr uint8_t FLAG_TARGETS = 0x04;
+constexpr int COUNTER_SHIFT = 3;
+constexpr int KEY_INTERVAL = 16;
+
+struct Track {
+    uint16_t id = 0;
+    int16_t x = 0, y = 0, z = 0; // cm
+};
+
+struct Record {
+    int deviceId = 0;
+    bool valid = false; // false: no fix in the interval, the JSON format sends zeros
+    int16_t x = 0, y = 0, z = 0; // cm
+    uint16_t r = 0;
+    bool degraded = false; // Some fixes of the interval were solved from two ranges (a sensor was stale)
+    uint8_t motion = 0;    // 0 unknown, 1 stationary, 2 moving (MotionState)
+    bool hasTargets = false;
+    std::vector<Track> targets;
+};
+
+bool is_binary(const uint8_t* data, size_t len);
+
+// Keeps the per-deviceID delta bases of one publisher. Use one decoder per
+// central node; seq and the bases are only meaningful within one stream.
+class Decoder {
+public:
+    // Appends the records of one message. Returns false for a malformed
+    // message (records decoded before the error are kept).
+    bool decode(const uint8_t* data, size_t len, std::vector<Record>& out);
+
+    uint64_t messages = 0;
+    uint64_t records = 0;
+    uint64_t skipped = 0; // Delta records whose base was lost, until the zone's next key record
+    uint64_t gaps = 0;    // Messages missed according to seq
+
+private:
+    struct Base {
+        int16_t x = 0, y = 0, z = 0;
+        uint8_t counter = 0;
+        bool synced = false;
+    };
+    std::unordered_map<int, Base> bases;
+    int lastSeq = -1;
+};
+
+// {"deviceID":N,"data":{"x":..,"y":..,"z":..,"r":..}[,"degraded":true][,"motion":".."][,"targets":[...]]}, the
+// central node's JSON result, for consumers that only read JSON
+std::string to_json(const Record& r);
+
+} // namespace results
+
+#endif // RESULT_DECODER_H
@@ -0,0 +1,190 @@
+#include "trace_format.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+
+namespace trace {
+
+static const char* const COLUMN_NAMES[COLUMN_COUNT] = { "time", "deviceID", "d1", "d2", "d3", "x", "y", "z" };
+
+const char* column_name(int column) {
+    return column >= 0 && column < COLUMN_COUNT ? COLUMN_NAMES[column] : "?";
+}
+
+size_t column_width(int column) {
+    return column == COL_TIME ? sizeof(int64_t) : 4;
+}
+
+static uint64_t align_up(uint64_t v) {
+    return (v + COLUMN_ALIGN - 1) & ~(uint64_t)(COLUMN_ALIGN - 1);
+}
+
+// --- Writer ---
+void TraceWriter::add(int64_t timeMs, int32_t deviceId, const float d[3], const float xyz[3]) {
+    time.push_back(timeMs);
+    device.push_back(deviceId);
+    for (int i = 0; i < 3; i++) {
+        values[i].push_back(d[i]);
+        values[3 + i].push_back(xyz[i]);
+    }
+}
+
+bool TraceWriter::write(const char* path, const Geometry& geometry) const {
+    Header h{};
+    h.magic = MAGIC;
+    h.version = VERSION;
+    h.columnCount = COLUMN_COUNT;
+    h.rows = time.size();
+    h.blockRows = BLOCK_ROWS;
+    h.blockCount = (uint32_t)((h.rows + BLOCK_ROWS - 1) / BLOCK_ROWS);
+    h.geometry = geometry;
+    uint64_t offset = HEADER_SIZE;
+    for (int c = 0; c < COLUMN_COUNT; c++) {
+        offset = align_up(offset);
+        h.columnOffset[c] = offset;
+        offset += h.rows * column_width(c);
+    }
+    h.indexOffset = align_up(offset);
+    h.fileSize = h.indexOffset + (uint64_t)h.blockCount * sizeof(Block);
+
+    std::vector<Block> index(h.blockCount);
+    for (uint32_t b = 0; b < h.blockCount; b++) {
+        size_t first = (size_t)b * BLOCK_ROWS;
+        size_t last = std::min(first + BLOCK_ROWS, time.size());
+        Block& k = index[b];
+        auto t = std::minmax_element(time.begin() + first, time.begin() + last);
+        auto d = std::minmax_element(device.begin() + first, device.begin() + last);
+        k.timeMin = *t.first;
+        k.timeMax = *t.second;
+        k.deviceMin = *d.first;
+        k.deviceMax = *d.second;
+        for (int i = 0; i < 6; i++) {
+            auto v = std::minmax_element(values[i].begin() + first, values[i].begin() + last);
+            k.min[i] = *v.first;
+            k.max[i] = *v.second;
+        }
+    }
+
+    FILE* f = fopen(path, "wb");
+    if (!f) return false;
+    static const uint8_t zeros[COLUMN_ALIGN] = {};
+    auto pad_to = [&](uint64_t target) {
+        long at = ftell(f);
+        return at >= 0 && (uint64_t)at <= target && fwrite(zeros, 1, target - at, f) == target - at;
+    };
+    bool ok = fwrite(&h, sizeof(h), 1, f) == 1;
+    for (int c = 0; ok && c < COLUMN_COUNT; c++) {
+        const void* data = c == COL_TIME ? (const void*)time.data()
+                           : c == COL_DEVICE ? (const void*)device.data()
+                                             : (const void*)values[c - COL_D1].data();
+        ok = pad_to(h.columnOffset[c]) && fwrite(data, column_width(c), h.rows, f) == h.rows;
+    }
+    ok = ok && pad_to(h.indexOffset) && fwrite(index.data(), sizeof(Block), index.size(), f) == index.size();
+    ok = fclose(f) == 0 && ok;
+    return ok;
+}
+
+// --- Reader ---
+TraceReader::~TraceReader() {
+    close();
+}
+
+void TraceReader::close() {
+    if (base) munmap((void*)base, size);
+    base = nullptr;
+    size = 0;
+    hdr = nullptr;
+    blocks = nullptr;
+}
+
+bool TraceReader::open(const char* path) {
+    close();
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        err = strerror(errno);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)HEADER_SIZE) {
+        err = "too short for a trace header";
+        ::close(fd);
+        return false;
+    }
+    void* map = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        err = strerror(errno);
+        return false;
+    }
+    base = (const uint8_t*)map;
+    size = (size_t)st.st_size;
+    hdr = (const Header*)base;
+
+    const Header& h = *hdr;
+    bool ok = h.magic == MAGIC && h.version == VERSION && h.columnCount == COLUMN_COUNT;
+    if (!ok) err = "not a version 1 trace";
+    if (ok && (h.fileSize != size || h.blockRows == 0 ||
+               h.blockCount != (h.rows + h.blockRows - 1) / h.blockRows)) {
+        ok = false;
+        err = "truncated or inconsistent header";
+    }
+    for (int c = 0; ok && c < COLUMN_COUNT; c++) {
+        if (h.columnOffset[c] % COLUMN_ALIGN != 0 || h.columnOffset[c] < HEADER_SIZE ||
+            h.columnOffset[c] + h.rows * column_width(c) > size) {
+            ok = false;
+            err = std::string("column ") + column_name(c) + " out of bounds";
+        }
+    }
+    if (ok && (h.indexOffset % alignof(Block) != 0 || h.indexOffset + (uint64_t)h.blockCount * sizeof(Block) > size)) {
+        ok = false;
+        err = "block index out of bounds";
+    }
+    if (!ok) {
+        close();
+        return false;
+    }
+    blocks = (const Block*)(base + h.indexOffset);
+    // Scans read the columns front to back
+    madvise(map, size, MADV_SEQUENTIAL);
+    return true;
+}
+
+void TraceReader::time_range(int64_t fromMs, int64_t toMs, uint64_t& first, uint64_t& last) const {
+    first = last = 0;
+    bool found = false;
+    for (uint32_t b = 0; b < hdr->blockCount; b++) {
+        if (blocks[b].timeMax < fromMs || blocks[b].timeMin > toMs) continue;
+        if (!found) first = (uint64_t)b * hdr->blockRows;
+        found = true;
+        last = std::min<uint64_t>((uint64_t)(b + 1) * hdr->blockRows, hdr->rows);
+    }
+}
+
+// --- Timestamps ---
+bool parse_timestamp(const char* s, int64_t& ms) {
+    while (*s == ' ' || *s == '"') s++;
+    int year, mon, day, hour, min;
+    double sec;
+    char sep;
+    if (sscanf(s, "%4d-%2d-%2d%c%2d:%2d:%lf", &year, &mon, &day, &sep, &hour, &min, &sec) != 7) return false;
+    if ((sep != ' ' && sep != 'T') || mon < 1 || mon > 12 || day < 1 || day > 31 || sec < 0 || sec >= 61) return false;
+    struct tm t;
+    memset(&t, 0, sizeof(t));
+    t.tm_year = year - 1900;
+    t.tm_mon = mon - 1;
+    t.tm_mday = day;
+    t.tm_hour = hour;
+    t.tm_min = min;
+    int whole = (int)sec;
+    t.tm_sec = whole;
+    ms = (int64_t)timegm(&t) * 1000 + (int64_t)((sec - whole) * 1000.0 + 0.5);
+    return true;
+}
+
+} // namespace trace
@@ -0,0 +1,123 @@
+#ifndef TRACE_FORMAT_H
+#define TRACE_FORMAT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Columnar binary trace of recorded fixes (.trk), the analysis format for the
+// central node's CSV logs. A file is
+//
+//   Header      fixed 256 bytes: row and block counts, anchor geometry and
+//               the file offset of every column and of the block index
+//   Columns     one contiguous array per column, each 64-byte aligned:
+//                 time      int64   ms since the Unix epoch (UTC)
+//                 deviceId  int32   0 when the log has no deviceID column
+//                 d1 d2 d3  float   raw ranges as logged (cm, before DISTANCE_OFFSET)
+//                 x y z     float   fix (cm)
+//   Block index one Block per BLOCK_ROWS rows: min/max of every column
+//
+// Everything is little-endian, which is what every host that runs the tools is.
+// TraceReader maps the file and hands out pointers into the mapping, so a scan
+// touches only the columns it reads; Block lets a time or position query skip
+// whole blocks without looking at their rows.
+namespace trace {
+
+constexpr uint32_t MAGIC = 0x4B525452; // "RTRK"
+constexpr uint16_t VERSION = 1;
+constexpr uint32_t HEADER_SIZE = 256;
+constexpr uint32_t BLOCK_ROWS = 4096;
+constexpr size_t COLUMN_ALIGN = 64;
+
+enum Column { COL_TIME, COL_DEVICE, COL_D1, COL_D2, COL_D3, COL_X, COL_Y, COL_Z, COLUMN_COUNT };
+
+const char* column_name(int column);
+size_t column_width(int column); // Bytes per value
+
+struct Geometry {
+    float S2_a = 370.0f; // S1 at the origin, S2 at (a,0,0), S3 at (c,b,0), as in config.h
+    float S3_c = 0.0f;
+    float S3_b = 110.0f;
+    float distanceOffset = 35.0f;
+};
+
+struct Header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t columnCount;
+    uint64_t rows;
+    uint32_t blockRows;
+    uint32_t blockCount;
+    Geometry geometry;
+    uint64_t columnOffset[COLUMN_COUNT];
+    uint64_t indexOffset;
+    uint64_t fileSize;
+    uint8_t reserved[HEADER_SIZE - 56 - 8 * COLUMN_COUNT];
+};
+static_assert(sizeof(Header) == HEADER_SIZE, "trace::Header layout changed");
+
+// Min/max of every column over one block of rows
+struct Block {
+    int64_t timeMin, timeMax;
+    int32_t deviceMin, deviceMax;
+    float min[6]; // d1 d2 d3 x y z
+    float max[6];
+};
+
+// Collects rows in memory and writes the file in one go
+class TraceWriter {
+public:
+    void add(int64_t timeMs, int32_t deviceId, const float d[3], const float xyz[3]);
+    bool write(const char* path, const Geometry& geometry) const;
+    size_t rows() const { return time.size(); }
+
+private:
+    std::vector<int64_t> time;
+    std::vector<int32_t> device;
+    std::vector<float> values[6];
+};
+
+// Read-only mapping of a trace file
+class TraceReader {
+public:
+    TraceReader() = default;
+    TraceReader(const TraceReader&) = delete;
+    TraceReader& operator=(const TraceReader&) = delete;
+    ~TraceReader();
+
+    // Maps the file and checks the header. On failure error() says why.
+    bool open(const char* path);
+    void close();
+    const std::string& error() const { return err; }
+
+    const Header& header() const { return *hdr; }
+    uint64_t rows() const { return hdr->rows; }
+    uint32_t block_count() const { return hdr->blockCount; }
+    const Block& block(uint32_t b) const { return blocks[b]; }
+
+    const int64_t* time() const { return (const int64_t*)column(COL_TIME); }
+    const int32_t* device() const { return (const int32_t*)column(COL_DEVICE); }
+    const float* values(int column) const { return (const float*)this->column(column); } // COL_D1..COL_Z
+    const void* column(int column) const { return base + hdr->columnOffset[column]; }
+
+    // Rows [first, last) of the blocks whose time range overlaps [fromMs, toMs].
+    // Rows are in log order, so for a log written in time order the result is
+    // exactly the blocks that can hold matching rows.
+    void time_range(int64_t fromMs, int64_t toMs, uint64_t& first, uint64_t& last) const;
+
+private:
+    const uint8_t* base = nullptr;
+    size_t size = 0;
+    const Header* hdr = nullptr;
+    const Block* blocks = nullptr;
+    std::string err;
+};
+
+// "2025-04-25 20:30:48" (central node CSV) or "2025-04-15T12:36:30.228Z"
+// (server0 logs), quotes allowed, read as UTC. Returns false if it is neither.
+bool parse_timestamp(const char* s, int64_t& ms);
+
+} // namespace trace
+
+#endif // TRACE_FORMAT_H
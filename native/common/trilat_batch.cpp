@@ -0,0 +1,140 @@
+#include "trilat_batch.h"
+#include <math.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TRILAT_HAVE_AVX2_KERNEL 1
+#endif
+
+namespace trilat {
+
+// Terms shared by every fix of a batch
+struct Constants {
+    float offset;
+    float aSq;      // a^2
+    float inv2a;    // 1 / 2a
+    float cbSq;     // c^2 + b^2
+    float twoC;     // 2c
+    float inv2b;    // 1 / 2b
+};
+
+static Constants constants(const Anchors& k) {
+    Constants c;
+    c.offset = k.distanceOffset;
+    c.aSq = k.S2_a * k.S2_a;
+    c.inv2a = 1.0f / (2.0f * k.S2_a);
+    c.cbSq = k.S3_c * k.S3_c + k.S3_b * k.S3_b;
+    c.twoC = 2.0f * k.S3_c;
+    c.inv2b = 1.0f / (2.0f * k.S3_b);
+    return c;
+}
+
+// Branch-free, so the compiler vectorises it (with -fno-math-errno -fno-trapping-math);
+// the valid count is a second pass, a reduction in this loop would keep it scalar
+static size_t solve_rows(const Constants& c, const float* __restrict d1, const float* __restrict d2,
+                         const float* __restrict d3, size_t begin, size_t end, float* __restrict x, float* __restrict y,
+                         float* __restrict z, uint8_t* __restrict valid) {
+    for (size_t i = begin; i < end; i++) {
+        float s1 = d1[i] + c.offset;
+        float s2 = d2[i] + c.offset;
+        float s3 = d3[i] + c.offset;
+        float s1Sq = s1 * s1;
+        float px = (c.aSq + s1Sq - s2 * s2) * c.inv2a;
+        float py = (s1Sq + c.cbSq - s3 * s3 - c.twoC * px) * c.inv2b;
+        float zSq = s1Sq - px * px - py * py;
+        float pz = sqrtf(zSq > 0 ? zSq : 0.0f);
+        x[i] = px;
+        y[i] = py;
+        z[i] = pz;
+        valid[i] = (zSq >= 0) & (px > 0) & (py > 0) & (pz > 0);
+    }
+    size_t count = 0;
+    for (size_t i = begin; i < end; i++) count += valid[i];
+    return count;
+}
+
+size_t solve_batch_portable(const Anchors& anchors, const float* d1, const float* d2, const float* d3, size_t n,
+                            float* x, float* y, float* z, uint8_t* valid) {
+    return solve_rows(constants(anchors), d1, d2, d3, 0, n, x, y, z, valid);
+}
+
+#ifdef TRILAT_HAVE_AVX2_KERNEL
+// Eight fixes per iteration; the tail goes through the portable loop
+__attribute__((target("avx2"))) static size_t solve_avx2(const Constants& c, const float* d1, const float* d2,
+                                                         const float* d3, size_t n, float* x, float* y, float* z,
+                                                         uint8_t* valid) {
+    const __m256 offset = _mm256_set1_ps(c.offset);
+    const __m256 aSq = _mm256_set1_ps(c.aSq);
+    const __m256 inv2a = _mm256_set1_ps(c.inv2a);
+    const __m256 cbSq = _mm256_set1_ps(c.cbSq);
+    const __m256 twoC = _mm256_set1_ps(c.twoC);
+    const __m256 inv2b = _mm256_set1_ps(c.inv2b);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m128i one = _mm_set1_epi8(1);
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 s1 = _mm256_add_ps(_mm256_loadu_ps(d1 + i), offset);
+        __m256 s2 = _mm256_add_ps(_mm256_loadu_ps(d2 + i), offset);
+        __m256 s3 = _mm256_add_ps(_mm256_loadu_ps(d3 + i), offset);
+        __m256 s1Sq = _mm256_mul_ps(s1, s1);
+        __m256 px = _mm256_mul_ps(_mm256_sub_ps(_mm256_add_ps(aSq, s1Sq), _mm256_mul_ps(s2, s2)), inv2a);
+        __m256 py = _mm256_sub_ps(_mm256_add_ps(s1Sq, cbSq), _mm256_mul_ps(s3, s3));
+        py = _mm256_mul_ps(_mm256_sub_ps(py, _mm256_mul_ps(twoC, px)), inv2b);
+        __m256 zSq = _mm256_sub_ps(_mm256_sub_ps(s1Sq, _mm256_mul_ps(px, px)), _mm256_mul_ps(py, py));
+        __m256 pz = _mm256_sqrt_ps(_mm256_max_ps(zSq, zero));
+        __m256 ok = _mm256_and_ps(_mm256_cmp_ps(zSq, zero, _CMP_GE_OQ), _mm256_cmp_ps(px, zero, _CMP_GT_OQ));
+        ok = _mm256_and_ps(ok, _mm256_and_ps(_mm256_cmp_ps(py, zero, _CMP_GT_OQ), _mm256_cmp_ps(pz, zero, _CMP_GT_OQ)));
+        _mm256_storeu_ps(x + i, px);
+        _mm256_storeu_ps(y + i, py);
+        _mm256_storeu_ps(z + i, pz);
+        // All-ones lanes narrowed to one byte each, then 0xFF to 1
+        __m256i lanes = _mm256_castps_si256(ok);
+        __m128i words = _mm_packs_epi32(_mm256_castsi256_si128(lanes), _mm256_extracti128_si256(lanes, 1));
+        _mm_storel_epi64((__m128i*)(valid + i), _mm_and_si128(_mm_packs_epi16(words, words), one));
+        count += (size_t)__builtin_popcount((unsigned)_mm256_movemask_ps(ok));
+    }
+    return count + solve_rows(c, d1, d2, d3, i, n, x, y, z, valid);
+}
+
+static bool cpu_has_avx2() {
+    static const bool has = __builtin_cpu_supports("avx2");
+    return has;
+}
+#endif
+
+size_t solve_batch(const Anchors& anchors, const float* d1, const float* d2, const float* d3, size_t n, float* x,
+                   float* y, float* z, uint8_t* valid) {
+    Constants c = constants(anchors);
+#ifdef TRILAT_HAVE_AVX2_KERNEL
+    if (cpu_has_avx2()) return solve_avx2(c, d1, d2, d3, n, x, y, z, valid);
+#endif
+    return solve_rows(c, d1, d2, d3, 0, n, x, y, z, valid);
+}
+
+const char* batch_kernel() {
+#ifdef TRILAT_HAVE_AVX2_KERNEL
+    if (cpu_has_avx2()) return "avx2";
+#endif
+    return "portable";
+}
+
+bool solve_scalar(const Anchors& anchors, float r1, float r2, float r3, float& x, float& y, float& z) {
+    float a = anchors.S2_a;
+    float c = anchors.S3_c;
+    float b = anchors.S3_b;
+    float d1 = r1 + anchors.distanceOffset;
+    float d2 = r2 + anchors.distanceOffset;
+    float d3 = r3 + anchors.distanceOffset;
+
+    x = (pow(a, 2) + pow(d1, 2) - pow(d2, 2)) / (2 * a);
+    float y_numerator = pow(d1, 2) + pow(c, 2) + pow(b, 2) - pow(d3, 2) - (2 * c * x);
+    y = y_numerator / (2 * b);
+    float zSquared = pow(d1, 2) - pow(x, 2) - pow(y, 2);
+    z = 0;
+    if (zSquared < 0) return false;
+    z = sqrt(zSquared);
+    return x > 0 && y > 0 && z > 0;
+}
+
+} // namespace trilat
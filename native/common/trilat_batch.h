@@ -0,0 +1,49 @@
+#ifndef TRILAT_BATCH_H
+#define TRILAT_BATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Batch trilateration for reprocessing recorded ranges, e.g. after a change of
+// DISTANCE_OFFSET or of the anchor geometry. Inputs and outputs are
+// struct-of-arrays columns (a trace's d1/d2/d3 columns can be passed straight
+// from TraceReader), and the fixes are solved without branches, several per
+// instruction.
+//
+// The math and the validity rules are those of solve_fix() in
+// ESP32_CentralNode_Hybrid/calculation_logic.cpp: the raw ranges get the
+// offset added, and a fix is valid only if z^2 >= 0 and x, y and z are all
+// positive. Instead of returning early, the kernels compute every row and
+// write the verdict to a mask.
+namespace trilat {
+
+struct Anchors {
+    float S2_a = 370.0f; // S1 at the origin, S2 at (a,0,0), S3 at (c,b,0)
+    float S3_c = 0.0f;
+    float S3_b = 110.0f;
+    float distanceOffset = 35.0f;
+};
+
+// Solves n fixes. x/y always hold the solution; z is 0 where z^2 < 0.
+// valid[i] is 1 for a fix solve_fix() would accept, 0 otherwise.
+// Returns the number of valid fixes. Uses AVX2 when the CPU has it.
+size_t solve_batch(const Anchors& anchors, const float* d1, const float* d2, const float* d3, size_t n, float* x,
+                   float* y, float* z, uint8_t* valid);
+
+// The same without AVX2 intrinsics: a plain loop for the compiler to vectorise,
+// which GCC only does with -fno-math-errno -fno-trapping-math
+size_t solve_batch_portable(const Anchors& anchors, const float* d1, const float* d2, const float* d3, size_t n,
+                            float* x, float* y, float* z, uint8_t* valid);
+
+// One fix the way solve_fix() computes it (pow() in double, one call per fix),
+// the reference the batch kernels are checked and timed against. The kernels
+// multiply by precomputed reciprocals in float, so their fixes agree to a few
+// float ulps and a fix right at a validity limit may be judged differently.
+bool solve_scalar(const Anchors& anchors, float r1, float r2, float r3, float& x, float& y, float& z);
+
+// "avx2" or "portable": what solve_batch() runs on this machine
+const char* batch_kernel();
+
+} // namespace trilat
+
+#endif // TRILAT_BATCH_H
@@ -0,0 +1,926 @@
+/**
+ * Firmware simulator - the whole ESP32_CentralNode_Hybrid firmware on a virtual clock.
+ *
+ * Every firmware source, the .ino included, is compiled unchanged against
+ * native/arduino_shim built with ARDUINO_SHIM_VIRTUAL_CLOCK and the library
+ * stand-ins in native/firmware_sim/shim (WiFi, sMQTTBroker, PubSubClient,
+ * Preferences). millis(), micros() and delay() read and advance a virtual
+ * clock, and nothing ever sleeps: after each loop() the clock jumps straight
+ * to the next sensor sample, scripted event or scheduler release
+ * (scheduler_idle_ms()). Firmware work takes no virtual time; anything that
+ * blocks on a real board (delay(), a connect() to an absent gateway) costs
+ * exactly its virtual duration, which is what the timing checks look at.
+ *
+ * Sensors follow loadgen's layout: zone g is served by sensor ids
+ * 3g+1..3g+3 and reports with deviceID g+1, all zones use zone 0's anchors,
+ * and each zone's target walks a circle (or stands where it stopped). Each
+ * sensor publishes
+ * {"id":N,"d":D} on SENSOR_TOPIC (or {"d":D} on SENSOR_TOPIC/N) at a fixed
+ * rate, staggered across the period. With "tdma" they follow the firmware's
+ * transmit schedule (tdma.h) from the first one they receive, like
+ * Device.ino: one sample per frame, measured at the start of the zone's
+ * group and sent in the sensor's slot. Delivery takes no time.
+ *
+ * A scenario file drives a run, one statement per line (lines starting with
+ * '#' are comments). Times take an ms, s, m or h suffix and default to seconds.
+ *   zones <n>                       anchor groups (1)
+ *   rate <hz>                       samples per sensor per second (5)
+ *   duration <time>                 simulated time (10m)
+ *   interval <ms>                   AVERAGE_INTERVAL_MS before setup()
+ *   binary                          BINARY_RESULTS
+ *   sensor_topics                   per-sensor topics SENSOR_TOPIC/<id>
+ *   tdma                            sensors follow the TDMA schedule
+ *   radar_energy                    sensors also send "me"/"se" (motion.h)
+ *   motion_adaptive                 MOTION_ADAPTIVE before setup()
+ *   simplify <cm>                   SIMPLIFY_TOLERANCE_CM before setup()
+ *   noise <cm>                      Gaussian range noise, fixed seed (0)
+ *   fence <id> <deviceID> <dwell> <x>,<y> <x>,<y> [...]
+ *                                   geofence after setup(): two corners of a
+ *                                   box or a polygon, dwell 0 for none
+ *   set connect_timeout_ms <ms>     how long a TCP connect to the absent gateway takes
+ *                                   when the firmware sets no timeout (3000)
+ *   set log_level <0..2>            LOG_LEVEL (0 unless --log is given)
+ *   at <time> gateway down|up
+ *   at <time> sensor <id> silent|resume
+ *   at <time> target <deviceID> stop|walk
+ *   at <time> control <json>        published on CONTROL_TOPIC by the gateway
+ *   at <time> history <json>        published on HISTORY_TOPIC by the gateway once the
+ *                                   previous request is answered; it asks again with
+ *                                   "from": next while a reply has one
+ *   expect <metric> <=|>= <value>   checked after the run, see print_report()
+ *
+ * Messages the local broker publishes on LOCAL_RESULT_TOPIC are counted, and
+ * so are its geofence events, the replies to history requests and their
+ * entries; entries a request's pages return twice are history_duplicates, and
+ * requests still paging after HISTORY_FOLLOW_MAX replies are history_stuck. Local JSON results are also timed per zone over the whole run,
+ * gateway outages included: local_missed_ticks and local_max_jitter_ms.
+ * Results on OUTPUT_TOPIC are decoded (JSON or result_codec packets) and
+ * measured: cadence jitter against AVERAGE_INTERVAL_MS and missed intervals
+ * (only between results of one gateway session, so outages are not counted
+ * twice), reconnect latency after the gateway comes back, and position error
+ * against the mean true position of each interval. With motion_adaptive the
+ * cadence is MOTION_MIN_INTERVAL_MS and intervals a zone skips are not
+ * missed; instead the motion tags are counted, and how long the results take
+ * to report a stop or walk event. With simplify, intervals without a result
+ * are not missed either; each result is scored against the true mean
+ * position of its own interval, and each dropped one by where the last two
+ * results extrapolate to (track_simplify.h). The share of fixes the fix
+ * cache (fix_cache.h) answered is reported as fix_cache_hit_pct. The report
+ * ends with the speedup over real time. The exit status is 1 if an
+ * expectation failed.
+ *
+ * Build (from the repository root, ArduinoJson 6 checked out somewhere):
+ *   g++ -std=c++17 -O2 -DESP32 -DARDUINO_SHIM_VIRTUAL_CLOCK -DMAX_ZONES=64 \
+ *       -Inative/firmware_sim/shim -Inative/firmware_sim -Inative/arduino_shim -Inative/common \
+ *       -IESP32_CentralNode_Hybrid -I<ArduinoJson>/src \
+ *       native/firmware_sim/firmware_sim.cpp native/firmware_sim/sim_world.cpp \
+ *       native/arduino_shim/arduino_shim.cpp native/common/result_decoder.cpp \
+ *       -x c++ ESP32_CentralNode_Hybrid/ESP32_CentralNode_Hybrid.ino -x none \
+ *       ESP32_CentralNode_Hybrid/calculation_logic.cpp ESP32_CentralNode_Hybrid/config.cpp \
+ *       ESP32_CentralNode_Hybrid/logging.cpp ESP32_CentralNode_Hybrid/multi_target.cpp \
+ *       ESP32_CentralNode_Hybrid/network_manager.cpp ESP32_CentralNode_Hybrid/result_codec.cpp \
+ *       ESP32_CentralNode_Hybrid/scheduler.cpp ESP32_CentralNode_Hybrid/tuning.cpp \
+ *       ESP32_CentralNode_Hybrid/warm_state.cpp ESP32_CentralNode_Hybrid/topic_router.cpp \
+ *       ESP32_CentralNode_Hybrid/ingest.cpp ESP32_CentralNode_Hybrid/profiler.cpp \
+ *       ESP32_CentralNode_Hybrid/tdma.cpp ESP32_CentralNode_Hybrid/fanout.cpp \
+ *       ESP32_CentralNode_Hybrid/history_store.cpp ESP32_CentralNode_Hybrid/geofence.cpp \
+ *       ESP32_CentralNode_Hybrid/motion.cpp ESP32_CentralNode_Hybrid/track_simplify.cpp \
+ *       ESP32_CentralNode_Hybrid/fix_cache.cpp native/common/profile_trace.cpp -o native/bin/firmware_sim
+ *
+ * Built with -DPROFILING, --profile writes every run of the firmware's
+ * profiling zones (profiler.h) to a Chrome trace. Timestamps are wall-clock
+ * time of the replay, not virtual time.
+ *
+ * Usage: firmware_sim <scenario.txt> [--log <file>] [--profile <trace.json>]
+ */
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <time.h>
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+#include "calculation_logic.h"
+#include "config.h"
+#include "fix_cache.h"
+#include "geofence.h"
+#include "motion.h"
+#include "profile_trace.h"
+#include "profiler.h"
+#include "result_decoder.h"
+#include "scheduler.h"
+#include "sim_world.h"
+
+void setup(); // ESP32_CentralNode_Hybrid.ino
+void loop();
+
+// --- Scenario ---
+
+enum EventKind { EV_GATEWAY, EV_SENSOR, EV_TARGET, EV_CONTROL, EV_HISTORY };
+
+struct Event {
+    uint64_t atUs;
+    EventKind kind;
+    bool on; // Gateway up, sensor resumed
+    int sensor;
+    std::string payload;
+};
+
+struct Expectation {
+    std::string metric;
+    bool atMost;
+    double limit;
+    int line;
+};
+
+struct Scenario {
+    int zones = 1;
+    double rateHz = 5;
+    uint64_t durationUs = 600ULL * 1000000;
+    unsigned long intervalMs = 0; // 0 = config.cpp default
+    bool binary = false;
+    bool sensorTopics = false;
+    bool tdma = false;
+    bool radarEnergy = false;
+    bool motionAdaptive = false;
+    double simplifyCm = 0;
+    double noiseCm = 0;
+    uint32_t connectTimeoutMs = 3000;
+    int logLevel = -1; // -1 = LOG_LEVEL_MINIMAL when muted, config.cpp default with --log
+    std::vector<Event> events;
+    std::vector<Expectation> expects;
+    std::vector<FenceConfig> fences;
+};
+
+static bool parse_time(const char* s, uint64_t& us) {
+    char* end;
+    double v = strtod(s, &end);
+    if (end == s || v < 0) return false;
+    double scale = 1e6;
+    if (!strcmp(end, "ms")) scale = 1e3;
+    else if (!strcmp(end, "m")) scale = 60e6;
+    else if (!strcmp(end, "h")) scale = 3600e6;
+    else if (*end && strcmp(end, "s")) return false;
+    us = (uint64_t)(v * scale);
+    return true;
+}
+
+static bool parse_line(Scenario& sc, char* line, int lineNo) {
+    line += strspn(line, " \t");
+    if (*line == '#') return true;
+    char* word = strtok(line, " \t\r\n");
+    if (!word) return true;
+    char* a = strtok(nullptr, " \t\r\n");
+    char* b = strtok(nullptr, " \t\r\n");
+
+    if (!strcmp(word, "zones") && a) sc.zones = atoi(a);
+    else if (!strcmp(word, "rate") && a) sc.rateHz = atof(a);
+    else if (!strcmp(word, "duration") && a) return parse_time(a, sc.durationUs);
+    else if (!strcmp(word, "interval") && a) sc.intervalMs = strtoul(a, nullptr, 10);
+    else if (!strcmp(word, "binary")) sc.binary = true;
+    else if (!strcmp(word, "sensor_topics")) sc.sensorTopics = true;
+    else if (!strcmp(word, "tdma")) sc.tdma = true;
+    else if (!strcmp(word, "radar_energy")) sc.radarEnergy = true;
+    else if (!strcmp(word, "motion_adaptive")) sc.motionAdaptive = true;
+    else if (!strcmp(word, "simplify") && a) sc.simplifyCm = atof(a);
+    else if (!strcmp(word, "noise") && a) sc.noiseCm = atof(a);
+    else if (!strcmp(word, "fence") && a && b) {
+        FenceConfig fence = {};
+        fence.id = atoi(a);
+        fence.deviceId = atoi(b);
+        char* dwell = strtok(nullptr, " \t\r\n");
+        uint64_t dwellUs;
+        if (!dwell || !parse_time(dwell, dwellUs)) return false;
+        fence.dwellMs = (unsigned long)(dwellUs / 1000);
+        for (char* point; (point = strtok(nullptr, " \t\r\n"));) {
+            if (fence.vertices == MAX_FENCE_VERTICES) return false;
+            if (sscanf(point, "%f,%f", &fence.x[fence.vertices], &fence.y[fence.vertices]) != 2) return false;
+            fence.vertices++;
+        }
+        if (fence.vertices < 2) return false;
+        sc.fences.push_back(fence);
+    }
+    else if (!strcmp(word, "set") && a && b && !strcmp(a, "connect_timeout_ms")) sc.connectTimeoutMs = strtoul(b, nullptr, 10);
+    else if (!strcmp(word, "set") && a && b && !strcmp(a, "log_level")) sc.logLevel = atoi(b);
+    else if (!strcmp(word, "expect") && a && b) {
+        char* v = strtok(nullptr, " \t\r\n");
+        if (!v || (strcmp(b, "<=") && strcmp(b, ">="))) return false;
+        sc.expects.push_back({ a, b[0] == '<', atof(v), lineNo });
+    } else if (!strcmp(word, "at") && a && b) {
+        Event ev = {};
+        if (!parse_time(a, ev.atUs)) return false;
+        char* c = strtok(nullptr, " \t\r\n");
+        if (!strcmp(b, "gateway") && c) {
+            ev.kind = EV_GATEWAY;
+            ev.on = !strcmp(c, "up");
+            if (!ev.on && strcmp(c, "down")) return false;
+        } else if ((!strcmp(b, "sensor") || !strcmp(b, "target")) && c) {
+            char* d = strtok(nullptr, " \t\r\n");
+            if (!d) return false;
+            bool sensor = !strcmp(b, "sensor");
+            ev.kind = sensor ? EV_SENSOR : EV_TARGET;
+            ev.sensor = atoi(c);
+            ev.on = !strcmp(d, sensor ? "resume" : "walk");
+            if (!ev.on && strcmp(d, sensor ? "silent" : "stop")) return false;
+        } else if ((!strcmp(b, "control") || !strcmp(b, "history")) && c) {
+            ev.kind = !strcmp(b, "control") ? EV_CONTROL : EV_HISTORY;
+            ev.payload = c;
+            for (char* rest; (rest = strtok(nullptr, "\r\n"));) ev.payload += std::string(" ") + rest;
+        } else {
+            return false;
+        }
+        sc.events.push_back(ev);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static bool load_scenario(const char* path, Scenario& sc) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "Cannot open scenario %s\n", path);
+        return false;
+    }
+    char line[512];
+    int lineNo = 0;
+    bool ok = true;
+    while (fgets(line, sizeof(line), f)) {
+        lineNo++;
+        if (!parse_line(sc, line, lineNo)) {
+            fprintf(stderr, "%s:%d: cannot parse this line\n", path, lineNo);
+            ok = false;
+        }
+    }
+    fclose(f);
+    std::stable_sort(sc.events.begin(), sc.events.end(), [](const Event& x, const Event& y) { return x.atUs < y.atUs; });
+    if (sc.zones < 1 || sc.zones > MAX_ZONES || 3 * sc.zones > MAX_SENSOR_ID || sc.rateHz <= 0) {
+        fprintf(stderr, "%s: zones must be 1..%d and rate positive\n", path, std::min(MAX_ZONES, MAX_SENSOR_ID / 3));
+        ok = false;
+    }
+    return ok;
+}
+
+// --- Sensors ---
+
+Scenario scenario;
+std::mt19937 rng(7);
+std::normal_distribution<double> noise(0.0, 1.0);
+
+int sensorCount = 0;
+uint64_t samplePeriodUs = 0;
+uint64_t sampleRound = 0; // Sensors sample in id order, once per round
+int sampleCursor = 0;
+std::vector<bool> sensorSilent;
+
+// Per zone: sum of the true positions since its last result
+std::vector<double> trueSumX, trueSumY;
+std::vector<uint32_t> trueCount;
+
+// Per zone with simplify: the true position at each sample round, and the
+// last two valid results received (newest first)
+struct TruePoint {
+    uint64_t atUs;
+    double x, y;
+};
+std::vector<std::vector<TruePoint>> truePath;
+struct Received {
+    int count;
+    uint64_t atUs[2];
+    double x[2], y[2];
+};
+std::vector<Received> received;
+
+// Per zone: time spent standing, the current stop (0 while walking), and the
+// motion state the results should report since the last stop or walk event
+std::vector<uint64_t> pausedUs, stoppedAtUs;
+std::vector<uint8_t> expectedMotion; // 0 = nothing pending
+std::vector<uint64_t> expectedSinceUs;
+
+// TDMA: sensors in slot order; the round counts frames from tdmaStartUs
+bool tdmaOn = false;
+uint64_t tdmaStartUs = 0;
+std::vector<int> tdmaOrder;              // Sensor index per slot
+std::vector<uint64_t> tdmaMeasureUs;     // Per slot, into the frame
+std::vector<uint64_t> tdmaSendUs;
+
+static uint64_t next_sample_us() {
+    if (tdmaOn) return tdmaStartUs + sampleRound * samplePeriodUs + tdmaSendUs[sampleCursor];
+    return sampleRound * samplePeriodUs + (samplePeriodUs * (uint64_t)sampleCursor) / (uint64_t)sensorCount;
+}
+
+static void target_position(int group, uint64_t atUs, double& x, double& y, double& z) {
+    const double speedCmS = 30.0;
+    double r = std::min(S2_a, S3_b) * 0.3;
+    double w = speedCmS / r;
+    double phase = group * 0.7;
+    double t = ((stoppedAtUs[group] ? stoppedAtUs[group] : atUs) - pausedUs[group]) / 1e6;
+    x = (S2_a + S3_c) / 2.0 + r * cos(w * t + phase);
+    y = S3_b / 2.0 + r * sin(w * t + phase);
+    z = 120.0;
+}
+
+// Raw range as Device.ino reports it: true range minus DISTANCE_OFFSET
+static void emit_sample(int index, uint64_t atUs) {
+    int group = index / 3;
+    int slot = index % 3;
+    double x, y, z;
+    target_position(group, atUs, x, y, z);
+    trueSumX[group] += x;
+    trueSumY[group] += y;
+    trueCount[group]++;
+    if (SIMPLIFY_TOLERANCE_CM > 0 && slot == 0) truePath[group].push_back({ atUs, x, y });
+
+    double ax = slot == 1 ? S2_a : (slot == 2 ? S3_c : 0.0);
+    double ay = slot == 2 ? S3_b : 0.0;
+    double d = sqrt((x - ax) * (x - ax) + (y - ay) * (y - ay) + z * z) - DISTANCE_OFFSET;
+    if (scenario.noiseCm > 0) d += noise(rng) * scenario.noiseCm;
+    // An LD2410 sees a walking person mostly as a moving target, a standing one as a stationary target
+    const char* energy = "";
+    if (scenario.radarEnergy) energy = stoppedAtUs[group] ? ",\"me\":0,\"se\":60" : ",\"me\":55,\"se\":30";
+    char payload[80];
+    long range = d < 0 ? 0L : lround(d);
+    if (scenario.sensorTopics) {
+        snprintf(payload, sizeof(payload), "{\"d\":%ld%s}", range, energy);
+        sim::brokerInbox.push_back({ std::string(SENSOR_TOPIC) + "/" + std::to_string(index + 1), payload });
+    } else {
+        snprintf(payload, sizeof(payload), "{\"id\":%d,\"d\":%ld%s}", index + 1, range, energy);
+        sim::brokerInbox.push_back({ SENSOR_TOPIC, payload });
+    }
+}
+
+// --- Measurements ---
+
+struct Stats {
+    uint64_t sensorMessages = 0;
+    uint64_t resultMessages = 0;
+    uint64_t localMessages = 0; // On LOCAL_RESULT_TOPIC
+    uint64_t localMissedTicks = 0; // Intervals a zone went without a local result, outages included
+    double localMaxJitterMs = 0;
+    uint64_t geofenceEnters = 0; // GEOFENCE_TOPIC on the local broker
+    uint64_t geofenceExits = 0;
+    uint64_t geofenceDwells = 0;
+    uint64_t historyReplies = 0;
+    uint64_t historyEntries = 0;
+    uint64_t historyErrors = 0;
+    uint64_t historyDuplicates = 0; // Entries with a time an earlier page of the request had
+    uint64_t historyStuck = 0;      // Requests given up after HISTORY_FOLLOW_MAX pages
+    uint64_t records = 0;
+    uint64_t emptyRecords = 0;
+    uint64_t degradedRecords = 0;
+    uint64_t movingRecords = 0;
+    uint64_t stationaryRecords = 0;
+    double maxMotionDetectMs = 0; // From a stop or walk event to the first result saying so
+    uint32_t motionUndetected = 0; // Events no result confirmed by the end of the run
+    uint64_t ticks = 0;
+    uint64_t missedTicks = 0;
+    uint64_t droppedResults = 0; // Intervals simplify left without a result, within one session
+    double sumDroppedErrorCm = 0;
+    double maxDroppedErrorCm = 0;
+    double maxJitterMs = 0;
+    double sumJitterMs = 0;
+    uint64_t jitterSamples = 0;
+    uint32_t connects = 0;
+    uint32_t failedConnects = 0;
+    double maxReconnectMs = 0;
+    double sumErrorCm = 0;
+    double maxErrorCm = 0;
+    uint64_t errorSamples = 0;
+} stats;
+
+uint64_t lastTickUs = 0;
+uint32_t lastTickSession = 0; // stats.connects when the last tick arrived
+bool haveTick = false;
+
+std::vector<uint64_t> lastLocalUs; // Per zone, 0 before its first local result
+bool tickContiguous = false; // Previous tick seen in the same session, so each zone's window is one interval
+bool waitingForReconnect = false;
+uint64_t gatewayUpAtUs = 0;
+results::Decoder decoder;
+
+// Local JSON results keep the averaging cadence whatever the gateway does:
+// per zone, the gaps between them are checked like those between ticks
+static void on_local_result(const char* payload) {
+    stats.localMessages++;
+    const char* id = strstr(payload, "\"deviceID\":");
+    if (!id || MOTION_ADAPTIVE || SIMPLIFY_TOLERANCE_CM > 0) return;
+    int group = atoi(id + 11) - 1;
+    if (group < 0 || group >= scenario.zones) return;
+    if (lastLocalUs[group]) {
+        double intervalUs = motion_tick_ms() * 1000.0;
+        double gapUs = (double)(sim::nowUs - lastLocalUs[group]);
+        long intervals = lround(gapUs / intervalUs);
+        if (intervals > 1) stats.localMissedTicks += (uint64_t)(intervals - 1);
+        double jitterMs = fabs(gapUs - intervals * intervalUs) / 1000.0;
+        if (jitterMs > stats.localMaxJitterMs) stats.localMaxJitterMs = jitterMs;
+    }
+    lastLocalUs[group] = sim::nowUs;
+}
+
+// Local results are counted. {"f","g","w","o","s"} from tdma.cpp: the layout
+// is taken over when it changes
+void sim::on_broker_publish(const char* topic, const char* payload) {
+    if (!strcmp(topic, LOCAL_RESULT_TOPIC)) on_local_result(payload);
+    if (!strcmp(topic, GEOFENCE_TOPIC)) {
+        if (strstr(payload, "\"enter\"")) stats.geofenceEnters++;
+        else if (strstr(payload, "\"exit\"")) stats.geofenceExits++;
+        else if (strstr(payload, "\"dwell\"")) stats.geofenceDwells++;
+    }
+    if (!scenario.tdma || strcmp(topic, TDMA_TOPIC) != 0) return;
+    StaticJsonDocument<4096> doc;
+    if (deserializeJson(doc, payload)) return;
+    uint64_t frameUs = (doc["f"] | 0UL) * 1000ULL;
+    uint64_t spacingUs = (doc["g"] | 0UL) * 1000ULL;
+    uint64_t slotUs = (doc["w"] | 0UL) * 1000ULL;
+    uint64_t phaseUs = (doc["o"] | 0UL) * 1000ULL;
+    std::vector<int> order;
+    std::vector<uint64_t> measureUs, sendUs;
+    int i = 0;
+    for (JsonVariant v : doc["s"].as<JsonArray>()) {
+        int index = v.as<int>() - 1;
+        if (index >= 0 && index < sensorCount) {
+            order.push_back(index);
+            measureUs.push_back((uint64_t)(i / 3) * spacingUs);
+            sendUs.push_back((uint64_t)(i / 3) * spacingUs + (uint64_t)(i % 3) * slotUs);
+        }
+        i++;
+    }
+    if (frameUs == 0 || order.empty()) return;
+    if (tdmaOn && frameUs == samplePeriodUs && order == tdmaOrder && sendUs == tdmaSendUs) return;
+    tdmaOn = true;
+    tdmaOrder = order;
+    tdmaMeasureUs = measureUs;
+    tdmaSendUs = sendUs;
+    samplePeriodUs = frameUs;
+    tdmaStartUs = sim::nowUs - phaseUs;
+    sampleRound = 1; // The frame in progress has passed its first slots; start with the next
+    sampleCursor = 0;
+}
+
+void sim::on_gateway_connect(bool ok) {
+    if (!ok) {
+        stats.failedConnects++;
+        return;
+    }
+    stats.connects++;
+    if (waitingForReconnect) {
+        double ms = (sim::nowUs - gatewayUpAtUs) / 1000.0;
+        if (ms > stats.maxReconnectMs) stats.maxReconnectMs = ms;
+        waitingForReconnect = false;
+    }
+}
+
+void sim::on_restart_request() {
+    fprintf(stderr, "Firmware called ESP.restart() at %.3f s\n", sim::nowUs / 1e6);
+    exit(2);
+}
+
+// Mean true position of the zone over (fromUs, toUs], false without samples there
+static bool true_mean(int group, uint64_t fromUs, uint64_t toUs, double& x, double& y) {
+    double sx = 0, sy = 0;
+    int n = 0;
+    for (const TruePoint& p : truePath[group]) {
+        if (p.atUs <= fromUs || p.atUs > toUs) continue;
+        sx += p.x;
+        sy += p.y;
+        n++;
+    }
+    if (n == 0) return false;
+    x = sx / n;
+    y = sy / n;
+    return true;
+}
+
+// Simplify: scores the intervals dropped since the zone's previous result
+// against the extrapolation of the two before, then this one against its own
+// interval. Returns this result's error, -1 when it cannot be scored
+static double score_simplified(int group, bool valid, double x, double y) {
+    Received& rx = received[group];
+    uint64_t intervalUs = AVERAGE_INTERVAL_MS * 1000ULL;
+    if (tickContiguous && rx.count > 0 && !MOTION_ADAPTIVE) {
+        for (uint64_t t = rx.atUs[0] + intervalUs; t + intervalUs / 2 < sim::nowUs; t += intervalUs) {
+            double k = rx.count == 2 ? (double)(t - rx.atUs[0]) / (rx.atUs[0] - rx.atUs[1]) : 0;
+            double px = rx.x[0] + (rx.x[0] - rx.x[1]) * k;
+            double py = rx.y[0] + (rx.y[0] - rx.y[1]) * k;
+            double tx, ty;
+            if (!true_mean(group, t - intervalUs, t, tx, ty)) continue;
+            double err = sqrt((px - tx) * (px - tx) + (py - ty) * (py - ty));
+            stats.droppedResults++;
+            stats.sumDroppedErrorCm += err;
+            if (err > stats.maxDroppedErrorCm) stats.maxDroppedErrorCm = err;
+        }
+    }
+    double err = -1, tx, ty;
+    if (valid && tickContiguous && true_mean(group, sim::nowUs - intervalUs, sim::nowUs, tx, ty)) {
+        err = sqrt((x - tx) * (x - tx) + (y - ty) * (y - ty));
+    }
+    if (!valid) {
+        rx.count = 0;
+    } else {
+        rx.atUs[1] = rx.atUs[0];
+        rx.x[1] = rx.x[0];
+        rx.y[1] = rx.y[0];
+        rx.atUs[0] = sim::nowUs;
+        rx.x[0] = x;
+        rx.y[0] = y;
+        if (rx.count < 2) rx.count++;
+    }
+    // Samples older than this result's interval are not needed again
+    std::vector<TruePoint>& path = truePath[group];
+    uint64_t keepFrom = sim::nowUs > intervalUs ? sim::nowUs - intervalUs : 0;
+    size_t old = 0;
+    while (old < path.size() && path[old].atUs <= keepFrom) old++;
+    path.erase(path.begin(), path.begin() + old);
+    return err;
+}
+
+static void on_record(int deviceId, bool valid, bool degraded, int motion, double x, double y) {
+    stats.records++;
+    if (degraded) stats.degradedRecords++;
+    if (motion == MOTION_MOVING) stats.movingRecords++;
+    if (motion == MOTION_STATIONARY) stats.stationaryRecords++;
+    int group = deviceId - 1;
+    if (group < 0 || group >= scenario.zones) return;
+    if (expectedMotion[group] && motion == expectedMotion[group]) {
+        double ms = (sim::nowUs - expectedSinceUs[group]) / 1000.0;
+        if (ms > stats.maxMotionDetectMs) stats.maxMotionDetectMs = ms;
+        expectedMotion[group] = 0;
+    }
+    if (SIMPLIFY_TOLERANCE_CM > 0) {
+        if (!valid) stats.emptyRecords++;
+        double err = score_simplified(group, valid, x, y);
+        if (err >= 0) {
+            stats.sumErrorCm += err;
+            stats.errorSamples++;
+            if (err > stats.maxErrorCm) stats.maxErrorCm = err;
+        }
+    } else if (!valid) {
+        stats.emptyRecords++;
+    } else if (tickContiguous && trueCount[group] > 0) {
+        double ex = x - trueSumX[group] / trueCount[group];
+        double ey = y - trueSumY[group] / trueCount[group];
+        double err = sqrt(ex * ex + ey * ey);
+        stats.sumErrorCm += err;
+        stats.errorSamples++;
+        if (err > stats.maxErrorCm) stats.maxErrorCm = err;
+    }
+    trueSumX[group] = trueSumY[group] = 0;
+    trueCount[group] = 0;
+}
+
+// All zones publish from one run of the averaging task, so every result
+// message at one virtual instant belongs to the same tick
+static void on_tick() {
+    if (haveTick && lastTickUs == sim::nowUs) return;
+    stats.ticks++;
+    tickContiguous = haveTick && lastTickSession == stats.connects;
+    if (tickContiguous) {
+        double intervalUs = motion_tick_ms() * 1000.0;
+        double gapUs = (double)(sim::nowUs - lastTickUs);
+        long intervals = lround(gapUs / intervalUs);
+        if (intervals > 1 && !MOTION_ADAPTIVE && SIMPLIFY_TOLERANCE_CM <= 0) stats.missedTicks += (uint64_t)(intervals - 1);
+        double jitterMs = fabs(gapUs - intervals * intervalUs) / 1000.0;
+        stats.sumJitterMs += jitterMs;
+        stats.jitterSamples++;
+        if (jitterMs > stats.maxJitterMs) stats.maxJitterMs = jitterMs;
+    }
+    haveTick = true;
+    lastTickUs = sim::nowUs;
+    lastTickSession = stats.connects;
+}
+
+// History requests by id, with the entry times their pages returned so far.
+// The hub holds one request, so like a dashboard the gateway asks one at a time.
+struct HistoryChain {
+    std::string request;
+    int pages;
+    std::set<uint32_t> seen;
+};
+static std::map<long, HistoryChain> historyChains;
+static std::deque<std::string> historyQueue;
+static bool historyInFlight = false;
+constexpr int HISTORY_FOLLOW_MAX = 100;
+
+static void send_history_request() {
+    if (historyInFlight || historyQueue.empty()) return;
+    std::string payload = std::move(historyQueue.front());
+    historyQueue.pop_front();
+    StaticJsonDocument<256> doc;
+    if (!deserializeJson(doc, payload)) historyChains[doc["id"] | 0L] = { payload, 0, {} };
+    sim::gatewayInbox.push_back({ HISTORY_TOPIC, payload });
+    historyInFlight = true;
+}
+
+// Replies to history requests: counted, with their entries, and followed
+// page by page like a dashboard would
+static void on_history_reply(const uint8_t* payload, size_t length) {
+    DynamicJsonDocument doc(8192);
+    if (deserializeJson(doc, (const char*)payload, length)) return;
+    stats.historyReplies++;
+    if (doc.containsKey("error")) stats.historyErrors++;
+    JsonArray entries = doc["b"].as<JsonArray>();
+    stats.historyEntries += entries.size();
+    historyInFlight = false;
+    auto chain = historyChains.find(doc["id"] | 0L);
+    if (chain != historyChains.end()) {
+        for (JsonArray entry : entries) {
+            if (!chain->second.seen.insert(entry[0].as<uint32_t>()).second) stats.historyDuplicates++;
+        }
+        if (doc.containsKey("next") && ++chain->second.pages >= HISTORY_FOLLOW_MAX) {
+            stats.historyStuck++;
+        } else if (doc.containsKey("next")) {
+            StaticJsonDocument<256> request;
+            deserializeJson(request, chain->second.request);
+            if (request.containsKey("since")) {
+                // Up to the first reply, or a fast raw tier is never caught up with
+                uint32_t now = doc["now"];
+                request["to"] = strcmp(request["tier"] | "", "raw") ? now : now * 1000 + 999;
+                request.remove("since");
+            }
+            request["from"] = doc["next"].as<uint32_t>();
+            std::string next;
+            serializeJson(request, next);
+            chain->second.request = next;
+            sim::gatewayInbox.push_back({ HISTORY_TOPIC, next });
+            historyInFlight = true;
+        }
+    }
+    send_history_request();
+}
+
+void sim::on_gateway_publish(const char* topic, const uint8_t* payload, size_t length) {
+    if (!strcmp(topic, HISTORY_REPLY_TOPIC)) on_history_reply(payload, length);
+    if (strcmp(topic, OUTPUT_TOPIC) != 0) return;
+    stats.resultMessages++;
+    on_tick();
+    if (results::is_binary(payload, length)) {
+        std::vector<results::Record> records;
+        decoder.decode(payload, length, records);
+        for (const results::Record& r : records) on_record(r.deviceId, r.valid, r.degraded, r.motion, r.x, r.y);
+        return;
+    }
+    StaticJsonDocument<512> doc;
+    if (deserializeJson(doc, (const char*)payload, length)) return;
+    double x = doc["data"]["x"] | 0.0;
+    double y = doc["data"]["y"] | 0.0;
+    double z = doc["data"]["z"] | 0.0;
+    const char* motion = doc["motion"] | "";
+    on_record(doc["deviceID"] | 0, x != 0 || y != 0 || z != 0, doc["degraded"] | false,
+              !strcmp(motion, "moving") ? MOTION_MOVING : (!strcmp(motion, "stationary") ? MOTION_STATIONARY : 0), x, y);
+}
+
+// --- Simulation ---
+
+size_t nextEvent = 0;
+
+static void apply_event(const Event& ev) {
+    switch (ev.kind) {
+        case EV_GATEWAY:
+            if (ev.on && !sim::gatewayUp) {
+                waitingForReconnect = true;
+                gatewayUpAtUs = ev.atUs;
+            }
+            sim::gatewayUp = ev.on;
+            break;
+        case EV_SENSOR:
+            if (ev.sensor >= 1 && ev.sensor <= sensorCount) sensorSilent[ev.sensor - 1] = !ev.on;
+            break;
+        case EV_TARGET: {
+            int group = ev.sensor - 1;
+            if (group < 0 || group >= scenario.zones || ev.on == !stoppedAtUs[group]) break;
+            if (ev.on) {
+                pausedUs[group] += sim::nowUs - stoppedAtUs[group];
+                stoppedAtUs[group] = 0;
+            } else {
+                stoppedAtUs[group] = sim::nowUs ? sim::nowUs : 1;
+            }
+            expectedMotion[group] = ev.on ? MOTION_MOVING : MOTION_STATIONARY;
+            expectedSinceUs[group] = sim::nowUs;
+            break;
+        }
+        case EV_CONTROL:
+            sim::gatewayInbox.push_back({ CONTROL_TOPIC, ev.payload });
+            break;
+        case EV_HISTORY:
+            historyQueue.push_back(ev.payload);
+            send_history_request();
+            break;
+    }
+}
+
+// Hands everything due by now to the stand-ins, in time order
+static void deliver_due() {
+    for (;;) {
+        uint64_t sampleAt = next_sample_us();
+        bool eventDue = nextEvent < scenario.events.size() && scenario.events[nextEvent].atUs <= sim::nowUs;
+        bool sampleDue = sampleAt <= sim::nowUs;
+        if (!eventDue && !sampleDue) return;
+        if (eventDue && (!sampleDue || scenario.events[nextEvent].atUs <= sampleAt)) {
+            apply_event(scenario.events[nextEvent++]);
+            continue;
+        }
+        int sensor = tdmaOn ? tdmaOrder[sampleCursor] : sampleCursor;
+        uint64_t measuredAt = tdmaOn ? sampleAt - (tdmaSendUs[sampleCursor] - tdmaMeasureUs[sampleCursor]) : sampleAt;
+        if (!sensorSilent[sensor]) {
+            emit_sample(sensor, measuredAt);
+            stats.sensorMessages++;
+        }
+        if (++sampleCursor == (tdmaOn ? (int)tdmaOrder.size() : sensorCount)) {
+            sampleCursor = 0;
+            sampleRound++;
+        }
+    }
+}
+
+static uint64_t next_wakeup_us(uint64_t endUs) {
+    uint64_t next = std::min(next_sample_us(), endUs);
+    if (nextEvent < scenario.events.size()) next = std::min(next, scenario.events[nextEvent].atUs);
+    uint32_t idle = scheduler_idle_ms();
+    if (idle != UINT32_MAX) next = std::min(next, ((uint64_t)millis() + idle) * 1000);
+    return next;
+}
+
+static void run(uint64_t endUs) {
+    while (sim::nowUs < endUs) {
+        deliver_due();
+        loop();
+        profiler_flush();
+        uint64_t next = next_wakeup_us(endUs);
+        if (next > sim::nowUs) sim::nowUs = next;
+    }
+}
+
+// --- Report ---
+
+static bool metric_value(const std::string& name, double& v) {
+    if (name == "results") v = (double)stats.records;
+    else if (name == "empty_results") v = (double)stats.emptyRecords;
+    else if (name == "degraded_results") v = (double)stats.degradedRecords;
+    else if (name == "local_messages") v = (double)stats.localMessages;
+    else if (name == "local_missed_ticks") v = (double)stats.localMissedTicks;
+    else if (name == "local_max_jitter_ms") v = stats.localMaxJitterMs;
+    else if (name == "moving_results") v = (double)stats.movingRecords;
+    else if (name == "stationary_results") v = (double)stats.stationaryRecords;
+    else if (name == "motion_detect_ms") v = stats.maxMotionDetectMs;
+    else if (name == "motion_undetected") v = (double)stats.motionUndetected;
+    else if (name == "geofence_enters") v = (double)stats.geofenceEnters;
+    else if (name == "geofence_exits") v = (double)stats.geofenceExits;
+    else if (name == "geofence_dwells") v = (double)stats.geofenceDwells;
+    else if (name == "history_replies") v = (double)stats.historyReplies;
+    else if (name == "history_entries") v = (double)stats.historyEntries;
+    else if (name == "history_errors") v = (double)stats.historyErrors;
+    else if (name == "history_duplicates") v = (double)stats.historyDuplicates;
+    else if (name == "history_stuck") v = (double)stats.historyStuck;
+    else if (name == "missed_ticks") v = (double)stats.missedTicks;
+    else if (name == "max_jitter_ms") v = stats.maxJitterMs;
+    else if (name == "max_reconnect_ms") v = stats.maxReconnectMs;
+    else if (name == "failed_connects") v = stats.failedConnects;
+    else if (name == "mean_error_cm") v = stats.errorSamples ? stats.sumErrorCm / stats.errorSamples : 0;
+    else if (name == "max_error_cm") v = stats.maxErrorCm;
+    else if (name == "dropped_results") v = (double)stats.droppedResults;
+    else if (name == "mean_dropped_error_cm")
+        v = stats.droppedResults ? stats.sumDroppedErrorCm / stats.droppedResults : 0;
+    else if (name == "max_dropped_error_cm") v = stats.maxDroppedErrorCm;
+    else if (name == "fix_cache_hit_pct") {
+        uint32_t hits, misses, bypassed;
+        fix_cache_totals(hits, misses, bypassed);
+        v = hits + misses + bypassed ? 100.0 * hits / (hits + misses + bypassed) : 0;
+    }
+    else return false;
+    return true;
+}
+
+static bool print_report(double wallS) {
+    double simS = sim::nowUs / 1e6;
+    printf("simulated %.0f s (%.2f h) in %.2f s wall, speedup %.0fx\n", simS, simS / 3600, wallS,
+           wallS > 0 ? simS / wallS : 0);
+    printf("sensors: %d in %d zone(s), %llu messages\n", sensorCount, scenario.zones,
+           (unsigned long long)stats.sensorMessages);
+    printf("results: %llu in %llu message(s), %llu empty, %llu degraded, %llu local message(s)\n",
+           (unsigned long long)stats.records, (unsigned long long)stats.resultMessages,
+           (unsigned long long)stats.emptyRecords, (unsigned long long)stats.degradedRecords,
+           (unsigned long long)stats.localMessages);
+    printf("local cadence: %llu missed interval(s), jitter max %.2f ms\n", (unsigned long long)stats.localMissedTicks,
+           stats.localMaxJitterMs);
+    printf("cadence: %llu ticks, jitter avg %.2f ms max %.2f ms, missed_ticks %llu\n", (unsigned long long)stats.ticks,
+           stats.jitterSamples ? stats.sumJitterMs / stats.jitterSamples : 0, stats.maxJitterMs,
+           (unsigned long long)stats.missedTicks);
+    printf("gateway: %u connect(s), %u failed, max reconnect %.0f ms%s\n", stats.connects, stats.failedConnects,
+           stats.maxReconnectMs, waitingForReconnect ? " (still waiting at the end)" : "");
+    for (int group = 0; group < scenario.zones; group++) {
+        if (expectedMotion[group]) stats.motionUndetected++;
+    }
+    printf("motion: %llu moving, %llu stationary result(s), detected within %.0f ms, %u undetected\n",
+           (unsigned long long)stats.movingRecords, (unsigned long long)stats.stationaryRecords,
+           stats.maxMotionDetectMs, stats.motionUndetected);
+    printf("geofence: %llu enter(s), %llu exit(s), %llu dwell(s)\n", (unsigned long long)stats.geofenceEnters,
+           (unsigned long long)stats.geofenceExits, (unsigned long long)stats.geofenceDwells);
+    printf("history: %llu repl(ies), %llu entries, %llu error(s), %llu duplicate(s), %llu stuck\n",
+           (unsigned long long)stats.historyReplies, (unsigned long long)stats.historyEntries,
+           (unsigned long long)stats.historyErrors, (unsigned long long)stats.historyDuplicates,
+           (unsigned long long)stats.historyStuck);
+    uint32_t cacheHits, cacheMisses, cacheBypassed;
+    fix_cache_totals(cacheHits, cacheMisses, cacheBypassed);
+    printf("fix cache: %lu hit(s), %lu miss(es), %lu bypassed\n", (unsigned long)cacheHits, (unsigned long)cacheMisses,
+           (unsigned long)cacheBypassed);
+    printf("error: mean %.2f cm, max %.2f cm over %llu results\n",
+           stats.errorSamples ? stats.sumErrorCm / stats.errorSamples : 0, stats.maxErrorCm,
+           (unsigned long long)stats.errorSamples);
+    if (SIMPLIFY_TOLERANCE_CM > 0) {
+        printf("simplify: %llu dropped result(s), extrapolation error mean %.2f cm, max %.2f cm\n",
+               (unsigned long long)stats.droppedResults,
+               stats.droppedResults ? stats.sumDroppedErrorCm / stats.droppedResults : 0, stats.maxDroppedErrorCm);
+    }
+
+    bool ok = true;
+    for (const Expectation& e : scenario.expects) {
+        double v;
+        if (!metric_value(e.metric, v)) {
+            printf("expect %s (line %d): unknown metric\n", e.metric.c_str(), e.line);
+            ok = false;
+            continue;
+        }
+        bool pass = e.atMost ? v <= e.limit : v >= e.limit;
+        printf("expect %s %s %g: %s (%g)\n", e.metric.c_str(), e.atMost ? "<=" : ">=", e.limit,
+               pass ? "PASS" : "FAIL", v);
+        ok = ok && pass;
+    }
+    return ok;
+}
+
+static double wall_seconds() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char** argv) {
+    const char* logPath = nullptr;
+    const char* profilePath = nullptr;
+    bool usage = argc < 2;
+    for (int i = 2; i < argc && !usage; i += 2) {
+        if (i + 1 >= argc) usage = true;
+        else if (!strcmp(argv[i], "--log")) logPath = argv[i + 1];
+        else if (!strcmp(argv[i], "--profile")) profilePath = argv[i + 1];
+        else usage = true;
+    }
+    if (usage) {
+        fprintf(stderr, "Usage: firmware_sim <scenario.txt> [--log <file>] [--profile <trace.json>]\n");
+        return 1;
+    }
+    if (!load_scenario(argv[1], scenario)) return 1;
+
+    FILE* logFile = nullptr;
+    if (logPath && !(logFile = fopen(logPath, "w"))) {
+        fprintf(stderr, "Cannot open log %s\n", logPath);
+        return 1;
+    }
+    Serial.setOutput(logFile);
+    if (profilePath && !profile::open_trace(profilePath, "firmware_sim")) {
+        fprintf(stderr, profile::profiling_built() ? "Cannot write %s\n" : "%s: built without -DPROFILING\n",
+                profilePath);
+        return 1;
+    }
+
+    // Compile-time settings the scenario overrides, before setup() reads them
+    if (scenario.intervalMs) AVERAGE_INTERVAL_MS = scenario.intervalMs;
+    if (scenario.binary) BINARY_RESULTS = true;
+    if (scenario.motionAdaptive) MOTION_ADAPTIVE = true;
+    if (scenario.simplifyCm > 0) SIMPLIFY_TOLERANCE_CM = (float)scenario.simplifyCm;
+    if (scenario.logLevel >= 0) LOG_LEVEL = scenario.logLevel;
+    else if (!logFile) LOG_LEVEL = LOG_LEVEL_MINIMAL;
+    sim::connectTimeoutMs = scenario.connectTimeoutMs;
+
+    sensorCount = 3 * scenario.zones;
+    samplePeriodUs = (uint64_t)(1e6 / scenario.rateHz);
+    sensorSilent.assign(sensorCount, false);
+    trueSumX.assign(scenario.zones, 0);
+    trueSumY.assign(scenario.zones, 0);
+    trueCount.assign(scenario.zones, 0);
+    lastLocalUs.assign(scenario.zones, 0);
+    pausedUs.assign(scenario.zones, 0);
+    stoppedAtUs.assign(scenario.zones, 0);
+    expectedMotion.assign(scenario.zones, 0);
+    expectedSinceUs.assign(scenario.zones, 0);
+    truePath.assign(scenario.zones, {});
+    received.assign(scenario.zones, Received{});
+
+    double wallStart = wall_seconds();
+    setup();
+    for (int g = 1; g < scenario.zones; g++) {
+        const int ids[3] = { 3 * g + 1, 3 * g + 2, 3 * g + 3 };
+        add_zone(g + 1, ids, S2_a, S3_c, S3_b);
+    }
+    for (const FenceConfig& fence : scenario.fences) geofence_add(fence);
+    for (int id = 1; id <= sensorCount; id++) sim::brokerConnects.push_back("sensor-" + std::to_string(id));
+
+    run(scenario.durationUs);
+    bool ok = print_report(wall_seconds() - wallStart);
+    profile::close_trace();
+    if (logFile) fclose(logFile);
+    return ok ? 0 : 1;
+}
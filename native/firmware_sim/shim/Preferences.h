@@ -0,0 +1,40 @@
+#ifndef SIM_PREFERENCES_H
+#define SIM_PREFERENCES_H
+
+// Stand-in for the ESP32 Preferences (NVS) library, kept in memory for one run
+
+#include <stdint.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include <vector>
+
+class Preferences {
+public:
+    bool begin(const char* name, bool) {
+        space = name;
+        return true;
+    }
+
+    size_t getBytes(const char* key, void* buf, size_t maxLen) {
+        auto it = store.find(space + "/" + key);
+        if (it == store.end()) return 0;
+        size_t len = it->second.size() < maxLen ? it->second.size() : maxLen;
+        memcpy(buf, it->second.data(), len);
+        return len;
+    }
+
+    size_t putBytes(const char* key, const void* value, size_t len) {
+        const uint8_t* p = (const uint8_t*)value;
+        store[space + "/" + key].assign(p, p + len);
+        return len;
+    }
+
+    bool remove(const char* key) { return store.erase(space + "/" + key) > 0; }
+
+private:
+    std::string space;
+    std::map<std::string, std::vector<uint8_t>> store;
+};
+
+#endif // SIM_PREFERENCES_H
@@ -0,0 +1,91 @@
+#ifndef SIM_PUBSUBCLIENT_H
+#define SIM_PUBSUBCLIENT_H
+
+// Stand-in for PubSubClient talking to the simulator's gateway.
+//
+// connect() succeeds while the gateway is up; otherwise it blocks for
+// sim::connectTimeoutMs of virtual time, the way a TCP connect to an absent
+// host without a timeout does, and fails with -2 (MQTT_CONNECT_FAILED). The
+// firmware makes the TCP connect itself first (WiFiClient in WiFi.h), so
+// this only happens when the gateway goes down in between. A session drops (-3,
+// MQTT_CONNECTION_LOST) the first time connected() is asked after the gateway
+// went down. publish() hands the payload to the simulator; loop() delivers
+// queued control messages to the callback.
+
+#include <WiFi.h>
+#include <set>
+#include "sim_world.h"
+
+class PubSubClient {
+public:
+    typedef void (*Callback)(char* topic, byte* payload, unsigned int length);
+
+    explicit PubSubClient(WiFiClient&) {}
+    PubSubClient& setServer(const char*, uint16_t) { return *this; }
+    PubSubClient& setCallback(Callback cb) {
+        callback = cb;
+        return *this;
+    }
+    bool setBufferSize(uint16_t) { return true; }
+    PubSubClient& setSocketTimeout(uint16_t) { return *this; }
+
+    bool connect(const char*) {
+        if (!sim::gatewayUp) {
+            delay(sim::connectTimeoutMs);
+            session = false;
+            rc = -2;
+            sim::on_gateway_connect(false);
+            return false;
+        }
+        session = true;
+        rc = 0;
+        topics.clear();
+        sim::on_gateway_connect(true);
+        return true;
+    }
+
+    bool connected() {
+        if (session && !sim::gatewayUp) {
+            session = false;
+            rc = -3;
+        }
+        return session;
+    }
+
+    int state() const { return rc; }
+
+    bool subscribe(const char* topic) {
+        if (!connected()) return false;
+        topics.insert(topic);
+        return true;
+    }
+
+    bool publish(const char* topic, const char* payload) {
+        return publish(topic, (const uint8_t*)payload, strlen(payload));
+    }
+
+    bool publish(const char* topic, const uint8_t* payload, unsigned int length) {
+        if (!connected()) return false;
+        sim::on_gateway_publish(topic, payload, length);
+        return true;
+    }
+
+    bool loop() {
+        if (!connected()) return false;
+        while (!sim::gatewayInbox.empty()) {
+            sim::Message m = std::move(sim::gatewayInbox.front());
+            sim::gatewayInbox.pop_front();
+            if (!callback || !topics.count(m.topic)) continue;
+            callback(&m.topic[0], (byte*)&m.payload[0], (unsigned int)m.payload.size());
+        }
+        return true;
+    }
+
+private:
+    Callback callback = nullptr;
+    std::set<std::string> topics;
+    bool session = false;
+    int rc = -1; // MQTT_DISCONNECTED
+};
+
+#endif // SIM_PUBSUBCLIENT_H
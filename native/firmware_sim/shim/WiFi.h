@@ -0,0 +1,76 @@
+#ifndef SIM_WIFI_H
+#define SIM_WIFI_H
+
+// Stand-in for the ESP32 WiFi library, plus the core types the network code
+// reaches through it (String, IPAddress, ESP). The station is always connected.
+
+#include <Arduino.h>
+#include <string>
+#include "sim_world.h"
+
+class String : public std::string {
+public:
+    using std::string::string;
+    String(const std::string& s) : std::string(s) {}
+};
+
+class IPAddress {
+public:
+    IPAddress(uint8_t a = 0, uint8_t b = 0, uint8_t c = 0, uint8_t d = 0) : octets{ a, b, c, d } {}
+    explicit IPAddress(uint32_t v) : octets{ (uint8_t)v, (uint8_t)(v >> 8), (uint8_t)(v >> 16), (uint8_t)(v >> 24) } {}
+    operator uint32_t() const {
+        return octets[0] | (uint32_t)octets[1] << 8 | (uint32_t)octets[2] << 16 | (uint32_t)octets[3] << 24;
+    }
+    String toString() const {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%u.%u.%u.%u", octets[0], octets[1], octets[2], octets[3]);
+        return String(buf);
+    }
+
+private:
+    uint8_t octets[4];
+};
+
+enum wl_status_t { WL_IDLE_STATUS = 0, WL_CONNECTED = 3, WL_DISCONNECTED = 6 };
+
+class SimWiFi {
+public:
+    void begin(const char*, const char*) {}
+    void begin(const char*, const char*, int32_t, const uint8_t*, bool = true) {}
+    bool config(IPAddress, IPAddress, IPAddress, IPAddress = IPAddress()) { return true; }
+    bool disconnect(bool = false) { return true; }
+    wl_status_t status() const { return WL_CONNECTED; }
+    IPAddress localIP() const { return IPAddress(192, 168, 1, 50); }
+    IPAddress gatewayIP() const { return IPAddress(192, 168, 1, 1); }
+    IPAddress subnetMask() const { return IPAddress(255, 255, 255, 0); }
+    IPAddress dnsIP(uint8_t = 0) const { return IPAddress(192, 168, 1, 1); }
+    uint8_t* BSSID() {
+        static uint8_t bssid[6] = { 0x02, 0, 0, 0, 0, 1 };
+        return bssid;
+    }
+    int32_t channel() const { return 6; }
+};
+
+// The TCP side of the gateway connection: connect() fails while the gateway
+// is down, after the shorter of its timeout and sim::connectTimeoutMs of
+// virtual time (an absent host), and succeeds at once while it is up
+class WiFiClient {
+public:
+    int connect(const char*, uint16_t, int32_t timeoutMs) {
+        if (sim::gatewayUp) return 1;
+        delay(timeoutMs < (int32_t)sim::connectTimeoutMs ? (uint32_t)timeoutMs : sim::connectTimeoutMs);
+        sim::on_gateway_connect(false);
+        return 0;
+    }
+    void stop() {}
+};
+
+class SimEsp {
+public:
+    void restart() { sim::on_restart_request(); }
+};
+
+extern SimWiFi WiFi;
+extern SimEsp ESP;
+
+#endif // SIM_WIFI_H
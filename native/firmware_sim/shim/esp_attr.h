@@ -0,0 +1,8 @@
+#ifndef SIM_ESP_ATTR_H
+#define SIM_ESP_ATTR_H
+
+// Stand-in for the ESP-IDF memory placement attributes: plain RAM on the host
+
+#define RTC_NOINIT_ATTR
+
+#endif // SIM_ESP_ATTR_H
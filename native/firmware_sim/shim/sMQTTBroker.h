@@ -0,0 +1,59 @@
+#ifndef SIM_SMQTTBROKER_H
+#define SIM_SMQTTBROKER_H
+
+// Stand-in for sMQTTBroker: no sockets, loop() hands the messages the
+// simulator queued for the sensors to the onData callback, in order, and
+// publish() goes straight to the simulated sensors.
+
+#include <WiFi.h>
+#include "sim_world.h"
+
+namespace sMQTT {
+
+class Client {
+public:
+    explicit Client(const std::string& clientId) : clientId(clientId) {}
+    bool isClient() const { return true; }
+    String id() const { return String(clientId); }
+    IPAddress ip() const { return IPAddress(192, 168, 1, 100); }
+
+private:
+    std::string clientId;
+};
+
+} // namespace sMQTT
+
+class sMQTTBroker {
+public:
+    typedef void (*ClientCallback)(const sMQTT::Client&);
+    typedef void (*DataCallback)(const char* topic, const char* payload, uint8_t* payloadRaw, size_t len);
+
+    explicit sMQTTBroker(int) {}
+    void onConnect(ClientCallback cb) { connectCb = cb; }
+    void onDisconnect(ClientCallback cb) { disconnectCb = cb; }
+    void onData(DataCallback cb) { dataCb = cb; }
+    bool publish(const std::string& topic, const std::string& payload, unsigned char = 0, bool = false) {
+        sim::on_broker_publish(topic.c_str(), payload.c_str());
+        return true;
+    }
+
+    void loop() {
+        while (!sim::brokerConnects.empty()) {
+            sMQTT::Client client(sim::brokerConnects.front());
+            sim::brokerConnects.pop_front();
+            if (connectCb) connectCb(client);
+        }
+        while (!sim::brokerInbox.empty()) {
+            sim::Message m = std::move(sim::brokerInbox.front());
+            sim::brokerInbox.pop_front();
+            if (dataCb) dataCb(m.topic.c_str(), m.payload.c_str(), (uint8_t*)&m.payload[0], m.payload.size());
+        }
+    }
+
+private:
+    ClientCallback connectCb = nullptr;
+    ClientCallback disconnectCb = nullptr;
+    DataCallback dataCb = nullptr;
+};
+
+#endif // SIM_SMQTTBROKER_H
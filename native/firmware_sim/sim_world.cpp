@@ -0,0 +1,33 @@
+#include <Arduino.h>
+#include <WiFi.h>
+#include "sim_world.h"
+
+// --- Virtual clock (the shim is built with ARDUINO_SHIM_VIRTUAL_CLOCK) ---
+
+unsigned long millis() {
+    return (unsigned long)(sim::nowUs / 1000);
+}
+
+unsigned long micros() {
+    return (unsigned long)sim::nowUs;
+}
+
+void delay(unsigned long ms) {
+    sim::nowUs += (uint64_t)ms * 1000;
+}
+
+// --- Library stand-in objects ---
+
+SimWiFi WiFi;
+SimEsp ESP;
+
+namespace sim {
+
+uint64_t nowUs = 0;
+std::deque<Message> brokerInbox;
+std::deque<std::string> brokerConnects;
+bool gatewayUp = true;
+uint32_t connectTimeoutMs = 0;
+std::deque<Message> gatewayInbox;
+
+} // namespace sim
@@ -0,0 +1,37 @@
+#ifndef SIM_WORLD_H
+#define SIM_WORLD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <deque>
+#include <string>
+
+// State shared by the simulator driver and the library stand-ins in shim/.
+// Everything runs on one thread, in virtual time.
+namespace sim {
+
+struct Message {
+    std::string topic;
+    std::string payload;
+};
+
+// Virtual clock behind millis(), micros() and delay()
+extern uint64_t nowUs;
+
+// Sensor side: what the stand-in sMQTTBroker delivers on its next loop()
+extern std::deque<Message> brokerInbox;
+extern std::deque<std::string> brokerConnects; // Sensor client ids connecting
+void on_broker_publish(const char* topic, const char* payload); // The firmware publishing to the sensors
+
+// Gateway side, as seen by the stand-in PubSubClient
+extern bool gatewayUp;
+extern uint32_t connectTimeoutMs;        // Virtual time a failed connect() blocks for
+extern std::deque<Message> gatewayInbox; // Messages for the client's subscriptions (CONTROL_TOPIC)
+
+void on_gateway_connect(bool ok);
+void on_gateway_publish(const char* topic, const uint8_t* payload, size_t length);
+void on_restart_request(); // ESP.restart() from the firmware
+
+} // namespace sim
+
+#endif // SIM_WORLD_H
@@ -0,0 +1,293 @@
+/**
+ * Gate peak bench - Device/radar_gates.h on the host.
+ *
+ * Synthetic (default): builds --frames LD2410 engineering frames from one or
+ * two people at random ranges, encodes them as the radar's UART bytes and
+ * runs them through gate_parser_feed() and gate_peaks() as Device.ino does.
+ * A person spreads energy over the gates around its range (a bell about one
+ * gate wide, 60-100 at its centre); a walking one in the moving energies with
+ * a weaker echo in the stationary ones, a standing one in the stationary
+ * energies only. Every gate gets up to --noise of clutter on top. Two people
+ * are at least --separation gates apart, about what 0.75 m gates resolve.
+ * It reports how many people a peak was found for (within --tolerance cm),
+ * the range error of those, the peaks that match nobody, and the detector's
+ * time per frame. --min-detection and --max-false turn it into a check: the
+ * exit status is 1 when either is missed.
+ *
+ * Capture (--capture): reads raw UART bytes recorded from the radar (e.g. a
+ * USB serial adapter on its TX at 256000 baud) and writes one CSV line per
+ * frame: the radar's own moving and stationary target, then the peaks.
+ *
+ * Build (from the repository root):
+ *   g++ -std=c++17 -O2 -IDevice -Inative/common native/gate_bench/gate_bench.cpp Device/radar_gates.cpp \
+ *       native/common/host_log.cpp -o native/bin/gate_bench
+ *
+ * Example:
+ *   native/bin/gate_bench --frames 100000 --targets 2 --noise 10
+ *   native/bin/gate_bench --capture ld2410.bin --out peaks.csv
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "host_log.h"
+#include "radar_gates.h"
+
+// --- Options ---
+struct Options {
+    size_t frames = 10000;
+    int targets = 2;
+    int noise = 10;
+    double separation = 2; // Gates
+    double toleranceCm = 0; // 0: half a gate
+    unsigned seed = 1;
+    double minDetection = -1;
+    double maxFalse = -1;
+    GatePeakConfig config;
+    const char* capturePath = nullptr;
+    const char* outPath = nullptr;
+};
+
+static Options opt;
+
+struct Person {
+    double cm;
+    int energy;
+    bool moving;
+};
+
+// Engineering frame bytes as the radar sends them
+static void encode_frame(const uint8_t* moving, const uint8_t* stationary, const Person* people, int count,
+                         std::vector<uint8_t>& out) {
+    uint8_t body[35] = {};
+    body[0] = 0x01;
+    body[1] = 0xAA;
+    for (int p = 0; p < count; p++) {
+        int at = people[p].moving ? 3 : 6;
+        if (body[at + 2] >= people[p].energy) continue; // The radar reports the strongest of each kind
+        body[2] |= people[p].moving ? 1 : 2;
+        body[at] = (uint8_t)((int)people[p].cm & 0xFF);
+        body[at + 1] = (uint8_t)((int)people[p].cm >> 8);
+        body[at + 2] = (uint8_t)people[p].energy;
+    }
+    body[11] = GATE_COUNT_MAX - 1;
+    body[12] = GATE_COUNT_MAX - 1;
+    memcpy(body + 13, moving, GATE_COUNT_MAX);
+    memcpy(body + 13 + GATE_COUNT_MAX, stationary, GATE_COUNT_MAX);
+    body[33] = 0x55;
+    body[34] = 0x00;
+    const uint8_t head[6] = { 0xF4, 0xF3, 0xF2, 0xF1, sizeof(body), 0 };
+    const uint8_t tail[4] = { 0xF8, 0xF7, 0xF6, 0xF5 };
+    out.insert(out.end(), head, head + 6);
+    out.insert(out.end(), body, body + sizeof(body));
+    out.insert(out.end(), tail, tail + 4);
+}
+
+static int synthetic() {
+    std::mt19937 rng(opt.seed);
+    const double gate = opt.config.gateCm;
+    std::uniform_real_distribution<double> range(gate, (GATE_COUNT_MAX - 1) * gate);
+    std::uniform_int_distribution<int> strength(60, 100), clutter(0, opt.noise);
+    std::bernoulli_distribution walking(0.5);
+    double tolerance = opt.toleranceCm > 0 ? opt.toleranceCm : gate / 2;
+
+    // Frames as one UART stream, with the people of each
+    std::vector<uint8_t> stream;
+    std::vector<Person> truth;
+    for (size_t f = 0; f < opt.frames; f++) {
+        Person people[2];
+        for (int p = 0; p < opt.targets; p++) {
+            do {
+                people[p].cm = range(rng);
+            } while (p == 1 && fabs(people[1].cm - people[0].cm) < opt.separation * gate);
+            people[p].energy = strength(rng);
+            people[p].moving = walking(rng);
+        }
+        uint8_t moving[GATE_COUNT_MAX], stationary[GATE_COUNT_MAX];
+        for (int g = 0; g < GATE_COUNT_MAX; g++) {
+            double m = clutter(rng), s = clutter(rng);
+            for (int p = 0; p < opt.targets; p++) {
+                double apart = ((g + 0.5) * gate - people[p].cm) / (0.6 * gate);
+                double e = people[p].energy * exp(-0.5 * apart * apart);
+                if (people[p].moving) {
+                    m += e;
+                    s += 0.4 * e;
+                } else {
+                    s += e;
+                }
+            }
+            moving[g] = (uint8_t)fmin(100, m);
+            stationary[g] = (uint8_t)fmin(100, s);
+        }
+        encode_frame(moving, stationary, people, opt.targets, stream);
+        truth.insert(truth.end(), people, people + opt.targets);
+    }
+
+    GateParser parser;
+    std::vector<GateFrame> frames;
+    GateFrame frame = {};
+    for (uint8_t b : stream) {
+        if (gate_parser_feed(parser, b, frame)) frames.push_back(frame);
+    }
+    if (frames.size() != opt.frames) {
+        logError("GATES", "%zu of %zu frames parsed.", frames.size(), opt.frames);
+        return 1;
+    }
+
+    size_t found = 0, falsePeaks = 0;
+    double errorSum = 0, errorMax = 0;
+    auto start = std::chrono::steady_clock::now();
+    std::vector<uint8_t> counts(frames.size());
+    std::vector<GatePeak> all(frames.size() * GATE_PEAKS_MAX);
+    for (size_t f = 0; f < frames.size(); f++) {
+        counts[f] = (uint8_t)gate_peaks(frames[f], opt.config, &all[f * GATE_PEAKS_MAX], GATE_PEAKS_MAX);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    for (size_t f = 0; f < frames.size(); f++) {
+        int n = counts[f];
+        const GatePeak* peaks = &all[f * GATE_PEAKS_MAX];
+        bool used[GATE_PEAKS_MAX] = {};
+        for (int p = 0; p < opt.targets; p++) {
+            const Person& person = truth[f * opt.targets + p];
+            int best = -1;
+            for (int k = 0; k < n; k++) {
+                if (used[k]) continue;
+                if (best < 0 || fabs(peaks[k].cm - person.cm) < fabs(peaks[best].cm - person.cm)) best = k;
+            }
+            if (best < 0 || fabs(peaks[best].cm - person.cm) > tolerance) continue;
+            used[best] = true;
+            double err = fabs(peaks[best].cm - person.cm);
+            errorSum += err;
+            errorMax = fmax(errorMax, err);
+            found++;
+        }
+        for (int k = 0; k < n; k++) falsePeaks += !used[k];
+    }
+
+    size_t people = frames.size() * opt.targets;
+    double detection = (double)found / people;
+    double falseRate = (double)falsePeaks / frames.size();
+    printf("%zu frames, %d person(s) each, %d gates of %.0f cm, clutter up to %d\n", frames.size(), opt.targets,
+           GATE_COUNT_MAX, gate, opt.noise);
+    printf("detected  %zu of %zu (%.1f%%) within %.0f cm, error mean %.1f cm max %.1f cm\n", found, people,
+           100 * detection, tolerance, found ? errorSum / found : 0.0, errorMax);
+    printf("false     %zu peak(s), %.3f per frame\n", falsePeaks, falseRate);
+    printf("detector  %.0f ns per frame\n", seconds * 1e9 / frames.size());
+
+    bool ok = true;
+    if (opt.minDetection >= 0 && detection < opt.minDetection) {
+        logError("GATES", "Detection %.3f below %.3f.", detection, opt.minDetection);
+        ok = false;
+    }
+    if (opt.maxFalse >= 0 && falseRate > opt.maxFalse) {
+        logError("GATES", "False peaks %.3f per frame above %.3f.", falseRate, opt.maxFalse);
+        ok = false;
+    }
+    return ok ? 0 : 1;
+}
+
+static int replay_capture() {
+    FILE* in = fopen(opt.capturePath, "rb");
+    if (!in) {
+        logError("GATES", "Cannot open %s", opt.capturePath);
+        return 1;
+    }
+    FILE* out = opt.outPath ? fopen(opt.outPath, "w") : stdout;
+    if (!out) {
+        logError("GATES", "Cannot write %s", opt.outPath);
+        fclose(in);
+        return 1;
+    }
+    fprintf(out, "frame,md,me,sd,se,gates");
+    for (int k = 1; k <= GATE_PEAKS_MAX; k++) fprintf(out, ",c%d,ce%d,moving%d", k, k, k);
+    fprintf(out, "\n");
+
+    GateParser parser;
+    GateFrame frame = {};
+    size_t frames = 0, engineering = 0, peakCount = 0;
+    int c;
+    while ((c = fgetc(in)) != EOF) {
+        if (!gate_parser_feed(parser, (uint8_t)c, frame)) continue;
+        GatePeak peaks[GATE_PEAKS_MAX];
+        int n = frame.gates > 0 ? gate_peaks(frame, opt.config, peaks, GATE_PEAKS_MAX) : 0;
+        fprintf(out, "%zu,%u,%u,%u,%u,%u", frames, frame.movingCm, frame.movingEnergy, frame.stationaryCm,
+                frame.stationaryEnergy, frame.gates);
+        for (int k = 0; k < GATE_PEAKS_MAX; k++) {
+            if (k < n) fprintf(out, ",%d,%u,%u", peaks[k].cm, peaks[k].energy, peaks[k].moving);
+            else fprintf(out, ",,,");
+        }
+        fprintf(out, "\n");
+        frames++;
+        engineering += frame.gates > 0;
+        peakCount += n;
+    }
+    fclose(in);
+    if (out != stdout) fclose(out);
+    logInfo("GATES", "%zu frame(s), %zu with gate energies, %zu peak(s).", frames, engineering, peakCount);
+    return 0;
+}
+
+static void print_usage() {
+    fprintf(stderr,
+            "Usage: gate_bench [options]\n"
+            "  --frames <n>           synthetic: frames (10000)\n"
+            "  --targets <1|2>        synthetic: people per frame (2)\n"
+            "  --noise <energy>       synthetic: clutter per gate, 0-100 (10)\n"
+            "  --separation <gates>   synthetic: least distance between two people (2)\n"
+            "  --tolerance <cm>       synthetic: range error of a detection (half a gate)\n"
+            "  --seed <n>             synthetic: random seed (1)\n"
+            "  --min-detection <0-1>  synthetic: fail below this share of people found\n"
+            "  --max-false <n>        synthetic: fail above this many unmatched peaks per frame\n"
+            "  --gate-cm <cm>         gate resolution (75)\n"
+            "  --training <n>         CFAR training gates per side (2)\n"
+            "  --guard <n>            CFAR guard gates per side (1)\n"
+            "  --scale <x>            CFAR threshold over the neighbourhood mean (2.0)\n"
+            "  --floor <energy>       least peak energy (20)\n"
+            "  --capture <file>       replay raw radar UART bytes instead, CSV per frame\n"
+            "  --out <file.csv>       --capture: write here instead of stdout\n"
+            "  --verbose              more log output\n");
+}
+
+static bool parse_args(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        const char* v = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!strcmp(a, "--verbose")) {
+            setHostLogLevel(LOG_LEVEL_VERBOSE);
+            continue;
+        }
+        if (!v) return false;
+        i++;
+        if (!strcmp(a, "--frames")) opt.frames = (size_t)atoll(v);
+        else if (!strcmp(a, "--targets")) opt.targets = atoi(v);
+        else if (!strcmp(a, "--noise")) opt.noise = atoi(v);
+        else if (!strcmp(a, "--separation")) opt.separation = atof(v);
+        else if (!strcmp(a, "--tolerance")) opt.toleranceCm = atof(v);
+        else if (!strcmp(a, "--seed")) opt.seed = (unsigned)atoi(v);
+        else if (!strcmp(a, "--min-detection")) opt.minDetection = atof(v);
+        else if (!strcmp(a, "--max-false")) opt.maxFalse = atof(v);
+        else if (!strcmp(a, "--gate-cm")) opt.config.gateCm = (uint16_t)atoi(v);
+        else if (!strcmp(a, "--training")) opt.config.training = (uint8_t)atoi(v);
+        else if (!strcmp(a, "--guard")) opt.config.guard = (uint8_t)atoi(v);
+        else if (!strcmp(a, "--scale")) opt.config.scaleQ4 = (uint8_t)lround(atof(v) * 16);
+        else if (!strcmp(a, "--floor")) opt.config.floor = (uint8_t)atoi(v);
+        else if (!strcmp(a, "--capture")) opt.capturePath = v;
+        else if (!strcmp(a, "--out")) opt.outPath = v;
+        else return false;
+    }
+    return opt.frames > 0 && opt.targets >= 1 && opt.targets <= GATE_PEAKS_MAX && opt.noise >= 0 &&
+           opt.noise <= 100 && opt.config.gateCm > 0 && (opt.outPath == nullptr || opt.capturePath != nullptr);
+}
+
+int main(int argc, char** argv) {
+    if (!parse_args(argc, argv)) {
+        print_usage();
+        return 1;
+    }
+    return opt.capturePath ? replay_capture() : synthetic();
+}
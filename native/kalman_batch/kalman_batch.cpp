@@ -0,0 +1,547 @@
+/**
+ * Kalman batch - offline evaluation of recorded tracks, Kalman4Tracking.m in C++.
+ *
+ * Runs the constant-velocity Kalman filter of Kalman4Tracking.m over every log
+ * it is given (files, or directories searched recursively for *.csv and
+ * *.trk) and writes one summary line per track. Files are spread over a pool
+ * of worker threads; each CSV is streamed line by line and each trace is
+ * mapped, so an archive of any size runs in bounded memory.
+ *
+ * The model is the script's, with the sample period as the time unit:
+ *   F = [1 0 1 0; 0 1 0 1; 0 0 1 0; 0 0 0 1], C = [1 0 0 0; 0 1 0 0]
+ *   Q1 = sigma_a * [1/4 0 1/2 0; 0 1/4 0 1/2; 1/2 0 1 0; 0 1/2 0 1]
+ *   Q2 = meas_var * I, Kn(0) = diag(100, 100, 1, 1)
+ *   xhat(1) = [x1; y1; x2 - x1; y2 - y1]
+ * By default (--filter script) sample i runs the script's recursion
+ *   G = F Kn C' inv(C Kn C' + Q2), alpha = y(i) - C xhat(i),
+ *   xhat(i+1) = F xhat(i) + G alpha, Kn = F (Kn - F G C Kn) F' + Q1
+ * and the position written and scored for it is xhat(i+1), the script's
+ * printed estimate: rows 2..N+1 of its table are the rows of a track.
+ * --filter standard is a textbook Kalman filter instead, and not the script:
+ * the covariance update is Kn - Kn C' inv(C Kn C' + Q2) C Kn (the script's
+ * applies F twice to the gain and over-shrinks the velocity covariance), and
+ * the position is the filtered estimate xhat(i) + Kn C' inv(...) alpha of
+ * sample i rather than the prediction for the next one.
+ *
+ * Recognised layouts, decided from the first line:
+ *   - a header naming x and y (x_mean / y_mean also work), e.g. the central
+ *     node's "time,d1,d2,d3,x,y,z" logs. A deviceID column splits the file
+ *     into one track per device; x_ref / y_ref (or ref_x, x_true, ...) are
+ *     the reference for RMSE, like columns D and E of the script's sheet.
+ *   - no header, quoted timestamp first: "time",x,y,z (server0 sim-device logs)
+ *   - no header, numbers only: x,y,z,r (server0 logs)
+ *   - .trk traces from trace_convert, read through the mapping with one track
+ *     per deviceID and no parsing at all
+ * --cols and --ref override the detected measurement and reference columns.
+ *
+ * Summary columns (units of the input, cm for every log in this repository):
+ *   innovation_rms   RMS of |y - C xhat|, the prediction error per sample
+ *   correction_rms   RMS distance between each measurement and its estimate
+ *   path_raw/kalman  Length of the measured and filtered trajectories; their
+ *                    ratio shows how much jitter the filter removes
+ *   rmse_raw/kalman  Only with a reference: RMSE of measurements and estimates
+ *
+ * Build (from the repository root):
+ *   g++ -std=c++17 -O2 -pthread -Inative/common native/kalman_batch/kalman_batch.cpp \
+ *       native/common/trace_format.cpp native/common/host_log.cpp -o native/bin/kalman_batch
+ *
+ * Example:
+ *   native/bin/kalman_batch --out summary.csv system/central_node/data system/server0/data
+ */
+
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "host_log.h"
+#include "trace_format.h"
+
+namespace fs = std::filesystem;
+
+// --- Options ---
+struct Options {
+    std::vector<std::string> inputs;
+    const char* out = nullptr;       // Summary CSV, stdout if unset
+    const char* tracksDir = nullptr; // Per-file filtered tracks
+    unsigned threads = 0;            // 0: one per hardware thread
+    double sigmaA = 0.04;
+    double measVar = 4.0;
+    bool standardFilter = false;     // --filter standard instead of the script's
+    int colX = -1, colY = -1;        // Overrides, -1 to detect
+    int refX = -1, refY = -1;
+};
+
+static Options opt;
+
+// --- Filter ---
+struct Kalman {
+    double s[4] = {};    // x, y, vx, vy
+    double P[4][4] = {}; // Kn of the script
+    double Q[4][4] = {};
+    double r = 4.0;
+
+    void init(double x1, double y1, double x2, double y2, double sigmaA, double measVar) {
+        s[0] = x1;
+        s[1] = y1;
+        s[2] = x2 - x1;
+        s[3] = y2 - y1;
+        memset(P, 0, sizeof(P));
+        P[0][0] = P[1][1] = 100.0;
+        P[2][2] = P[3][3] = 1.0;
+        static const double q[4][4] = {
+            { 0.25, 0, 0.5, 0 }, { 0, 0.25, 0, 0.5 }, { 0.5, 0, 1, 0 }, { 0, 0.5, 0, 1 } };
+        for (int i = 0; i < 4; i++)
+            for (int j = 0; j < 4; j++) Q[i][j] = sigmaA * q[i][j];
+        r = measVar;
+    }
+
+    // One sample; returns the position for it (see --filter) and the innovation
+    void step(double mx, double my, double& fx, double& fy, double& ax, double& ay) {
+        // S = C P C' + R, 2x2
+        double s00 = P[0][0] + r, s01 = P[0][1], s10 = P[1][0], s11 = P[1][1] + r;
+        double det = s00 * s11 - s01 * s10;
+        double i00 = s11 / det, i01 = -s01 / det, i10 = -s10 / det, i11 = s00 / det;
+        // Kf = P C' inv(S), 4x2
+        double k[4][2];
+        for (int i = 0; i < 4; i++) {
+            k[i][0] = P[i][0] * i00 + P[i][1] * i10;
+            k[i][1] = P[i][0] * i01 + P[i][1] * i11;
+        }
+        ax = mx - s[0];
+        ay = my - s[1];
+        double f[4];
+        for (int i = 0; i < 4; i++) f[i] = s[i] + k[i][0] * ax + k[i][1] * ay;
+
+        // M = Kf C P: the covariance removed by the measurement
+        double m[4][4];
+        for (int i = 0; i < 4; i++)
+            for (int j = 0; j < 4; j++) m[i][j] = k[i][0] * P[0][j] + k[i][1] * P[1][j];
+        if (!opt.standardFilter) {
+            // F G C Kn = F F Kf C Kn; F adds row i+2 to row i
+            for (int pass = 0; pass < 2; pass++)
+                for (int j = 0; j < 4; j++) {
+                    m[0][j] += m[2][j];
+                    m[1][j] += m[3][j];
+                }
+        }
+        double a[4][4];
+        for (int i = 0; i < 4; i++)
+            for (int j = 0; j < 4; j++) a[i][j] = P[i][j] - m[i][j];
+        // P = F A F' + Q
+        double fa[4][4];
+        for (int j = 0; j < 4; j++) {
+            fa[0][j] = a[0][j] + a[2][j];
+            fa[1][j] = a[1][j] + a[3][j];
+            fa[2][j] = a[2][j];
+            fa[3][j] = a[3][j];
+        }
+        for (int i = 0; i < 4; i++) {
+            P[i][0] = fa[i][0] + fa[i][2] + Q[i][0];
+            P[i][1] = fa[i][1] + fa[i][3] + Q[i][1];
+            P[i][2] = fa[i][2] + Q[i][2];
+            P[i][3] = fa[i][3] + Q[i][3];
+        }
+
+        // xhat' = F (xhat + Kf alpha) = F xhat + G alpha
+        s[0] = f[0] + f[2];
+        s[1] = f[1] + f[3];
+        s[2] = f[2];
+        s[3] = f[3];
+        fx = opt.standardFilter ? f[0] : s[0];
+        fy = opt.standardFilter ? f[1] : s[1];
+    }
+};
+
+// --- Per-track state ---
+struct Track {
+    std::string device; // Empty for single-track files
+    Kalman kf;
+    int pending = 0;    // Samples held until the velocity can be initialised
+    double held[2][4];  // mx, my, rx, ry
+    bool hasRef = false;
+    uint64_t samples = 0;
+    double innovSq = 0, corrSq = 0;
+    double pathRaw = 0, pathKalman = 0;
+    double rawSq = 0, kalmanSq = 0;
+    double lastMx = 0, lastMy = 0, lastFx = 0, lastFy = 0;
+};
+
+struct FileResult {
+    std::string path;
+    uint64_t skipped = 0;
+    bool failed = false;
+    std::vector<Track> tracks;
+};
+
+struct Layout {
+    int x = -1, y = -1, refX = -1, refY = -1, device = -1;
+    bool header = false;
+};
+
+static std::string field_name(const char* f) {
+    std::string s;
+    for (; *f; f++) {
+        if (*f == '"' || *f == '\'' || isspace((unsigned char)*f)) continue;
+        s += (char)tolower((unsigned char)*f);
+    }
+    return s;
+}
+
+static bool parse_number(const char* f, double& v) {
+    while (isspace((unsigned char)*f)) f++;
+    char* end;
+    v = strtod(f, &end);
+    if (end == f) return false;
+    while (isspace((unsigned char)*end)) end++;
+    return *end == '\0' && isfinite(v);
+}
+
+// Splits a CSV line in place; no quoted commas occur in these logs
+static void split_fields(char* line, std::vector<char*>& fields) {
+    fields.clear();
+    size_t len = strlen(line);
+    while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) line[--len] = '\0';
+    char* p = line;
+    fields.push_back(p);
+    for (; *p; p++) {
+        if (*p == ',') {
+            *p = '\0';
+            fields.push_back(p + 1);
+        }
+    }
+}
+
+static int find_column(const std::vector<std::string>& names, std::initializer_list<const char*> wanted) {
+    for (const char* w : wanted) {
+        auto it = std::find(names.begin(), names.end(), w);
+        if (it != names.end()) return (int)(it - names.begin());
+    }
+    return -1;
+}
+
+static Layout detect_layout(const std::vector<char*>& fields) {
+    Layout l;
+    std::vector<std::string> names;
+    for (const char* f : fields) names.push_back(field_name(f));
+    l.x = find_column(names, { "x", "x_mean" });
+    l.y = find_column(names, { "y", "y_mean" });
+    if (l.x >= 0 && l.y >= 0) {
+        l.header = true;
+        l.refX = find_column(names, { "x_ref", "ref_x", "x_true", "true_x" });
+        l.refY = find_column(names, { "y_ref", "ref_y", "y_true", "true_y" });
+        l.device = find_column(names, { "deviceid", "device" });
+    } else {
+        double v;
+        bool timestamped = !fields.empty() && !parse_number(fields[0], v);
+        l.x = timestamped ? 1 : 0;
+        l.y = timestamped ? 2 : 1;
+    }
+    if (opt.colX >= 0) {
+        l.x = opt.colX;
+        l.y = opt.colY;
+    }
+    if (opt.refX >= 0) {
+        l.refX = opt.refX;
+        l.refY = opt.refY;
+    }
+    return l;
+}
+
+// --- Filtering ---
+static FILE* open_track_file(const std::string& path) {
+    if (!opt.tracksDir) return nullptr;
+    std::string name = fs::path(path).stem().string() + ".kalman.csv";
+    std::string out = (fs::path(opt.tracksDir) / name).string();
+    FILE* f = fopen(out.c_str(), "w");
+    if (!f) {
+        logError("KALMAN", "Cannot write %s", out.c_str());
+        return nullptr;
+    }
+    fprintf(f, "device,sample,x_meas,y_meas,x_kalman,y_kalman,vx,vy\n");
+    return f;
+}
+
+static void filter_sample(Track& t, double mx, double my, double rx, double ry, FILE* tracks) {
+    double fx, fy, ax, ay;
+    t.kf.step(mx, my, fx, fy, ax, ay);
+    t.innovSq += ax * ax + ay * ay;
+    t.corrSq += (fx - mx) * (fx - mx) + (fy - my) * (fy - my);
+    if (t.samples > 0) {
+        t.pathRaw += hypot(mx - t.lastMx, my - t.lastMy);
+        t.pathKalman += hypot(fx - t.lastFx, fy - t.lastFy);
+    }
+    if (t.hasRef) {
+        t.rawSq += (mx - rx) * (mx - rx) + (my - ry) * (my - ry);
+        t.kalmanSq += (fx - rx) * (fx - rx) + (fy - ry) * (fy - ry);
+    }
+    t.lastMx = mx;
+    t.lastMy = my;
+    t.lastFx = fx;
+    t.lastFy = fy;
+    if (tracks) {
+        fprintf(tracks, "%s,%llu,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f\n", t.device.c_str(), (unsigned long long)t.samples, mx,
+                my, fx, fy, t.kf.s[2], t.kf.s[3]);
+    }
+    t.samples++;
+}
+
+// The script starts the velocity from the first two samples, then filters both
+static void add_sample(Track& t, double mx, double my, double rx, double ry, FILE* tracks) {
+    if (t.pending < 2 && t.samples == 0) {
+        double* h = t.held[t.pending++];
+        h[0] = mx;
+        h[1] = my;
+        h[2] = rx;
+        h[3] = ry;
+        if (t.pending < 2) return;
+        t.kf.init(t.held[0][0], t.held[0][1], t.held[1][0], t.held[1][1], opt.sigmaA, opt.measVar);
+        for (int i = 0; i < 2; i++) filter_sample(t, t.held[i][0], t.held[i][1], t.held[i][2], t.held[i][3], tracks);
+        return;
+    }
+    filter_sample(t, mx, my, rx, ry, tracks);
+}
+
+// A track that ended after one sample is filtered with zero velocity
+static void finish_track(Track& t, FILE* tracks) {
+    if (t.samples == 0 && t.pending == 1) {
+        const double* h = t.held[0];
+        t.kf.init(h[0], h[1], h[0], h[1], opt.sigmaA, opt.measVar);
+        filter_sample(t, h[0], h[1], h[2], h[3], tracks);
+    }
+}
+
+static Track& track_for(FileResult& result, std::unordered_map<std::string, size_t>& trackIndex,
+                        const std::string& device, bool hasRef) {
+    auto it = trackIndex.find(device);
+    if (it == trackIndex.end()) {
+        it = trackIndex.emplace(device, result.tracks.size()).first;
+        result.tracks.emplace_back();
+        result.tracks.back().device = device;
+        result.tracks.back().hasRef = hasRef;
+    }
+    return result.tracks[it->second];
+}
+
+static void process_trace(FileResult& result) {
+    trace::TraceReader reader;
+    if (!reader.open(result.path.c_str())) {
+        logError("KALMAN", "%s: %s", result.path.c_str(), reader.error().c_str());
+        result.failed = true;
+        return;
+    }
+    FILE* tracks = open_track_file(result.path);
+    std::unordered_map<std::string, size_t> trackIndex;
+    const int32_t* device = reader.device();
+    const float* x = reader.values(trace::COL_X);
+    const float* y = reader.values(trace::COL_Y);
+    int32_t lastDevice = 0;
+    Track* t = nullptr;
+    for (uint64_t i = 0; i < reader.rows(); i++) {
+        if (!t || device[i] != lastDevice) {
+            lastDevice = device[i];
+            t = &track_for(result, trackIndex, device[i] != 0 ? std::to_string(device[i]) : std::string(), false);
+        }
+        add_sample(*t, x[i], y[i], 0, 0, tracks);
+    }
+    for (Track& k : result.tracks) finish_track(k, tracks);
+    if (tracks) fclose(tracks);
+    logVerbose("KALMAN", "%s: %zu track(s) from %llu rows", result.path.c_str(), result.tracks.size(),
+               (unsigned long long)reader.rows());
+}
+
+static void process_file(FileResult& result) {
+    if (fs::path(result.path).extension() == ".trk") {
+        process_trace(result);
+        return;
+    }
+    FILE* in = fopen(result.path.c_str(), "r");
+    if (!in) {
+        logError("KALMAN", "Cannot open %s", result.path.c_str());
+        result.failed = true;
+        return;
+    }
+    FILE* tracks = open_track_file(result.path);
+    std::unordered_map<std::string, size_t> trackIndex;
+    std::vector<char*> fields;
+    Layout layout;
+    char* line = nullptr;
+    size_t cap = 0;
+    bool first = true;
+    while (getline(&line, &cap, in) > 0) {
+        split_fields(line, fields);
+        if (first) {
+            first = false;
+            layout = detect_layout(fields);
+            if (layout.header) continue;
+        }
+        int needed = std::max({ layout.x, layout.y, layout.refX, layout.refY, layout.device });
+        double mx, my, rx = 0, ry = 0;
+        bool hasRef = layout.refX >= 0 && layout.refY >= 0;
+        if ((int)fields.size() <= needed || !parse_number(fields[layout.x], mx) || !parse_number(fields[layout.y], my) ||
+            (hasRef && (!parse_number(fields[layout.refX], rx) || !parse_number(fields[layout.refY], ry)))) {
+            result.skipped++;
+            continue;
+        }
+        std::string device = layout.device >= 0 ? field_name(fields[layout.device]) : std::string();
+        add_sample(track_for(result, trackIndex, device, hasRef), mx, my, rx, ry, tracks);
+    }
+    free(line);
+    fclose(in);
+    for (Track& t : result.tracks) finish_track(t, tracks);
+    if (tracks) fclose(tracks);
+    logVerbose("KALMAN", "%s: %zu track(s), %llu line(s) skipped", result.path.c_str(), result.tracks.size(),
+               (unsigned long long)result.skipped);
+}
+
+// --- Input discovery ---
+static bool collect_inputs(std::vector<FileResult>& files) {
+    for (const std::string& input : opt.inputs) {
+        std::error_code ec;
+        if (fs::is_directory(input, ec)) {
+            std::vector<std::string> found;
+            for (auto it = fs::recursive_directory_iterator(input, ec); !ec && it != fs::recursive_directory_iterator();
+                 it.increment(ec)) {
+                if (it->is_regular_file(ec) &&
+                    (it->path().extension() == ".csv" || it->path().extension() == ".trk"))
+                    found.push_back(it->path().string());
+            }
+            std::sort(found.begin(), found.end());
+            for (std::string& path : found) {
+                files.emplace_back();
+                files.back().path = std::move(path);
+            }
+        } else if (fs::is_regular_file(input, ec)) {
+            files.emplace_back();
+            files.back().path = input;
+        } else {
+            logError("KALMAN", "No such file or directory: %s", input.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+// --- Output ---
+static void write_summary(FILE* out, const std::vector<FileResult>& files) {
+    fprintf(out, "file,device,samples,skipped,innovation_rms,correction_rms,path_raw,path_kalman,rmse_raw,rmse_kalman\n");
+    for (const FileResult& file : files) {
+        if (file.failed) continue;
+        for (const Track& t : file.tracks) {
+            double n = t.samples > 0 ? (double)t.samples : 1.0;
+            fprintf(out, "%s,%s,%llu,%llu,%.3f,%.3f,%.1f,%.1f,", file.path.c_str(), t.device.c_str(),
+                    (unsigned long long)t.samples, (unsigned long long)file.skipped, sqrt(t.innovSq / n),
+                    sqrt(t.corrSq / n), t.pathRaw, t.pathKalman);
+            if (t.hasRef) fprintf(out, "%.3f,%.3f\n", sqrt(t.rawSq / n), sqrt(t.kalmanSq / n));
+            else fprintf(out, ",\n");
+        }
+    }
+}
+
+static void print_usage() {
+    fprintf(stderr,
+            "Usage: kalman_batch [options] <file.csv|file.trk|directory>...\n"
+            "  --out <file>           summary CSV (stdout)\n"
+            "  --tracks <dir>         also write <name>.kalman.csv with the filtered track per input\n"
+            "  --threads <n>          worker threads (one per hardware thread)\n"
+            "  --sigma-a <v>          process noise scale sigma_a (0.04)\n"
+            "  --meas-var <v>         measurement noise variance Q2 (4)\n"
+            "  --cols <x,y>           measurement columns, 0-based (detected)\n"
+            "  --ref <x,y>            reference columns for RMSE, 0-based (x_ref,y_ref header)\n"
+            "  --filter <mode>        script: Kalman4Tracking.m as written, xhat(i+1) per sample (default)\n"
+            "                         standard: textbook covariance update, filtered estimate per sample\n"
+            "  --verbose              per-file log lines\n");
+}
+
+static bool parse_args(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        if (a[0] != '-') {
+            opt.inputs.push_back(a);
+            continue;
+        }
+        if (!strcmp(a, "--verbose")) {
+            setHostLogLevel(LOG_LEVEL_VERBOSE);
+            continue;
+        }
+        const char* v = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!v) return false;
+        i++;
+        if (!strcmp(a, "--out")) opt.out = v;
+        else if (!strcmp(a, "--tracks")) opt.tracksDir = v;
+        else if (!strcmp(a, "--threads")) opt.threads = (unsigned)atoi(v);
+        else if (!strcmp(a, "--sigma-a")) opt.sigmaA = atof(v);
+        else if (!strcmp(a, "--meas-var")) opt.measVar = atof(v);
+        else if (!strcmp(a, "--filter")) {
+            if (strcmp(v, "script") && strcmp(v, "standard")) return false;
+            opt.standardFilter = !strcmp(v, "standard");
+        }
+        else if (!strcmp(a, "--cols")) {
+            if (sscanf(v, "%d,%d", &opt.colX, &opt.colY) != 2) return false;
+        }
+        else if (!strcmp(a, "--ref")) {
+            if (sscanf(v, "%d,%d", &opt.refX, &opt.refY) != 2) return false;
+        }
+        else return false;
+    }
+    return !opt.inputs.empty() && opt.sigmaA >= 0 && opt.measVar > 0 && (opt.colX < 0) == (opt.colY < 0) &&
+           (opt.refX < 0) == (opt.refY < 0);
+}
+
+int main(int argc, char** argv) {
+    if (!parse_args(argc, argv)) {
+        print_usage();
+        return 1;
+    }
+    std::vector<FileResult> files;
+    if (!collect_inputs(files)) return 1;
+    if (files.empty()) {
+        logError("KALMAN", "No CSV files found.");
+        return 1;
+    }
+    if (opt.tracksDir) {
+        std::error_code ec;
+        fs::create_directories(opt.tracksDir, ec);
+    }
+    FILE* out = opt.out ? fopen(opt.out, "w") : stdout;
+    if (!out) {
+        logError("KALMAN", "Cannot write %s", opt.out);
+        return 1;
+    }
+
+    unsigned threads = opt.threads ? opt.threads : std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min<unsigned>(threads, (unsigned)files.size());
+    auto start = std::chrono::steady_clock::now();
+
+    // Workers take the next unprocessed file; results land in input order
+    std::atomic<size_t> next{ 0 };
+    std::vector<std::thread> pool;
+    for (unsigned i = 0; i < threads; i++) {
+        pool.emplace_back([&]() {
+            for (size_t f = next++; f < files.size(); f = next++) process_file(files[f]);
+        });
+    }
+    for (std::thread& t : pool) t.join();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    write_summary(out, files);
+    if (out != stdout) fclose(out);
+
+    uint64_t samples = 0;
+    size_t failed = 0;
+    for (const FileResult& file : files) {
+        failed += file.failed ? 1 : 0;
+        for (const Track& t : file.tracks) samples += t.samples;
+    }
+    logInfo("KALMAN", "%zu file(s), %llu samples in %.2f s on %u thread(s).", files.size() - failed,
+            (unsigned long long)samples, seconds, threads);
+    return failed > 0 ? 1 : 0;
+}
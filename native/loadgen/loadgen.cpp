@@ -0,0 +1,624 @@
+/**
+ * Load generator - many simulated LD2410 sensors against a central node.
+ *
+ * Each simulated sensor is its own MQTT connection to the central node's
+ * broker port (1886) and publishes {"id":N,"d":D} on SENSOR_TOPIC, exactly
+ * like Device.ino. Sensors are grouped in anchor groups of three; the three
+ * ranges of a group are derived from a synthetic trajectory and the anchor
+ * geometry (S1 at the origin, S2 at (a,0,0), S3 at (c,b,0)), minus
+ * DISTANCE_OFFSET so the central node's offset correction lands back on the
+ * true range.
+ *
+ * A separate connection subscribes to OUTPUT_TOPIC on the gateway broker
+ * (1885) and measures:
+ *   - throughput: sensor messages sent and results received per second
+ *   - latency: from the newest triplet of a group to its next result
+ *     ("fresh") and from the oldest triplet still waiting ("oldest"),
+ *     which includes the averaging window.
+ *
+ * With --ramp-step the per-sensor rate is raised every --ramp-every seconds
+ * and each step is reported on its own line, which is how a firmware build's
+ * saturation point shows up: results/s stops tracking the expected rate and
+ * latency percentiles climb.
+ *
+ * Sensor ids are allocated as 3*g+1 .. 3*g+3 for group g and results are
+ * expected with deviceID g+1.
+ *
+ * With --targets 2 every group holds a second person, mirrored through the
+ * room centre, and sensors add both ranges as candidates ("c":[d1,d2]) for
+ * a central node in multi-target mode; the report then shows how many
+ * confirmed targets each result carries.
+ *
+ * Results may be JSON or the central node's binary format (BINARY_RESULTS),
+ * told apart per message; "uplink" reports the OUTPUT_TOPIC bytes either way.
+ *
+ * Build (from the repository root):
+ *   g++ -std=c++17 -O2 -Inative/common native/loadgen/loadgen.cpp \
+ *       native/common/mqtt_codec.cpp native/common/net_util.cpp native/common/host_log.cpp \
+ *       native/common/result_decoder.cpp \
+ *       -o native/bin/loadgen
+ *
+ * Local run against the broker stand-in and the Node.js central node:
+ *   native/bin/broker_standin --port 1885 &
+ *   node system/central_node/central_node.js &
+ *   native/bin/loadgen --groups 1 --rate 5 --ramp-step 5 --ramp-every 10 --duration 60
+ */
+
+#include <math.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <algorithm>
+#include <queue>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "host_log.h"
+#include "mqtt_codec.h"
+#include "net_util.h"
+#include "result_decoder.h"
+
+// --- Options ---
+struct Options {
+    const char* host = "127.0.0.1";
+    uint16_t port = 1886;
+    const char* gatewayHost = "127.0.0.1";
+    uint16_t gatewayPort = 1885;
+    const char* sensorTopic = "/node/central";
+    const char* outputTopic = "/central/d_gateway";
+    int groups = 1;
+    double rateHz = 3.33; // Device.ino publishes every 600 ms, device*.js every 300 ms
+    double rampStepHz = 0;
+    double rampEveryS = 10;
+    double durationS = 30;
+    double reportS = 5;
+    double intervalMs = 3000; // AVERAGE_INTERVAL_MS of the build under test
+    const char* trajectory = "circle";
+    double speedCmS = 50;
+    double heightCm = 120;
+    double jitterCm = 0;
+    int targets = 1;
+    float S2_a = 370.0f;
+    float S3_c = 0.0f;
+    float S3_b = 110.0f;
+    float distanceOffset = 35.0f;
+    unsigned seed = 1;
+};
+
+enum TrajectoryKind { TRAJ_STATIC, TRAJ_CIRCLE, TRAJ_LINE, TRAJ_RANDOM };
+
+struct Sensor {
+    int id = 0;
+    int group = 0;
+    int slot = 0;
+    Connection conn;
+    bool connected = false;
+    uint64_t reconnectAtUs = 0;
+};
+
+struct Group {
+    uint8_t sentMask = 0;
+    uint64_t lastTripletUs = 0;
+    uint64_t pendingSinceUs = 0;
+    double phase = 0;
+    // Random waypoint state
+    double px = 0, py = 0, tx = 0, ty = 0;
+    uint64_t lastMoveUs = 0;
+};
+
+struct StepStats {
+    uint64_t sent = 0;
+    uint64_t backpressured = 0;
+    uint64_t results = 0;
+    uint64_t emptyResults = 0;
+    uint64_t trackedTargets = 0;
+    uint64_t resultBytes = 0; // OUTPUT_TOPIC payload bytes, JSON or binary
+    std::vector<double> freshMs;
+    std::vector<double> oldestMs;
+};
+
+static volatile sig_atomic_t running = 1;
+static Options opt;
+static TrajectoryKind trajectory = TRAJ_CIRCLE;
+static int epollFd = -1;
+static std::vector<Sensor> sensors;
+static std::vector<Group> groups;
+static std::unordered_map<int, size_t> sensorByFd;
+static Connection gateway;
+static bool gatewayConnected = false;
+static std::mt19937 rng;
+static std::normal_distribution<double> noise(0.0, 1.0);
+static results::Decoder resultDecoder;
+
+static void on_signal(int) {
+    running = 0;
+}
+
+// --- Trajectories ---
+
+static void target_position(Group& g, uint64_t nowUs, double& x, double& y, double& z) {
+    double t = nowUs / 1e6;
+    double cx = (opt.S2_a + opt.S3_c) / 2.0;
+    double cy = opt.S3_b / 2.0;
+    double spanX = opt.S2_a * 0.6;
+    double spanY = opt.S3_b * 0.6;
+    z = opt.heightCm;
+    switch (trajectory) {
+        case TRAJ_STATIC:
+            x = cx;
+            y = cy;
+            break;
+        case TRAJ_CIRCLE: {
+            double r = std::min(spanX, spanY) / 2.0;
+            double w = opt.speedCmS / r;
+            x = cx + r * cos(w * t + g.phase);
+            y = cy + r * sin(w * t + g.phase);
+            break;
+        }
+        case TRAJ_LINE: {
+            double period = 2.0 * spanX / opt.speedCmS;
+            double u = fmod(t / period + g.phase / (2 * M_PI), 1.0);
+            double tri = u < 0.5 ? u * 2.0 : (1.0 - u) * 2.0;
+            x = cx - spanX / 2.0 + tri * spanX;
+            y = cy;
+            break;
+        }
+        case TRAJ_RANDOM: {
+            if (g.lastMoveUs == 0) {
+                g.px = g.tx = cx;
+                g.py = g.ty = cy;
+                g.lastMoveUs = nowUs;
+            }
+            double dt = (nowUs - g.lastMoveUs) / 1e6;
+            g.lastMoveUs = nowUs;
+            double dx = g.tx - g.px, dy = g.ty - g.py;
+            double dist = sqrt(dx * dx + dy * dy);
+            double step = opt.speedCmS * dt;
+            if (dist <= step) {
+                g.px = g.tx;
+                g.py = g.ty;
+                std::uniform_real_distribution<double> ux(cx - spanX / 2.0, cx + spanX / 2.0);
+                std::uniform_real_distribution<double> uy(cy - spanY / 2.0, cy + spanY / 2.0);
+                g.tx = ux(rng);
+                g.ty = uy(rng);
+            } else {
+                g.px += dx / dist * step;
+                g.py += dy / dist * step;
+            }
+            x = g.px;
+            y = g.py;
+            break;
+        }
+    }
+}
+
+// Raw range as a sensor would report it: true range minus the configured offset.
+// Target 1 is target 0 mirrored through the room centre.
+static int sensor_range(const Sensor& s, uint64_t nowUs, int target = 0) {
+    double x = 0, y = 0, z = 0;
+    target_position(groups[s.group], nowUs, x, y, z);
+    if (target == 1) {
+        x = (opt.S2_a + opt.S3_c) - x;
+        y = opt.S3_b - y;
+    }
+    double ax = 0, ay = 0;
+    if (s.slot == 1) ax = opt.S2_a;
+    if (s.slot == 2) {
+        ax = opt.S3_c;
+        ay = opt.S3_b;
+    }
+    double d = sqrt((x - ax) * (x - ax) + (y - ay) * (y - ay) + z * z) - opt.distanceOffset;
+    if (opt.jitterCm > 0) d += noise(rng) * opt.jitterCm;
+    return d < 0 ? 0 : (int)lround(d);
+}
+
+// --- Connections ---
+
+static void watch(Connection& c, uint32_t events, bool add) {
+    epoll_event ev{};
+    ev.events = events;
+    ev.data.fd = c.fd;
+    epoll_ctl(epollFd, add ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, c.fd, &ev);
+}
+
+static void sync_interest(Connection& c) {
+    watch(c, EPOLLIN | (c.out.empty() ? 0u : (uint32_t)EPOLLOUT), false);
+}
+
+static bool open_connection(Connection& c, const char* host, uint16_t port, const char* clientId) {
+    c.fd = tcp_connect(host, port);
+    if (c.fd < 0) return false;
+    c.in.clear();
+    c.out.clear();
+    c.outLimit = 64 * 1024;
+    mqtt::encode_connect(c.out, clientId, 60, clientId);
+    watch(c, EPOLLIN | EPOLLOUT, true);
+    return true;
+}
+
+static void drop_connection(Connection& c) {
+    if (c.fd >= 0) {
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, c.fd, nullptr);
+        close(c.fd);
+    }
+    c.fd = -1;
+}
+
+static void connect_sensor(size_t index) {
+    Sensor& s = sensors[index];
+    char clientId[32];
+    snprintf(clientId, sizeof(clientId), "loadgen-s%d", s.id);
+    s.connected = false;
+    if (open_connection(s.conn, opt.host, opt.port, clientId)) {
+        sensorByFd[s.conn.fd] = index;
+    } else {
+        s.reconnectAtUs = now_us() + 1000000;
+    }
+}
+
+static void disconnect_sensor(Sensor& s, uint64_t nowUs) {
+    sensorByFd.erase(s.conn.fd);
+    drop_connection(s.conn);
+    s.connected = false;
+    s.reconnectAtUs = nowUs + 1000000;
+}
+
+// --- Result parsing ---
+
+static bool json_number(const char* json, size_t len, const char* key, double& out) {
+    std::string needle = std::string("\"") + key + "\":";
+    const char* end = json + len;
+    const char* p = std::search(json, end, needle.begin(), needle.end());
+    if (p == end) return false;
+    out = strtod(p + needle.size(), nullptr);
+    return true;
+}
+
+static void count_result(int deviceId, bool empty, StepStats& st, uint64_t nowUs) {
+    st.results++;
+    if (empty) {
+        st.emptyResults++;
+        return;
+    }
+    int g = deviceId - 1;
+    if (g < 0 || g >= (int)groups.size()) return;
+    Group& grp = groups[g];
+    if (grp.pendingSinceUs == 0) return;
+    st.freshMs.push_back((nowUs - grp.lastTripletUs) / 1000.0);
+    st.oldestMs.push_back((nowUs - grp.pendingSinceUs) / 1000.0);
+    grp.pendingSinceUs = 0;
+}
+
+static void on_result(const mqtt::PublishView& pub, StepStats& st, uint64_t nowUs) {
+    st.resultBytes += pub.payloadLen;
+    if (results::is_binary(pub.payload, pub.payloadLen)) {
+        std::vector<results::Record> records;
+        if (!resultDecoder.decode(pub.payload, pub.payloadLen, records)) {
+            logWarn("GATEWAY", "Malformed binary result message (%zu bytes)", pub.payloadLen);
+        }
+        for (const results::Record& rec : records) {
+            st.trackedTargets += rec.targets.size();
+            count_result(rec.deviceId, !rec.valid || (rec.x == 0 && rec.y == 0 && rec.z == 0), st, nowUs);
+        }
+        return;
+    }
+
+    const char* json = (const char*)pub.payload;
+    double deviceId, x = 0, y = 0, z = 0;
+    if (!json_number(json, pub.payloadLen, "deviceID", deviceId)) return;
+    json_number(json, pub.payloadLen, "x", x);
+    json_number(json, pub.payloadLen, "y", y);
+    json_number(json, pub.payloadLen, "z", z);
+    const char* end = json + pub.payloadLen;
+    for (const char* p = json; (p = std::search(p, end, "\"track\"", "\"track\"" + 7)) != end; p += 7) {
+        st.trackedTargets++;
+    }
+    count_result((int)deviceId, x == 0 && y == 0 && z == 0, st, nowUs);
+}
+
+static void handle_gateway_input(StepStats& st) {
+    size_t offset = 0;
+    uint64_t nowUs = now_us();
+    for (;;) {
+        mqtt::Packet p;
+        long used = mqtt::parse_packet((const uint8_t*)gateway.in.data() + offset, gateway.in.size() - offset, p);
+        if (used <= 0) break;
+        offset += (size_t)used;
+        if (p.type == mqtt::CONNACK && !gatewayConnected) {
+            gatewayConnected = true;
+            mqtt::encode_subscribe(gateway.out, 1, opt.outputTopic);
+            logInfo("GATEWAY", "Connected, subscribing to %s", opt.outputTopic);
+        } else if (p.type == mqtt::PUBLISH) {
+            mqtt::PublishView pub;
+            if (mqtt::decode_publish(p, pub)) on_result(pub, st, nowUs);
+        }
+    }
+    gateway.in.erase(0, offset);
+}
+
+static void handle_sensor_input(Sensor& s) {
+    size_t offset = 0;
+    for (;;) {
+        mqtt::Packet p;
+        long used = mqtt::parse_packet((const uint8_t*)s.conn.in.data() + offset, s.conn.in.size() - offset, p);
+        if (used <= 0) break;
+        offset += (size_t)used;
+        if (p.type == mqtt::CONNACK) s.connected = true;
+    }
+    s.conn.in.erase(0, offset);
+}
+
+// --- Publishing ---
+
+static void publish_range(Sensor& s, StepStats& st, uint64_t nowUs) {
+    if (!s.connected) return;
+    if (s.conn.out.size() > s.conn.outLimit) {
+        st.backpressured++;
+        return;
+    }
+    char payload[64];
+    int len;
+    if (opt.targets == 2) {
+        int d0 = sensor_range(s, nowUs, 0);
+        len = snprintf(payload, sizeof(payload), "{\"id\":%d,\"d\":%d,\"c\":[%d,%d]}", s.id, d0, d0, sensor_range(s, nowUs, 1));
+    } else {
+        len = snprintf(payload, sizeof(payload), "{\"id\":%d,\"d\":%d}", s.id, sensor_range(s, nowUs));
+    }
+    bool wasEmpty = s.conn.out.empty();
+    mqtt::encode_publish(s.conn.out, opt.sensorTopic, payload, (size_t)len);
+    if (!flush_output(s.conn)) {
+        disconnect_sensor(s, nowUs);
+        return;
+    }
+    if (wasEmpty != s.conn.out.empty()) sync_interest(s.conn);
+    st.sent++;
+
+    Group& g = groups[s.group];
+    g.sentMask |= (uint8_t)(1 << s.slot);
+    if (g.sentMask == 0x07) {
+        g.sentMask = 0;
+        g.lastTripletUs = nowUs;
+        if (g.pendingSinceUs == 0) g.pendingSinceUs = nowUs;
+    }
+}
+
+// --- Reporting ---
+
+static double percentile(std::vector<double>& v, double q) {
+    if (v.empty()) return 0;
+    size_t idx = (size_t)(q * (v.size() - 1));
+    std::nth_element(v.begin(), v.begin() + idx, v.end());
+    return v[idx];
+}
+
+static void report(const char* label, double rateHz, StepStats& st, double secs) {
+    double expected = groups.size() * 1000.0 / opt.intervalMs;
+    double resultsPerS = st.results / secs;
+    char line[512];
+    snprintf(line, sizeof(line),
+             "%s rate=%.2fHz sensors=%zu sent=%.0f/s backpressured=%llu results=%.2f/s (expected %.2f/s, %.0f%%) empty=%llu "
+             "fresh_ms p50=%.1f p95=%.1f p99=%.1f max=%.1f oldest_ms p50=%.1f p99=%.1f uplink=%.0fB/s (%.1fB/result)",
+             label, rateHz, sensors.size(), st.sent / secs, (unsigned long long)st.backpressured,
+             resultsPerS, expected, expected > 0 ? 100.0 * resultsPerS / expected : 0.0,
+             (unsigned long long)st.emptyResults,
+             percentile(st.freshMs, 0.50), percentile(st.freshMs, 0.95), percentile(st.freshMs, 0.99),
+             percentile(st.freshMs, 1.0), percentile(st.oldestMs, 0.50), percentile(st.oldestMs, 0.99),
+             st.resultBytes / secs, st.results ? (double)st.resultBytes / st.results : 0.0);
+    if (opt.targets > 1) {
+        size_t used = strlen(line);
+        snprintf(line + used, sizeof(line) - used, " targets/result=%.2f",
+                 st.results ? (double)st.trackedTargets / st.results : 0.0);
+    }
+    logResult(line);
+}
+
+// --- CLI ---
+
+static void print_usage() {
+    fprintf(stderr,
+            "Usage: loadgen [options]\n"
+            "  --host <ip>            central node broker host (127.0.0.1)\n"
+            "  --port <n>             central node broker port (1886)\n"
+            "  --gateway-host <ip>    gateway broker host for OUTPUT_TOPIC (127.0.0.1)\n"
+            "  --gateway-port <n>     gateway broker port (1885)\n"
+            "  --sensor-topic <t>     SENSOR_TOPIC (/node/central)\n"
+            "  --output-topic <t>     OUTPUT_TOPIC (/central/d_gateway)\n"
+            "  --groups <n>           anchor groups, three sensors each (1)\n"
+            "  --rate <hz>            publish rate per sensor (3.33)\n"
+            "  --ramp-step <hz>       raise the rate by this much every --ramp-every seconds\n"
+            "  --ramp-every <s>       ramp step length (10)\n"
+            "  --duration <s>         total run time (30)\n"
+            "  --report <s>           report period without ramping (5)\n"
+            "  --interval-ms <ms>     AVERAGE_INTERVAL_MS of the build under test (3000)\n"
+            "  --trajectory <k>       static | circle | line | random (circle)\n"
+            "  --speed <cm/s>         target speed (50)\n"
+            "  --height <cm>          target height above the anchor plane (120)\n"
+            "  --jitter <cm>          gaussian range noise (0)\n"
+            "  --targets <1|2>        people per group; 2 adds candidate ranges (1)\n"
+            "  --anchors <a,c,b>      S2_a,S3_c,S3_b (370,0,110)\n"
+            "  --offset <cm>          DISTANCE_OFFSET (35)\n"
+            "  --seed <n>             random seed (1)\n"
+            "  --verbose\n");
+}
+
+static bool parse_args(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        const char* v = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!strcmp(a, "--verbose")) {
+            setHostLogLevel(LOG_LEVEL_VERBOSE);
+            continue;
+        }
+        if (!v) return false;
+        i++;
+        if (!strcmp(a, "--host")) opt.host = v;
+        else if (!strcmp(a, "--port")) opt.port = (uint16_t)atoi(v);
+        else if (!strcmp(a, "--gateway-host")) opt.gatewayHost = v;
+        else if (!strcmp(a, "--gateway-port")) opt.gatewayPort = (uint16_t)atoi(v);
+        else if (!strcmp(a, "--sensor-topic")) opt.sensorTopic = v;
+        else if (!strcmp(a, "--output-topic")) opt.outputTopic = v;
+        else if (!strcmp(a, "--groups")) opt.groups = atoi(v);
+        else if (!strcmp(a, "--rate")) opt.rateHz = atof(v);
+        else if (!strcmp(a, "--ramp-step")) opt.rampStepHz = atof(v);
+        else if (!strcmp(a, "--ramp-every")) opt.rampEveryS = atof(v);
+        else if (!strcmp(a, "--duration")) opt.durationS = atof(v);
+        else if (!strcmp(a, "--report")) opt.reportS = atof(v);
+        else if (!strcmp(a, "--interval-ms")) opt.intervalMs = atof(v);
+        else if (!strcmp(a, "--trajectory")) opt.trajectory = v;
+        else if (!strcmp(a, "--speed")) opt.speedCmS = atof(v);
+        else if (!strcmp(a, "--height")) opt.heightCm = atof(v);
+        else if (!strcmp(a, "--jitter")) opt.jitterCm = atof(v);
+        else if (!strcmp(a, "--targets")) opt.targets = atoi(v);
+        else if (!strcmp(a, "--anchors")) {
+            if (sscanf(v, "%f,%f,%f", &opt.S2_a, &opt.S3_c, &opt.S3_b) != 3) return false;
+        }
+        else if (!strcmp(a, "--offset")) opt.distanceOffset = (float)atof(v);
+        else if (!strcmp(a, "--seed")) opt.seed = (unsigned)atoi(v);
+        else return false;
+    }
+    if (!strcmp(opt.trajectory, "static")) trajectory = TRAJ_STATIC;
+    else if (!strcmp(opt.trajectory, "circle")) trajectory = TRAJ_CIRCLE;
+    else if (!strcmp(opt.trajectory, "line")) trajectory = TRAJ_LINE;
+    else if (!strcmp(opt.trajectory, "random")) trajectory = TRAJ_RANDOM;
+    else return false;
+    return opt.groups > 0 && opt.rateHz > 0 && opt.S2_a != 0 && opt.S3_b != 0 && (opt.targets == 1 || opt.targets == 2);
+}
+
+int main(int argc, char** argv) {
+    if (!parse_args(argc, argv)) {
+        print_usage();
+        return 1;
+    }
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    signal(SIGPIPE, SIG_IGN);
+    rng.seed(opt.seed);
+
+    epollFd = epoll_create1(0);
+    groups.resize(opt.groups);
+    std::uniform_real_distribution<double> phase(0, 2 * M_PI);
+    for (Group& g : groups) g.phase = phase(rng);
+
+    sensors.resize((size_t)opt.groups * 3);
+    for (size_t i = 0; i < sensors.size(); i++) {
+        sensors[i].id = (int)i + 1;
+        sensors[i].group = (int)i / 3;
+        sensors[i].slot = (int)i % 3;
+    }
+
+    if (!open_connection(gateway, opt.gatewayHost, opt.gatewayPort, "loadgen-monitor")) {
+        logError("GATEWAY", "Cannot reach %s:%u", opt.gatewayHost, opt.gatewayPort);
+        return 1;
+    }
+    for (size_t i = 0; i < sensors.size(); i++) connect_sensor(i);
+    logInfo("LOADGEN", "%zu sensors in %d groups -> %s:%u, results from %s:%u",
+            sensors.size(), opt.groups, opt.host, opt.port, opt.gatewayHost, opt.gatewayPort);
+
+    // Per-sensor publish schedule, staggered across one period
+    typedef std::pair<uint64_t, size_t> Due;
+    std::priority_queue<Due, std::vector<Due>, std::greater<Due>> schedule;
+    uint64_t startUs = now_us();
+    std::uniform_real_distribution<double> stagger(0, 1);
+    double rateHz = opt.rateHz;
+    for (size_t i = 0; i < sensors.size(); i++) {
+        schedule.push(Due(startUs + (uint64_t)(stagger(rng) * 1e6 / rateHz), i));
+    }
+
+    double stepS = opt.rampStepHz > 0 ? opt.rampEveryS : opt.reportS;
+    uint64_t stepStartUs = startUs;
+    uint64_t endUs = startUs + (uint64_t)(opt.durationS * 1e6);
+    uint64_t lastPingUs = startUs;
+    int stepIndex = 0;
+    StepStats st;
+    std::vector<epoll_event> events(1024);
+
+    while (running) {
+        uint64_t nowUs = now_us();
+        if (nowUs >= endUs) break;
+
+        int timeoutMs = 100;
+        if (!schedule.empty()) {
+            uint64_t due = schedule.top().first;
+            timeoutMs = due <= nowUs ? 0 : (int)std::min<uint64_t>((due - nowUs) / 1000, 100);
+        }
+        int n = epoll_wait(epollFd, events.data(), (int)events.size(), timeoutMs);
+        nowUs = now_us();
+
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+            if (fd == gateway.fd) {
+                bool alive = true;
+                if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                    alive = read_available(gateway);
+                    handle_gateway_input(st);
+                }
+                if (alive) alive = flush_output(gateway);
+                if (!alive) {
+                    logError("GATEWAY", "Connection to gateway lost. Stopping.");
+                    running = 0;
+                    break;
+                }
+                sync_interest(gateway);
+                continue;
+            }
+            auto it = sensorByFd.find(fd);
+            if (it == sensorByFd.end()) continue;
+            Sensor& s = sensors[it->second];
+            bool alive = true;
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                alive = read_available(s.conn);
+                handle_sensor_input(s);
+            }
+            if (alive) alive = flush_output(s.conn);
+            if (alive) {
+                sync_interest(s.conn);
+            } else {
+                logWarn("SENSOR", "Sensor %d lost its connection, reconnecting", s.id);
+                disconnect_sensor(s, nowUs);
+            }
+        }
+
+        while (!schedule.empty() && schedule.top().first <= nowUs) {
+            Due due = schedule.top();
+            schedule.pop();
+            publish_range(sensors[due.second], st, nowUs);
+            schedule.push(Due(due.first + (uint64_t)(1e6 / rateHz), due.second));
+        }
+
+        for (size_t i = 0; i < sensors.size(); i++) {
+            Sensor& s = sensors[i];
+            if (s.conn.fd < 0 && s.reconnectAtUs && nowUs >= s.reconnectAtUs) {
+                s.reconnectAtUs = 0;
+                connect_sensor(i);
+            }
+        }
+
+        if (nowUs - lastPingUs > 30000000ull) {
+            lastPingUs = nowUs;
+            mqtt::encode_pingreq(gateway.out);
+            sync_interest(gateway);
+        }
+
+        if (nowUs - stepStartUs >= (uint64_t)(stepS * 1e6)) {
+            char label[32];
+            snprintf(label, sizeof(label), "step=%d", stepIndex++);
+            report(label, rateHz, st, (nowUs - stepStartUs) / 1e6);
+            st = StepStats();
+            stepStartUs = nowUs;
+            if (opt.rampStepHz > 0) rateHz += opt.rampStepHz;
+        }
+    }
+
+    uint64_t nowUs = now_us();
+    if (nowUs - stepStartUs > 100000) {
+        report("final", rateHz, st, (nowUs - stepStartUs) / 1e6);
+    }
+    for (Sensor& s : sensors) drop_connection(s.conn);
+    drop_connection(gateway);
+    close(epollFd);
+    return 0;
+}
@@ -0,0 +1,268 @@
+/**
+ * Trace converter - central node CSV logs to the columnar trace format.
+ *
+ * Reads a CSV with a header naming its columns, as written by
+ * system/central_node/central_node.js ("time,d1,d2,d3,x,y,z") or by the
+ * native daemon's --csv (the same plus "deviceID"), and writes a .trk file
+ * (native/common/trace_format.h): typed int64 timestamps, d1-d3 and x/y/z as
+ * float columns, a min/max index per 4096-row block and the anchor geometry
+ * of the recording in the header. Columns the CSV lacks are written as 0;
+ * lines that do not parse are skipped and counted.
+ *
+ * With --info the argument is a trace instead: it prints the header and the
+ * per-column ranges from the block index, then times a zero-copy scan of the
+ * x/y/z columns, which is the speed analysis over the trace can reach.
+ * --from/--to limit the scan to a time window; the block index picks the
+ * blocks to read.
+ *
+ * Build (from the repository root):
+ *   g++ -std=c++17 -O2 -Inative/common native/trace_convert/trace_convert.cpp \
+ *       native/common/trace_format.cpp native/common/host_log.cpp \
+ *       -o native/bin/trace_convert
+ *
+ * Example:
+ *   native/bin/trace_convert --anchors 210,0,130 system/central_node/data/1.csv 1.trk
+ *   native/bin/trace_convert --info 1.trk
+ */
+
+#include <ctype.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "host_log.h"
+#include "trace_format.h"
+
+// --- Options ---
+struct Options {
+    const char* input = nullptr;
+    const char* output = nullptr;
+    bool info = false;
+    int64_t fromMs = INT64_MIN; // --info scan window
+    int64_t toMs = INT64_MAX;
+    trace::Geometry geometry;
+};
+
+static Options opt;
+
+static std::string field_name(const char* f) {
+    std::string s;
+    for (; *f; f++) {
+        if (*f == '"' || isspace((unsigned char)*f)) continue;
+        s += (char)tolower((unsigned char)*f);
+    }
+    return s;
+}
+
+static bool parse_float(const char* f, float& v) {
+    char* end;
+    v = strtof(f, &end);
+    if (end == f) return false;
+    while (isspace((unsigned char)*end)) end++;
+    return *end == '\0' && isfinite(v);
+}
+
+static void split_fields(char* line, std::vector<char*>& fields) {
+    fields.clear();
+    size_t len = strlen(line);
+    while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) line[--len] = '\0';
+    fields.push_back(line);
+    for (char* p = line; *p; p++) {
+        if (*p == ',') {
+            *p = '\0';
+            fields.push_back(p + 1);
+        }
+    }
+}
+
+// --- Conversion ---
+static int convert() {
+    FILE* in = fopen(opt.input, "r");
+    if (!in) {
+        logError("TRACE", "Cannot open %s", opt.input);
+        return 1;
+    }
+    // Source column of every trace column, -1 if the CSV has none
+    int source[trace::COLUMN_COUNT];
+    for (int& s : source) s = -1;
+    std::vector<char*> fields;
+    char* line = nullptr;
+    size_t cap = 0;
+    if (getline(&line, &cap, in) > 0) {
+        split_fields(line, fields);
+        for (size_t i = 0; i < fields.size(); i++) {
+            std::string name = field_name(fields[i]);
+            for (int c = 0; c < trace::COLUMN_COUNT; c++) {
+                if (name == field_name(trace::column_name(c))) source[c] = (int)i;
+            }
+        }
+    }
+    if (source[trace::COL_X] < 0 || source[trace::COL_Y] < 0) {
+        logError("TRACE", "%s: the first line must be a header naming at least x and y", opt.input);
+        free(line);
+        fclose(in);
+        return 1;
+    }
+    for (int c = 0; c < trace::COLUMN_COUNT; c++) {
+        if (source[c] < 0) logWarn("TRACE", "No %s column, writing 0.", trace::column_name(c));
+    }
+
+    trace::TraceWriter writer;
+    uint64_t skipped = 0;
+    while (getline(&line, &cap, in) > 0) {
+        split_fields(line, fields);
+        int64_t timeMs = 0;
+        float v[trace::COLUMN_COUNT] = {};
+        bool ok = true;
+        for (int c = 0; ok && c < trace::COLUMN_COUNT; c++) {
+            if (source[c] < 0) continue;
+            if ((size_t)source[c] >= fields.size()) ok = false;
+            else if (c == trace::COL_TIME) ok = trace::parse_timestamp(fields[source[c]], timeMs);
+            else ok = parse_float(fields[source[c]], v[c]);
+        }
+        if (!ok) {
+            skipped++;
+            continue;
+        }
+        writer.add(timeMs, (int32_t)v[trace::COL_DEVICE], &v[trace::COL_D1], &v[trace::COL_X]);
+    }
+    free(line);
+    fclose(in);
+
+    if (!writer.write(opt.output, opt.geometry)) {
+        logError("TRACE", "Cannot write %s", opt.output);
+        return 1;
+    }
+    logInfo("TRACE", "%s: %zu rows written to %s, %llu line(s) skipped.", opt.input, writer.rows(), opt.output,
+            (unsigned long long)skipped);
+    return 0;
+}
+
+// --- Info ---
+static std::string format_time(int64_t ms) {
+    time_t s = (time_t)(ms / 1000);
+    struct tm t;
+    gmtime_r(&s, &t);
+    char buf[32];
+    strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", &t);
+    return buf;
+}
+
+static int info() {
+    trace::TraceReader reader;
+    if (!reader.open(opt.input)) {
+        logError("TRACE", "%s: %s", opt.input, reader.error().c_str());
+        return 1;
+    }
+    const trace::Header& h = reader.header();
+    printf("%s: %llu rows in %u block(s) of %u, %llu bytes\n", opt.input, (unsigned long long)h.rows, h.blockCount,
+           h.blockRows, (unsigned long long)h.fileSize);
+    printf("anchors: S2_a=%.1f S3_c=%.1f S3_b=%.1f offset=%.1f\n", h.geometry.S2_a, h.geometry.S3_c, h.geometry.S3_b,
+           h.geometry.distanceOffset);
+    if (h.blockCount == 0) return 0;
+
+    // Ranges straight from the block index
+    trace::Block all = reader.block(0);
+    for (uint32_t b = 1; b < h.blockCount; b++) {
+        const trace::Block& k = reader.block(b);
+        all.timeMin = std::min(all.timeMin, k.timeMin);
+        all.timeMax = std::max(all.timeMax, k.timeMax);
+        all.deviceMin = std::min(all.deviceMin, k.deviceMin);
+        all.deviceMax = std::max(all.deviceMax, k.deviceMax);
+        for (int i = 0; i < 6; i++) {
+            all.min[i] = std::min(all.min[i], k.min[i]);
+            all.max[i] = std::max(all.max[i], k.max[i]);
+        }
+    }
+    printf("time: %s .. %s UTC\n", format_time(all.timeMin).c_str(), format_time(all.timeMax).c_str());
+    printf("deviceID: %d .. %d\n", all.deviceMin, all.deviceMax);
+    for (int i = 0; i < 6; i++) {
+        printf("%s: %.2f .. %.2f\n", trace::column_name(trace::COL_D1 + i), all.min[i], all.max[i]);
+    }
+
+    // Zero-copy scan of the position columns, over the blocks the window touches
+    auto start = std::chrono::steady_clock::now();
+    uint64_t first, last;
+    reader.time_range(opt.fromMs, opt.toMs, first, last);
+    const int64_t* t = reader.time();
+    const float* x = reader.values(trace::COL_X);
+    const float* y = reader.values(trace::COL_Y);
+    const float* z = reader.values(trace::COL_Z);
+    bool windowed = opt.fromMs != INT64_MIN || opt.toMs != INT64_MAX;
+    double sx = 0, sy = 0, sz = 0;
+    uint64_t n = 0;
+    for (uint64_t i = first; i < last; i++) {
+        if (windowed && (t[i] < opt.fromMs || t[i] > opt.toMs)) continue;
+        sx += x[i];
+        sy += y[i];
+        sz += z[i];
+        n++;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (n > 0) printf("mean position of %llu row(s): %.2f, %.2f, %.2f\n", (unsigned long long)n, sx / n, sy / n, sz / n);
+    else printf("no rows in the window\n");
+    printf("x/y/z scan of rows %llu..%llu: %.3f ms, %.0f MB/s\n", (unsigned long long)first, (unsigned long long)last,
+           seconds * 1e3, seconds > 0 ? (last - first) * (windowed ? 20.0 : 12.0) / seconds / 1e6 : 0.0);
+    return 0;
+}
+
+static void print_usage() {
+    fprintf(stderr,
+            "Usage: trace_convert [options] <log.csv> <out.trk>\n"
+            "       trace_convert --info <file.trk>\n"
+            "  --anchors <a,c,b>      anchor geometry of the recording: S2_a, S3_c, S3_b (370,0,110)\n"
+            "  --offset <cm>          DISTANCE_OFFSET of the recording (35)\n"
+            "  --from <time>          --info: scan from this time (\"2025-04-25 20:30:48\", UTC)\n"
+            "  --to <time>            --info: scan up to this time\n"
+            "  --verbose              more log output\n");
+}
+
+static bool parse_args(int argc, char** argv) {
+    std::vector<const char*> positional;
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        if (a[0] != '-') {
+            positional.push_back(a);
+            continue;
+        }
+        if (!strcmp(a, "--verbose")) {
+            setHostLogLevel(LOG_LEVEL_VERBOSE);
+            continue;
+        }
+        if (!strcmp(a, "--info")) {
+            opt.info = true;
+            continue;
+        }
+        const char* v = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!v) return false;
+        i++;
+        if (!strcmp(a, "--anchors")) {
+            if (sscanf(v, "%f,%f,%f", &opt.geometry.S2_a, &opt.geometry.S3_c, &opt.geometry.S3_b) != 3) return false;
+        }
+        else if (!strcmp(a, "--offset")) opt.geometry.distanceOffset = (float)atof(v);
+        else if (!strcmp(a, "--from")) {
+            if (!trace::parse_timestamp(v, opt.fromMs)) return false;
+        }
+        else if (!strcmp(a, "--to")) {
+            if (!trace::parse_timestamp(v, opt.toMs)) return false;
+        }
+        else return false;
+    }
+    if (positional.size() != (opt.info ? 1u : 2u)) return false;
+    opt.input = positional[0];
+    opt.output = opt.info ? nullptr : positional[1];
+    return true;
+}
+
+int main(int argc, char** argv) {
+    if (!parse_args(argc, argv)) {
+        print_usage();
+        return 1;
+    }
+    return opt.info ? info() : convert();
+}
@@ -0,0 +1,403 @@
+/**
+ * Track simplifier - drops the fixes of stored tracks that a line through
+ * their neighbours already describes.
+ *
+ * Reads every log it is given (files, or directories searched recursively
+ * for *.csv), splits each into one track per deviceID and keeps only the
+ * fixes needed to stay within --tolerance cm of every fix it drops:
+ *   window   (default) opening window, a streaming Douglas-Peucker: a fix is
+ *            dropped while the segment from the last kept fix to the newest
+ *            one passes within the tolerance of every fix in between. When
+ *            it no longer does, or --window fixes are pending, the fix before
+ *            the newest is kept. Joining the kept fixes with straight lines
+ *            reproduces every dropped one within the tolerance
+ *   reckon   the central node's rule for its results (track_simplify.h): a
+ *            fix is kept when it is more than the tolerance from the
+ *            extrapolation of the last two kept ones, or --max-gap fixes after
+ *            the last one. Rows stand in for the result intervals
+ * Fixes are 3D where the log has a z column. --average n first replaces each
+ * fix by the mean of it and the n - 1 before it of the same device, the
+ * smoothing the central node's averaging interval gives its results.
+ *
+ * Recognised layouts, decided from the first line: a header naming x and y
+ * (z and deviceID are used when present), e.g. the central node's
+ * "time,d1,d2,d3,x,y,z" logs; or no header, with x,y,z first or after a
+ * timestamp (server0 logs). One summary line per file goes to stdout:
+ * path,tracks,fixes,kept,kept_pct,max_error_cm. With --out-dir the kept rows
+ * are written there under the file's name, unchanged and in their original
+ * order, after the header; with --average their x, y and z are the means.
+ *
+ * Build (from the repository root):
+ *   g++ -std=c++17 -O2 -Inative/common native/track_simplify/track_simplify.cpp native/common/host_log.cpp \
+ *       -o native/bin/track_simplify
+ *
+ * Example:
+ *   native/bin/track_simplify --tolerance 15 --average 5 --out-dir simplified system/central_node/data
+ */
+
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "host_log.h"
+
+namespace fs = std::filesystem;
+
+// --- Options ---
+struct Options {
+    double toleranceCm = 10;
+    bool reckon = false;
+    size_t window = 64;   // window: most fixes pending before one is kept
+    size_t maxGap = 10;   // reckon: most fixes between kept ones
+    int average = 1;
+    const char* outDir = nullptr;
+    std::vector<std::string> inputs;
+};
+
+static Options opt;
+
+struct Fix {
+    size_t row; // Line index in the file
+    double p[3];
+};
+
+struct Stats {
+    size_t fixes = 0;
+    size_t kept = 0;
+    double maxErrorCm = 0;
+};
+
+static double distance(const double* a, const double* b) {
+    double dx = a[0] - b[0], dy = a[1] - b[1], dz = a[2] - b[2];
+    return sqrt(dx * dx + dy * dy + dz * dz);
+}
+
+// Distance of p from the segment a-b
+static double segment_distance(const double* p, const double* a, const double* b) {
+    double ab[3], ap[3];
+    double len = 0, dot = 0;
+    for (int i = 0; i < 3; i++) {
+        ab[i] = b[i] - a[i];
+        ap[i] = p[i] - a[i];
+        len += ab[i] * ab[i];
+        dot += ab[i] * ap[i];
+    }
+    double t = len > 0 ? std::min(1.0, std::max(0.0, dot / len)) : 0;
+    double q[3] = { a[0] + t * ab[0], a[1] + t * ab[1], a[2] + t * ab[2] };
+    return distance(p, q);
+}
+
+// --- Simplifiers ---
+// One per track; keep() marks the rows to write
+struct Track {
+    std::vector<Fix> pending;   // window: fixes since the last kept one
+    Fix kept[2];                // Last two kept, newest first
+    size_t keptCount = 0;
+    size_t sinceKept = 0;       // reckon
+    std::vector<double> recent; // --average: the last fixes, 3 per fix
+};
+
+static void keep(Track& t, const Fix& f, std::vector<bool>& rows, std::vector<Fix>& values, Stats& stats) {
+    rows[f.row] = true;
+    values.push_back(f);
+    stats.kept++;
+    t.kept[1] = t.kept[0];
+    t.kept[0] = f;
+    if (t.keptCount < 2) t.keptCount++;
+    t.sinceKept = 0;
+}
+
+static void push_window(Track& t, const Fix& f, std::vector<bool>& rows, std::vector<Fix>& values, Stats& stats) {
+    if (t.keptCount == 0) {
+        keep(t, f, rows, values, stats);
+        return;
+    }
+    bool covered = t.pending.size() < opt.window;
+    double worst = 0;
+    for (size_t i = 0; covered && i < t.pending.size(); i++) {
+        worst = std::max(worst, segment_distance(t.pending[i].p, t.kept[0].p, f.p));
+        covered = worst <= opt.toleranceCm;
+    }
+    if (covered) {
+        t.pending.push_back(f);
+        return;
+    }
+    // The newest pending fix ends the segment; those before it are within the tolerance of it
+    Fix vertex = t.pending.back();
+    for (size_t i = 0; i + 1 < t.pending.size(); i++) {
+        stats.maxErrorCm = std::max(stats.maxErrorCm, segment_distance(t.pending[i].p, t.kept[0].p, vertex.p));
+    }
+    keep(t, vertex, rows, values, stats);
+    t.pending.clear();
+    t.pending.push_back(f);
+}
+
+static void finish_window(Track& t, std::vector<bool>& rows, std::vector<Fix>& values, Stats& stats) {
+    if (t.pending.empty()) return;
+    Fix last = t.pending.back();
+    for (size_t i = 0; i + 1 < t.pending.size(); i++) {
+        stats.maxErrorCm = std::max(stats.maxErrorCm, segment_distance(t.pending[i].p, t.kept[0].p, last.p));
+    }
+    keep(t, last, rows, values, stats);
+    t.pending.clear();
+}
+
+static void push_reckon(Track& t, const Fix& f, std::vector<bool>& rows, std::vector<Fix>& values, Stats& stats) {
+    t.sinceKept++;
+    if (t.keptCount > 0 && t.sinceKept < opt.maxGap) {
+        // Rows since the newest kept fix, over rows between the two kept ones
+        double k = 0;
+        if (t.keptCount == 2) k = (double)t.sinceKept / (double)(t.kept[0].row - t.kept[1].row);
+        double predicted[3];
+        for (int i = 0; i < 3; i++) predicted[i] = t.kept[0].p[i] + (t.kept[0].p[i] - t.kept[1].p[i]) * k;
+        double err = distance(f.p, predicted);
+        if (err <= opt.toleranceCm) {
+            stats.maxErrorCm = std::max(stats.maxErrorCm, err);
+            return;
+        }
+    }
+    keep(t, f, rows, values, stats);
+}
+
+// --- Files ---
+struct Layout {
+    int x = -1, y = -1, z = -1, device = -1;
+    bool header = false;
+};
+
+static std::string field_name(const char* f) {
+    std::string s;
+    for (; *f; f++) {
+        if (*f == '"' || *f == '\'' || isspace((unsigned char)*f)) continue;
+        s += (char)tolower((unsigned char)*f);
+    }
+    return s;
+}
+
+static bool parse_number(const char* f, double& v) {
+    while (isspace((unsigned char)*f)) f++;
+    char* end;
+    v = strtod(f, &end);
+    if (end == f) return false;
+    while (isspace((unsigned char)*end)) end++;
+    return *end == '\0' && isfinite(v);
+}
+
+// Field boundaries of a line, without its line ending; no quoted commas occur in these logs
+static void split_fields(const std::string& line, std::vector<std::string>& fields) {
+    fields.clear();
+    size_t end = line.find_last_not_of("\r\n");
+    std::string s = end == std::string::npos ? std::string() : line.substr(0, end + 1);
+    size_t start = 0;
+    for (size_t comma; (comma = s.find(',', start)) != std::string::npos; start = comma + 1) {
+        fields.push_back(s.substr(start, comma - start));
+    }
+    fields.push_back(s.substr(start));
+}
+
+static Layout detect_layout(const std::vector<std::string>& fields) {
+    Layout l;
+    std::vector<std::string> names;
+    for (const std::string& f : fields) names.push_back(field_name(f.c_str()));
+    auto column = [&](std::initializer_list<const char*> wanted) {
+        for (const char* w : wanted) {
+            auto it = std::find(names.begin(), names.end(), w);
+            if (it != names.end()) return (int)(it - names.begin());
+        }
+        return -1;
+    };
+    l.x = column({ "x", "x_mean" });
+    l.y = column({ "y", "y_mean" });
+    if (l.x >= 0 && l.y >= 0) {
+        l.header = true;
+        l.z = column({ "z", "z_mean" });
+        l.device = column({ "deviceid", "device" });
+        return l;
+    }
+    double v;
+    int first = !fields.empty() && !parse_number(fields[0].c_str(), v) ? 1 : 0;
+    l.x = first;
+    l.y = first + 1;
+    l.z = (int)fields.size() > first + 2 ? first + 2 : -1;
+    return l;
+}
+
+static bool process_file(const std::string& path) {
+    FILE* in = fopen(path.c_str(), "r");
+    if (!in) {
+        logError("SIMPLIFY", "Cannot open %s", path.c_str());
+        return false;
+    }
+    std::vector<std::string> lines;
+    char* buf = nullptr;
+    size_t cap = 0;
+    while (getline(&buf, &cap, in) > 0) lines.push_back(buf);
+    free(buf);
+    fclose(in);
+
+    std::vector<bool> rows(lines.size(), false);
+    std::vector<Fix> values; // Kept fixes, for --average output
+    std::unordered_map<std::string, Track> tracks;
+    std::vector<std::string> fields;
+    Layout layout;
+    Stats stats;
+    size_t skipped = 0;
+    for (size_t i = 0; i < lines.size(); i++) {
+        split_fields(lines[i], fields);
+        if (i == 0) {
+            layout = detect_layout(fields);
+            if (layout.header) {
+                rows[0] = true;
+                continue;
+            }
+        }
+        int needed = std::max({ layout.x, layout.y, layout.z, layout.device });
+        Fix f = { i, { 0, 0, 0 } };
+        if ((int)fields.size() <= needed || !parse_number(fields[layout.x].c_str(), f.p[0]) ||
+            !parse_number(fields[layout.y].c_str(), f.p[1]) ||
+            (layout.z >= 0 && !parse_number(fields[layout.z].c_str(), f.p[2]))) {
+            skipped++;
+            continue;
+        }
+        Track& t = tracks[layout.device >= 0 ? field_name(fields[layout.device].c_str()) : std::string()];
+        if (opt.average > 1) {
+            t.recent.insert(t.recent.end(), f.p, f.p + 3);
+            if (t.recent.size() > 3 * (size_t)opt.average) t.recent.erase(t.recent.begin(), t.recent.begin() + 3);
+            size_t n = t.recent.size() / 3;
+            for (int k = 0; k < 3; k++) {
+                double sum = 0;
+                for (size_t j = 0; j < n; j++) sum += t.recent[3 * j + k];
+                f.p[k] = sum / n;
+            }
+        }
+        stats.fixes++;
+        if (opt.reckon) push_reckon(t, f, rows, values, stats);
+        else push_window(t, f, rows, values, stats);
+    }
+    if (!opt.reckon) {
+        for (auto& entry : tracks) finish_window(entry.second, rows, values, stats);
+    }
+
+    printf("%s,%zu,%zu,%zu,%.1f,%.2f\n", path.c_str(), tracks.size(), stats.fixes, stats.kept,
+           stats.fixes ? 100.0 * stats.kept / stats.fixes : 0.0, stats.maxErrorCm);
+    if (skipped > 0) logVerbose("SIMPLIFY", "%s: %zu line(s) skipped", path.c_str(), skipped);
+    if (!opt.outDir) return true;
+
+    std::string outPath = (fs::path(opt.outDir) / fs::path(path).filename()).string();
+    FILE* out = fopen(outPath.c_str(), "w");
+    if (!out) {
+        logError("SIMPLIFY", "Cannot write %s", outPath.c_str());
+        return false;
+    }
+    std::unordered_map<size_t, const Fix*> averaged;
+    if (opt.average > 1) {
+        for (const Fix& f : values) averaged[f.row] = &f;
+    }
+    for (size_t i = 0; i < lines.size(); i++) {
+        if (!rows[i]) continue;
+        auto it = averaged.find(i);
+        if (it == averaged.end()) {
+            fputs(lines[i].c_str(), out);
+            continue;
+        }
+        split_fields(lines[i], fields);
+        char v[32];
+        const int cols[3] = { layout.x, layout.y, layout.z };
+        for (int k = 0; k < 3; k++) {
+            if (cols[k] < 0) continue;
+            snprintf(v, sizeof(v), "%.2f", it->second->p[k]);
+            fields[cols[k]] = v;
+        }
+        for (size_t c = 0; c < fields.size(); c++) fprintf(out, c ? ",%s" : "%s", fields[c].c_str());
+        fputc('\n', out);
+    }
+    fclose(out);
+    return true;
+}
+
+static bool collect_inputs(std::vector<std::string>& files) {
+    for (const std::string& input : opt.inputs) {
+        std::error_code ec;
+        if (fs::is_directory(input, ec)) {
+            std::vector<std::string> found;
+            for (auto it = fs::recursive_directory_iterator(input, ec); !ec && it != fs::recursive_directory_iterator();
+                 it.increment(ec)) {
+                if (it->is_regular_file(ec) && it->path().extension() == ".csv") found.push_back(it->path().string());
+            }
+            std::sort(found.begin(), found.end());
+            files.insert(files.end(), found.begin(), found.end());
+        } else if (fs::is_regular_file(input, ec)) {
+            files.push_back(input);
+        } else {
+            logError("SIMPLIFY", "%s is neither a file nor a directory", input.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+static void print_usage() {
+    fprintf(stderr,
+            "Usage: track_simplify [options] <file.csv|dir> [...]\n"
+            "  --tolerance <cm>       largest distance of a dropped fix from the kept track (10)\n"
+            "  --method <m>           window (stored tracks) or reckon (the central node's rule) (window)\n"
+            "  --window <n>           window: most fixes pending before one is kept (64)\n"
+            "  --max-gap <n>          reckon: most fixes between kept ones (10)\n"
+            "  --average <n>          mean of each fix and the n - 1 before it of its device first (1)\n"
+            "  --out-dir <dir>        write the kept rows of each file here\n"
+            "  --verbose              more log output\n");
+}
+
+static bool parse_args(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        if (a[0] != '-') {
+            opt.inputs.push_back(a);
+            continue;
+        }
+        if (!strcmp(a, "--verbose")) {
+            setHostLogLevel(LOG_LEVEL_VERBOSE);
+            continue;
+        }
+        const char* v = i + 1 < argc ? argv[++i] : nullptr;
+        if (!v) return false;
+        if (!strcmp(a, "--tolerance")) opt.toleranceCm = atof(v);
+        else if (!strcmp(a, "--method")) {
+            if (strcmp(v, "window") && strcmp(v, "reckon")) return false;
+            opt.reckon = !strcmp(v, "reckon");
+        }
+        else if (!strcmp(a, "--window")) opt.window = (size_t)atoll(v);
+        else if (!strcmp(a, "--max-gap")) opt.maxGap = (size_t)atoll(v);
+        else if (!strcmp(a, "--average")) opt.average = atoi(v);
+        else if (!strcmp(a, "--out-dir")) opt.outDir = v;
+        else return false;
+    }
+    return !opt.inputs.empty() && opt.toleranceCm > 0 && opt.window > 0 && opt.maxGap > 0 && opt.average >= 1;
+}
+
+int main(int argc, char** argv) {
+    if (!parse_args(argc, argv)) {
+        print_usage();
+        return 1;
+    }
+    std::vector<std::string> files;
+    if (!collect_inputs(files)) return 1;
+    if (files.empty()) {
+        logError("SIMPLIFY", "No CSV files found.");
+        return 1;
+    }
+    if (opt.outDir) {
+        std::error_code ec;
+        fs::create_directories(opt.outDir, ec);
+    }
+    printf("path,tracks,fixes,kept,kept_pct,max_error_cm\n");
+    size_t failed = 0;
+    for (const std::string& path : files) failed += process_file(path) ? 0 : 1;
+    return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,238 @@
+/**
+ * Trilateration benchmark and bulk re-solver.
+ *
+ * Benchmark (default): draws --fixes random positions in a room around the
+ * anchors, turns them into raw ranges the way a sensor would report them
+ * (true range minus the offset, plus --noise cm of Gaussian noise, which makes
+ * some fixes invalid as in real logs) and solves them three ways:
+ *   scalar    one solve_scalar() call per fix, the firmware's solve_fix() math
+ *   portable  solve_batch_portable(), the plain loop as the compiler vectorises it
+ *   batch     solve_batch(), AVX2 where the CPU has it
+ * It reports fixes per second for each, and how far the batch results are
+ * from the scalar ones (valid verdicts that differ, largest coordinate error).
+ *
+ * Re-solve (--trace): reads the d1/d2/d3 columns of a .trk trace in place,
+ * solves them with the anchors and offset given here instead of those of the
+ * recording, and writes the valid fixes with their time and deviceID to
+ * --out as a new trace. This is the job after a change of DISTANCE_OFFSET or
+ * the anchor geometry.
+ *
+ * Build (from the repository root):
+ *   g++ -std=c++17 -O3 -fno-math-errno -fno-trapping-math -Inative/common \
+ *       native/trilat_bench/trilat_bench.cpp native/common/trilat_batch.cpp native/common/trace_format.cpp native/common/host_log.cpp \
+ *       -o native/bin/trilat_bench
+ *
+ * Example:
+ *   native/bin/trilat_bench --fixes 4000000 --repeat 10
+ *   native/bin/trilat_bench --trace 1.trk --offset 30 --out 1-offset30.trk
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "host_log.h"
+#include "trace_format.h"
+#include "trilat_batch.h"
+
+// --- Options ---
+struct Options {
+    size_t fixes = 1 << 20;
+    int repeat = 5;
+    double noiseCm = 5;
+    unsigned seed = 1;
+    trilat::Anchors anchors;
+    bool anchorsSet = false; // --trace: take the recording's anchors unless given
+    bool offsetSet = false;
+    const char* tracePath = nullptr;
+    const char* outPath = nullptr;
+};
+
+static Options opt;
+
+struct Columns {
+    std::vector<float> x, y, z;
+    std::vector<uint8_t> valid;
+    explicit Columns(size_t n) : x(n), y(n), z(n), valid(n) {}
+};
+
+static double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Best of --repeat runs, in fixes per second
+template <typename Solve>
+static double time_runs(size_t n, Solve solve) {
+    double best = 0;
+    for (int r = 0; r < opt.repeat; r++) {
+        auto start = std::chrono::steady_clock::now();
+        solve();
+        double s = seconds_since(start);
+        if (s > 0 && n / s > best) best = n / s;
+    }
+    return best;
+}
+
+static void compare(const char* name, const Columns& ref, const Columns& got, size_t n) {
+    size_t verdicts = 0;
+    double maxErr = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (ref.valid[i] != got.valid[i]) {
+            verdicts++;
+            continue;
+        }
+        if (!ref.valid[i]) continue;
+        maxErr = fmax(maxErr, fabs(ref.x[i] - got.x[i]));
+        maxErr = fmax(maxErr, fabs(ref.y[i] - got.y[i]));
+        maxErr = fmax(maxErr, fabs(ref.z[i] - got.z[i]));
+    }
+    printf("%-9s vs scalar: %zu verdict(s) differ, max coordinate difference %.5f cm\n", name, verdicts, maxErr);
+}
+
+static int benchmark() {
+    size_t n = opt.fixes;
+    const trilat::Anchors& k = opt.anchors;
+    std::mt19937 rng(opt.seed);
+    std::uniform_real_distribution<float> ux(0, k.S2_a), uy(0, k.S3_b * 3), uz(20, 250);
+    std::normal_distribution<float> noise(0, (float)opt.noiseCm);
+    std::vector<float> d1(n), d2(n), d3(n);
+    for (size_t i = 0; i < n; i++) {
+        float x = ux(rng), y = uy(rng), z = uz(rng);
+        d1[i] = sqrtf(x * x + y * y + z * z) - k.distanceOffset + noise(rng);
+        d2[i] = sqrtf((x - k.S2_a) * (x - k.S2_a) + y * y + z * z) - k.distanceOffset + noise(rng);
+        d3[i] = sqrtf((x - k.S3_c) * (x - k.S3_c) + (y - k.S3_b) * (y - k.S3_b) + z * z) - k.distanceOffset +
+                noise(rng);
+    }
+
+    Columns scalar(n), portable(n), batch(n);
+    size_t validCount = 0;
+    double scalarRate = time_runs(n, [&]() {
+        validCount = 0;
+        for (size_t i = 0; i < n; i++) {
+            bool ok = trilat::solve_scalar(k, d1[i], d2[i], d3[i], scalar.x[i], scalar.y[i], scalar.z[i]);
+            scalar.valid[i] = ok;
+            validCount += ok;
+        }
+    });
+    double portableRate = time_runs(n, [&]() {
+        trilat::solve_batch_portable(k, d1.data(), d2.data(), d3.data(), n, portable.x.data(), portable.y.data(),
+                                     portable.z.data(), portable.valid.data());
+    });
+    double batchRate = time_runs(n, [&]() {
+        trilat::solve_batch(k, d1.data(), d2.data(), d3.data(), n, batch.x.data(), batch.y.data(), batch.z.data(),
+                            batch.valid.data());
+    });
+
+    printf("%zu fixes (%.1f%% valid), anchors a=%.1f c=%.1f b=%.1f, offset %.1f, best of %d\n", n,
+           100.0 * validCount / n, k.S2_a, k.S3_c, k.S3_b, k.distanceOffset, opt.repeat);
+    printf("scalar    %10.1f M fixes/s\n", scalarRate / 1e6);
+    printf("portable  %10.1f M fixes/s  %.1fx\n", portableRate / 1e6, portableRate / scalarRate);
+    printf("batch     %10.1f M fixes/s  %.1fx (%s)\n", batchRate / 1e6, batchRate / scalarRate, trilat::batch_kernel());
+    compare("portable", scalar, portable, n);
+    compare("batch", scalar, batch, n);
+    return 0;
+}
+
+static int resolve_trace() {
+    trace::TraceReader reader;
+    if (!reader.open(opt.tracePath)) {
+        logError("TRILAT", "%s: %s", opt.tracePath, reader.error().c_str());
+        return 1;
+    }
+    const trace::Geometry& g = reader.header().geometry;
+    trilat::Anchors k = opt.anchors;
+    if (!opt.anchorsSet) {
+        k.S2_a = g.S2_a;
+        k.S3_c = g.S3_c;
+        k.S3_b = g.S3_b;
+    }
+    if (!opt.offsetSet) k.distanceOffset = g.distanceOffset;
+
+    size_t n = (size_t)reader.rows();
+    Columns out(n);
+    auto start = std::chrono::steady_clock::now();
+    size_t valid = trilat::solve_batch(k, reader.values(trace::COL_D1), reader.values(trace::COL_D2),
+                                       reader.values(trace::COL_D3), n, out.x.data(), out.y.data(), out.z.data(),
+                                       out.valid.data());
+    double seconds = seconds_since(start);
+    logInfo("TRILAT", "%zu of %zu fixes valid with a=%.1f c=%.1f b=%.1f offset %.1f (was %.1f), %.2f ms.", valid, n,
+            k.S2_a, k.S3_c, k.S3_b, k.distanceOffset, g.distanceOffset, seconds * 1e3);
+    if (!opt.outPath) return 0;
+
+    trace::TraceWriter writer;
+    const int64_t* t = reader.time();
+    const int32_t* device = reader.device();
+    const float* d[3] = { reader.values(trace::COL_D1), reader.values(trace::COL_D2), reader.values(trace::COL_D3) };
+    for (size_t i = 0; i < n; i++) {
+        if (!out.valid[i]) continue;
+        const float ranges[3] = { d[0][i], d[1][i], d[2][i] };
+        const float xyz[3] = { out.x[i], out.y[i], out.z[i] };
+        writer.add(t[i], device[i], ranges, xyz);
+    }
+    trace::Geometry geometry;
+    geometry.S2_a = k.S2_a;
+    geometry.S3_c = k.S3_c;
+    geometry.S3_b = k.S3_b;
+    geometry.distanceOffset = k.distanceOffset;
+    if (!writer.write(opt.outPath, geometry)) {
+        logError("TRILAT", "Cannot write %s", opt.outPath);
+        return 1;
+    }
+    logInfo("TRILAT", "%zu fixes written to %s.", writer.rows(), opt.outPath);
+    return 0;
+}
+
+static void print_usage() {
+    fprintf(stderr,
+            "Usage: trilat_bench [options]\n"
+            "  --fixes <n>            benchmark: fixes per run (1048576)\n"
+            "  --repeat <n>           benchmark: runs per kernel, the best counts (5)\n"
+            "  --noise <cm>           benchmark: range noise (5)\n"
+            "  --seed <n>             benchmark: random seed (1)\n"
+            "  --anchors <a,c,b>      S2_a, S3_c, S3_b (370,0,110; --trace: the recording's)\n"
+            "  --offset <cm>          DISTANCE_OFFSET (35; --trace: the recording's)\n"
+            "  --trace <file.trk>     re-solve the ranges of a trace instead of benchmarking\n"
+            "  --out <file.trk>       --trace: write the valid re-solved fixes here\n"
+            "  --verbose              more log output\n");
+}
+
+static bool parse_args(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        const char* v = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!strcmp(a, "--verbose")) {
+            setHostLogLevel(LOG_LEVEL_VERBOSE);
+            continue;
+        }
+        if (!v) return false;
+        i++;
+        if (!strcmp(a, "--fixes")) opt.fixes = (size_t)atoll(v);
+        else if (!strcmp(a, "--repeat")) opt.repeat = atoi(v);
+        else if (!strcmp(a, "--noise")) opt.noiseCm = atof(v);
+        else if (!strcmp(a, "--seed")) opt.seed = (unsigned)atoi(v);
+        else if (!strcmp(a, "--anchors")) {
+            if (sscanf(v, "%f,%f,%f", &opt.anchors.S2_a, &opt.anchors.S3_c, &opt.anchors.S3_b) != 3) return false;
+            opt.anchorsSet = true;
+        }
+        else if (!strcmp(a, "--offset")) {
+            opt.anchors.distanceOffset = (float)atof(v);
+            opt.offsetSet = true;
+        }
+        else if (!strcmp(a, "--trace")) opt.tracePath = v;
+        else if (!strcmp(a, "--out")) opt.outPath = v;
+        else return false;
+    }
+    return opt.fixes > 0 && opt.repeat > 0 && opt.anchors.S2_a != 0 && opt.anchors.S3_b != 0 &&
+           (opt.outPath == nullptr || opt.tracePath != nullptr);
+}
+
+int main(int argc, char** argv) {
+    if (!parse_args(argc, argv)) {
+        print_usage();
+        return 1;
+    }
+    return opt.tracePath ? resolve_trace() : benchmark();
+}